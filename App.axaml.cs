@@ -213,8 +213,12 @@ namespace FaceLocker
                 // 预初始化摄像头服务
                 await InitializeCameraServiceAsync();
 
-                // GStreamer 摄像头服务不需要预初始化，因为已经是 Singleton
+                // 预启动 GStreamer 管道（打开设备、协商格式），点击存件/取件后只需进入 PLAYING
                 var cameraService = _serviceProvider.GetRequiredService<ICameraService>();
+                if (cameraService is INativeVideoCameraService nativeService && cameraService.IsCameraAvailable)
+                {
+                    await nativeService.PrewarmAsync();
+                }
                 logger.LogInformation("GStreamer 摄像头服务准备就绪，类型: {CameraServiceType}", cameraService.GetType().Name);
 
                 logger.LogInformation("关键服务预初始化完成");
@@ -30,6 +30,41 @@
         /// </summary>
         public bool AutoDetectCameras { get; set; } = true;
 
+        /// <summary>
+        /// 是否启用事件录像（硬件编码，开锁时保存前后片段）
+        /// </summary>
+        public bool EventRecordingEnabled { get; set; } = false;
+
+        /// <summary>
+        /// 事件录像预录时长（毫秒）
+        /// </summary>
+        public int EventRecordPreMs { get; set; } = 5000;
+
+        /// <summary>
+        /// GStreamer 流线程 SCHED_FIFO 优先级（0 表示普通调度，需要 CAP_SYS_NICE）
+        /// </summary>
+        public int StreamingThreadPriority { get; set; } = 0;
+
+        /// <summary>
+        /// GStreamer 流线程绑定的 CPU 核心位掩码（0 表示不绑定）
+        /// </summary>
+        public uint StreamingCpuMask { get; set; } = 0;
+
+        /// <summary>
+        /// 是否锁定播放器热点内存（mlock，受 RLIMIT_MEMLOCK 限制）
+        /// </summary>
+        public bool LockMemory { get; set; } = false;
+
+        /// <summary>
+        /// 是否以拉取模式获取检测帧（原生端写入预先固定的缓冲区，后台线程按检测节奏拉取，不再每帧回调托管代码）
+        /// </summary>
+        public bool NativeFramePull { get; set; } = true;
+
+        /// <summary>
+        /// 是否按 CPU 负载自动调整人脸检测帧率和尺寸（负载高时降档保证识别延迟，空闲时升档）
+        /// </summary>
+        public bool AdaptiveDetect { get; set; } = true;
+
 
         public CameraSettings()
         {
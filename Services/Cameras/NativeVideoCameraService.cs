@@ -30,9 +30,20 @@ namespace FaceLocker.Services
         #region Native Interop
         private const string LibraryName = "gst_video_player";
 
-        // 帧回调委托（人脸识别用）
+        // 检测帧的帧号和时间（与 gst_player_frame_info_t 对应，CLOCK_MONOTONIC 微秒，0 表示未知）
+        [StructLayout(LayoutKind.Sequential)]
+        private struct GstPlayerFrameInfo
+        {
+            public ulong frame_id;
+            public long capture_us;
+            public long decode_us;
+            public long deliver_us;
+        }
+
+        // 帧回调委托（人脸识别用，附帧号和时间）
         [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-        private delegate void GstFrameCallback(IntPtr userData, IntPtr data, int width, int height, int stride);
+        private delegate void GstFrameCallback(IntPtr userData, IntPtr data, int width, int height, int stride,
+            ref GstPlayerFrameInfo info);
 
         // 视频格式枚举
         private enum GstPlayerFormat
@@ -42,6 +53,23 @@ namespace FaceLocker.Services
             NV12 = 2
         }
 
+        // 显示路径枚举
+        private enum GstPlayerDisplayMode
+        {
+            Auto = 0,   // 有 glimagesink 时走 GL 硬件路径
+            Cairo = 1,  // 软件 cairooverlay 路径
+            GL = 2      // mppjpegdec → glimagesink，GPU 合成人脸框
+        }
+
+        // 线程调度配置，对应 camera_thread_config_t
+        [StructLayout(LayoutKind.Sequential)]
+        private struct CameraThreadConfig
+        {
+            public int policy;      // 0=继承/普通调度，1=SCHED_FIFO，2=SCHED_RR
+            public int priority;    // RT 优先级（0 表示默认 40）
+            public uint cpu_mask;   // CPU 核心位掩码（0 表示不绑定）
+        }
+
         // 配置结构体
         [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
         private struct GstPlayerConfig
@@ -58,6 +86,48 @@ namespace FaceLocker.Services
             public int face_detect_fps;
             public int face_detect_width;
             public int face_detect_height;
+            public GstPlayerDisplayMode display_mode;
+            public IntPtr shared_camera;    // camera_handle_t，IntPtr.Zero 表示由 GStreamer 自行采集
+            public int face_detect_format;  // 0=BGRA（托管回调使用），1=NV12（仅零拷贝回调）
+            public int detect_workers;      // >0 时帧回调在原生工作线程中执行，GStreamer 流线程只投递最新帧
+            public uint detect_cpu_mask;    // 工作线程绑定的 CPU 核心位掩码（0 表示不绑定）
+            public int idle_width;          // 低功耗空闲模式分辨率/帧率（0 表示默认 320x240@5fps）
+            public int idle_height;
+            public int idle_fps;
+            [MarshalAs(UnmanagedType.I1)]
+            public bool motion_gate;        // 画面静止时不交付检测帧（只按心跳间隔交付）
+            public int motion_threshold;    // 以下阈值 0 表示默认值：格子亮度变化 12
+            public int motion_area_permille; // 变化格子占比 20‰
+            public int motion_heartbeat_ms; // 静止时交付间隔 1000ms（<0 表示不交付）
+            public int motion_hold_ms;      // 运动或有人脸后持续交付 1500ms
+            public int max_face_boxes;      // 最多显示的人脸框数（0 表示默认 10）
+            public int face_box_predict_ms; // 检测间隔内按速度外推人脸框的最长时间（0 表示不外推）
+            public int record_pre_ms;       // 事件录像预录时长（0 表示不创建录像分支）
+            public int record_codec;        // 0=H.264（mpph264enc），1=H.265（mpph265enc）
+            public int record_bitrate_kbps; // 录像码率（0 表示默认 2000）
+            public CameraThreadConfig streaming_thread; // GStreamer 流线程调度（普通调度且不绑核时不替换任务池）
+            [MarshalAs(UnmanagedType.I1)]
+            public bool lock_memory;        // mlock 播放器热点内存
+            [MarshalAs(UnmanagedType.I1)]
+            public bool adaptive_detect;    // 按负载在上下限之间调整检测帧率和尺寸（face_detect_* 为上限）
+            public int detect_min_fps;      // 帧率下限（0 表示默认 2）
+            public int detect_min_width;    // 宽度下限，高度按比例（0 表示上限的一半）
+            public int detect_budget_ms;    // 回调执行时间预算（0 表示默认 300）
+        }
+
+        // 工作模式
+        private enum GstPlayerMode
+        {
+            Active = 0, // 正常分辨率/帧率，检测开启
+            Idle = 1    // 低分辨率/低帧率，检测暂停
+        }
+
+        // 管道分支
+        private enum GstPlayerBranch
+        {
+            Display = 0,
+            Detect = 1,
+            Record = 2
         }
 
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
@@ -73,7 +143,7 @@ namespace FaceLocker.Services
         private static extern int gst_player_set_window(IntPtr handle, ulong x11_window_id);
 
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
-        private static extern int gst_player_set_frame_callback(IntPtr handle, GstFrameCallback callback, IntPtr userData);
+        private static extern int gst_player_set_frame_info_callback(IntPtr handle, GstFrameCallback callback, IntPtr userData);
 
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
         private static extern int gst_player_start(IntPtr handle);
@@ -81,16 +151,72 @@ namespace FaceLocker.Services
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
         private static extern int gst_player_stop(IntPtr handle);
 
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_preroll(IntPtr handle);
+
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
         [return: MarshalAs(UnmanagedType.I1)]
         private static extern bool gst_player_is_playing(IntPtr handle);
 
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_reconfigure(IntPtr handle, int width, int height, int fps);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_set_mode(IntPtr handle, GstPlayerMode mode);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_set_branch_enabled(IntPtr handle, GstPlayerBranch branch, [MarshalAs(UnmanagedType.I1)] bool enabled);
+
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
         private static extern IntPtr gst_player_get_error_string(int error);
 
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
         private static extern void gst_player_get_stats(IntPtr handle, out float fps, out int dropped_frames);
 
+        // 延迟摘要（微秒），对应 latency_summary_t
+        [StructLayout(LayoutKind.Sequential)]
+        public struct GstLatencySummary
+        {
+            public ulong count;
+            public uint min_us;
+            public uint avg_us;
+            public uint p95_us;
+            public uint max_us;
+        }
+
+        // 详细性能统计，对应 gst_player_perf_stats_t
+        [StructLayout(LayoutKind.Sequential)]
+        public struct GstPlayerPerfStats
+        {
+            public float fps;
+            public ulong frames_displayed;
+            public ulong frames_detected;
+            public ulong display_queue_drops;
+            public ulong detect_queue_drops;
+            public ulong sink_dropped;
+            public ulong sequence_gaps;
+            public ulong frames_lost;
+            public GstLatencySummary display_latency;
+            public GstLatencySummary frame_interval;
+            public GstLatencySummary callback;
+            public ulong frames_gated;      // 运动门控判定为静止而未交付的检测帧
+            public long first_frame_us;     // start 到首帧送显（微秒），0 表示尚无帧
+            public ulong clips_recorded;    // 已写完的事件录像片段数
+            public ulong record_buffer_bytes; // 预录缓冲当前字节数
+            public int detect_level;        // 检测自适应当前档位（0 为上限）
+            public int detect_fps;          // 当前检测帧率
+            public int detect_width;        // 当前检测尺寸
+            public int detect_height;
+            public int cpu_percent;         // 最近一个评估周期的系统 CPU 占用，-1 表示未知
+            public ulong detect_adjustments; // 档位调整次数
+        }
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_get_perf_stats(IntPtr handle, out GstPlayerPerfStats stats);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_record_event(IntPtr handle, string path, int pre_ms, int post_ms);
+
         // 人脸框结构体
         [StructLayout(LayoutKind.Sequential)]
         public struct GstFaceBox
@@ -107,8 +233,56 @@ namespace FaceLocker.Services
             [MarshalAs(UnmanagedType.LPArray)] GstFaceBox[] boxes, 
             int count, int source_width, int source_height);
 
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_set_face_boxes_ex(IntPtr handle,
+            [MarshalAs(UnmanagedType.LPArray)] GstFaceBox[] boxes,
+            int count, int source_width, int source_height, ulong frame_id);
+
         [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
         private static extern void gst_player_clear_face_boxes(IntPtr handle);
+
+        // 人脸裁剪图，对应 gst_face_crop_t（数据归原生播放器所有，下一次裁剪前有效）
+        [StructLayout(LayoutKind.Sequential)]
+        private struct GstFaceCrop
+        {
+            public IntPtr data;
+            public UIntPtr size;
+            public int width;
+            public int height;
+            public int stride;
+            public GstFaceBox box;          // 实际裁剪的区域（帧像素）
+        }
+
+        private const int MaxFaceCrops = 8; // GST_PLAYER_MAX_FACE_CROPS
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_crop_faces_bgra(IntPtr handle, IntPtr data, int width, int height, int stride,
+            [Out] GstFaceCrop[] crops, int max_crops, out int count);
+
+        // 拉取到的检测帧，对应 gst_player_pulled_frame_t（像素已复制到注册的缓冲区，行间无填充）
+        [StructLayout(LayoutKind.Sequential)]
+        private struct GstPulledFrame
+        {
+            public int width;
+            public int height;
+            public int stride;
+            public int format;              // GST_PLAYER_PIXEL_BGRA = 0
+            public UIntPtr size;
+            public uint skipped;            // 上次拉取以来被新帧替换掉的帧数
+            public GstPlayerFrameInfo info;
+        }
+
+        private const int GstPlayerErrorNoData = -8; // GST_PLAYER_ERROR_NO_DATA
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_register_frame_buffers(IntPtr handle, IntPtr[]? buffers, int count,
+            UIntPtr buffer_size);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_get_latest_frame_into(IntPtr handle, int slot, out GstPulledFrame frame);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern int gst_player_wait_frame(IntPtr handle, int timeout_ms);
         #endregion
 
         #region 私有字段
@@ -119,8 +293,13 @@ namespace FaceLocker.Services
         private IntPtr _playerHandle = IntPtr.Zero;
         private GstFrameCallback? _frameCallback;
         private bool _isDisposed = false;
+        private bool _isPrewarmed = false;  // 播放器已预启动到 PAUSED，停止时保留
         private ulong _currentWindowId = 0;
 
+        // 性能统计定时输出
+        private static readonly TimeSpan PerfStatsInterval = TimeSpan.FromSeconds(30);
+        private Timer? _perfStatsTimer;
+
         // 人脸识别帧缓存
         private WriteableBitmap? _latestFaceFrame;
         private DateTime _lastFaceFrameTime = DateTime.MinValue;
@@ -130,6 +309,12 @@ namespace FaceLocker.Services
         private byte[]? _frameDataBuffer;
         private int _faceFrameWidth = 0;
         private int _faceFrameHeight = 0;
+
+        // 拉取模式：原生端把检测帧直接写入固定（pinned）缓冲区，拉取线程轮流使用，每帧不分配托管对象
+        private const int PullBufferCount = 2;
+        private const int PullWaitTimeoutMs = 200;  // 等待超时后检查是否需要退出
+        private Thread? _pullThread;
+        private volatile bool _pullRunning;
         #endregion
 
         #region 属性
@@ -238,6 +423,119 @@ namespace FaceLocker.Services
         #endregion
 
         #region 启动摄像头
+        /// <summary>
+        /// 创建播放器并设置帧回调（调用方持有 _lock 或尚无其他线程访问 _playerHandle）
+        /// </summary>
+        private bool CreatePlayer()
+        {
+            var cfg = _appSettings.Camera;
+
+            // 构建配置
+            var config = new GstPlayerConfig
+            {
+                device = cfg.DevicePath,
+                width = cfg.Resolution.Width,
+                height = cfg.Resolution.Height,
+                fps = cfg.FrameRate,
+                format = GstPlayerFormat.MJPEG, // MJPEG 格式
+                use_hardware_decode = true,      // 使用 MPP 硬件解码
+                use_rga = true,                  // 使用 RGA 硬件加速
+                face_detect_fps = cfg.AdaptiveDetect ? 15 : 10, // 人脸检测帧率（自适应时为上限，空闲时多采样）
+                face_detect_width = 640,         // 人脸检测缩放宽度
+                face_detect_height = 360,        // 人脸检测缩放高度
+                display_mode = GstPlayerDisplayMode.Auto, // 优先 GL 硬件显示路径
+                detect_workers = 1,              // OnNativeFrameReceived 复用帧缓冲区，不可重入
+                motion_gate = true,              // 柜前无人时不做人脸检测
+                face_box_predict_ms = 150,       // 10 FPS 检测之间外推人脸框，显示帧率下平滑跟随
+                record_pre_ms = cfg.EventRecordingEnabled ? cfg.EventRecordPreMs : 0,
+                streaming_thread = new CameraThreadConfig
+                {
+                    policy = cfg.StreamingThreadPriority > 0 ? 1 : 0, // SCHED_FIFO
+                    priority = cfg.StreamingThreadPriority,
+                    cpu_mask = cfg.StreamingCpuMask
+                },
+                lock_memory = cfg.LockMemory,
+                adaptive_detect = cfg.AdaptiveDetect,
+                detect_min_fps = 3,              // 负载最高时仍每秒检测 3 帧，识别延迟有上界
+                detect_min_width = 320,          // 最小检测尺寸 320x180
+                detect_budget_ms = 250
+            };
+
+            // 创建播放器
+            _playerHandle = gst_player_create(ref config);
+            if (_playerHandle == IntPtr.Zero)
+            {
+                _logger.LogError("创建播放器失败");
+                return false;
+            }
+
+            // 拉取模式不需要帧回调，注册失败时退回回调
+            if (cfg.NativeFramePull && StartFramePull(config.face_detect_width, config.face_detect_height))
+            {
+                return true;
+            }
+
+            // 设置帧回调
+            _frameCallback = OnNativeFrameReceived;
+            int callbackResult = gst_player_set_frame_info_callback(_playerHandle, _frameCallback, IntPtr.Zero);
+            if (callbackResult != 0)
+            {
+                _logger.LogWarning("设置帧回调失败: {Error}", GetErrorString(callbackResult));
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// 预启动：应用启动时在后台创建播放器并切到 PAUSED（打开设备、协商格式），
+        /// 之后 StartCameraAsync 只需设置窗口并进入 PLAYING；StopCameraAsync 不再销毁播放器
+        /// </summary>
+        public async Task<bool> PrewarmAsync()
+        {
+            if (_isDisposed)
+            {
+                return false;
+            }
+
+            return await Task.Run(() =>
+            {
+                lock (_lock)
+                {
+                    if (_playerHandle != IntPtr.Zero)
+                    {
+                        return true;
+                    }
+
+                    try
+                    {
+                        if (!CreatePlayer())
+                        {
+                            return false;
+                        }
+
+                        int result = gst_player_preroll(_playerHandle);
+                        if (result != 0)
+                        {
+                            // 预启动失败不影响正常启动，下次 StartCameraAsync 重新创建
+                            _logger.LogWarning("预启动失败: {Error}", GetErrorString(result));
+                            gst_player_destroy(_playerHandle);
+                            _playerHandle = IntPtr.Zero;
+                            _frameCallback = null;
+                            return false;
+                        }
+
+                        _isPrewarmed = true;
+                        _logger.LogInformation("摄像头管道已预启动");
+                        return true;
+                    }
+                    catch (Exception ex)
+                    {
+                        _logger.LogError(ex, "预启动摄像头时发生异常");
+                        return false;
+                    }
+                }
+            });
+        }
+
         /// <summary>
         /// 启动摄像头
         /// </summary>
@@ -251,7 +549,7 @@ namespace FaceLocker.Services
 
             lock (_lock)
             {
-                if (_playerHandle != IntPtr.Zero)
+                if (_playerHandle != IntPtr.Zero && !_isPrewarmed)
                 {
                     _logger.LogInformation("摄像头已在运行中");
                     return true;
@@ -264,71 +562,52 @@ namespace FaceLocker.Services
                 {
                     _logger.LogInformation("开始启动原生视频摄像头");
 
-                    var cfg = _appSettings.Camera;
-
-                    // 构建配置
-                    var config = new GstPlayerConfig
-                    {
-                        device = cfg.DevicePath,
-                        width = cfg.Resolution.Width,
-                        height = cfg.Resolution.Height,
-                        fps = cfg.FrameRate,
-                        format = GstPlayerFormat.MJPEG, // MJPEG 格式
-                        use_hardware_decode = true,      // 使用 MPP 硬件解码
-                        use_rga = true,                  // 使用 RGA 硬件加速
-                        face_detect_fps = 10,           // 人脸检测 10 FPS（提高帧率减少延迟）
-                        face_detect_width = 640,         // 人脸检测缩放宽度
-                        face_detect_height = 360         // 人脸检测缩放高度
-                    };
-
-                    // 创建播放器
-                    _playerHandle = gst_player_create(ref config);
-                    if (_playerHandle == IntPtr.Zero)
-                    {
-                        _logger.LogError("创建播放器失败");
-                        return false;
-                    }
-
-                    // 设置帧回调
-                    _frameCallback = OnNativeFrameReceived;
-                    int callbackResult = gst_player_set_frame_callback(_playerHandle, _frameCallback, IntPtr.Zero);
-                    if (callbackResult != 0)
+                    lock (_lock)
                     {
-                        _logger.LogWarning("设置帧回调失败: {Error}", GetErrorString(callbackResult));
-                    }
-
-                    // 设置窗口（如果已有）
-                    if (_currentWindowId != 0)
-                    {
-                        int windowResult = gst_player_set_window(_playerHandle, _currentWindowId);
-                        if (windowResult != 0)
+                        // 已预启动的播放器直接复用
+                        if (_playerHandle == IntPtr.Zero && !CreatePlayer())
                         {
-                            _logger.LogError("设置窗口失败: {Error}", GetErrorString(windowResult));
-                            gst_player_destroy(_playerHandle);
-                            _playerHandle = IntPtr.Zero;
                             return false;
                         }
-                    }
-                    else
-                    {
-                        _logger.LogWarning("窗口未设置，需要先调用 SetWindowAsync");
-                    }
+                        if (gst_player_is_playing(_playerHandle))
+                        {
+                            _logger.LogInformation("摄像头已在运行中");
+                            return true;
+                        }
 
-                    // 如果窗口已设置，启动播放
-                    if (_currentWindowId != 0)
-                    {
-                        int startResult = gst_player_start(_playerHandle);
-                        if (startResult != 0)
+                        // 设置窗口（如果已有）
+                        if (_currentWindowId != 0)
                         {
-                            _logger.LogError("启动播放失败: {Error}", GetErrorString(startResult));
-                            gst_player_destroy(_playerHandle);
-                            _playerHandle = IntPtr.Zero;
-                            return false;
+                            int windowResult = gst_player_set_window(_playerHandle, _currentWindowId);
+                            if (windowResult != 0)
+                            {
+                                _logger.LogError("设置窗口失败: {Error}", GetErrorString(windowResult));
+                                DestroyPlayer();
+                                return false;
+                            }
+                        }
+                        else
+                        {
+                            _logger.LogWarning("窗口未设置，需要先调用 SetWindowAsync");
+                        }
+
+                        // 如果窗口已设置，启动播放
+                        if (_currentWindowId != 0)
+                        {
+                            int startResult = gst_player_start(_playerHandle);
+                            if (startResult != 0)
+                            {
+                                _logger.LogError("启动播放失败: {Error}", GetErrorString(startResult));
+                                DestroyPlayer();
+                                return false;
+                            }
                         }
                     }
 
-                    _logger.LogInformation("原生视频摄像头启动成功");
+                    _logger.LogInformation("原生视频摄像头启动成功{Prewarmed}", _isPrewarmed ? "（已预启动）" : "");
                     IsCameraAvailable = true;
+                    _perfStatsTimer?.Dispose();
+                    _perfStatsTimer = new Timer(LogPerformanceStats, null, PerfStatsInterval, PerfStatsInterval);
                     return true;
                 }
                 catch (Exception ex)
@@ -392,13 +671,21 @@ namespace FaceLocker.Services
                     {
                         _logger.LogInformation("开始停止原生视频摄像头");
 
-                        // 停止播放
+                        _perfStatsTimer?.Dispose();
+                        _perfStatsTimer = null;
+
+                        // 停止播放（预启动的播放器回到 PAUSED）
                         gst_player_stop(_playerHandle);
 
+                        // 预启动的播放器保留到服务释放，下次启动不再重新打开设备
+                        if (_isPrewarmed && !_isDisposed)
+                        {
+                            _logger.LogInformation("原生视频摄像头已停止（保持预启动）");
+                            return;
+                        }
+
                         // 销毁播放器
-                        gst_player_destroy(_playerHandle);
-                        _playerHandle = IntPtr.Zero;
-                        _frameCallback = null;
+                        DestroyPlayer();
 
                         _logger.LogInformation("原生视频摄像头停止成功");
                     }
@@ -411,32 +698,151 @@ namespace FaceLocker.Services
         }
         #endregion
 
+        #region 运行中切换格式
+        /// <summary>
+        /// 运行中修改分辨率/帧率（不重建 GStreamer 管道，窗口保持不变）
+        /// </summary>
+        public async Task<bool> ReconfigureAsync(int width, int height, int fps)
+        {
+            return await Task.Run(() =>
+            {
+                lock (_lock)
+                {
+                    if (_playerHandle == IntPtr.Zero)
+                    {
+                        return false;
+                    }
+
+                    int result = gst_player_reconfigure(_playerHandle, width, height, fps);
+                    if (result != 0)
+                    {
+                        _logger.LogError("切换分辨率失败: {Error}", GetErrorString(result));
+                        return false;
+                    }
+
+                    _logger.LogInformation("摄像头格式已切换: {Width}x{Height}@{Fps}fps", width, height, fps);
+                    return true;
+                }
+            });
+        }
+
+        /// <summary>
+        /// 切换低功耗空闲模式（低分辨率/低帧率，暂停人脸检测）或恢复正常模式
+        /// </summary>
+        public async Task<bool> SetIdleModeAsync(bool idle)
+        {
+            return await Task.Run(() =>
+            {
+                lock (_lock)
+                {
+                    if (_playerHandle == IntPtr.Zero)
+                    {
+                        return false;
+                    }
+
+                    int result = gst_player_set_mode(_playerHandle, idle ? GstPlayerMode.Idle : GstPlayerMode.Active);
+                    if (result != 0)
+                    {
+                        _logger.LogError("切换{Mode}模式失败: {Error}", idle ? "空闲" : "正常", GetErrorString(result));
+                        return false;
+                    }
+
+                    _logger.LogInformation("摄像头已切换到{Mode}模式", idle ? "空闲" : "正常");
+                    return true;
+                }
+            });
+        }
+
+        /// <summary>
+        /// 连接或断开检测分支（断开后不再缩放/转换检测帧，显示不受影响）
+        /// </summary>
+        public async Task<bool> SetDetectionEnabledAsync(bool enabled)
+        {
+            return await Task.Run(() =>
+            {
+                lock (_lock)
+                {
+                    if (_playerHandle == IntPtr.Zero)
+                    {
+                        return false;
+                    }
+
+                    int result = gst_player_set_branch_enabled(_playerHandle, GstPlayerBranch.Detect, enabled);
+                    if (result != 0)
+                    {
+                        _logger.LogError("{Action}检测分支失败: {Error}", enabled ? "连接" : "断开", GetErrorString(result));
+                        return false;
+                    }
+
+                    _logger.LogInformation("人脸检测已{State}", enabled ? "开启" : "关闭");
+                    return true;
+                }
+            });
+        }
+
+        /// <summary>
+        /// 触发事件录像：把事件前 preMs 到事件后 postMs 的硬件编码码流写成 MP4（不重新编码）
+        /// 未启用录像、上一个片段还在写或尚无码流时返回 false
+        /// </summary>
+        public bool RecordEvent(string path, int preMs = 5000, int postMs = 5000)
+        {
+            lock (_lock)
+            {
+                if (_playerHandle == IntPtr.Zero)
+                {
+                    return false;
+                }
+
+                int result = gst_player_record_event(_playerHandle, path, preMs, postMs);
+                if (result != 0)
+                {
+                    _logger.LogWarning("触发事件录像失败: {Error}", GetErrorString(result));
+                    return false;
+                }
+
+                _logger.LogInformation("事件录像: {Path}", path);
+                return true;
+            }
+        }
+        #endregion
+
         #region 帧回调
         /// <summary>
         /// 原生帧回调处理（人脸识别用）
         /// </summary>
-        private void OnNativeFrameReceived(IntPtr userData, IntPtr data, int width, int height, int stride)
+        private void OnNativeFrameReceived(IntPtr userData, IntPtr data, int width, int height, int stride,
+            ref GstPlayerFrameInfo info)
         {
             if (_isDisposed || data == IntPtr.Zero)
             {
                 return;
             }
 
+            DeliverNativeFrame(new NativeFrameEventArgs
+            {
+                Data = data,
+                Width = width,
+                Height = height,
+                Stride = stride,
+                FrameId = info.frame_id,
+                CaptureTimeUs = info.capture_us
+            });
+        }
+
+        /// <summary>
+        /// 把检测帧交给订阅者（帧回调和拉取线程共用）
+        /// </summary>
+        private void DeliverNativeFrame(NativeFrameEventArgs frame)
+        {
             try
             {
                 // 触发原生帧事件（高效接口）
-                NativeFrameReceived?.Invoke(this, new NativeFrameEventArgs
-                {
-                    Data = data,
-                    Width = width,
-                    Height = height,
-                    Stride = stride
-                });
+                NativeFrameReceived?.Invoke(this, frame);
 
                 // 如果有 FrameDisplayCaptured 订阅者，创建 WriteableBitmap
                 if (FrameDisplayCaptured != null)
                 {
-                    CreateWriteableBitmapFromNative(data, width, height, stride);
+                    CreateWriteableBitmapFromNative(frame.Data, frame.Width, frame.Height, frame.Stride);
                 }
             }
             catch (Exception ex)
@@ -445,6 +851,107 @@ namespace FaceLocker.Services
             }
         }
 
+        /// <summary>
+        /// 拉取模式：注册固定缓冲区并启动拉取线程（调用方持有 _lock 或尚无其他线程访问 _playerHandle）
+        /// </summary>
+        private bool StartFramePull(int width, int height)
+        {
+            int bufferSize = width * height * 4;
+            var buffers = new byte[PullBufferCount][];
+            var addresses = new IntPtr[PullBufferCount];
+            for (int i = 0; i < PullBufferCount; i++)
+            {
+                // 分配在固定对象堆上，地址在整个生命周期内不变，原生端可以直接写入
+                buffers[i] = GC.AllocateArray<byte>(bufferSize, pinned: true);
+                addresses[i] = Marshal.UnsafeAddrOfPinnedArrayElement(buffers[i], 0);
+            }
+
+            int result = gst_player_register_frame_buffers(_playerHandle, addresses, PullBufferCount, (UIntPtr)bufferSize);
+            if (result != 0)
+            {
+                _logger.LogWarning("注册拉取缓冲区失败，改用帧回调: {Error}", GetErrorString(result));
+                return false;
+            }
+
+            _pullRunning = true;
+            IntPtr handle = _playerHandle;
+            _pullThread = new Thread(() => FramePullLoop(handle, buffers))
+            {
+                IsBackground = true,
+                Name = "NativeFramePull"
+            };
+            _pullThread.Start();
+            _logger.LogInformation("检测帧拉取模式已启动：{Count} 个缓冲区，每个 {Size} 字节", PullBufferCount, bufferSize);
+            return true;
+        }
+
+        /// <summary>
+        /// 拉取线程：等待新帧后复制到下一个缓冲区再交付，订阅者处理期间到达的帧由原生端只保留最新一帧
+        /// 每个缓冲区复用同一个事件参数对象，订阅者不要在处理之后继续持有
+        /// 只有本线程让原生端写入缓冲区，缓冲区由本线程引用到退出为止
+        /// </summary>
+        private void FramePullLoop(IntPtr handle, byte[][] buffers)
+        {
+            var frames = new NativeFrameEventArgs[buffers.Length];
+            for (int i = 0; i < frames.Length; i++)
+            {
+                frames[i] = new NativeFrameEventArgs { Data = Marshal.UnsafeAddrOfPinnedArrayElement(buffers[i], 0) };
+            }
+
+            int slot = 0;
+            bool sizeWarned = false;
+            while (_pullRunning)
+            {
+                if (gst_player_wait_frame(handle, PullWaitTimeoutMs) != 0)
+                {
+                    continue;
+                }
+
+                int result = gst_player_get_latest_frame_into(handle, slot, out GstPulledFrame pulled);
+                if (result == GstPlayerErrorNoData)
+                {
+                    continue;
+                }
+                if (result != 0)
+                {
+                    if (!sizeWarned)
+                    {
+                        _logger.LogWarning("检测帧 {Width}x{Height} 超出拉取缓冲区，帧被丢弃", pulled.width, pulled.height);
+                        sizeWarned = true;
+                    }
+                    continue;
+                }
+                if (_isDisposed || pulled.format != 0)
+                {
+                    continue;   // 订阅者只接受 BGRA
+                }
+
+                var frame = frames[slot];
+                frame.Width = pulled.width;
+                frame.Height = pulled.height;
+                frame.Stride = pulled.stride;
+                frame.FrameId = pulled.info.frame_id;
+                frame.CaptureTimeUs = pulled.info.capture_us;
+                DeliverNativeFrame(frame);
+
+                slot = (slot + 1) % frames.Length;
+            }
+            GC.KeepAlive(buffers);
+        }
+
+        /// <summary>
+        /// 停止拉取线程并注销缓冲区（在 gst_player_destroy 之前调用）
+        /// </summary>
+        private void StopFramePull()
+        {
+            if (_pullThread == null) return;
+
+            _pullRunning = false;
+            _pullThread.Join();     // 最长等待一个 PullWaitTimeoutMs 加当前帧的处理时间
+            _pullThread = null;
+            gst_player_register_frame_buffers(_playerHandle, null, 0, UIntPtr.Zero);
+        }
+
         /// <summary>
         /// 从原生数据创建 WriteableBitmap
         /// </summary>
@@ -569,10 +1076,53 @@ namespace FaceLocker.Services
             return (fps, dropped);
         }
 
+        /// <summary>
+        /// 获取详细性能统计（延迟分位、分支丢帧、V4L2 序号缺口），未运行时返回 null
+        /// </summary>
+        public GstPlayerPerfStats? GetPerformanceStats()
+        {
+            lock (_lock)
+            {
+                if (_playerHandle == IntPtr.Zero)
+                {
+                    return null;
+                }
+
+                return gst_player_get_perf_stats(_playerHandle, out var stats) == 0 ? stats : null;
+            }
+        }
+
+        /// <summary>
+        /// 定时输出性能统计
+        /// </summary>
+        private void LogPerformanceStats(object? state)
+        {
+            var stats = GetPerformanceStats();
+            if (stats is not { } s)
+            {
+                return;
+            }
+
+            _logger.LogInformation(
+                "[Perf] fps={Fps:F1} displayed={Displayed} detected={Detected} gated={Gated} " +
+                "drops(display={DisplayDrops}, detect={DetectDrops}, sink={SinkDrops}) " +
+                "seqGaps={SeqGaps} lost={Lost} firstFrame={FirstFrame}us " +
+                "displayLatency(avg={LatAvg}us, p95={LatP95}us, max={LatMax}us) " +
+                "callback(avg={CbAvg}us, p95={CbP95}us) " +
+                "detect(level={Level}, {DetectFps}fps {DetectW}x{DetectH}, cpu={Cpu}%, adjustments={Adjust})",
+                s.fps, s.frames_displayed, s.frames_detected, s.frames_gated,
+                s.display_queue_drops, s.detect_queue_drops, s.sink_dropped,
+                s.sequence_gaps, s.frames_lost, s.first_frame_us,
+                s.display_latency.avg_us, s.display_latency.p95_us, s.display_latency.max_us,
+                s.callback.avg_us, s.callback.p95_us,
+                s.detect_level, s.detect_fps, s.detect_width, s.detect_height, s.cpu_percent, s.detect_adjustments);
+        }
+
         /// <summary>
         /// 设置人脸框（用于 GStreamer cairooverlay 绘制）
+        /// frameId 为检测所用帧的 NativeFrameEventArgs.FrameId，指定时按该帧的采集时刻补偿检测延迟
         /// </summary>
-        public void SetFaceBoxes(GstFaceBox[]? boxes, int sourceWidth, int sourceHeight)
+        public void SetFaceBoxes(GstFaceBox[]? boxes, int sourceWidth, int sourceHeight, ulong? frameId = null)
         {
             if (_playerHandle == IntPtr.Zero)
             {
@@ -587,7 +1137,14 @@ namespace FaceLocker.Services
             else
             {
                 _logger.LogDebug("[SetFaceBoxes] 调用 native: count={Count}, srcW={W}, srcH={H}", boxes.Length, sourceWidth, sourceHeight);
-                gst_player_set_face_boxes(_playerHandle, boxes, boxes.Length, sourceWidth, sourceHeight);
+                if (frameId.HasValue)
+                {
+                    gst_player_set_face_boxes_ex(_playerHandle, boxes, boxes.Length, sourceWidth, sourceHeight, frameId.Value);
+                }
+                else
+                {
+                    gst_player_set_face_boxes(_playerHandle, boxes, boxes.Length, sourceWidth, sourceHeight);
+                }
             }
         }
 
@@ -601,9 +1158,55 @@ namespace FaceLocker.Services
                 gst_player_clear_face_boxes(_playerHandle);
             }
         }
+
+        /// <summary>
+        /// 按最近设置的人脸框从检测帧裁出 112x112 BGR 人脸图（必须在 NativeFrameReceived 处理中调用，帧数据之后失效）
+        /// 识别时传入裁剪图而不是整帧，SDK 只需处理小图
+        /// </summary>
+        public NativeFaceCrop[] CropFaces(NativeFrameEventArgs frame)
+        {
+            if (_playerHandle == IntPtr.Zero || frame.Data == IntPtr.Zero)
+            {
+                return Array.Empty<NativeFaceCrop>();
+            }
+
+            var crops = new GstFaceCrop[MaxFaceCrops];
+            int result = gst_player_crop_faces_bgra(_playerHandle, frame.Data, frame.Width, frame.Height, frame.Stride,
+                crops, crops.Length, out int count);
+            if (result != 0)
+            {
+                _logger.LogWarning("人脸裁剪失败: {Error}", GetErrorString(result));
+                return Array.Empty<NativeFaceCrop>();
+            }
+
+            var output = new NativeFaceCrop[count];
+            for (int i = 0; i < count; i++)
+            {
+                var bgr = new byte[(int)crops[i].size];
+                Marshal.Copy(crops[i].data, bgr, 0, bgr.Length);
+                output[i] = new NativeFaceCrop
+                {
+                    Bgr = bgr,
+                    Width = crops[i].width,
+                    Height = crops[i].height,
+                    Stride = crops[i].stride,
+                    Region = crops[i].box
+                };
+            }
+            return output;
+        }
         #endregion
 
         #region 辅助方法
+        private void DestroyPlayer()
+        {
+            StopFramePull();
+            gst_player_destroy(_playerHandle);
+            _playerHandle = IntPtr.Zero;
+            _frameCallback = null;
+            _isPrewarmed = false;
+        }
+
         private static string GetErrorString(int error)
         {
             IntPtr ptr = gst_player_get_error_string(error);
@@ -660,6 +1263,47 @@ namespace FaceLocker.Services
         /// 行字节数
         /// </summary>
         public int Stride { get; set; }
+
+        /// <summary>
+        /// 帧号（传回 SetFaceBoxes 用于延迟补偿）
+        /// </summary>
+        public ulong FrameId { get; set; }
+
+        /// <summary>
+        /// 采集时刻（CLOCK_MONOTONIC 微秒，0 表示未知）
+        /// </summary>
+        public long CaptureTimeUs { get; set; }
+    }
+
+    /// <summary>
+    /// 原生裁剪的人脸图（BGR 交织，可直接构造 OpenCV Mat）
+    /// </summary>
+    public class NativeFaceCrop
+    {
+        /// <summary>
+        /// BGR 像素数据
+        /// </summary>
+        public byte[] Bgr { get; set; } = Array.Empty<byte>();
+
+        /// <summary>
+        /// 宽度
+        /// </summary>
+        public int Width { get; set; }
+
+        /// <summary>
+        /// 高度
+        /// </summary>
+        public int Height { get; set; }
+
+        /// <summary>
+        /// 行字节数
+        /// </summary>
+        public int Stride { get; set; }
+
+        /// <summary>
+        /// 裁剪区域在检测帧中的位置（中心 + 尺寸），Score 为人脸框置信度
+        /// </summary>
+        public NativeVideoCameraService.GstFaceBox Region { get; set; }
     }
 
     /// <summary>
@@ -677,24 +1321,59 @@ namespace FaceLocker.Services
         /// </summary>
         Task<bool> StartPlaybackAsync();
 
+        /// <summary>
+        /// 预启动管道（应用启动时调用，缩短首帧时间）
+        /// </summary>
+        Task<bool> PrewarmAsync();
+
         /// <summary>
         /// 原生帧事件（高效人脸识别接口）
         /// </summary>
         event EventHandler<NativeFrameEventArgs>? NativeFrameReceived;
 
+        /// <summary>
+        /// 运行中修改分辨率/帧率（不重建管道）
+        /// </summary>
+        Task<bool> ReconfigureAsync(int width, int height, int fps);
+
+        /// <summary>
+        /// 切换低功耗空闲模式 / 正常模式
+        /// </summary>
+        Task<bool> SetIdleModeAsync(bool idle);
+
+        /// <summary>
+        /// 开启 / 关闭人脸检测分支
+        /// </summary>
+        Task<bool> SetDetectionEnabledAsync(bool enabled);
+
+        /// <summary>
+        /// 触发事件录像（事件前后的 MP4 片段，立即返回）
+        /// </summary>
+        bool RecordEvent(string path, int preMs = 5000, int postMs = 5000);
+
         /// <summary>
         /// 获取性能统计
         /// </summary>
         (float Fps, int DroppedFrames) GetStats();
 
+        /// <summary>
+        /// 获取详细性能统计，未运行时返回 null
+        /// </summary>
+        NativeVideoCameraService.GstPlayerPerfStats? GetPerformanceStats();
+
         /// <summary>
         /// 设置人脸框（用于 GStreamer cairooverlay 绘制）
         /// </summary>
-        void SetFaceBoxes(NativeVideoCameraService.GstFaceBox[]? boxes, int sourceWidth, int sourceHeight);
+        void SetFaceBoxes(NativeVideoCameraService.GstFaceBox[]? boxes, int sourceWidth, int sourceHeight, ulong? frameId = null);
 
         /// <summary>
         /// 清除人脸框
         /// </summary>
         void ClearFaceBoxes();
+
+        /// <summary>
+        /// 按最近设置的人脸框裁出人脸图（在 NativeFrameReceived 处理中调用）
+        /// </summary>
+        NativeFaceCrop[] CropFaces(NativeFrameEventArgs frame);
     }
 }
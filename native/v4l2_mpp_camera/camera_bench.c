@@ -0,0 +1,807 @@
+/*
+ * V4L2 + MPP Camera Benchmark
+ *
+ * 不需要摄像头，逐级测量处理链路的耗时，结果以 JSON 输出，便于在 MPP/RGA 驱动升级前后对比：
+ * 1. decode  - 回放录制的 MJPEG 文件（多帧 JPEG 直接拼接，如 ffmpeg -c:v copy -f mjpeg）
+ * 2. rga     - RGA imcvtcolor YUV 转 BGRA（解码输出及各分辨率的合成 NV12/NV16）
+ * 3. cpu     - CPU 转换内核（yuv_convert），单线程及多线程按行分块
+ * 4. gate    - 运动门控（motion_gate）在 Y 平面上求网格均值并与上一帧比较
+ *
+ * 每级输出 min/avg/p50/p95/p99/max、对数直方图、吞吐（fps）、进程 CPU 占用和有效内存带宽
+ * （每帧读写字节数 / 耗时，不是硬件计数器）。
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "rockchip/rk_mpi.h"
+#include "rockchip/mpp_buffer.h"
+#include "rockchip/mpp_frame.h"
+#include "rockchip/mpp_packet.h"
+
+#ifdef USE_RGA
+#include "rga/im2d.h"
+#include "rga/rga.h"
+#endif
+
+#include "yuv_convert.h"
+#include "motion_gate.h"
+
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+
+#define BENCH_MAX_RESOLUTIONS 8
+#define BENCH_HIST_BUCKETS 22           /* <=1us, <=2us ... <=2^20us，最后一桶为溢出 */
+#define BENCH_OUTPUT_POLL_TIMEOUT_MS 1000
+
+/* 一级测量的样本和资源占用 */
+typedef struct {
+    const char* stage;
+    const char* input;              /* "file" 或 "synthetic" */
+    const char* format;
+    int width;
+    int height;
+    int threads;
+    size_t bytes_per_frame;         /* 每帧读写字节数，用于估算带宽 */
+    
+    long* samples_us;
+    int count;
+    int capacity;
+    
+    struct timespec wall_start;
+    struct rusage usage_start;
+    double wall_s;
+    double cpu_s;
+} bench_stage_t;
+
+/* 回放用的 MJPEG 帧表 */
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t* offsets;
+    size_t* lengths;
+    int count;
+    int width;
+    int height;
+} mjpeg_file_t;
+
+/* MJPEG 解码器（与库中一样使用 MppTask 接口，单任务同步等待） */
+typedef struct {
+    MppCtx ctx;
+    MppApi* mpi;
+    MppBufferGroup grp;
+    MppBuffer pkt_buf;
+    size_t pkt_size;
+    MppBuffer frm_buf;
+    
+    /* 最近一次解码输出 */
+    int width;
+    int height;
+    int hor_stride;
+    int ver_stride;
+    MppFrameFormat fmt;
+} bench_decoder_t;
+
+/* 转换源：MPP 缓冲区中的 YUV 图像 */
+typedef struct {
+    MppBuffer buf;
+    int width;
+    int height;
+    int hor_stride;
+    int ver_stride;
+    MppFrameFormat fmt;
+} bench_yuv_t;
+
+static FILE* g_json = NULL;
+static int g_json_results = 0;
+
+static long elapsed_us(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000 + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+static double rusage_cpu_s(const struct rusage* u)
+{
+    return u->ru_utime.tv_sec + u->ru_utime.tv_usec / 1e6 +
+           u->ru_stime.tv_sec + u->ru_stime.tv_usec / 1e6;
+}
+
+/* ============================================
+ * 统计与 JSON 输出
+ * ============================================ */
+
+static int stage_begin(bench_stage_t* st, const char* stage, const char* input, const char* format,
+                       int width, int height, int threads, size_t bytes_per_frame, int iterations)
+{
+    memset(st, 0, sizeof(*st));
+    st->stage = stage;
+    st->input = input;
+    st->format = format;
+    st->width = width;
+    st->height = height;
+    st->threads = threads;
+    st->bytes_per_frame = bytes_per_frame;
+    st->capacity = iterations;
+    st->samples_us = (long*)calloc(iterations, sizeof(long));
+    if (!st->samples_us) return -1;
+    
+    getrusage(RUSAGE_SELF, &st->usage_start);
+    clock_gettime(CLOCK_MONOTONIC, &st->wall_start);
+    return 0;
+}
+
+static void stage_record(bench_stage_t* st, long us)
+{
+    if (st->count < st->capacity) {
+        st->samples_us[st->count++] = us;
+    }
+}
+
+static int compare_long(const void* a, const void* b)
+{
+    long x = *(const long*)a;
+    long y = *(const long*)b;
+    return x < y ? -1 : (x > y);
+}
+
+static long percentile(const long* sorted, int n, int pct)
+{
+    if (n == 0) return 0;
+    return sorted[(n * pct + 99) / 100 - 1];
+}
+
+/* 结束一级测量：计算统计值并追加到 JSON 结果数组 */
+static void stage_end(bench_stage_t* st)
+{
+    struct timespec wall_end;
+    struct rusage usage_end;
+    uint64_t hist[BENCH_HIST_BUCKETS] = {0};
+    long sum = 0;
+    int n = st->count;
+    
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    getrusage(RUSAGE_SELF, &usage_end);
+    st->wall_s = elapsed_us(&st->wall_start, &wall_end) / 1e6;
+    st->cpu_s = rusage_cpu_s(&usage_end) - rusage_cpu_s(&st->usage_start);
+    
+    qsort(st->samples_us, n, sizeof(long), compare_long);
+    for (int i = 0; i < n; i++) {
+        long us = st->samples_us[i];
+        int b = 0;
+        while (b < BENCH_HIST_BUCKETS - 1 && us > (1L << b)) b++;
+        hist[b]++;
+        sum += us;
+    }
+    
+    double busy_s = sum / 1e6;
+    double fps = busy_s > 0 ? n / busy_s : 0;
+    double cpu_pct = st->wall_s > 0 ? st->cpu_s * 100.0 / st->wall_s : 0;
+    double mbps = busy_s > 0 ? (double)st->bytes_per_frame * n / busy_s / 1e6 : 0;
+    
+    fprintf(stderr, "  %-8s %-9s %-5s %4dx%-4d t%d  avg %8.1f  p95 %8ld  max %8ld us  %8.1f fps  cpu %5.1f%%  %8.1f MB/s\n",
+            st->stage, st->input, st->format, st->width, st->height, st->threads,
+            n ? (double)sum / n : 0.0, percentile(st->samples_us, n, 95),
+            n ? st->samples_us[n - 1] : 0L, fps, cpu_pct, mbps);
+    
+    fprintf(g_json, "%s\n    {\"stage\": \"%s\", \"input\": \"%s\", \"format\": \"%s\", "
+            "\"width\": %d, \"height\": %d, \"threads\": %d, \"frames\": %d,\n",
+            g_json_results ? "," : "", st->stage, st->input, st->format,
+            st->width, st->height, st->threads, n);
+    fprintf(g_json, "     \"latency_us\": {\"min\": %ld, \"avg\": %.1f, \"p50\": %ld, \"p95\": %ld, "
+            "\"p99\": %ld, \"max\": %ld},\n",
+            n ? st->samples_us[0] : 0L, n ? (double)sum / n : 0.0,
+            percentile(st->samples_us, n, 50), percentile(st->samples_us, n, 95),
+            percentile(st->samples_us, n, 99), n ? st->samples_us[n - 1] : 0L);
+    fprintf(g_json, "     \"histogram_us\": [");
+    int first = 1;
+    for (int b = 0; b < BENCH_HIST_BUCKETS; b++) {
+        if (hist[b] == 0) continue;
+        if (b == BENCH_HIST_BUCKETS - 1) {
+            fprintf(g_json, "%s{\"le\": null, \"count\": %llu}", first ? "" : ", ", (unsigned long long)hist[b]);
+        } else {
+            fprintf(g_json, "%s{\"le\": %ld, \"count\": %llu}", first ? "" : ", ", 1L << b,
+                    (unsigned long long)hist[b]);
+        }
+        first = 0;
+    }
+    fprintf(g_json, "],\n");
+    fprintf(g_json, "     \"fps\": %.2f, \"wall_s\": %.3f, \"cpu_s\": %.3f, \"cpu_percent\": %.1f, "
+            "\"bytes_per_frame\": %zu, \"bandwidth_mbps\": %.1f}",
+            fps, st->wall_s, st->cpu_s, cpu_pct, st->bytes_per_frame, mbps);
+    g_json_results++;
+    
+    free(st->samples_us);
+    st->samples_us = NULL;
+}
+
+/* ============================================
+ * MJPEG 文件回放
+ * ============================================ */
+
+/* 从 SOF 段读取图像尺寸 */
+static int jpeg_parse_size(const uint8_t* p, size_t len, int* width, int* height)
+{
+    size_t i = 2;
+    
+    while (i + 9 < len) {
+        if (p[i] != 0xFF) return -1;
+        uint8_t marker = p[i + 1];
+        size_t seg_len = ((size_t)p[i + 2] << 8) | p[i + 3];
+        
+        if (marker >= 0xC0 && marker <= 0xC3) {
+            *height = (p[i + 5] << 8) | p[i + 6];
+            *width = (p[i + 7] << 8) | p[i + 8];
+            return 0;
+        }
+        if (marker == 0xDA) return -1;  /* 扫描数据之前没有 SOF */
+        i += 2 + seg_len;
+    }
+    return -1;
+}
+
+/* 读取文件并按 SOI/EOI 标记切分出每一帧 */
+static int mjpeg_file_load(const char* path, mjpeg_file_t* mf)
+{
+    memset(mf, 0, sizeof(*mf));
+    
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return -1;
+    }
+    
+    fseek(fp, 0, SEEK_END);
+    mf->size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    mf->data = (uint8_t*)malloc(mf->size);
+    if (!mf->data || fread(mf->data, 1, mf->size, fp) != mf->size) {
+        fprintf(stderr, "Failed to read %s\n", path);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    
+    int capacity = 64;
+    mf->offsets = (size_t*)malloc(capacity * sizeof(size_t));
+    mf->lengths = (size_t*)malloc(capacity * sizeof(size_t));
+    
+    size_t start = 0;
+    int in_frame = 0;
+    for (size_t i = 0; i + 1 < mf->size; i++) {
+        if (mf->data[i] != 0xFF) continue;
+        if (!in_frame && mf->data[i + 1] == 0xD8) {
+            start = i;
+            in_frame = 1;
+        } else if (in_frame && mf->data[i + 1] == 0xD9) {
+            if (mf->count == capacity) {
+                capacity *= 2;
+                mf->offsets = (size_t*)realloc(mf->offsets, capacity * sizeof(size_t));
+                mf->lengths = (size_t*)realloc(mf->lengths, capacity * sizeof(size_t));
+            }
+            mf->offsets[mf->count] = start;
+            mf->lengths[mf->count] = i + 2 - start;
+            mf->count++;
+            in_frame = 0;
+            i++;
+        }
+    }
+    
+    if (mf->count == 0 ||
+        jpeg_parse_size(mf->data + mf->offsets[0], mf->lengths[0], &mf->width, &mf->height) < 0) {
+        fprintf(stderr, "No decodable JPEG frames in %s\n", path);
+        return -1;
+    }
+    
+    fprintf(stderr, "Loaded %s: %d frames, %dx%d\n", path, mf->count, mf->width, mf->height);
+    return 0;
+}
+
+static void mjpeg_file_free(mjpeg_file_t* mf)
+{
+    free(mf->data);
+    free(mf->offsets);
+    free(mf->lengths);
+    memset(mf, 0, sizeof(*mf));
+}
+
+static int decoder_open(bench_decoder_t* dec, MppBufferGroup grp, int width, int height, size_t max_packet)
+{
+    MPP_RET ret;
+    MppDecCfg cfg = NULL;
+    
+    memset(dec, 0, sizeof(*dec));
+    dec->grp = grp;
+    
+    ret = mpp_create(&dec->ctx, &dec->mpi);
+    if (ret != MPP_OK) {
+        fprintf(stderr, "mpp_create failed: %d\n", ret);
+        return -1;
+    }
+    ret = mpp_init(dec->ctx, MPP_CTX_DEC, MPP_VIDEO_CodingMJPEG);
+    if (ret != MPP_OK) {
+        fprintf(stderr, "mpp_init failed: %d\n", ret);
+        return -1;
+    }
+    
+    mpp_dec_cfg_init(&cfg);
+    if (dec->mpi->control(dec->ctx, MPP_DEC_GET_CFG, cfg) == MPP_OK) {
+        mpp_dec_cfg_set_u32(cfg, "base:split_parse", 0);
+        mpp_dec_cfg_set_u32(cfg, "base:fast_out", 1);
+        dec->mpi->control(dec->ctx, MPP_DEC_SET_CFG, cfg);
+    }
+    mpp_dec_cfg_deinit(cfg);
+    
+    dec->pkt_size = max_packet;
+    if (mpp_buffer_get(grp, &dec->pkt_buf, dec->pkt_size) != MPP_OK ||
+        mpp_buffer_get(grp, &dec->frm_buf, (size_t)ALIGN(width, 16) * ALIGN(height, 16) * 4) != MPP_OK) {
+        fprintf(stderr, "mpp_buffer_get failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void decoder_close(bench_decoder_t* dec)
+{
+    if (dec->pkt_buf) mpp_buffer_put(dec->pkt_buf);
+    if (dec->frm_buf) mpp_buffer_put(dec->frm_buf);
+    if (dec->ctx) {
+        dec->mpi->reset(dec->ctx);
+        mpp_destroy(dec->ctx);
+    }
+    memset(dec, 0, sizeof(*dec));
+}
+
+/* 解码一帧并等待结果
+ * @param us 输出：提交到取得结果的耗时（不含复制到包缓冲区，对应库的 DMABUF 零拷贝路径）
+ */
+static int decoder_run(bench_decoder_t* dec, const uint8_t* data, size_t size, long* us)
+{
+    MppPacket packet = NULL;
+    MppFrame frame = NULL;
+    MppTask task = NULL;
+    MppFrame out_frame = NULL;
+    struct timespec t0, t1;
+    int result = -1;
+    
+    if (size > dec->pkt_size) return -1;
+    memcpy(mpp_buffer_get_ptr(dec->pkt_buf), data, size);
+    
+    if (mpp_packet_init_with_buffer(&packet, dec->pkt_buf) != MPP_OK) return -1;
+    mpp_packet_set_length(packet, size);
+    if (mpp_frame_init(&frame) != MPP_OK) {
+        mpp_packet_deinit(&packet);
+        return -1;
+    }
+    mpp_frame_set_buffer(frame, dec->frm_buf);
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    
+    if (dec->mpi->poll(dec->ctx, MPP_PORT_INPUT, MPP_POLL_BLOCK) != MPP_OK ||
+        dec->mpi->dequeue(dec->ctx, MPP_PORT_INPUT, &task) != MPP_OK || !task) {
+        goto out;
+    }
+    mpp_task_meta_set_packet(task, KEY_INPUT_PACKET, packet);
+    mpp_task_meta_set_frame(task, KEY_OUTPUT_FRAME, frame);
+    if (dec->mpi->enqueue(dec->ctx, MPP_PORT_INPUT, task) != MPP_OK) {
+        goto out;
+    }
+    
+    task = NULL;
+    if (dec->mpi->poll(dec->ctx, MPP_PORT_OUTPUT, (MppPollType)BENCH_OUTPUT_POLL_TIMEOUT_MS) != MPP_OK ||
+        dec->mpi->dequeue(dec->ctx, MPP_PORT_OUTPUT, &task) != MPP_OK || !task) {
+        fprintf(stderr, "MPP decode timed out\n");
+        goto out;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *us = elapsed_us(&t0, &t1);
+    
+    mpp_task_meta_get_frame(task, KEY_OUTPUT_FRAME, &out_frame);
+    if (out_frame && !mpp_frame_get_errinfo(out_frame)) {
+        dec->width = mpp_frame_get_width(out_frame);
+        dec->height = mpp_frame_get_height(out_frame);
+        dec->hor_stride = mpp_frame_get_hor_stride(out_frame);
+        dec->ver_stride = mpp_frame_get_ver_stride(out_frame);
+        dec->fmt = mpp_frame_get_fmt(out_frame) & MPP_FRAME_FMT_MASK;
+        result = 0;
+    }
+    dec->mpi->enqueue(dec->ctx, MPP_PORT_OUTPUT, task);
+
+out:
+    mpp_frame_deinit(&frame);
+    mpp_packet_deinit(&packet);
+    return result;
+}
+
+/* ============================================
+ * 转换内核
+ * ============================================ */
+
+static const char* mpp_format_name(MppFrameFormat fmt)
+{
+    switch (fmt & MPP_FRAME_FMT_MASK) {
+        case MPP_FMT_YUV420SP: return "nv12";
+        case MPP_FMT_YUV420SP_VU: return "nv21";
+        case MPP_FMT_YUV422SP: return "nv16";
+        case MPP_FMT_YUV422SP_VU: return "nv61";
+        default: return "unknown";
+    }
+}
+
+static size_t yuv_frame_bytes(const bench_yuv_t* yuv)
+{
+    MppFrameFormat fmt = yuv->fmt & MPP_FRAME_FMT_MASK;
+    size_t luma = (size_t)yuv->width * yuv->height;
+    return (fmt == MPP_FMT_YUV422SP || fmt == MPP_FMT_YUV422SP_VU) ? luma * 2 : luma * 3 / 2;
+}
+
+static void yuv_image_init(const bench_yuv_t* yuv, yuv_image_t* img)
+{
+    MppFrameFormat fmt = yuv->fmt & MPP_FRAME_FMT_MASK;
+    uint8_t* base = (uint8_t*)mpp_buffer_get_ptr(yuv->buf);
+    
+    img->y = base;
+    img->uv = base + (size_t)yuv->hor_stride * yuv->ver_stride;
+    img->y_stride = yuv->hor_stride;
+    img->uv_stride = yuv->hor_stride;
+    img->width = yuv->width;
+    img->height = yuv->height;
+    img->layout = (fmt == MPP_FMT_YUV422SP || fmt == MPP_FMT_YUV422SP_VU) ? YUV_LAYOUT_422SP : YUV_LAYOUT_420SP;
+    img->vu = (fmt == MPP_FMT_YUV420SP_VU || fmt == MPP_FMT_YUV422SP_VU);
+}
+
+/* 合成测试图：亮度斜坡 + 色度棋盘，避免全零数据让内存压缩/缓存失真 */
+static int synthetic_yuv_alloc(MppBufferGroup grp, int width, int height, MppFrameFormat fmt, bench_yuv_t* yuv)
+{
+    yuv->width = width;
+    yuv->height = height;
+    yuv->hor_stride = ALIGN(width, 16);
+    yuv->ver_stride = ALIGN(height, 16);
+    yuv->fmt = fmt;
+    
+    /* 与库中解码缓冲区相同的 4 字节/像素大小，RGA 按 RGBA 导入整个缓冲区 */
+    if (mpp_buffer_get(grp, &yuv->buf, (size_t)yuv->hor_stride * yuv->ver_stride * 4) != MPP_OK) {
+        return -1;
+    }
+    
+    yuv_image_t img;
+    yuv_image_init(yuv, &img);
+    int chroma_rows = img.layout == YUV_LAYOUT_422SP ? height : height / 2;
+    uint8_t* y = (uint8_t*)img.y;
+    uint8_t* uv = (uint8_t*)img.uv;
+    
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            y[(size_t)i * img.y_stride + j] = (uint8_t)(i + j);
+        }
+    }
+    for (int i = 0; i < chroma_rows; i++) {
+        for (int j = 0; j < width; j++) {
+            uv[(size_t)i * img.uv_stride + j] = (uint8_t)((((i >> 3) ^ (j >> 4)) & 1) ? 64 + j : 192 - i);
+        }
+    }
+    mpp_buffer_sync_end(yuv->buf);
+    return 0;
+}
+
+static void bench_cpu(const bench_yuv_t* yuv, const char* input, int threads, int iterations, int warmup,
+                      yuv_color_space_t color_space)
+{
+    bench_stage_t st;
+    yuv_image_t img;
+    struct timespec t0, t1;
+    uint8_t* bgra = (uint8_t*)malloc((size_t)yuv->width * yuv->height * 4);
+    yuv_converter_t* conv = yuv_converter_create(threads);
+    
+    if (!bgra || (threads > 1 && !conv)) {
+        fprintf(stderr, "CPU bench setup failed (%dx%d, %d threads)\n", yuv->width, yuv->height, threads);
+        free(bgra);
+        yuv_converter_destroy(conv);
+        return;
+    }
+    yuv_image_init(yuv, &img);
+    
+    for (int i = 0; i < warmup; i++) {
+        yuv_converter_to_bgra(conv, &img, bgra, yuv->width * 4, color_space);
+    }
+    
+    if (stage_begin(&st, "cpu", input, mpp_format_name(yuv->fmt), yuv->width, yuv->height, threads,
+                    yuv_frame_bytes(yuv) + (size_t)yuv->width * yuv->height * 4, iterations) == 0) {
+        for (int i = 0; i < iterations; i++) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            yuv_converter_to_bgra(conv, &img, bgra, yuv->width * 4, color_space);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stage_record(&st, elapsed_us(&t0, &t1));
+        }
+        stage_end(&st);
+    }
+    
+    yuv_converter_destroy(conv);
+    free(bgra);
+}
+
+/* 运动门控：心跳关闭，同一帧反复比较即静止画面的判定开销（带宽按整个 Y 平面计，实际只采样部分行） */
+static void bench_gate(const bench_yuv_t* yuv, const char* input, int iterations, int warmup)
+{
+    bench_stage_t st;
+    struct timespec t0, t1;
+    motion_gate_config_t cfg = { .heartbeat_ms = -1, .hold_ms = -1 };
+    motion_gate_t* gate = motion_gate_create(&cfg);
+    const uint8_t* luma = (const uint8_t*)mpp_buffer_get_ptr(yuv->buf);
+    int64_t now_us = 0;
+    
+    if (!gate) {
+        fprintf(stderr, "Gate bench setup failed (%dx%d)\n", yuv->width, yuv->height);
+        return;
+    }
+    
+    for (int i = 0; i < warmup; i++) {
+        motion_gate_check(gate, luma, yuv->width, yuv->height, yuv->hor_stride, 1, now_us += 100000);
+    }
+    
+    if (stage_begin(&st, "gate", input, mpp_format_name(yuv->fmt), yuv->width, yuv->height, 1,
+                    (size_t)yuv->width * yuv->height, iterations) == 0) {
+        for (int i = 0; i < iterations; i++) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            motion_gate_check(gate, luma, yuv->width, yuv->height, yuv->hor_stride, 1, now_us += 100000);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stage_record(&st, elapsed_us(&t0, &t1));
+        }
+        stage_end(&st);
+    }
+    
+    motion_gate_destroy(gate);
+}
+
+#ifdef USE_RGA
+/* MPP 解码输出格式对应的 RGA 输入格式 */
+static int rga_src_format(MppFrameFormat format)
+{
+    switch (format & MPP_FRAME_FMT_MASK) {
+        case MPP_FMT_YUV420SP_VU: return RK_FORMAT_YCrCb_420_SP;
+        case MPP_FMT_YUV422SP: return RK_FORMAT_YCbCr_422_SP;
+        case MPP_FMT_YUV422SP_VU: return RK_FORMAT_YCrCb_422_SP;
+        default: return RK_FORMAT_YCbCr_420_SP;
+    }
+}
+
+/* 与库相同的方式：源和目标都是预先导入的 DMA 句柄，每帧只有 imcvtcolor */
+static void bench_rga(MppBufferGroup grp, const bench_yuv_t* yuv, const char* input, int iterations, int warmup)
+{
+    bench_stage_t st;
+    struct timespec t0, t1;
+    MppBuffer dst_buf = NULL;
+    im_handle_param_t src_param = {0};
+    im_handle_param_t dst_param = {0};
+    rga_buffer_handle_t src_handle = 0;
+    rga_buffer_handle_t dst_handle = 0;
+    
+    if (mpp_buffer_get(grp, &dst_buf, (size_t)yuv->width * yuv->height * 4) != MPP_OK) {
+        fprintf(stderr, "RGA bench: destination allocation failed\n");
+        return;
+    }
+    
+    src_param.width = yuv->hor_stride;
+    src_param.height = yuv->ver_stride;
+    src_param.format = RK_FORMAT_RGBA_8888;
+    dst_param.width = yuv->width;
+    dst_param.height = yuv->height;
+    dst_param.format = RK_FORMAT_BGRA_8888;
+    src_handle = importbuffer_fd(mpp_buffer_get_fd(yuv->buf), &src_param);
+    dst_handle = importbuffer_fd(mpp_buffer_get_fd(dst_buf), &dst_param);
+    if (src_handle == 0 || dst_handle == 0) {
+        fprintf(stderr, "RGA bench: importbuffer_fd failed\n");
+        goto out;
+    }
+    
+    rga_buffer_t src = wrapbuffer_handle(src_handle, yuv->width, yuv->height, rga_src_format(yuv->fmt));
+    src.wstride = yuv->hor_stride;
+    src.hstride = yuv->ver_stride;
+    rga_buffer_t dst = wrapbuffer_handle(dst_handle, yuv->width, yuv->height, RK_FORMAT_BGRA_8888);
+    
+    for (int i = 0; i < warmup; i++) {
+        imcvtcolor(src, dst, src.format, dst.format);
+    }
+    
+    if (stage_begin(&st, "rga", input, mpp_format_name(yuv->fmt), yuv->width, yuv->height, 1,
+                    yuv_frame_bytes(yuv) + (size_t)yuv->width * yuv->height * 4, iterations) == 0) {
+        for (int i = 0; i < iterations; i++) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            IM_STATUS ret = imcvtcolor(src, dst, src.format, dst.format);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            if (ret != IM_STATUS_SUCCESS) {
+                fprintf(stderr, "RGA imcvtcolor failed: %s\n", imStrError(ret));
+                break;
+            }
+            stage_record(&st, elapsed_us(&t0, &t1));
+        }
+        stage_end(&st);
+    }
+
+out:
+    if (src_handle) releasebuffer_handle(src_handle);
+    if (dst_handle) releasebuffer_handle(dst_handle);
+    mpp_buffer_put(dst_buf);
+}
+#endif
+
+/* 解码回放的 MJPEG，之后用最后一帧解码输出测转换 */
+static void bench_file(MppBufferGroup grp, const mjpeg_file_t* mf, int iterations, int warmup, int threads)
+{
+    bench_decoder_t dec;
+    bench_stage_t st;
+    size_t max_packet = 0;
+    long us;
+    
+    for (int i = 0; i < mf->count; i++) {
+        if (mf->lengths[i] > max_packet) max_packet = mf->lengths[i];
+    }
+    if (decoder_open(&dec, grp, mf->width, mf->height, max_packet) < 0) {
+        decoder_close(&dec);
+        return;
+    }
+    
+    for (int i = 0; i < warmup; i++) {
+        int f = i % mf->count;
+        decoder_run(&dec, mf->data + mf->offsets[f], mf->lengths[f], &us);
+    }
+    
+    size_t total_bytes = 0;
+    for (int i = 0; i < mf->count; i++) total_bytes += mf->lengths[i];
+    
+    if (stage_begin(&st, "decode", "file", "mjpeg", mf->width, mf->height, 1,
+                    total_bytes / mf->count + (size_t)mf->width * mf->height * 2, iterations) == 0) {
+        int errors = 0;
+        for (int i = 0; i < iterations; i++) {
+            int f = i % mf->count;
+            if (decoder_run(&dec, mf->data + mf->offsets[f], mf->lengths[f], &us) == 0) {
+                stage_record(&st, us);
+            } else {
+                errors++;
+            }
+        }
+        if (errors) fprintf(stderr, "  decode: %d frames failed\n", errors);
+        stage_end(&st);
+    }
+    
+    if (dec.width > 0) {
+        bench_yuv_t yuv = {
+            .buf = dec.frm_buf,
+            .width = dec.width,
+            .height = dec.height,
+            .hor_stride = dec.hor_stride,
+            .ver_stride = dec.ver_stride,
+            .fmt = dec.fmt,
+        };
+        mpp_buffer_sync_begin(dec.frm_buf);
+#ifdef USE_RGA
+        bench_rga(grp, &yuv, "file", iterations, warmup);
+#endif
+        bench_cpu(&yuv, "file", 1, iterations, warmup, YUV_BT601_FULL);
+        if (threads > 1) {
+            bench_cpu(&yuv, "file", threads, iterations, warmup, YUV_BT601_FULL);
+        }
+        bench_gate(&yuv, "file", iterations, warmup);
+    }
+    
+    decoder_close(&dec);
+}
+
+static int parse_resolutions(const char* arg, int widths[], int heights[])
+{
+    char buf[256];
+    int n = 0;
+    
+    snprintf(buf, sizeof(buf), "%s", arg);
+    for (char* tok = strtok(buf, ","); tok && n < BENCH_MAX_RESOLUTIONS; tok = strtok(NULL, ",")) {
+        if (sscanf(tok, "%dx%d", &widths[n], &heights[n]) == 2 && widths[n] > 0 && heights[n] > 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* input = NULL;
+    const char* output = NULL;
+    int iterations = 200;
+    int warmup = 10;
+    int threads = 4;
+    int widths[BENCH_MAX_RESOLUTIONS] = { 640, 1280, 1920, 3840 };
+    int heights[BENCH_MAX_RESOLUTIONS] = { 480, 720, 1080, 2160 };
+    int res_count = 4;
+    static const MppFrameFormat synthetic_formats[] = { MPP_FMT_YUV420SP, MPP_FMT_YUV422SP };
+    
+    /* 解析命令行参数 */
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            res_count = parse_resolutions(argv[++i], widths, heights);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [options]\n", argv[0]);
+            printf("  -i <file>      Recorded MJPEG stream to replay (concatenated JPEG frames)\n");
+            printf("  -o <file>      Write JSON results to file (default: stdout)\n");
+            printf("  -n <frames>    Measured iterations per stage (default: 200)\n");
+            printf("  -w <frames>    Warm-up iterations per stage (default: 10)\n");
+            printf("  -t <threads>   Threads for the multi-threaded CPU conversion (default: 4)\n");
+            printf("  -r <WxH,...>   Synthetic resolutions (default: 640x480,1280x720,1920x1080,3840x2160)\n");
+            return 0;
+        }
+    }
+    if (iterations <= 0) iterations = 1;
+    if (warmup < 0) warmup = 0;
+    
+    g_json = output ? fopen(output, "w") : stdout;
+    if (!g_json) {
+        fprintf(stderr, "Failed to open %s\n", output);
+        return 1;
+    }
+    
+    MppBufferGroup grp = NULL;
+    if (mpp_buffer_group_get_internal(&grp, MPP_BUFFER_TYPE_ION) != MPP_OK) {
+        fprintf(stderr, "mpp_buffer_group_get failed\n");
+        return 1;
+    }
+    
+    fprintf(g_json, "{\n  \"benchmark\": \"camera_bench\",\n  \"timestamp\": %ld,\n  \"cpus\": %ld,\n"
+            "  \"rga\": %s,\n  \"neon\": %s,\n  \"iterations\": %d,\n  \"results\": [",
+            (long)time(NULL), sysconf(_SC_NPROCESSORS_ONLN),
+#ifdef USE_RGA
+            "true",
+#else
+            "false",
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+            "true",
+#else
+            "false",
+#endif
+            iterations);
+    
+    if (input) {
+        mjpeg_file_t mf;
+        if (mjpeg_file_load(input, &mf) == 0) {
+            bench_file(grp, &mf, iterations, warmup, threads);
+        }
+        mjpeg_file_free(&mf);
+    }
+    
+    for (int r = 0; r < res_count; r++) {
+        for (size_t f = 0; f < sizeof(synthetic_formats) / sizeof(synthetic_formats[0]); f++) {
+            bench_yuv_t yuv = {0};
+            if (synthetic_yuv_alloc(grp, widths[r], heights[r], synthetic_formats[f], &yuv) < 0) {
+                fprintf(stderr, "Synthetic %dx%d allocation failed\n", widths[r], heights[r]);
+                continue;
+            }
+#ifdef USE_RGA
+            bench_rga(grp, &yuv, "synthetic", iterations, warmup);
+#endif
+            bench_cpu(&yuv, "synthetic", 1, iterations, warmup, YUV_BT601_FULL);
+            if (threads > 1) {
+                bench_cpu(&yuv, "synthetic", threads, iterations, warmup, YUV_BT601_FULL);
+            }
+            bench_gate(&yuv, "synthetic", iterations, warmup);
+            mpp_buffer_put(yuv.buf);
+        }
+    }
+    
+    fprintf(g_json, "\n  ]\n}\n");
+    if (output) fclose(g_json);
+    mpp_buffer_group_put(grp);
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * 相机组实现
+ *
+ * 缓冲池和 RGA 调度各用一把锁：借用/归还只在锁内改计数和空闲栈，只有首次分配缓冲区时在锁内调用 MPP；
+ * RGA 调度只在超过并发上限或有更高优先级相机排队时等待。
+ * 共享缓冲区分配后保留到相机组释放，fd 不变，各相机的 RGA 句柄缓存可以一直使用。
+ */
+
+#define MODULE_TAG "camera_group"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "rockchip/mpp_buffer.h"
+
+#include "camera_group.h"
+
+/* 默认共享缓冲区总数：两路相机各 2 帧在途 + 各 1 帧在转换 + 显示持有的余量 */
+#define DEFAULT_FRAME_BUFFERS 8
+#define MAX_FRAME_BUFFERS 16
+#define MAX_MEMBERS 8
+
+struct camera_group_member {
+    camera_group_t* group;
+    int priority;
+    int reserve;
+    int in_use;                     /* 借用中的缓冲区数（pool_lock 保护） */
+    bool active;
+};
+
+struct camera_group {
+    camera_group_config_t cfg;
+
+    /* 缓冲池 */
+    pthread_mutex_t pool_lock;
+    MppBufferGroup buf_grp;
+    MppBuffer buffers[MAX_FRAME_BUFFERS];
+    MppBuffer free_list[MAX_FRAME_BUFFERS];
+    int allocated;
+    int free_count;
+    int in_use;
+    int peak;
+    size_t buffer_size;             /* 0 表示尚未确定 */
+    uint64_t denied;
+    camera_group_member_t members[MAX_MEMBERS];
+    int member_count;
+    bool destroyed;                 /* camera_group_destroy 已调用，最后一个成员离开时释放 */
+
+    /* RGA 调度 */
+    pthread_mutex_t rga_lock;
+    pthread_cond_t rga_cond;
+    int rga_active;
+    int rga_waiting[CAMERA_PRIORITY_MAX + 1];
+    uint64_t rga_jobs;
+    uint64_t rga_waits;
+    latency_stats_t lat_rga_wait;
+};
+
+static long elapsed_us(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+static void group_free(camera_group_t* group)
+{
+    for (int i = 0; i < group->allocated; i++) {
+        mpp_buffer_put(group->buffers[i]);
+    }
+    if (group->buf_grp) mpp_buffer_group_put(group->buf_grp);
+    pthread_mutex_destroy(&group->pool_lock);
+    pthread_mutex_destroy(&group->rga_lock);
+    pthread_cond_destroy(&group->rga_cond);
+    latency_stats_destroy(&group->lat_rga_wait);
+    printf("[%s] Camera group released (%d shared buffers)\n", MODULE_TAG, group->allocated);
+    free(group);
+}
+
+camera_group_t* camera_group_create(const camera_group_config_t* config)
+{
+    camera_group_t* group = (camera_group_t*)calloc(1, sizeof(camera_group_t));
+    if (!group) return NULL;
+
+    if (config) group->cfg = *config;
+    if (group->cfg.frame_buffers <= 0) group->cfg.frame_buffers = DEFAULT_FRAME_BUFFERS;
+    if (group->cfg.frame_buffers > MAX_FRAME_BUFFERS) group->cfg.frame_buffers = MAX_FRAME_BUFFERS;
+    if (group->cfg.rga_jobs <= 0) group->cfg.rga_jobs = 1;
+    if (group->cfg.max_width > 0 && group->cfg.max_height > 0) {
+        /* 与解码缓冲区相同的计算方式（16 对齐，按 NV16 2 字节/像素，NV12 输出也放得下） */
+        group->buffer_size = (size_t)((group->cfg.max_width + 15) & ~15) * ((group->cfg.max_height + 15) & ~15) * 2;
+    }
+
+    if (mpp_buffer_group_get_internal(&group->buf_grp, MPP_BUFFER_TYPE_ION) != MPP_OK) {
+        fprintf(stderr, "[%s] mpp_buffer_group_get failed\n", MODULE_TAG);
+        free(group);
+        return NULL;
+    }
+
+    pthread_mutex_init(&group->pool_lock, NULL);
+    pthread_mutex_init(&group->rga_lock, NULL);
+    pthread_cond_init(&group->rga_cond, NULL);
+    latency_stats_init(&group->lat_rga_wait);
+
+    printf("[%s] Camera group created: up to %d shared buffers, %d concurrent RGA jobs\n", MODULE_TAG,
+           group->cfg.frame_buffers, group->cfg.rga_jobs);
+    return group;
+}
+
+void camera_group_destroy(camera_group_t* group)
+{
+    if (!group) return;
+
+    pthread_mutex_lock(&group->pool_lock);
+    bool release = group->member_count == 0;
+    group->destroyed = true;
+    pthread_mutex_unlock(&group->pool_lock);
+
+    if (release) group_free(group);
+}
+
+camera_error_t camera_group_get_stats(camera_group_t* group, camera_group_stats_t* stats)
+{
+    if (!group || !stats) return CAMERA_ERROR_INVALID_PARAM;
+
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&group->pool_lock);
+    stats->cameras = group->member_count;
+    stats->buffers_allocated = group->allocated;
+    stats->buffers_in_use = group->in_use;
+    stats->buffers_peak = group->peak;
+    stats->buffer_size = group->buffer_size;
+    stats->buffers_denied = group->denied;
+    pthread_mutex_unlock(&group->pool_lock);
+
+    pthread_mutex_lock(&group->rga_lock);
+    stats->rga_jobs = group->rga_jobs;
+    stats->rga_waits = group->rga_waits;
+    pthread_mutex_unlock(&group->rga_lock);
+    latency_stats_summary(&group->lat_rga_wait, &stats->rga_wait);
+    return CAMERA_OK;
+}
+
+camera_group_member_t* camera_group_join(camera_group_t* group, int priority, int reserve)
+{
+    camera_group_member_t* member = NULL;
+
+    if (!group) return NULL;
+    if (priority < 0) priority = 0;
+    if (priority > CAMERA_PRIORITY_MAX) priority = CAMERA_PRIORITY_MAX;
+
+    pthread_mutex_lock(&group->pool_lock);
+    for (int i = 0; i < MAX_MEMBERS; i++) {
+        if (!group->members[i].active) {
+            member = &group->members[i];
+            break;
+        }
+    }
+    if (member) {
+        member->group = group;
+        member->priority = priority;
+        member->reserve = reserve > 0 ? reserve : 0;
+        member->in_use = 0;
+        member->active = true;
+        group->member_count++;
+    }
+    pthread_mutex_unlock(&group->pool_lock);
+
+    if (!member) fprintf(stderr, "[%s] Camera group is full (%d cameras)\n", MODULE_TAG, MAX_MEMBERS);
+    return member;
+}
+
+void camera_group_leave(camera_group_member_t* member)
+{
+    if (!member) return;
+    camera_group_t* group = member->group;
+
+    pthread_mutex_lock(&group->pool_lock);
+    if (member->in_use > 0) {
+        fprintf(stderr, "[%s] Camera left the group with %d borrowed buffers\n", MODULE_TAG, member->in_use);
+    }
+    member->active = false;
+    group->member_count--;
+    bool release = group->destroyed && group->member_count == 0;
+    pthread_mutex_unlock(&group->pool_lock);
+
+    if (release) group_free(group);
+}
+
+bool camera_group_pool_fits(camera_group_member_t* member, size_t size)
+{
+    if (!member) return false;
+    camera_group_t* group = member->group;
+
+    pthread_mutex_lock(&group->pool_lock);
+    if (group->buffer_size == 0) group->buffer_size = size;
+    bool fits = size <= group->buffer_size;
+    pthread_mutex_unlock(&group->pool_lock);
+    return fits;
+}
+
+/* 需要为比 member 优先级高的相机保留的缓冲区数（pool_lock 内调用） */
+static int pool_reserved_for_higher(camera_group_t* group, const camera_group_member_t* member)
+{
+    int reserved = 0;
+
+    for (int i = 0; i < MAX_MEMBERS; i++) {
+        const camera_group_member_t* m = &group->members[i];
+        if (!m->active || m->priority <= member->priority) continue;
+        if (m->reserve > m->in_use) reserved += m->reserve - m->in_use;
+    }
+    return reserved;
+}
+
+void* camera_group_buffer_get(camera_group_member_t* member)
+{
+    if (!member) return NULL;
+    camera_group_t* group = member->group;
+    MppBuffer buffer = NULL;
+
+    pthread_mutex_lock(&group->pool_lock);
+    int available = group->free_count + (group->cfg.frame_buffers - group->allocated);
+    if (available > pool_reserved_for_higher(group, member)) {
+        if (group->free_count > 0) {
+            buffer = group->free_list[--group->free_count];
+        } else if (mpp_buffer_get(group->buf_grp, &buffer, group->buffer_size) == MPP_OK) {
+            group->buffers[group->allocated++] = buffer;
+        } else {
+            fprintf(stderr, "[%s] mpp_buffer_get for shared buffer failed\n", MODULE_TAG);
+            buffer = NULL;
+        }
+    }
+    if (buffer) {
+        member->in_use++;
+        group->in_use++;
+        if (group->in_use > group->peak) group->peak = group->in_use;
+    } else {
+        group->denied++;
+    }
+    pthread_mutex_unlock(&group->pool_lock);
+
+    return buffer;
+}
+
+void camera_group_buffer_put(camera_group_member_t* member, void* buffer)
+{
+    if (!member || !buffer) return;
+    camera_group_t* group = member->group;
+
+    pthread_mutex_lock(&group->pool_lock);
+    group->free_list[group->free_count++] = (MppBuffer)buffer;
+    member->in_use--;
+    group->in_use--;
+    pthread_mutex_unlock(&group->pool_lock);
+}
+
+/* 是否有比 priority 高的相机在排队（rga_lock 内调用） */
+static bool rga_higher_waiting(camera_group_t* group, int priority)
+{
+    for (int p = priority + 1; p <= CAMERA_PRIORITY_MAX; p++) {
+        if (group->rga_waiting[p] > 0) return true;
+    }
+    return false;
+}
+
+void camera_group_rga_begin(camera_group_member_t* member)
+{
+    if (!member) return;
+    camera_group_t* group = member->group;
+    int priority = member->priority;
+
+    pthread_mutex_lock(&group->rga_lock);
+    group->rga_jobs++;
+    if (group->rga_active >= group->cfg.rga_jobs || rga_higher_waiting(group, priority)) {
+        struct timespec ts_start, ts_end;
+        clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+        group->rga_waits++;
+        group->rga_waiting[priority]++;
+        while (group->rga_active >= group->cfg.rga_jobs || rga_higher_waiting(group, priority)) {
+            pthread_cond_wait(&group->rga_cond, &group->rga_lock);
+        }
+        group->rga_waiting[priority]--;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts_end);
+        latency_stats_record(&group->lat_rga_wait, elapsed_us(&ts_start, &ts_end));
+    }
+    group->rga_active++;
+    pthread_mutex_unlock(&group->rga_lock);
+}
+
+void camera_group_rga_end(camera_group_member_t* member)
+{
+    if (!member) return;
+    camera_group_t* group = member->group;
+
+    pthread_mutex_lock(&group->rga_lock);
+    group->rga_active--;
+    pthread_cond_broadcast(&group->rga_cond);
+    pthread_mutex_unlock(&group->rga_lock);
+}
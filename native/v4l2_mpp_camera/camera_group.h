@@ -0,0 +1,68 @@
+/*
+ * 相机组 - 多个相机共享的解码输出缓冲池和 RGA 调度（库内部接口，公共接口见 v4l2_mpp_camera.h）
+ *
+ * 1. 缓冲池：缓冲区按需从 ION 分配，相机只在一帧解码到处理完（含外部持有）期间借用，
+ *    两路相机的缓冲区总数取决于同时在途的帧数，而不是每路固定预分配
+ * 2. 优先级：低优先级相机借用时要为高优先级相机留出其在途解码所需（尚未借到）的缓冲区
+ * 3. RGA 调度：同时提交的作业数有上限，排队时高优先级相机先执行
+ * 4. 相机组引用计数：camera_group_destroy 后最后一个成员离开时才释放
+ */
+
+#ifndef CAMERA_GROUP_H
+#define CAMERA_GROUP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "v4l2_mpp_camera.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 相机组成员（每个相机一个） */
+typedef struct camera_group_member camera_group_member_t;
+
+/**
+ * 加入相机组
+ * @param group 相机组
+ * @param priority 优先级（超出 0~CAMERA_PRIORITY_MAX 时截断）
+ * @param reserve 在途解码需要的缓冲区数，低优先级相机不能占用
+ * @return 成员句柄，组内相机已满返回 NULL
+ */
+camera_group_member_t* camera_group_join(camera_group_t* group, int priority, int reserve);
+
+/**
+ * 离开相机组（借用的缓冲区必须已全部归还）
+ */
+void camera_group_leave(camera_group_member_t* member);
+
+/**
+ * 该成员能否使用共享缓冲区（第一个询问的成员决定未配置时的缓冲区大小）
+ * @param size 每帧需要的字节数
+ * @return true 共享缓冲区足够大
+ */
+bool camera_group_pool_fits(camera_group_member_t* member, size_t size);
+
+/**
+ * 借用一个共享缓冲区（采集线程调用，不阻塞）
+ * @return MppBuffer，缓冲池已满或需为高优先级相机保留时返回 NULL
+ */
+void* camera_group_buffer_get(camera_group_member_t* member);
+
+/**
+ * 归还共享缓冲区（可在任意线程调用）
+ */
+void camera_group_buffer_put(camera_group_member_t* member, void* buffer);
+
+/**
+ * RGA 作业开始/结束，超过并发上限时按优先级排队（member 为 NULL 时不调度）
+ */
+void camera_group_rga_begin(camera_group_member_t* member);
+void camera_group_rga_end(camera_group_member_t* member);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAMERA_GROUP_H */
@@ -0,0 +1,757 @@
+/*
+ * V4L2 + MPP Camera Soak Test
+ *
+ * 长时间循环创建/启动/重新配置/停止/销毁两个库的句柄，检测内存增长、fd 泄漏和延迟漂移：
+ * 1. camera  - camera_init_ex → start → reconfigure → 空闲/正常模式切换 → stop → deinit（带 BGRA 检测流，经过 RGA 导入）
+ * 2. player  - gst_player_create → start → reconfigure → 模式切换 → stop → destroy（界面切换窗口时的路径）
+ * 3. shared  - 相机 + 共享采集播放器（shared_camera），两个库的句柄同时创建和销毁
+ * 默认三种依次轮换（-m 只跑其中一种）。
+ *
+ * 每轮句柄全部销毁后采样 RSS、fd 数、进程映射的 dmabuf 字节数和系统 dmabuf 总量（ION/DMA heap 缓冲区都是 dmabuf），
+ * 以及该轮各阶段的 p95 延迟。预热轮之后取前一个窗口的中位数作为基准，之后每轮与最近一个窗口的中位数比较，
+ * 任何一项超过阈值（资源为绝对增长，延迟为相对增长）即失败退出，返回 1。
+ * 每轮输出一行 JSON（JSON Lines），便于画出随时间的变化曲线。
+ *
+ * 回放：-i 指定录制的 MJPEG 文件（与 camera_bench 相同，多帧 JPEG 直接拼接）时，启动 ffmpeg 把它循环写入
+ * -d 指定的 v4l2loopback 设备，不需要真实摄像头和画面变化。
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <glob.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "v4l2_mpp_camera.h"
+#include "gst_video_player.h"
+
+#define SOAK_LATENCY_SLACK_US 2000      /* 延迟漂移的绝对容差，避免低延迟阶段的抖动触发相对阈值 */
+#define SOAK_MODE_SWITCH_MS 500         /* 空闲/正常模式各保持的时间 */
+#define SOAK_REPLAY_SETTLE_MS 1000      /* 启动回放后等待 v4l2loopback 有数据 */
+#define SOAK_DETECT_WIDTH 320
+#define SOAK_DETECT_HEIGHT 240
+#define SOAK_DETECT_FPS 10
+
+/* 循环类型 */
+typedef enum {
+    SOAK_MODE_CAMERA = 0,
+    SOAK_MODE_PLAYER = 1,
+    SOAK_MODE_SHARED = 2,
+    SOAK_MODE_COUNT = 3,
+} soak_mode_t;
+
+static const char* const g_mode_names[SOAK_MODE_COUNT] = { "camera", "player", "shared" };
+
+/* 每轮采集的延迟阶段（p95，微秒） */
+typedef enum {
+    SOAK_LAT_CAPTURE = 0,       /* 相机：驱动时间戳 -> 出队 */
+    SOAK_LAT_DECODE,            /* 相机：送入 MPP -> 取回解码结果 */
+    SOAK_LAT_CONVERT,           /* 相机：取回解码结果 -> 各输出流发布 */
+    SOAK_LAT_END_TO_END,        /* 相机：出队 -> 各输出流发布 */
+    SOAK_LAT_CAMERA_CALLBACK,   /* 相机：用户回调 */
+    SOAK_LAT_DISPLAY,           /* 播放器：采集 -> 送达显示 sink */
+    SOAK_LAT_PLAYER_CALLBACK,   /* 播放器：检测帧回调 */
+    SOAK_LAT_FIRST_FRAME,       /* 播放器：start 到首帧送显 */
+    SOAK_LAT_COUNT,
+} soak_latency_t;
+
+static const char* const g_latency_names[SOAK_LAT_COUNT] = {
+    "capture", "decode", "convert", "end_to_end", "camera_callback", "display", "player_callback", "first_frame",
+};
+
+/* 资源指标 */
+typedef enum {
+    SOAK_RES_RSS_KB = 0,
+    SOAK_RES_FDS,
+    SOAK_RES_DMABUF_MAPPED_KB,  /* 本进程映射的 dmabuf（/proc/self/maps） */
+    SOAK_RES_DMABUF_SYSTEM_KB,  /* 系统 dmabuf 总量（/sys/kernel/dmabuf 或 debugfs，无权限时不可用） */
+    SOAK_RES_COUNT,
+} soak_resource_t;
+
+static const char* const g_resource_names[SOAK_RES_COUNT] = {
+    "rss_kb", "fds", "dmabuf_mapped_kb", "dmabuf_system_kb",
+};
+
+/* 一项指标随轮次的样本，-1 表示该轮不可用 */
+typedef struct {
+    char name[48];
+    int latency;                /* 1 延迟（相对阈值），0 资源（绝对阈值） */
+    double limit;               /* 资源：允许的增长量；延迟：允许的增长百分比 */
+    double* values;
+    int count;
+    int capacity;
+    double baseline;
+    int has_baseline;
+    double current;
+    int failed;
+} soak_series_t;
+
+/* 一轮的结果 */
+typedef struct {
+    soak_mode_t mode;
+    int ok;
+    uint64_t frames;
+    double resources[SOAK_RES_COUNT];
+    double latency[SOAK_LAT_COUNT];
+} soak_cycle_t;
+
+/* 命令行配置 */
+typedef struct {
+    const char* device;
+    const char* replay;
+    int width, height, fps;
+    int alt_width, alt_height, alt_fps;
+    int mode;                   /* -1 表示轮换 */
+    int headless;
+    int run_ms;
+    int warmup;
+    int window;
+    int max_cycles;
+    int minutes;
+    int max_failures;
+    double rss_mb;
+    double fd_limit;
+    double dmabuf_mb;
+    double latency_pct;
+} soak_options_t;
+
+static volatile int g_running = 1;
+static atomic_uint_fast64_t g_frames;
+static FILE* g_json = NULL;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    g_running = 0;
+}
+
+/* 可被信号打断的睡眠 */
+static void soak_sleep_ms(int ms)
+{
+    for (int i = 0; i < ms / 50 && g_running; i++) {
+        usleep(50000);
+    }
+}
+
+static void on_camera_frame(void* user_data, uint8_t* data, int width, int height, int stride)
+{
+    (void)user_data; (void)data; (void)width; (void)height; (void)stride;
+    atomic_fetch_add(&g_frames, 1);
+}
+
+static void on_player_frame(void* user_data, uint8_t* data, int width, int height, int stride,
+                            const gst_player_frame_info_t* info)
+{
+    (void)user_data; (void)data; (void)width; (void)height; (void)stride; (void)info;
+    atomic_fetch_add(&g_frames, 1);
+}
+
+/* ============================================
+ * 资源采样
+ * ============================================ */
+
+static double read_rss_kb(void)
+{
+    char line[256];
+    double kb = -1;
+    FILE* fp = fopen("/proc/self/status", "r");
+
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+        long v;
+        if (sscanf(line, "VmRSS: %ld kB", &v) == 1) {
+            kb = v;
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+static double count_fds(void)
+{
+    DIR* dir = opendir("/proc/self/fd");
+    struct dirent* ent;
+    int n = 0;
+
+    if (!dir) return -1;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] != '.') n++;
+    }
+    closedir(dir);
+    return n - 1;   /* 不计 opendir 自己的 fd */
+}
+
+/* 映射到本进程的 dmabuf（anon_inode:dmabuf 或 /dmabuf:，内核版本不同名称不同） */
+static double read_mapped_dmabuf_kb(void)
+{
+    char line[512];
+    unsigned long long total = 0;
+    FILE* fp = fopen("/proc/self/maps", "r");
+
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long start, end;
+        if (strstr(line, "dmabuf") && sscanf(line, "%llx-%llx", &start, &end) == 2) {
+            total += end - start;
+        }
+    }
+    fclose(fp);
+    return (double)(total / 1024);
+}
+
+/* 系统 dmabuf 总量：优先 CONFIG_DMABUF_SYSFS_STATS，否则 debugfs 的 bufinfo 汇总行 */
+static double read_system_dmabuf_kb(void)
+{
+    glob_t g;
+    unsigned long long total = 0;
+    int found = 0;
+
+    if (glob("/sys/kernel/dmabuf/buffers/*/size", 0, NULL, &g) == 0) {
+        for (size_t i = 0; i < g.gl_pathc; i++) {
+            FILE* fp = fopen(g.gl_pathv[i], "r");
+            unsigned long long size;
+            if (fp && fscanf(fp, "%llu", &size) == 1) {
+                total += size;
+                found = 1;
+            }
+            if (fp) fclose(fp);
+        }
+        globfree(&g);
+        if (found) return (double)(total / 1024);
+    }
+
+    char line[256];
+    FILE* fp = fopen("/sys/kernel/debug/dma_buf/bufinfo", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+        int objects;
+        if (sscanf(line, "Total %d objects, %llu bytes", &objects, &total) == 2) {
+            found = 1;
+        }
+    }
+    fclose(fp);
+    return found ? (double)(total / 1024) : -1;
+}
+
+static void sample_resources(double out[SOAK_RES_COUNT])
+{
+    out[SOAK_RES_RSS_KB] = read_rss_kb();
+    out[SOAK_RES_FDS] = count_fds();
+    out[SOAK_RES_DMABUF_MAPPED_KB] = read_mapped_dmabuf_kb();
+    out[SOAK_RES_DMABUF_SYSTEM_KB] = read_system_dmabuf_kb();
+}
+
+/* ============================================
+ * 漂移检测
+ * ============================================ */
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : (x > y);
+}
+
+static double median(const double* values, int n)
+{
+    double* tmp = (double*)malloc(n * sizeof(double));
+    double m;
+
+    if (!tmp) return values[n - 1];
+    memcpy(tmp, values, n * sizeof(double));
+    qsort(tmp, n, sizeof(double), compare_double);
+    m = n % 2 ? tmp[n / 2] : (tmp[n / 2 - 1] + tmp[n / 2]) / 2;
+    free(tmp);
+    return m;
+}
+
+static void series_init(soak_series_t* s, const char* name, int latency, double limit)
+{
+    memset(s, 0, sizeof(*s));
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    s->latency = latency;
+    s->limit = limit;
+}
+
+/* 加入一个样本；前 window 个样本确定基准后，每个样本都与最近 window 个样本的中位数比较
+ * @return 1 漂移超过阈值 */
+static int series_add(soak_series_t* s, double v, int window)
+{
+    if (v < 0) return 0;
+    if (s->count == s->capacity) {
+        int capacity = s->capacity ? s->capacity * 2 : 256;
+        double* values = (double*)realloc(s->values, capacity * sizeof(double));
+        if (!values) return 0;
+        s->values = values;
+        s->capacity = capacity;
+    }
+    s->values[s->count++] = v;
+
+    if (!s->has_baseline) {
+        if (s->count == window) {
+            s->baseline = median(s->values, window);
+            s->has_baseline = 1;
+        }
+        return 0;
+    }
+    if (s->count < 2 * window) return 0;
+
+    s->current = median(s->values + s->count - window, window);
+    s->failed = s->latency
+        ? s->current > s->baseline * (1.0 + s->limit / 100.0) + SOAK_LATENCY_SLACK_US
+        : s->current - s->baseline > s->limit;
+    return s->failed;
+}
+
+/* 汇总输出一项指标（有基准和当前窗口时）并释放样本 */
+static void series_report(soak_series_t* s, int window, int* reported)
+{
+    if (s->has_baseline && s->count >= 2 * window) {
+        fprintf(g_json, "%s{\"metric\": \"%s\", \"baseline\": %.0f, \"current\": %.0f, \"limit\": %.0f, "
+                "\"limit_unit\": \"%s\", \"drift\": %s}", *reported ? ", " : "", s->name, s->baseline, s->current,
+                s->limit, s->latency ? "percent" : "absolute", s->failed ? "true" : "false");
+        (*reported)++;
+    }
+    if (s->failed) {
+        fprintf(stderr, "DRIFT %s: baseline %.0f -> %.0f (limit +%.0f%s)\n", s->name, s->baseline, s->current,
+                s->limit, s->latency ? "%" : "");
+    }
+    free(s->values);
+    s->values = NULL;
+}
+
+/* ============================================
+ * 循环
+ * ============================================ */
+
+static void camera_config_fill(const soak_options_t* opt, camera_config_t* config)
+{
+    memset(config, 0, sizeof(*config));
+    config->device = opt->device;
+    config->width = opt->width;
+    config->height = opt->height;
+    config->fps = opt->fps;
+    config->detect_format = CAMERA_PIXEL_FORMAT_BGRA8888;
+    config->detect_width = SOAK_DETECT_WIDTH;
+    config->detect_height = SOAK_DETECT_HEIGHT;
+}
+
+static void camera_latency(camera_handle_t camera, soak_cycle_t* out)
+{
+    camera_stats_t stats;
+
+    if (camera_get_stats(camera, &stats) != CAMERA_OK) return;
+    out->latency[SOAK_LAT_CAPTURE] = stats.capture.count ? (double)stats.capture.p95_us : -1;
+    out->latency[SOAK_LAT_DECODE] = stats.decode.count ? (double)stats.decode.p95_us : -1;
+    out->latency[SOAK_LAT_CONVERT] = stats.convert.count ? (double)stats.convert.p95_us : -1;
+    out->latency[SOAK_LAT_END_TO_END] = stats.end_to_end.count ? (double)stats.end_to_end.p95_us : -1;
+    out->latency[SOAK_LAT_CAMERA_CALLBACK] = stats.callback.count ? (double)stats.callback.p95_us : -1;
+}
+
+static void player_latency(gst_player_handle_t player, soak_cycle_t* out)
+{
+    gst_player_perf_stats_t stats;
+
+    if (gst_player_get_perf_stats(player, &stats) != GST_PLAYER_OK) return;
+    out->latency[SOAK_LAT_DISPLAY] = stats.display_latency.count ? (double)stats.display_latency.p95_us : -1;
+    out->latency[SOAK_LAT_PLAYER_CALLBACK] = stats.callback.count ? (double)stats.callback.p95_us : -1;
+    out->latency[SOAK_LAT_FIRST_FRAME] = stats.first_frame_us > 0 ? (double)stats.first_frame_us : -1;
+}
+
+/* 相机：启动 → 切换格式 → 空闲/正常模式 → 停止，返回 0 成功 */
+static int cycle_camera(const soak_options_t* opt, soak_cycle_t* out)
+{
+    camera_config_t config;
+    camera_error_t err;
+
+    camera_config_fill(opt, &config);
+    camera_handle_t camera = camera_init_ex(&config);
+    if (!camera) {
+        fprintf(stderr, "camera_init_ex failed\n");
+        return -1;
+    }
+    camera_set_detect_callback(camera, on_camera_frame, NULL);
+    err = camera_start(camera, on_camera_frame, NULL);
+    if (err != CAMERA_OK) {
+        fprintf(stderr, "camera_start failed: %s\n", camera_get_error_string(err));
+        camera_deinit(camera);
+        return -1;
+    }
+
+    soak_sleep_ms(opt->run_ms / 2);
+    err = camera_reconfigure(camera, opt->alt_width, opt->alt_height, opt->alt_fps);
+    if (err != CAMERA_OK && err != CAMERA_ERROR_NOT_SUPPORTED) {
+        fprintf(stderr, "camera_reconfigure failed: %s\n", camera_get_error_string(err));
+    }
+    soak_sleep_ms(opt->run_ms / 2);
+    camera_set_mode(camera, CAMERA_MODE_IDLE);
+    soak_sleep_ms(SOAK_MODE_SWITCH_MS);
+    camera_set_mode(camera, CAMERA_MODE_ACTIVE);
+    soak_sleep_ms(SOAK_MODE_SWITCH_MS);
+
+    camera_latency(camera, out);
+    camera_stop(camera);
+    camera_deinit(camera);
+    return 0;
+}
+
+/* 播放器（shared 时相机由这里创建并作为共享采集源）：启动 → 切换格式 → 模式切换 → 停止，返回 0 成功 */
+static int cycle_player(const soak_options_t* opt, int shared, soak_cycle_t* out)
+{
+    camera_handle_t camera = NULL;
+    gst_player_error_t ret;
+    int result = -1;
+
+    if (shared) {
+        camera_config_t config;
+        camera_config_fill(opt, &config);
+        camera = camera_init_ex(&config);
+        if (!camera) {
+            fprintf(stderr, "camera_init_ex failed\n");
+            return -1;
+        }
+        camera_error_t err = camera_start(camera, NULL, NULL);
+        if (err != CAMERA_OK) {
+            fprintf(stderr, "camera_start failed: %s\n", camera_get_error_string(err));
+            camera_deinit(camera);
+            return -1;
+        }
+    }
+
+    gst_player_config_t config = {
+        .device = opt->device,
+        .width = opt->width,
+        .height = opt->height,
+        .fps = opt->fps,
+        .format = GST_PLAYER_FORMAT_MJPEG,
+        .use_hardware_decode = true,
+        .use_rga = true,
+        .face_detect_fps = SOAK_DETECT_FPS,
+        .face_detect_width = SOAK_DETECT_WIDTH,
+        .face_detect_height = SOAK_DETECT_HEIGHT,
+        .shared_camera = camera,
+        .face_detect_format = GST_PLAYER_PIXEL_BGRA,
+    };
+    gst_player_handle_t player = gst_player_create(&config);
+    if (!player) {
+        fprintf(stderr, "gst_player_create failed\n");
+        goto out;
+    }
+    if (opt->headless) {
+        gst_player_set_branch_enabled(player, GST_PLAYER_BRANCH_DISPLAY, false);
+    }
+    gst_player_set_frame_info_callback(player, on_player_frame, NULL);
+
+    ret = gst_player_start(player);
+    if (ret != GST_PLAYER_OK) {
+        fprintf(stderr, "gst_player_start failed: %s\n", gst_player_get_error_string(ret));
+        gst_player_destroy(player);
+        goto out;
+    }
+
+    soak_sleep_ms(opt->run_ms / 2);
+    ret = gst_player_reconfigure(player, opt->alt_width, opt->alt_height, opt->alt_fps);
+    if (ret != GST_PLAYER_OK) {
+        fprintf(stderr, "gst_player_reconfigure failed: %s\n", gst_player_get_error_string(ret));
+    }
+    soak_sleep_ms(opt->run_ms / 2);
+    gst_player_set_mode(player, GST_PLAYER_MODE_IDLE);
+    soak_sleep_ms(SOAK_MODE_SWITCH_MS);
+    gst_player_set_mode(player, GST_PLAYER_MODE_ACTIVE);
+    soak_sleep_ms(SOAK_MODE_SWITCH_MS);
+
+    player_latency(player, out);
+    if (camera) camera_latency(camera, out);
+    gst_player_stop(player);
+    if (camera) camera_stop(camera);   /* 播放器销毁前先停止共享的相机（camera_stop 可重复调用） */
+    gst_player_destroy(player);
+    result = 0;
+
+out:
+    if (camera) {
+        camera_stop(camera);
+        camera_deinit(camera);
+    }
+    return result;
+}
+
+static void run_cycle(const soak_options_t* opt, soak_mode_t mode, soak_cycle_t* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->mode = mode;
+    for (int i = 0; i < SOAK_LAT_COUNT; i++) out->latency[i] = -1;
+
+    atomic_store(&g_frames, 0);
+    int ret = mode == SOAK_MODE_CAMERA ? cycle_camera(opt, out) : cycle_player(opt, mode == SOAK_MODE_SHARED, out);
+    out->frames = atomic_load(&g_frames);
+    out->ok = ret == 0 && out->frames > 0;
+
+    sample_resources(out->resources);
+}
+
+static void print_cycle(int index, double elapsed_s, const soak_cycle_t* c)
+{
+    fprintf(stderr, "  #%-5d %-6s %-4s frames %6llu  rss %8.0f kB  fds %4.0f  dmabuf %8.0f/%8.0f kB",
+            index, g_mode_names[c->mode], c->ok ? "ok" : "FAIL", (unsigned long long)c->frames,
+            c->resources[SOAK_RES_RSS_KB], c->resources[SOAK_RES_FDS],
+            c->resources[SOAK_RES_DMABUF_MAPPED_KB], c->resources[SOAK_RES_DMABUF_SYSTEM_KB]);
+    if (c->latency[SOAK_LAT_END_TO_END] >= 0) fprintf(stderr, "  e2e p95 %6.0f us", c->latency[SOAK_LAT_END_TO_END]);
+    if (c->latency[SOAK_LAT_DISPLAY] >= 0) fprintf(stderr, "  display p95 %6.0f us", c->latency[SOAK_LAT_DISPLAY]);
+    fputc('\n', stderr);
+
+    fprintf(g_json, "{\"cycle\": %d, \"elapsed_s\": %.1f, \"mode\": \"%s\", \"ok\": %s, \"frames\": %llu",
+            index, elapsed_s, g_mode_names[c->mode], c->ok ? "true" : "false", (unsigned long long)c->frames);
+    for (int i = 0; i < SOAK_RES_COUNT; i++) {
+        fprintf(g_json, ", \"%s\": %.0f", g_resource_names[i], c->resources[i]);
+    }
+    fprintf(g_json, ", \"latency_p95_us\": {");
+    int first = 1;
+    for (int i = 0; i < SOAK_LAT_COUNT; i++) {
+        if (c->latency[i] < 0) continue;
+        fprintf(g_json, "%s\"%s\": %.0f", first ? "" : ", ", g_latency_names[i], c->latency[i]);
+        first = 0;
+    }
+    fprintf(g_json, "}}\n");
+    fflush(g_json);
+}
+
+static int parse_format(const char* arg, int* width, int* height, int* fps)
+{
+    int w, h, f = *fps;
+    int n = sscanf(arg, "%dx%d@%d", &w, &h, &f);
+    if (n < 2 || w <= 0 || h <= 0 || f <= 0) return -1;
+    *width = w;
+    *height = h;
+    *fps = f;
+    return 0;
+}
+
+/* 回放：ffmpeg 按原帧率循环写入 v4l2loopback（MJPEG 直接复制，不重新编码） */
+static pid_t replay_start(const char* file, const char* device, int fps)
+{
+    char rate[16];
+    pid_t pid = fork();
+
+    if (pid != 0) return pid;
+    snprintf(rate, sizeof(rate), "%d", fps);
+    execlp("ffmpeg", "ffmpeg", "-hide_banner", "-loglevel", "error", "-re", "-stream_loop", "-1",
+           "-f", "mjpeg", "-framerate", rate, "-i", file, "-c:v", "copy", "-f", "v4l2", device, (char*)NULL);
+    fprintf(stderr, "Failed to run ffmpeg for replay\n");
+    _exit(127);
+}
+
+static void replay_stop(pid_t pid)
+{
+    if (pid <= 0) return;
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+}
+
+int main(int argc, char* argv[])
+{
+    soak_options_t opt = {
+        .device = "/dev/video0",
+        .width = 1280, .height = 720, .fps = 30,
+        .alt_width = 640, .alt_height = 480, .alt_fps = 30,
+        .mode = -1,
+        .run_ms = 4000,
+        .warmup = 5,
+        .window = 10,
+        .minutes = 60,
+        .max_failures = 3,
+        .rss_mb = 8,
+        .fd_limit = 4,
+        .dmabuf_mb = 8,
+        .latency_pct = 50,
+    };
+    const char* output = NULL;
+
+    /* 解析命令行参数 */
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            opt.device = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            opt.replay = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            if (parse_format(argv[++i], &opt.width, &opt.height, &opt.fps) < 0) {
+                fprintf(stderr, "Invalid format: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            if (parse_format(argv[++i], &opt.alt_width, &opt.alt_height, &opt.alt_fps) < 0) {
+                fprintf(stderr, "Invalid format: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            opt.mode = -2;
+            for (int m = 0; m < SOAK_MODE_COUNT; m++) {
+                if (strcmp(name, g_mode_names[m]) == 0) opt.mode = m;
+            }
+            if (strcmp(name, "all") == 0) opt.mode = -1;
+            if (opt.mode == -2) {
+                fprintf(stderr, "Unknown mode: %s\n", name);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            opt.minutes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            opt.max_cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            opt.run_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            opt.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc) {
+            opt.window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            opt.max_failures = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-H") == 0) {
+            opt.headless = 1;
+        } else if (strcmp(argv[i], "--rss-mb") == 0 && i + 1 < argc) {
+            opt.rss_mb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--fds") == 0 && i + 1 < argc) {
+            opt.fd_limit = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--dmabuf-mb") == 0 && i + 1 < argc) {
+            opt.dmabuf_mb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--latency-pct") == 0 && i + 1 < argc) {
+            opt.latency_pct = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [options]\n", argv[0]);
+            printf("  -d <device>        Camera device, or a v4l2loopback node with -i (default: /dev/video0)\n");
+            printf("  -i <file>          Replay a recorded MJPEG stream into the loopback device via ffmpeg\n");
+            printf("  -s <WxH@fps>       Start format (default: 1280x720@30)\n");
+            printf("  -a <WxH@fps>       Format switched to in each cycle (default: 640x480@30)\n");
+            printf("  -m <mode>          camera, player, shared or all (default: all, alternating)\n");
+            printf("  -T <minutes>       Total duration (default: 60, 0 = until -c or Ctrl+C)\n");
+            printf("  -c <cycles>        Stop after this many cycles (default: 0 = no limit)\n");
+            printf("  -r <ms>            Run time per cycle, split around the format switch (default: 4000)\n");
+            printf("  -W <cycles>        Warm-up cycles excluded from the baseline (default: 5)\n");
+            printf("  -N <samples>       Baseline/current window size per metric (default: 10)\n");
+            printf("  -e <cycles>        Fail after this many consecutive failed cycles (default: 3)\n");
+            printf("  -H                 Headless: disconnect the player's display branch\n");
+            printf("  -o <file>          Write per-cycle JSON lines to file (default: stdout)\n");
+            printf("  --rss-mb <mb>      Allowed RSS growth (default: 8)\n");
+            printf("  --fds <n>          Allowed open fd growth (default: 4)\n");
+            printf("  --dmabuf-mb <mb>   Allowed mapped/system dmabuf growth (default: 8)\n");
+            printf("  --latency-pct <p>  Allowed p95 latency growth in percent (default: 50)\n");
+            return 0;
+        }
+    }
+    if (opt.run_ms < 100) opt.run_ms = 100;
+    if (opt.warmup < 0) opt.warmup = 0;
+    if (opt.window < 1) opt.window = 1;
+    if (opt.max_failures < 1) opt.max_failures = 1;
+
+    g_json = output ? fopen(output, "w") : stdout;
+    if (!g_json) {
+        fprintf(stderr, "Failed to open %s\n", output);
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    if (opt.mode != SOAK_MODE_CAMERA && gst_player_global_init() != GST_PLAYER_OK) {
+        fprintf(stderr, "gst_player_global_init failed\n");
+        return 1;
+    }
+
+    pid_t replay_pid = -1;
+    if (opt.replay) {
+        replay_pid = replay_start(opt.replay, opt.device, opt.fps);
+        if (replay_pid < 0) {
+            fprintf(stderr, "Failed to start replay\n");
+            return 1;
+        }
+        soak_sleep_ms(SOAK_REPLAY_SETTLE_MS);
+    }
+
+    /* 资源指标每轮都有；延迟按循环类型分开（独立相机和共享采集的解码路径不同） */
+    soak_series_t resources[SOAK_RES_COUNT];
+    soak_series_t latency[SOAK_MODE_COUNT][SOAK_LAT_COUNT];
+    double resource_limits[SOAK_RES_COUNT] = {
+        opt.rss_mb * 1024, opt.fd_limit, opt.dmabuf_mb * 1024, opt.dmabuf_mb * 1024,
+    };
+    for (int r = 0; r < SOAK_RES_COUNT; r++) {
+        series_init(&resources[r], g_resource_names[r], 0, resource_limits[r]);
+    }
+    for (int m = 0; m < SOAK_MODE_COUNT; m++) {
+        for (int l = 0; l < SOAK_LAT_COUNT; l++) {
+            char name[48];
+            snprintf(name, sizeof(name), "%s.%s_p95_us", g_mode_names[m], g_latency_names[l]);
+            series_init(&latency[m][l], name, 1, opt.latency_pct);
+        }
+    }
+
+    fprintf(stderr, "Soak: %s %dx%d@%d <-> %dx%d@%d, %s, %d ms per cycle%s\n", opt.device,
+            opt.width, opt.height, opt.fps, opt.alt_width, opt.alt_height, opt.alt_fps,
+            opt.mode < 0 ? "all modes" : g_mode_names[opt.mode], opt.run_ms, opt.replay ? ", replay" : "");
+
+    struct timespec t_start, now;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    int cycles = 0, failed_cycles = 0, consecutive_failures = 0, drift = 0;
+
+    while (g_running && !drift && (opt.max_cycles <= 0 || cycles < opt.max_cycles)) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed_s = (now.tv_sec - t_start.tv_sec) + (now.tv_nsec - t_start.tv_nsec) / 1e9;
+        if (opt.minutes > 0 && elapsed_s >= opt.minutes * 60.0) break;
+
+        soak_cycle_t c;
+        soak_mode_t mode = opt.mode >= 0 ? (soak_mode_t)opt.mode : (soak_mode_t)(cycles % SOAK_MODE_COUNT);
+        run_cycle(&opt, mode, &c);
+        print_cycle(cycles, elapsed_s, &c);
+
+        if (!c.ok) {
+            failed_cycles++;
+            if (++consecutive_failures >= opt.max_failures) {
+                fprintf(stderr, "%d consecutive cycles failed\n", consecutive_failures);
+                break;
+            }
+        } else {
+            consecutive_failures = 0;
+        }
+
+        /* 预热轮（首次打开设备、加载插件、建立缓冲池）不计入基准 */
+        if (cycles++ < opt.warmup) continue;
+        for (int r = 0; r < SOAK_RES_COUNT; r++) {
+            drift |= series_add(&resources[r], c.resources[r], opt.window);
+        }
+        if (c.ok) {
+            for (int l = 0; l < SOAK_LAT_COUNT; l++) {
+                drift |= series_add(&latency[mode][l], c.latency[l], opt.window);
+            }
+        }
+    }
+
+    replay_stop(replay_pid);
+
+    /* 汇总（最后一行 JSON）：各指标的基准/当前值，以及是否超过阈值 */
+    int pass = !drift && consecutive_failures < opt.max_failures;
+    fprintf(g_json, "{\"summary\": true, \"cycles\": %d, \"failed_cycles\": %d, \"result\": \"%s\", \"metrics\": [",
+            cycles, failed_cycles, pass ? "pass" : "fail");
+    int reported = 0;
+    for (int r = 0; r < SOAK_RES_COUNT; r++) {
+        series_report(&resources[r], opt.window, &reported);
+    }
+    for (int m = 0; m < SOAK_MODE_COUNT; m++) {
+        for (int l = 0; l < SOAK_LAT_COUNT; l++) {
+            series_report(&latency[m][l], opt.window, &reported);
+        }
+    }
+    fprintf(g_json, "]}\n");
+    if (output) fclose(g_json);
+
+    fprintf(stderr, "Soak %s: %d cycles, %d failed\n", pass ? "passed" : "FAILED", cycles, failed_cycles);
+    return pass ? 0 : 1;
+}
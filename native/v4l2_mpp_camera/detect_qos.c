@@ -0,0 +1,251 @@
+/*
+ * 检测自适应实现
+ *
+ * 回调执行时间在任意线程中累加到原子计数器，评估线程每个周期取走；档位和对外发布的工作点为原子变量。
+ * 升档前按像素数之比估算升档后的回调时间，估算会超出预算或占用率上限时保持当前档位。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "detect_qos.h"
+
+#define DEFAULT_MIN_FPS 2
+#define DEFAULT_BUDGET_MS 300
+#define DEFAULT_CPU_HIGH_PERCENT 85
+#define DEFAULT_CPU_LOW_PERCENT 60
+#define DEFAULT_INTERVAL_MS 1000
+#define OVERLOAD_OCCUPANCY_PERCENT 80   /* 回调执行时间占检测帧间隔的比例高于此值视为过载 */
+#define IDLE_OCCUPANCY_PERCENT 50       /* 低于此值且升档后估算不超过 OVERLOAD 的 7/8 才允许升档 */
+#define OVERLOAD_DROP_PERCENT 10        /* 一个周期内丢帧超过应交付帧数的此比例视为过载 */
+#define UPGRADE_PERIODS 3               /* 连续空闲的周期数达到此值才升一档 */
+#define SIZE_ALIGN 16                   /* 缩放宽度对齐（RGA 和 NEON 路径的行对齐） */
+
+/* 档位表比例（帧率百分比, 尺寸百分比），交替降低帧率和尺寸 */
+static const int g_level_steps[][2] = {
+    { 100, 100 }, { 75, 100 }, { 75, 75 }, { 50, 75 }, { 50, 50 }, { 33, 50 }, { 25, 50 }, { 25, 25 },
+};
+
+typedef struct {
+    int fps;
+    int width;
+    int height;
+} qos_level_t;
+
+struct detect_qos {
+    detect_qos_config_t cfg;
+    qos_level_t levels[DETECT_QOS_MAX_LEVELS];
+    int level_count;
+
+    /* 仅评估线程访问 */
+    int64_t last_us;                /* 上次评估时刻，0 表示尚未开始 */
+    uint64_t last_drops;
+    uint64_t cpu_busy;              /* 上次读取的 /proc/stat 累计值 */
+    uint64_t cpu_total;
+    int calm_periods;
+
+    atomic_int_fast64_t next_due_us;
+    atomic_uint_fast64_t callbacks;
+    atomic_uint_fast64_t callback_total_us;
+    atomic_bool reset_pending;
+
+    /* 对外发布的工作点 */
+    atomic_int level;
+    atomic_int cpu_percent;
+    atomic_int callback_us;
+    atomic_uint_fast64_t adjustments;
+};
+
+/* 读取 /proc/stat 的总 CPU 时间，返回距上次读取的占用百分比，无法读取或首次读取返回 -1 */
+static int read_cpu_percent(detect_qos_t* qos)
+{
+    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+    FILE* fp = fopen("/proc/stat", "r");
+
+    if (!fp) return -1;
+    int n = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                   &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+    fclose(fp);
+    if (n < 4) return -1;
+    if (n < 8) {
+        if (n < 5) iowait = 0;
+        if (n < 6) irq = 0;
+        if (n < 7) softirq = 0;
+        steal = 0;
+    }
+
+    uint64_t busy = user + nice + system + irq + softirq + steal;
+    uint64_t total = busy + idle + iowait;
+    uint64_t busy_delta = busy - qos->cpu_busy;
+    uint64_t total_delta = total - qos->cpu_total;
+    bool first = qos->cpu_total == 0;
+
+    qos->cpu_busy = busy;
+    qos->cpu_total = total;
+    if (first || total_delta == 0) return -1;
+    return (int)(busy_delta * 100 / total_delta);
+}
+
+/* 按比例生成档位表，相邻相同的档位合并 */
+static void build_levels(detect_qos_t* qos)
+{
+    const detect_qos_config_t* cfg = &qos->cfg;
+    int steps = (int)(sizeof(g_level_steps) / sizeof(g_level_steps[0]));
+
+    qos->level_count = 0;
+    for (int i = 0; i < steps && qos->level_count < DETECT_QOS_MAX_LEVELS; i++) {
+        qos_level_t lv;
+        lv.fps = (cfg->max_fps * g_level_steps[i][0] + 50) / 100;
+        if (lv.fps < cfg->min_fps) lv.fps = cfg->min_fps;
+
+        if (g_level_steps[i][1] == 100) {
+            lv.width = cfg->max_width;
+            lv.height = cfg->max_height;
+        } else {
+            lv.width = cfg->max_width * g_level_steps[i][1] / 100 / SIZE_ALIGN * SIZE_ALIGN;
+            if (lv.width < cfg->min_width) lv.width = cfg->min_width;
+            lv.height = (int)((int64_t)cfg->max_height * lv.width / cfg->max_width) & ~1;
+        }
+
+        if (qos->level_count > 0) {
+            const qos_level_t* prev = &qos->levels[qos->level_count - 1];
+            if (prev->fps == lv.fps && prev->width == lv.width) continue;
+        }
+        qos->levels[qos->level_count++] = lv;
+    }
+}
+
+detect_qos_t* detect_qos_create(const detect_qos_config_t* config)
+{
+    if (!config || config->max_fps <= 0 || config->max_width <= 0 || config->max_height <= 0) return NULL;
+
+    detect_qos_t* qos = (detect_qos_t*)calloc(1, sizeof(detect_qos_t));
+    if (!qos) return NULL;
+
+    qos->cfg = *config;
+    detect_qos_config_t* cfg = &qos->cfg;
+    if (cfg->min_fps <= 0) cfg->min_fps = DEFAULT_MIN_FPS;
+    if (cfg->min_fps > cfg->max_fps) cfg->min_fps = cfg->max_fps;
+    if (cfg->min_width <= 0) cfg->min_width = cfg->max_width / 2;
+    cfg->min_width = cfg->min_width / SIZE_ALIGN * SIZE_ALIGN;
+    if (cfg->min_width < SIZE_ALIGN || cfg->min_width > cfg->max_width) cfg->min_width = cfg->max_width;
+    if (cfg->budget_ms <= 0) cfg->budget_ms = DEFAULT_BUDGET_MS;
+    if (cfg->cpu_high_percent <= 0) cfg->cpu_high_percent = DEFAULT_CPU_HIGH_PERCENT;
+    if (cfg->cpu_low_percent <= 0) cfg->cpu_low_percent = DEFAULT_CPU_LOW_PERCENT;
+    if (cfg->cpu_low_percent > cfg->cpu_high_percent) cfg->cpu_low_percent = cfg->cpu_high_percent;
+    if (cfg->interval_ms <= 0) cfg->interval_ms = DEFAULT_INTERVAL_MS;
+    build_levels(qos);
+
+    atomic_init(&qos->next_due_us, 0);
+    atomic_init(&qos->callbacks, 0);
+    atomic_init(&qos->callback_total_us, 0);
+    atomic_init(&qos->reset_pending, false);
+    atomic_init(&qos->level, 0);
+    atomic_init(&qos->cpu_percent, -1);
+    atomic_init(&qos->callback_us, 0);
+    atomic_init(&qos->adjustments, 0);
+    return qos;
+}
+
+void detect_qos_destroy(detect_qos_t* qos)
+{
+    free(qos);
+}
+
+void detect_qos_record(detect_qos_t* qos, int64_t duration_us)
+{
+    if (!qos || duration_us < 0) return;
+    atomic_fetch_add(&qos->callbacks, 1);
+    atomic_fetch_add(&qos->callback_total_us, (uint64_t)duration_us);
+}
+
+bool detect_qos_due(detect_qos_t* qos, int64_t now_us)
+{
+    return qos && now_us >= atomic_load(&qos->next_due_us);
+}
+
+bool detect_qos_update(detect_qos_t* qos, uint64_t drops, int64_t now_us, detect_qos_state_t* state)
+{
+    if (!qos) return false;
+
+    int64_t elapsed_us = now_us - qos->last_us;
+    int level = atomic_load(&qos->level);
+    int old_level = level;
+    atomic_store(&qos->next_due_us, now_us + (int64_t)qos->cfg.interval_ms * 1000);
+
+    uint64_t callbacks = atomic_exchange(&qos->callbacks, 0);
+    uint64_t callback_total = atomic_exchange(&qos->callback_total_us, 0);
+    int cpu = read_cpu_percent(qos);
+    uint64_t new_drops = drops >= qos->last_drops ? drops - qos->last_drops : 0;   /* 统计清零后不算丢帧 */
+    qos->last_drops = drops;
+
+    if (atomic_exchange(&qos->reset_pending, false)) {
+        level = 0;
+        qos->calm_periods = 0;
+    } else if (qos->last_us > 0 && elapsed_us > 0) {
+        /* 第一个周期只建立基准 */
+        const qos_level_t* cur = &qos->levels[level];
+        int callback_us = callbacks > 0 ? (int)(callback_total / callbacks) : 0;
+        int occupancy = (int)((int64_t)callback_us * cur->fps / 10000);
+        int64_t expected = (int64_t)cur->fps * elapsed_us / 1000000;
+        int64_t budget_us = (int64_t)qos->cfg.budget_ms * 1000;
+
+        atomic_store(&qos->callback_us, callback_us);
+
+        bool overload = occupancy > OVERLOAD_OCCUPANCY_PERCENT || callback_us > budget_us ||
+                        (int64_t)new_drops * 100 > (expected > 0 ? expected : 1) * OVERLOAD_DROP_PERCENT ||
+                        cpu > qos->cfg.cpu_high_percent;
+        if (overload) {
+            qos->calm_periods = 0;
+            if (level < qos->level_count - 1) level++;
+        } else if (level > 0) {
+            /* 升档后的回调时间按像素数之比估算 */
+            const qos_level_t* next = &qos->levels[level - 1];
+            int64_t next_callback = (int64_t)callback_us * next->width * next->height / (cur->width * cur->height);
+            int next_occupancy = (int)(next_callback * next->fps / 10000);
+            bool idle = occupancy < IDLE_OCCUPANCY_PERCENT && new_drops == 0 &&
+                        next_occupancy < OVERLOAD_OCCUPANCY_PERCENT * 7 / 8 && next_callback < budget_us * 7 / 8 &&
+                        cpu < qos->cfg.cpu_low_percent;
+            qos->calm_periods = idle ? qos->calm_periods + 1 : 0;
+            if (qos->calm_periods >= UPGRADE_PERIODS) {
+                qos->calm_periods = 0;
+                level--;
+            }
+        }
+    }
+
+    qos->last_us = now_us;
+    atomic_store(&qos->cpu_percent, cpu);
+    if (level != old_level) {
+        atomic_store(&qos->level, level);
+        atomic_fetch_add(&qos->adjustments, 1);
+    }
+    if (state) detect_qos_get_state(qos, state);
+    return level != old_level;
+}
+
+void detect_qos_reset(detect_qos_t* qos)
+{
+    if (!qos) return;
+    atomic_store(&qos->reset_pending, true);
+    atomic_store(&qos->next_due_us, 0);
+}
+
+void detect_qos_get_state(detect_qos_t* qos, detect_qos_state_t* state)
+{
+    if (!state) return;
+    memset(state, 0, sizeof(*state));
+    if (!qos) return;
+
+    int level = atomic_load(&qos->level);
+    state->level = level;
+    state->level_count = qos->level_count;
+    state->fps = qos->levels[level].fps;
+    state->width = qos->levels[level].width;
+    state->height = qos->levels[level].height;
+    state->cpu_percent = atomic_load(&qos->cpu_percent);
+    state->callback_us = atomic_load(&qos->callback_us);
+    state->adjustments = atomic_load(&qos->adjustments);
+}
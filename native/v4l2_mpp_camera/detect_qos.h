@@ -0,0 +1,97 @@
+/*
+ * 检测自适应 - 按负载在上下限之间调整检测帧率和缩放尺寸，负载高时识别延迟仍有上界
+ *
+ * 1. 档位表从（上限帧率, 上限尺寸）开始，交替降低帧率和尺寸，直到（下限帧率, 下限尺寸）
+ * 2. 每个评估周期统计回调平均执行时间、检测丢帧（队列/邮箱/拉取被替换）和系统 CPU 占用（/proc/stat）
+ * 3. 过载（消费者占用率高、有丢帧、回调超出预算或 CPU 占用高）立即降一档；
+ *    连续几个周期空闲（占用率和 CPU 都低、升档后回调仍在预算内）才升一档，避免来回振荡
+ * 4. 只做决策，由播放器把档位应用到检测分支（帧率限速、缩放 caps）
+ */
+
+#ifndef DETECT_QOS_H
+#define DETECT_QOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 档位表最大长度 */
+#define DETECT_QOS_MAX_LEVELS 8
+
+/* 控制器配置，0 表示使用默认值 */
+typedef struct {
+    int max_fps;                /* 帧率上限（必填） */
+    int min_fps;                /* 帧率下限（默认 2） */
+    int max_width;              /* 尺寸上限（必填） */
+    int max_height;
+    int min_width;              /* 宽度下限，高度按比例（默认上限的一半，等于上限时只调整帧率） */
+    int budget_ms;              /* 回调执行时间预算（默认 300） */
+    int cpu_high_percent;       /* CPU 占用高于此值时降档（默认 85） */
+    int cpu_low_percent;        /* CPU 占用低于此值才允许升档（默认 60） */
+    int interval_ms;            /* 评估周期（默认 1000） */
+} detect_qos_config_t;
+
+/* 当前工作点 */
+typedef struct {
+    int level;                  /* 档位，0 为上限，越大越省 */
+    int level_count;            /* 档位数 */
+    int fps;
+    int width;
+    int height;
+    int cpu_percent;            /* 最近一个周期的系统 CPU 占用，-1 表示无法读取 */
+    int callback_us;            /* 最近一个周期回调的平均执行时间，0 表示没有回调 */
+    uint64_t adjustments;       /* 档位变化次数 */
+} detect_qos_state_t;
+
+/* 控制器句柄 */
+typedef struct detect_qos detect_qos_t;
+
+/**
+ * 创建控制器
+ * @param config 配置
+ * @return 控制器，失败返回 NULL
+ */
+detect_qos_t* detect_qos_create(const detect_qos_config_t* config);
+
+/**
+ * 销毁控制器
+ */
+void detect_qos_destroy(detect_qos_t* qos);
+
+/**
+ * 记录一次回调（或消费者持有检测帧）的执行时间（可在任意线程调用）
+ */
+void detect_qos_record(detect_qos_t* qos, int64_t duration_us);
+
+/**
+ * 是否到了评估时刻（检测路径每帧调用，开销只是一次时间比较）
+ */
+bool detect_qos_due(detect_qos_t* qos, int64_t now_us);
+
+/**
+ * 评估一个周期并调整档位，同一控制器只能在一个线程中调用
+ * @param drops 检测丢帧累计数（控制器取相邻两次的差值）
+ * @param now_us 当前时间（微秒）
+ * @param state 输出评估后的工作点，可为 NULL
+ * @return true 档位发生变化
+ */
+bool detect_qos_update(detect_qos_t* qos, uint64_t drops, int64_t now_us, detect_qos_state_t* state);
+
+/**
+ * 回到档位 0（切换模式或重新开始播放后调用，可在任意线程调用，下一次评估时生效）
+ */
+void detect_qos_reset(detect_qos_t* qos);
+
+/**
+ * 获取当前工作点（可在任意线程调用）
+ */
+void detect_qos_get_state(detect_qos_t* qos, detect_qos_state_t* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DETECT_QOS_H */
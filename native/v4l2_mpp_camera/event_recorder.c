@@ -0,0 +1,362 @@
+/*
+ * 事件录像实现
+ *
+ * 缓冲中的包是编码输出的深拷贝（编码器输出缓冲区可能来自容量有限的缓冲池，不能长时间持有，码流每帧只有几十 KB），
+ * 写文件时用 gst_buffer_copy 复制元数据改写时间戳，不再复制码流数据。
+ * 缓冲、写文件管道指针和统计都由 lock 保护；写文件管道的结束（EOS/错误）由每个片段一个的等待线程处理。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <gst/app/gstappsrc.h>
+
+#include "event_recorder.h"
+
+#define MODULE_TAG "event_recorder"
+#define DEFAULT_PRE_MS 5000
+#define DEFAULT_MAX_BYTES (16 * 1024 * 1024)
+
+struct event_recorder {
+    event_recorder_config_t cfg;
+    pthread_mutex_t lock;
+    
+    /* 预录缓冲：GstBuffer*，按到达顺序，第一个总是关键帧 */
+    GQueue packets;
+    int keyframes;
+    size_t bytes;
+    GstCaps* caps;                  /* 缓冲中码流的 caps */
+    
+    /* 正在写的片段，writer 为 NULL 表示空闲 */
+    GstElement* writer;
+    GstElement* writer_src;
+    GstClockTime clip_base;         /* 片段第一个包的 PTS，写入时减去 */
+    GstClockTime clip_end;          /* 收到 PTS 达到此值的包后结束片段 */
+    bool clip_ending;               /* 已发送 EOS */
+    char* clip_path;
+    pthread_t writer_thread;
+    bool writer_thread_started;     /* 等待线程尚未 join */
+    
+    uint64_t clips_written;
+    uint64_t clips_failed;
+    uint64_t gops_dropped;
+};
+
+static bool packet_is_keyframe(GstBuffer* buffer)
+{
+    return !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+}
+
+/* 丢弃缓冲头部的一个包 */
+static void packets_pop(event_recorder_t* rec)
+{
+    GstBuffer* buffer = (GstBuffer*)g_queue_pop_head(&rec->packets);
+    if (!buffer) return;
+    
+    if (packet_is_keyframe(buffer)) rec->keyframes--;
+    rec->bytes -= gst_buffer_get_size(buffer);
+    gst_buffer_unref(buffer);
+}
+
+static void packets_clear(event_recorder_t* rec)
+{
+    while (!g_queue_is_empty(&rec->packets)) {
+        packets_pop(rec);
+    }
+}
+
+/* 按 GOP 丢弃：第二个 GOP 已能覆盖 pre_ms，或字节数超限时丢弃第一个 GOP */
+static void packets_trim(event_recorder_t* rec)
+{
+    GstBuffer* newest = (GstBuffer*)g_queue_peek_tail(&rec->packets);
+    GstClockTime window = (GstClockTime)rec->cfg.pre_ms * GST_MSECOND;
+    
+    /* 复位后第一个关键帧之前的包无法单独解码 */
+    while (!g_queue_is_empty(&rec->packets) && !packet_is_keyframe((GstBuffer*)g_queue_peek_head(&rec->packets))) {
+        packets_pop(rec);
+    }
+    
+    while (rec->keyframes >= 2) {
+        GList* link = rec->packets.head->next;
+        while (!packet_is_keyframe((GstBuffer*)link->data)) {
+            link = link->next;
+        }
+        GstClockTime second = GST_BUFFER_PTS((GstBuffer*)link->data);
+        
+        bool expired = GST_CLOCK_TIME_IS_VALID(second) && GST_BUFFER_PTS(newest) >= window &&
+                       second <= GST_BUFFER_PTS(newest) - window;
+        bool oversize = rec->bytes > rec->cfg.max_bytes;
+        if (!expired && !oversize) break;
+        
+        if (!expired) rec->gops_dropped++;
+        while (rec->packets.head != link) {
+            packets_pop(rec);
+        }
+    }
+}
+
+/* 把一个包送入写文件管道（时间戳以片段起点为 0） */
+static void clip_push(event_recorder_t* rec, GstBuffer* buffer)
+{
+    GstBuffer* copy = gst_buffer_copy(buffer);
+    if (!copy) return;
+    
+    if (GST_BUFFER_PTS_IS_VALID(copy)) {
+        GST_BUFFER_PTS(copy) = GST_BUFFER_PTS(copy) >= rec->clip_base ? GST_BUFFER_PTS(copy) - rec->clip_base : 0;
+    }
+    if (GST_BUFFER_DTS_IS_VALID(copy)) {
+        GST_BUFFER_DTS(copy) = GST_BUFFER_DTS(copy) >= rec->clip_base ? GST_BUFFER_DTS(copy) - rec->clip_base : 0;
+    }
+    gst_app_src_push_buffer(GST_APP_SRC(rec->writer_src), copy);
+}
+
+/* 结束片段：写文件管道收到 EOS 后 mp4mux 写 moov，等待线程收尾 */
+static void clip_finish(event_recorder_t* rec)
+{
+    if (!rec->writer || rec->clip_ending) return;
+    
+    gst_app_src_end_of_stream(GST_APP_SRC(rec->writer_src));
+    rec->clip_ending = true;
+}
+
+/* 等待写文件管道结束并释放 */
+static void* writer_thread_func(void* arg)
+{
+    event_recorder_t* rec = (event_recorder_t*)arg;
+    GstElement* writer = rec->writer;
+    GstBus* bus = gst_element_get_bus(writer);
+    bool ok = false;
+    
+    GstMessage* msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (msg) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* err = NULL;
+            gst_message_parse_error(msg, &err, NULL);
+            printf("[%s] 写文件失败: %s\n", MODULE_TAG, err ? err->message : "未知错误");
+            if (err) g_error_free(err);
+        } else {
+            ok = true;
+        }
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+    
+    pthread_mutex_lock(&rec->lock);
+    printf("[%s] 片段%s: %s\n", MODULE_TAG, ok ? "已写完" : "未完成", rec->clip_path);
+    if (ok) {
+        rec->clips_written++;
+    } else {
+        rec->clips_failed++;
+    }
+    rec->writer = NULL;
+    rec->writer_src = NULL;
+    g_free(rec->clip_path);
+    rec->clip_path = NULL;
+    pthread_mutex_unlock(&rec->lock);
+    
+    gst_element_set_state(writer, GST_STATE_NULL);
+    gst_object_unref(writer);
+    return NULL;
+}
+
+/* 创建写文件管道：appsrc → parse（字节流转 avc/hvc） → mp4mux → filesink */
+static GstElement* writer_new(GstCaps* caps, const char* path, GstElement** src_out)
+{
+    GstStructure* s = gst_caps_get_structure(caps, 0);
+    const char* parser = gst_structure_has_name(s, "video/x-h265") ? "h265parse" : "h264parse";
+    
+    GstElement* pipeline = gst_object_ref_sink(gst_pipeline_new("recorder"));
+    GstElement* src = gst_element_factory_make("appsrc", NULL);
+    GstElement* parse = gst_element_factory_make(parser, NULL);
+    GstElement* mux = gst_element_factory_make("mp4mux", NULL);
+    GstElement* sink = gst_element_factory_make("filesink", NULL);
+    
+    if (!src || !parse || !mux || !sink) {
+        printf("[%s] 缺少元素: appsrc/%s/mp4mux/filesink\n", MODULE_TAG, parser);
+        if (src) gst_object_unref(gst_object_ref_sink(src));
+        if (parse) gst_object_unref(gst_object_ref_sink(parse));
+        if (mux) gst_object_unref(gst_object_ref_sink(mux));
+        if (sink) gst_object_unref(gst_object_ref_sink(sink));
+        gst_object_unref(pipeline);
+        return NULL;
+    }
+    
+    /* 缓冲中的包一次性推入，appsrc 队列不限长度 */
+    g_object_set(src, "caps", caps, "format", GST_FORMAT_TIME, "max-bytes", (guint64)0, NULL);
+    g_object_set(sink, "location", path, NULL);
+    gst_bin_add_many(GST_BIN(pipeline), src, parse, mux, sink, NULL);
+    if (!gst_element_link_many(src, parse, mux, sink, NULL) ||
+        gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        printf("[%s] 写文件管道启动失败: %s\n", MODULE_TAG, path);
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+        return NULL;
+    }
+    
+    *src_out = src;
+    return pipeline;
+}
+
+event_recorder_t* event_recorder_create(const event_recorder_config_t* config)
+{
+    event_recorder_t* rec = (event_recorder_t*)calloc(1, sizeof(event_recorder_t));
+    if (!rec) return NULL;
+    
+    if (config) rec->cfg = *config;
+    if (rec->cfg.pre_ms <= 0) rec->cfg.pre_ms = DEFAULT_PRE_MS;
+    if (rec->cfg.max_bytes == 0) rec->cfg.max_bytes = DEFAULT_MAX_BYTES;
+    
+    pthread_mutex_init(&rec->lock, NULL);
+    g_queue_init(&rec->packets);
+    return rec;
+}
+
+void event_recorder_destroy(event_recorder_t* rec)
+{
+    if (!rec) return;
+    
+    pthread_mutex_lock(&rec->lock);
+    clip_finish(rec);
+    pthread_mutex_unlock(&rec->lock);
+    if (rec->writer_thread_started) pthread_join(rec->writer_thread, NULL);
+    
+    packets_clear(rec);
+    if (rec->caps) gst_caps_unref(rec->caps);
+    pthread_mutex_destroy(&rec->lock);
+    free(rec);
+}
+
+void event_recorder_push(event_recorder_t* rec, GstSample* sample)
+{
+    GstBuffer* buffer = sample ? gst_sample_get_buffer(sample) : NULL;
+    GstCaps* caps = sample ? gst_sample_get_caps(sample) : NULL;
+    if (!rec || !buffer || !caps || !GST_BUFFER_PTS_IS_VALID(buffer)) return;
+    
+    pthread_mutex_lock(&rec->lock);
+    
+    /* 分辨率/帧率变化后旧的包不能和新码流写进同一个文件 */
+    if (!rec->caps || !gst_caps_is_equal(caps, rec->caps)) {
+        packets_clear(rec);
+        clip_finish(rec);
+        if (rec->caps) gst_caps_unref(rec->caps);
+        rec->caps = gst_caps_ref(caps);
+    }
+    
+    GstBuffer* packet = gst_buffer_copy_deep(buffer);
+    if (packet) {
+        g_queue_push_tail(&rec->packets, packet);
+        rec->bytes += gst_buffer_get_size(packet);
+        if (packet_is_keyframe(packet)) rec->keyframes++;
+        packets_trim(rec);
+        
+        if (rec->writer && !rec->clip_ending) {
+            clip_push(rec, packet);
+            if (GST_BUFFER_PTS(packet) >= rec->clip_end) clip_finish(rec);
+        }
+    }
+    
+    pthread_mutex_unlock(&rec->lock);
+}
+
+event_recorder_result_t event_recorder_trigger(event_recorder_t* rec, const char* path, int pre_ms, int post_ms)
+{
+    if (!rec || !path) return EVENT_RECORDER_FAILED;
+    
+    pthread_mutex_lock(&rec->lock);
+    if (rec->writer) {
+        pthread_mutex_unlock(&rec->lock);
+        return EVENT_RECORDER_BUSY;
+    }
+    if (rec->writer_thread_started) {
+        pthread_join(rec->writer_thread, NULL);     /* 上一个片段的等待线程已释放锁，只剩释放管道 */
+        rec->writer_thread_started = false;
+    }
+    
+    /* 起点：事件前 pre_ms 处之前最近的关键帧，缓冲不够长时取最早的关键帧 */
+    GstBuffer* newest = (GstBuffer*)g_queue_peek_tail(&rec->packets);
+    if (!newest || rec->keyframes == 0) {
+        pthread_mutex_unlock(&rec->lock);
+        return EVENT_RECORDER_NO_DATA;
+    }
+    GstClockTime event_pts = GST_BUFFER_PTS(newest);
+    GstClockTime pre = (GstClockTime)(pre_ms > 0 ? pre_ms : 0) * GST_MSECOND;
+    GstClockTime start_pts = event_pts > pre ? event_pts - pre : 0;
+    GList* start = rec->packets.head;
+    for (GList* link = start; link; link = link->next) {
+        GstBuffer* buffer = (GstBuffer*)link->data;
+        if (GST_BUFFER_PTS(buffer) > start_pts) break;
+        if (packet_is_keyframe(buffer)) start = link;
+    }
+    
+    GstElement* src = NULL;
+    rec->writer = writer_new(rec->caps, path, &src);
+    if (!rec->writer) {
+        rec->clips_failed++;
+        pthread_mutex_unlock(&rec->lock);
+        return EVENT_RECORDER_FAILED;
+    }
+    rec->writer_src = src;
+    rec->clip_base = GST_BUFFER_PTS((GstBuffer*)start->data);
+    rec->clip_end = event_pts + (GstClockTime)(post_ms > 0 ? post_ms : 0) * GST_MSECOND;
+    rec->clip_ending = false;
+    rec->clip_path = g_strdup(path);
+    
+    for (GList* link = start; link; link = link->next) {
+        clip_push(rec, (GstBuffer*)link->data);
+    }
+    if (post_ms <= 0) clip_finish(rec);
+    
+    if (pthread_create(&rec->writer_thread, NULL, writer_thread_func, rec) != 0) {
+        /* 没有等待线程就无法收尾，直接丢弃这个片段 */
+        gst_element_set_state(rec->writer, GST_STATE_NULL);
+        gst_object_unref(rec->writer);
+        rec->writer = NULL;
+        rec->writer_src = NULL;
+        g_free(rec->clip_path);
+        rec->clip_path = NULL;
+        rec->clips_failed++;
+        pthread_mutex_unlock(&rec->lock);
+        return EVENT_RECORDER_FAILED;
+    }
+    rec->writer_thread_started = true;
+    
+    printf("[%s] 开始写片段: %s（事件前 %lld ms，事件后 %d ms）\n", MODULE_TAG, path,
+           (long long)((event_pts - rec->clip_base) / GST_MSECOND), post_ms);
+    pthread_mutex_unlock(&rec->lock);
+    return EVENT_RECORDER_OK;
+}
+
+void event_recorder_reset(event_recorder_t* rec)
+{
+    if (!rec) return;
+    
+    pthread_mutex_lock(&rec->lock);
+    packets_clear(rec);
+    clip_finish(rec);
+    if (rec->caps) {
+        gst_caps_unref(rec->caps);
+        rec->caps = NULL;
+    }
+    pthread_mutex_unlock(&rec->lock);
+}
+
+void event_recorder_get_stats(event_recorder_t* rec, event_recorder_stats_t* stats)
+{
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!rec) return;
+    
+    pthread_mutex_lock(&rec->lock);
+    stats->clips_written = rec->clips_written;
+    stats->clips_failed = rec->clips_failed;
+    stats->gops_dropped = rec->gops_dropped;
+    stats->buffered_bytes = rec->bytes;
+    if (!g_queue_is_empty(&rec->packets)) {
+        GstClockTime first = GST_BUFFER_PTS((GstBuffer*)g_queue_peek_head(&rec->packets));
+        GstClockTime last = GST_BUFFER_PTS((GstBuffer*)g_queue_peek_tail(&rec->packets));
+        stats->buffered_ms = (int64_t)((last - first) / GST_MSECOND);
+    }
+    stats->writing = rec->writer != NULL;
+    pthread_mutex_unlock(&rec->lock);
+}
@@ -0,0 +1,92 @@
+/*
+ * 事件录像 - 硬件编码码流的预录缓冲，触发时写出事件前后的片段（MP4）
+ *
+ * 1. 编码分支（mpph264enc/mpph265enc → parse）输出的码流包复制保存在内存中，至少覆盖最近 pre_ms，
+ *    按 GOP 整段丢弃（缓冲总是从关键帧开始），总字节数超过 max_bytes 时提前丢弃最旧的 GOP
+ * 2. 触发时从事件前 pre_ms 内最早的关键帧开始，把缓冲中的包和之后 post_ms 内的新包送入
+ *    appsrc → parse → mp4mux → filesink 写文件管道，全程不解码、不重新编码
+ * 3. 写文件在独立管道的流线程中进行，编码分支的流线程只入队，不等待磁盘
+ * 4. 码流 caps 变化（切换分辨率/帧率）时清空缓冲，正在写的片段提前结束
+ */
+
+#ifndef EVENT_RECORDER_H
+#define EVENT_RECORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 录像配置，0 表示使用默认值 */
+typedef struct {
+    int pre_ms;                 /* 预录时长（默认 5000） */
+    size_t max_bytes;           /* 预录缓冲字节数上限（默认 16 MB，至少保留一个 GOP） */
+} event_recorder_config_t;
+
+/* 触发结果 */
+typedef enum {
+    EVENT_RECORDER_OK = 0,
+    EVENT_RECORDER_BUSY = -1,       /* 上一个片段还在写 */
+    EVENT_RECORDER_NO_DATA = -2,    /* 缓冲中还没有关键帧 */
+    EVENT_RECORDER_FAILED = -3,     /* 创建写文件管道失败 */
+} event_recorder_result_t;
+
+/* 录像统计 */
+typedef struct {
+    uint64_t clips_written;     /* 已写完的片段数 */
+    uint64_t clips_failed;      /* 写文件出错的片段数 */
+    uint64_t gops_dropped;      /* 因超过 max_bytes 提前丢弃的 GOP 数 */
+    size_t buffered_bytes;      /* 当前缓冲的字节数 */
+    int64_t buffered_ms;        /* 当前缓冲覆盖的时长 */
+    bool writing;               /* 正在写片段 */
+} event_recorder_stats_t;
+
+/* 录像句柄 */
+typedef struct event_recorder event_recorder_t;
+
+/**
+ * 创建录像缓冲
+ * @param config 配置，NULL 表示全部使用默认值
+ * @return 句柄，失败返回 NULL
+ */
+event_recorder_t* event_recorder_create(const event_recorder_config_t* config);
+
+/**
+ * 销毁（正在写的片段以已收到的包收尾，等待文件写完）
+ */
+void event_recorder_destroy(event_recorder_t* rec);
+
+/**
+ * 加入一个编码包（编码分支 appsink 的流线程调用，不阻塞）
+ * @param sample 码流样本（字节流、按访问单元对齐），不持有样本
+ */
+void event_recorder_push(event_recorder_t* rec, GstSample* sample);
+
+/**
+ * 触发录像：写出事件前 pre_ms 到事件后 post_ms 的片段，立即返回（可在任意线程调用）
+ * @param path 输出文件路径（MP4）
+ * @param pre_ms 事件前时长，超过配置的 pre_ms 时按缓冲中已有的计
+ * @param post_ms 事件后时长
+ * @return 触发结果
+ */
+event_recorder_result_t event_recorder_trigger(event_recorder_t* rec, const char* path, int pre_ms, int post_ms);
+
+/**
+ * 丢弃缓冲（码流中断时调用：停止播放、断开分支），正在写的片段收尾
+ */
+void event_recorder_reset(event_recorder_t* rec);
+
+/**
+ * 获取统计（可在任意线程调用）
+ */
+void event_recorder_get_stats(event_recorder_t* rec, event_recorder_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_RECORDER_H */
@@ -0,0 +1,351 @@
+/*
+ * 人脸裁剪实现
+ *
+ * 输出缓冲区在创建时按 FACE_CROP_MAX 张分配，RGA 目标句柄同时导入，每次裁剪只导入一次源 dmabuf。
+ * RGB_F32 布局先由 RGA/CPU 得到 BGR 小图，再归一化到 float 平面；小图只有 112x112，CPU 双线性足够快。
+ */
+
+#define MODULE_TAG "face_crop"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "face_crop.h"
+
+#ifdef USE_RGA
+#include "rga/im2d.h"
+#include "rga/rga.h"
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define USE_NEON 1
+#endif
+
+#define DEFAULT_CROP_SIZE 112
+#define DEFAULT_MARGIN_PERCENT 40
+#define MAX_CROP_SIZE 512
+#define RGA_MAX_SCALE 16            /* RGA 缩放倍数上限，区域更小时走 CPU */
+#define BUFFER_ALIGN 4096
+
+struct face_crop {
+    face_crop_config_t cfg;
+    float inv_std[3];
+    size_t bgr_size;                /* 一张 BGR 小图的字节数 */
+    uint8_t* bgr[FACE_CROP_MAX];    /* BGR 小图：BGR888 布局的输出，RGB_F32 布局的中间结果 */
+    float* planes[FACE_CROP_MAX];   /* RGB_F32 输出，BGR888 布局为 NULL */
+#ifdef USE_RGA
+    rga_buffer_handle_t bgr_handle[FACE_CROP_MAX];
+#endif
+};
+
+face_crop_t* face_crop_create(const face_crop_config_t* config)
+{
+    face_crop_t* crop = (face_crop_t*)calloc(1, sizeof(face_crop_t));
+    if (!crop) return NULL;
+
+    if (config) crop->cfg = *config;
+    if (crop->cfg.size <= 0) crop->cfg.size = DEFAULT_CROP_SIZE;
+    if (crop->cfg.size > MAX_CROP_SIZE) crop->cfg.size = MAX_CROP_SIZE;
+    crop->cfg.size &= ~1;           /* NV12 目标和 RGA 都要求偶数尺寸 */
+    if (crop->cfg.margin_percent <= 0) crop->cfg.margin_percent = DEFAULT_MARGIN_PERCENT;
+    if (crop->cfg.std[0] == 0 && crop->cfg.std[1] == 0 && crop->cfg.std[2] == 0) {
+        for (int c = 0; c < 3; c++) {
+            crop->cfg.mean[c] = 127.5f;
+            crop->cfg.std[c] = 128.0f;
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        crop->inv_std[c] = crop->cfg.std[c] != 0 ? 1.0f / crop->cfg.std[c] : 1.0f;
+    }
+
+    int size = crop->cfg.size;
+    crop->bgr_size = (size_t)size * size * 3;
+    for (int i = 0; i < FACE_CROP_MAX; i++) {
+        if (posix_memalign((void**)&crop->bgr[i], BUFFER_ALIGN, crop->bgr_size) != 0) {
+            crop->bgr[i] = NULL;
+            face_crop_destroy(crop);
+            return NULL;
+        }
+        if (crop->cfg.layout == FACE_CROP_LAYOUT_RGB_F32) {
+            crop->planes[i] = (float*)malloc(crop->bgr_size * sizeof(float));
+            if (!crop->planes[i]) {
+                face_crop_destroy(crop);
+                return NULL;
+            }
+        }
+#ifdef USE_RGA
+        im_handle_param_t param = { 0 };
+        param.width = size;
+        param.height = size;
+        param.format = RK_FORMAT_BGR_888;
+        crop->bgr_handle[i] = importbuffer_virtualaddr(crop->bgr[i], &param);
+        if (crop->bgr_handle[i] == 0) {
+            fprintf(stderr, "[%s] RGA import of crop buffer %d failed, using CPU\n", MODULE_TAG, i);
+        }
+#endif
+    }
+
+    printf("[%s] Face crop %dx%d, margin %d%%, %s\n", MODULE_TAG, size, size, crop->cfg.margin_percent,
+           crop->cfg.layout == FACE_CROP_LAYOUT_RGB_F32 ? "RGB float planar" : "BGR888");
+    return crop;
+}
+
+void face_crop_destroy(face_crop_t* crop)
+{
+    if (!crop) return;
+
+    for (int i = 0; i < FACE_CROP_MAX; i++) {
+#ifdef USE_RGA
+        if (crop->bgr_handle[i]) releasebuffer_handle(crop->bgr_handle[i]);
+#endif
+        free(crop->bgr[i]);
+        free(crop->planes[i]);
+    }
+    free(crop);
+}
+
+void face_crop_get_config(const face_crop_t* crop, face_crop_config_t* config)
+{
+    if (crop && config) *config = crop->cfg;
+}
+
+/* 检测框 -> 正方形裁剪区域（整数像素，偶数对齐），无效时返回 -1 */
+static int crop_region(const face_crop_t* crop, const face_crop_source_t* src, const face_crop_rect_t* box,
+                       int* x, int* y, int* side)
+{
+    if (box->width <= 0 || box->height <= 0) return -1;
+    if (box->x >= src->width || box->y >= src->height || box->x + box->width <= 0 || box->y + box->height <= 0) {
+        return -1;
+    }
+
+    float longest = box->width > box->height ? box->width : box->height;
+    int s = (int)(longest * (100 + crop->cfg.margin_percent) / 100.0f);
+    int limit = src->width < src->height ? src->width : src->height;
+    if (s > limit) s = limit;
+    s &= ~1;
+    if (s < 2) return -1;
+
+    int cx = (int)(box->x + box->width / 2);
+    int cy = (int)(box->y + box->height / 2);
+    int left = cx - s / 2;
+    int top = cy - s / 2;
+    if (left > src->width - s) left = src->width - s;
+    if (top > src->height - s) top = src->height - s;
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+
+    *x = left & ~1;
+    *y = top & ~1;
+    *side = s;
+    return 0;
+}
+
+/* 取源图 (x, y) 处的 BGR */
+static inline void source_pixel(const face_crop_source_t* src, const yuv_image_t* img, const yuv_coeffs_t* coeffs,
+                                int x, int y, uint8_t* px)
+{
+    if (src->format == FACE_CROP_SOURCE_BGRA) {
+        const uint8_t* p = src->data + (size_t)y * src->stride + x * 4;
+        px[0] = p[0];
+        px[1] = p[1];
+        px[2] = p[2];
+        return;
+    }
+
+    int yv, u, v;
+    yuv_image_sample(img, x, y, &yv, &u, &v);
+    yuv_pixel_to_bgr(coeffs, yv, u - 128, v - 128, px);
+}
+
+/* CPU 回退：双线性采样（Q8 定点）裁剪 + 缩放到 BGR 小图 */
+static void crop_cpu(const face_crop_t* crop, const face_crop_source_t* src, int x, int y, int side, uint8_t* dst)
+{
+    const yuv_coeffs_t* coeffs = yuv_get_coeffs(src->color_space);
+    yuv_image_t img = {
+        .y = src->data,
+        .uv = src->data + src->uv_offset,
+        .y_stride = src->stride,
+        .uv_stride = src->stride,
+        .width = src->width,
+        .height = src->height,
+        .layout = YUV_LAYOUT_420SP,
+        .vu = false,
+    };
+    int size = crop->cfg.size;
+
+    for (int i = 0; i < size; i++) {
+        /* 像素中心对齐：源坐标 = 区域起点 + (i + 0.5) * side / size - 0.5 */
+        int fy = y * 256 + ((2 * i + 1) * side * 128) / size - 128;
+        if (fy < 0) fy = 0;
+        int y0 = fy >> 8;
+        int y1 = y0 + 1 < src->height ? y0 + 1 : y0;
+        int wy = fy & 255;
+        uint8_t* row = dst + (size_t)i * size * 3;
+
+        for (int j = 0; j < size; j++) {
+            int fx = x * 256 + ((2 * j + 1) * side * 128) / size - 128;
+            if (fx < 0) fx = 0;
+            int x0 = fx >> 8;
+            int x1 = x0 + 1 < src->width ? x0 + 1 : x0;
+            int wx = fx & 255;
+            uint8_t p00[3], p01[3], p10[3], p11[3];
+
+            source_pixel(src, &img, coeffs, x0, y0, p00);
+            source_pixel(src, &img, coeffs, x1, y0, p01);
+            source_pixel(src, &img, coeffs, x0, y1, p10);
+            source_pixel(src, &img, coeffs, x1, y1, p11);
+            for (int c = 0; c < 3; c++) {
+                int top = p00[c] * (256 - wx) + p01[c] * wx;
+                int bottom = p10[c] * (256 - wx) + p11[c] * wx;
+                row[j * 3 + c] = (uint8_t)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+            }
+        }
+    }
+}
+
+#ifdef USE_RGA
+/* 导入源 dmabuf，按整个缓冲区（NV12 为 stride x 平面高度）描述 */
+static rga_buffer_handle_t source_import(const face_crop_source_t* src, int* wstride, int* hstride, int* format)
+{
+    im_handle_param_t param = { 0 };
+
+    if (src->format == FACE_CROP_SOURCE_NV12) {
+        *wstride = src->stride;
+        *hstride = src->stride > 0 ? (int)(src->uv_offset / src->stride) : 0;
+        *format = RK_FORMAT_YCbCr_420_SP;
+    } else {
+        *wstride = src->stride / 4;
+        *hstride = src->height;
+        *format = RK_FORMAT_BGRA_8888;
+    }
+    if (*wstride < src->width || *hstride < src->height) return 0;
+
+    param.width = *wstride;
+    param.height = *hstride;
+    param.format = *format;
+    return importbuffer_fd(src->dmabuf_fd, &param);
+}
+
+/* RGA 一次完成裁剪 + 缩放 + 颜色转换 */
+static int crop_rga(const face_crop_t* crop, const face_crop_source_t* src, rga_buffer_handle_t src_handle,
+                    int wstride, int hstride, int format, int x, int y, int side, int index)
+{
+    int size = crop->cfg.size;
+    rga_buffer_t pat = { 0 };
+    im_rect src_rect = { x, y, side, side };
+    im_rect dst_rect = { 0, 0, size, size };
+    im_rect pat_rect = { 0 };
+
+    if (crop->bgr_handle[index] == 0 || side * RGA_MAX_SCALE < size || side > size * RGA_MAX_SCALE) return -1;
+
+    rga_buffer_t s = wrapbuffer_handle(src_handle, src->width, src->height, format);
+    s.wstride = wstride;
+    s.hstride = hstride;
+    rga_buffer_t d = wrapbuffer_handle(crop->bgr_handle[index], size, size, RK_FORMAT_BGR_888);
+    d.wstride = size;
+    d.hstride = size;
+
+    IM_STATUS ret = improcess(s, d, pat, src_rect, dst_rect, pat_rect, IM_SYNC);
+    if (ret != IM_STATUS_SUCCESS) {
+        fprintf(stderr, "[%s] RGA improcess failed: %s\n", MODULE_TAG, imStrError(ret));
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+#ifdef USE_NEON
+/* 8 个 uint8 -> (v - mean) * inv_std */
+static inline void normalize8_neon(float* dst, uint8x8_t v, float32x4_t mean, float32x4_t inv_std)
+{
+    uint16x8_t w = vmovl_u8(v);
+    float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(w)));
+    float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(w)));
+    vst1q_f32(dst, vmulq_f32(vsubq_f32(lo, mean), inv_std));
+    vst1q_f32(dst + 4, vmulq_f32(vsubq_f32(hi, mean), inv_std));
+}
+#endif
+
+/* BGR 交织 -> RGB float 平面 */
+static void normalize_planes(const face_crop_t* crop, const uint8_t* bgr, float* out)
+{
+    int n = crop->cfg.size * crop->cfg.size;
+    float* r = out;
+    float* g = out + n;
+    float* b = out + 2 * n;
+    const float* mean = crop->cfg.mean;
+    const float* inv_std = crop->inv_std;
+    int i = 0;
+
+#ifdef USE_NEON
+    float32x4_t mean_r = vdupq_n_f32(mean[0]), mean_g = vdupq_n_f32(mean[1]), mean_b = vdupq_n_f32(mean[2]);
+    float32x4_t inv_r = vdupq_n_f32(inv_std[0]), inv_g = vdupq_n_f32(inv_std[1]), inv_b = vdupq_n_f32(inv_std[2]);
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x3_t px = vld3_u8(bgr + i * 3);
+        normalize8_neon(b + i, px.val[0], mean_b, inv_b);
+        normalize8_neon(g + i, px.val[1], mean_g, inv_g);
+        normalize8_neon(r + i, px.val[2], mean_r, inv_r);
+    }
+#endif
+    for (; i < n; i++) {
+        b[i] = (bgr[i * 3 + 0] - mean[2]) * inv_std[2];
+        g[i] = (bgr[i * 3 + 1] - mean[1]) * inv_std[1];
+        r[i] = (bgr[i * 3 + 2] - mean[0]) * inv_std[0];
+    }
+}
+
+int face_crop_run(face_crop_t* crop, const face_crop_source_t* src, const face_crop_rect_t* boxes, int count,
+                  face_crop_result_t* results)
+{
+    if (!crop || !src || !src->data || !results || (count > 0 && !boxes)) return -1;
+    if (src->width <= 0 || src->height <= 0 || src->stride <= 0) return -1;
+    if (count > FACE_CROP_MAX) count = FACE_CROP_MAX;
+
+    int size = crop->cfg.size;
+    int produced = 0;
+
+#ifdef USE_RGA
+    rga_buffer_handle_t src_handle = 0;
+    int wstride = 0, hstride = 0, format = 0;
+    if (src->dmabuf_fd >= 0 && count > 0) {
+        src_handle = source_import(src, &wstride, &hstride, &format);
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        int x, y, side;
+        if (crop_region(crop, src, &boxes[i], &x, &y, &side) != 0) continue;
+
+        uint8_t* bgr = crop->bgr[produced];
+        int done = -1;
+#ifdef USE_RGA
+        if (src_handle) done = crop_rga(crop, src, src_handle, wstride, hstride, format, x, y, side, produced);
+#endif
+        if (done != 0) crop_cpu(crop, src, x, y, side, bgr);
+
+        face_crop_result_t* out = &results[produced];
+        if (crop->cfg.layout == FACE_CROP_LAYOUT_RGB_F32) {
+            normalize_planes(crop, bgr, crop->planes[produced]);
+            out->data = crop->planes[produced];
+            out->size = crop->bgr_size * sizeof(float);
+            out->stride = size * (int)sizeof(float);
+        } else {
+            out->data = bgr;
+            out->size = crop->bgr_size;
+            out->stride = size * 3;
+        }
+        out->box_index = i;
+        out->region.x = (float)x;
+        out->region.y = (float)y;
+        out->region.width = (float)side;
+        out->region.height = (float)side;
+        produced++;
+    }
+
+#ifdef USE_RGA
+    if (src_handle) releasebuffer_handle(src_handle);
+#endif
+    return produced;
+}
@@ -0,0 +1,110 @@
+/*
+ * 人脸裁剪 - 按检测框从整帧裁出固定尺寸的人脸图，识别时只处理小图
+ *
+ * 1. 以检测框中心取正方形区域并按 margin_percent 外扩（识别模型需要额头和下巴），超出图像时平移回图像内
+ * 2. 源图为 NV12（解码缓冲区）或 BGRA（检测帧）；有 dmabuf 时 RGA 一次完成裁剪 + 缩放 + 颜色转换，否则 CPU 双线性采样
+ * 3. 输出 BGR 交织（OpenCV Mat / 百度 SDK 的输入）或 RGB 平面 float（(v - mean) / std，ARM 上 NEON 归一化）
+ * 4. 检测框没有关键点，对齐只做中心和尺度，不做旋转
+ */
+
+#ifndef FACE_CROP_H
+#define FACE_CROP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "yuv_convert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 一次最多裁剪的人脸数 */
+#define FACE_CROP_MAX 8
+
+/* 输出布局 */
+typedef enum {
+    FACE_CROP_LAYOUT_BGR888 = 0,    /* uint8 BGR 交织，行字节数 size * 3 */
+    FACE_CROP_LAYOUT_RGB_F32 = 1,   /* float RGB 平面（CHW），每平面 size * size 个 */
+} face_crop_layout_t;
+
+/* 裁剪配置，0 表示使用默认值 */
+typedef struct {
+    int size;                       /* 输出边长（默认 112，最大 512） */
+    int margin_percent;             /* 正方形边长 = 检测框长边 * (100 + margin) / 100（默认 40） */
+    face_crop_layout_t layout;
+    float mean[3];                  /* RGB_F32 的 R/G/B 均值和标准差，std 全为 0 时使用 127.5 / 128 */
+    float std[3];
+} face_crop_config_t;
+
+/* 源图格式 */
+typedef enum {
+    FACE_CROP_SOURCE_NV12 = 0,
+    FACE_CROP_SOURCE_BGRA = 1,
+} face_crop_source_format_t;
+
+/* 源图 */
+typedef struct {
+    face_crop_source_format_t format;
+    const uint8_t* data;            /* CPU 地址（缓冲区起始） */
+    int dmabuf_fd;                  /* -1 表示不是 dmabuf（只走 CPU 路径） */
+    int width;
+    int height;
+    int stride;                     /* 行字节数（NV12 两个平面相同） */
+    size_t uv_offset;               /* NV12 色度平面相对缓冲区起始的偏移 */
+    yuv_color_space_t color_space;  /* NV12 的 CPU 转换系数（RGA 使用默认系数） */
+} face_crop_source_t;
+
+/* 源图中的矩形（像素，左上角 + 尺寸） */
+typedef struct {
+    float x;
+    float y;
+    float width;
+    float height;
+} face_crop_rect_t;
+
+/* 一张裁剪图（缓冲区属于裁剪器，下一次 face_crop_run 前有效） */
+typedef struct {
+    const void* data;
+    size_t size;                    /* 字节数 */
+    int stride;                     /* 行字节数 */
+    int box_index;                  /* 对应的输入检测框下标 */
+    face_crop_rect_t region;        /* 实际裁剪的源区域 */
+} face_crop_result_t;
+
+/* 裁剪器句柄 */
+typedef struct face_crop face_crop_t;
+
+/**
+ * 创建裁剪器（预分配 FACE_CROP_MAX 张输出缓冲区）
+ * @param config 配置，NULL 表示全部使用默认值
+ * @return 裁剪器，失败返回 NULL
+ */
+face_crop_t* face_crop_create(const face_crop_config_t* config);
+
+/**
+ * 销毁裁剪器
+ */
+void face_crop_destroy(face_crop_t* crop);
+
+/**
+ * 获取生效的配置（默认值已填入）
+ */
+void face_crop_get_config(const face_crop_t* crop, face_crop_config_t* config);
+
+/**
+ * 裁剪一帧中的人脸，同一裁剪器只能在一个线程中调用
+ * @param src 源图
+ * @param boxes 检测框（源图像素），尺寸无效或完全在图像外的被跳过
+ * @param count 检测框数量，超过 FACE_CROP_MAX 的部分被忽略
+ * @param results 输出，至少 FACE_CROP_MAX 项
+ * @return 裁剪出的数量，参数无效返回 -1
+ */
+int face_crop_run(face_crop_t* crop, const face_crop_source_t* src, const face_crop_rect_t* boxes, int count,
+                  face_crop_result_t* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FACE_CROP_H */
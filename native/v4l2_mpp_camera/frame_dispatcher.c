@@ -0,0 +1,258 @@
+/*
+ * 帧回调分发器实现
+ *
+ * 邮箱只有一个槽位：生产者投递时若上一帧尚未被工作线程取走，直接释放旧帧并计为丢弃，
+ * 生产者从不等待。工作线程取帧、在锁外执行回调、再释放帧。
+ */
+
+#define _GNU_SOURCE
+#define MODULE_TAG "frame_dispatcher"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "frame_dispatcher.h"
+
+struct dispatcher_context;
+
+/* 工作线程 */
+typedef struct {
+    struct dispatcher_context* owner;
+    pthread_t thread;
+    int index;
+    int cpu;
+    bool started;
+    atomic_uint_fast64_t frames;
+    atomic_uint_fast64_t busy_us;
+} dispatcher_worker_t;
+
+/* 分发器上下文 */
+typedef struct dispatcher_context {
+    char name[11];
+    dispatch_run_t run;
+    dispatch_release_t release;
+    void* user_data;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            /* 新帧到达 / 停止 */
+    pthread_cond_t idle_cond;       /* 有工作线程完成处理 */
+    void* pending;                  /* 邮箱：最新的未处理帧 */
+    int busy;                       /* 正在执行回调的工作线程数 */
+    bool stopping;
+    
+    int worker_count;
+    dispatcher_worker_t workers[DISPATCHER_MAX_WORKERS];
+    
+    atomic_uint_fast64_t posted;
+    atomic_uint_fast64_t dropped;
+    struct timespec start_time;
+} dispatcher_context_t;
+
+static long elapsed_us(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+/* 取 cpu_mask 中第 n 个（循环）置位的核心，掩码为 0 返回 -1 */
+static int mask_nth_cpu(uint32_t mask, int n)
+{
+    int count = __builtin_popcount(mask);
+    if (count == 0) return -1;
+    
+    n %= count;
+    for (int cpu = 0; cpu < 32; cpu++) {
+        if ((mask & (1u << cpu)) && n-- == 0) return cpu;
+    }
+    return -1;
+}
+
+static void* worker_thread_func(void* arg)
+{
+    dispatcher_worker_t* worker = (dispatcher_worker_t*)arg;
+    dispatcher_context_t* ctx = worker->owner;
+    struct timespec ts_start, ts_end;
+    
+    for (;;) {
+        pthread_mutex_lock(&ctx->mutex);
+        while (!ctx->pending && !ctx->stopping) {
+            pthread_cond_wait(&ctx->cond, &ctx->mutex);
+        }
+        if (ctx->stopping) {
+            pthread_mutex_unlock(&ctx->mutex);
+            break;
+        }
+        void* item = ctx->pending;
+        ctx->pending = NULL;
+        ctx->busy++;
+        pthread_mutex_unlock(&ctx->mutex);
+        
+        clock_gettime(CLOCK_MONOTONIC, &ts_start);
+        ctx->run(ctx->user_data, item);
+        if (ctx->release) ctx->release(ctx->user_data, item);
+        clock_gettime(CLOCK_MONOTONIC, &ts_end);
+        
+        atomic_fetch_add_explicit(&worker->frames, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&worker->busy_us, elapsed_us(&ts_start, &ts_end), memory_order_relaxed);
+        
+        pthread_mutex_lock(&ctx->mutex);
+        ctx->busy--;
+        pthread_cond_broadcast(&ctx->idle_cond);
+        pthread_mutex_unlock(&ctx->mutex);
+    }
+    
+    return NULL;
+}
+
+dispatcher_handle_t dispatcher_create(const dispatcher_config_t* config)
+{
+    if (!config || !config->run || config->worker_count <= 0) return NULL;
+    
+    dispatcher_context_t* ctx = (dispatcher_context_t*)calloc(1, sizeof(dispatcher_context_t));
+    if (!ctx) return NULL;
+    
+    strncpy(ctx->name, config->name ? config->name : "dispatch", sizeof(ctx->name) - 1);
+    ctx->run = config->run;
+    ctx->release = config->release;
+    ctx->user_data = config->user_data;
+    ctx->worker_count = config->worker_count < DISPATCHER_MAX_WORKERS ? config->worker_count : DISPATCHER_MAX_WORKERS;
+    
+    pthread_mutex_init(&ctx->mutex, NULL);
+    pthread_cond_init(&ctx->cond, NULL);
+    pthread_cond_init(&ctx->idle_cond, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &ctx->start_time);
+    
+    for (int i = 0; i < ctx->worker_count; i++) {
+        dispatcher_worker_t* worker = &ctx->workers[i];
+        worker->owner = ctx;
+        worker->index = i;
+        worker->cpu = mask_nth_cpu(config->cpu_mask, i);
+        
+        if (pthread_create(&worker->thread, NULL, worker_thread_func, worker) != 0) {
+            fprintf(stderr, "[%s] Failed to create worker %d\n", MODULE_TAG, i);
+            dispatcher_destroy(ctx);
+            return NULL;
+        }
+        worker->started = true;
+        
+        char thread_name[16];
+        snprintf(thread_name, sizeof(thread_name), "%s-%d", ctx->name, i);
+        pthread_setname_np(worker->thread, thread_name);
+        
+        if (worker->cpu >= 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(worker->cpu, &cpus);
+            if (pthread_setaffinity_np(worker->thread, sizeof(cpus), &cpus) != 0) {
+                fprintf(stderr, "[%s] Failed to pin worker %d to CPU %d\n", MODULE_TAG, i, worker->cpu);
+                worker->cpu = -1;
+            }
+        }
+    }
+    
+    printf("[%s] %s: %d workers, cpu mask 0x%x\n", MODULE_TAG, ctx->name, ctx->worker_count, config->cpu_mask);
+    return ctx;
+}
+
+void dispatcher_destroy(dispatcher_handle_t handle)
+{
+    dispatcher_context_t* ctx = (dispatcher_context_t*)handle;
+    if (!ctx) return;
+    
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->stopping = true;
+    void* item = ctx->pending;
+    ctx->pending = NULL;
+    pthread_cond_broadcast(&ctx->cond);
+    pthread_mutex_unlock(&ctx->mutex);
+    
+    if (item && ctx->release) ctx->release(ctx->user_data, item);
+    
+    for (int i = 0; i < ctx->worker_count; i++) {
+        if (ctx->workers[i].started) {
+            pthread_join(ctx->workers[i].thread, NULL);
+        }
+    }
+    
+    pthread_cond_destroy(&ctx->idle_cond);
+    pthread_cond_destroy(&ctx->cond);
+    pthread_mutex_destroy(&ctx->mutex);
+    free(ctx);
+}
+
+bool dispatcher_post(dispatcher_handle_t handle, void* item)
+{
+    dispatcher_context_t* ctx = (dispatcher_context_t*)handle;
+    void* replaced = NULL;
+    bool accepted = true;
+    
+    if (!ctx || !item) return false;
+    
+    pthread_mutex_lock(&ctx->mutex);
+    if (ctx->stopping) {
+        replaced = item;
+        accepted = false;
+    } else {
+        replaced = ctx->pending;
+        ctx->pending = item;
+        pthread_cond_signal(&ctx->cond);
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+    
+    if (accepted) {
+        atomic_fetch_add_explicit(&ctx->posted, 1, memory_order_relaxed);
+        if (replaced) atomic_fetch_add_explicit(&ctx->dropped, 1, memory_order_relaxed);
+    }
+    
+    /* 释放放在锁外，release 可能较慢（如归还 GStreamer 样本） */
+    if (replaced && ctx->release) ctx->release(ctx->user_data, replaced);
+    
+    return accepted;
+}
+
+void dispatcher_flush(dispatcher_handle_t handle)
+{
+    dispatcher_context_t* ctx = (dispatcher_context_t*)handle;
+    if (!ctx) return;
+    
+    pthread_mutex_lock(&ctx->mutex);
+    void* item = ctx->pending;
+    ctx->pending = NULL;
+    while (ctx->busy > 0) {
+        pthread_cond_wait(&ctx->idle_cond, &ctx->mutex);
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+    
+    if (item && ctx->release) ctx->release(ctx->user_data, item);
+}
+
+int dispatcher_get_stats(dispatcher_handle_t handle, dispatcher_stats_t* stats)
+{
+    dispatcher_context_t* ctx = (dispatcher_context_t*)handle;
+    struct timespec now;
+    
+    if (!ctx || !stats) return -1;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long lifetime_us = elapsed_us(&ctx->start_time, &now);
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->frames_posted = atomic_load(&ctx->posted);
+    stats->frames_dropped = atomic_load(&ctx->dropped);
+    stats->worker_count = ctx->worker_count;
+    
+    for (int i = 0; i < ctx->worker_count; i++) {
+        dispatcher_worker_t* worker = &ctx->workers[i];
+        dispatcher_worker_stats_t* ws = &stats->workers[i];
+        ws->cpu = worker->cpu;
+        ws->frames = atomic_load(&worker->frames);
+        ws->busy_us = atomic_load(&worker->busy_us);
+        ws->occupancy = lifetime_us > 0 ? (float)ws->busy_us / lifetime_us : 0.0f;
+    }
+    
+    return 0;
+}
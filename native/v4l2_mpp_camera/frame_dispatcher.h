@@ -0,0 +1,97 @@
+/*
+ * 帧回调分发器 - 有界工作线程池 + 最新帧邮箱
+ *
+ * 采集/流线程只投递帧，从不执行用户代码：
+ * 1. 邮箱只保留一帧，工作线程都忙时新帧替换未处理的旧帧（最新帧优先）
+ * 2. 工作线程可绑定到指定 CPU 核心
+ * 3. 每个工作线程统计处理帧数和占用率，分发器统计投递/丢弃帧数
+ */
+
+#ifndef FRAME_DISPATCHER_H
+#define FRAME_DISPATCHER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 最大工作线程数 */
+#define DISPATCHER_MAX_WORKERS 8
+
+/* 分发器句柄 */
+typedef void* dispatcher_handle_t;
+
+/* 在工作线程中处理一帧 */
+typedef void (*dispatch_run_t)(void* user_data, void* item);
+
+/* 释放一帧（处理完成或被新帧替换时调用） */
+typedef void (*dispatch_release_t)(void* user_data, void* item);
+
+/* 分发器配置 */
+typedef struct {
+    const char* name;           /* 线程名前缀（最长 10 字符） */
+    int worker_count;           /* 工作线程数（1~DISPATCHER_MAX_WORKERS） */
+    uint32_t cpu_mask;          /* 绑定的 CPU 核心位掩码，工作线程依次绑定到各个置位核心（0 表示不绑定） */
+    dispatch_run_t run;
+    dispatch_release_t release;
+    void* user_data;
+} dispatcher_config_t;
+
+/* 单个工作线程统计 */
+typedef struct {
+    int cpu;                    /* 绑定的核心，-1 表示未绑定 */
+    uint64_t frames;            /* 已处理帧数 */
+    uint64_t busy_us;           /* 累计处理时间 */
+    float occupancy;            /* 自创建以来的占用率 (0~1) */
+} dispatcher_worker_stats_t;
+
+/* 分发器统计 */
+typedef struct {
+    uint64_t frames_posted;     /* 投递的帧数 */
+    uint64_t frames_dropped;    /* 在邮箱中被新帧替换、未被处理的帧数 */
+    int worker_count;
+    dispatcher_worker_stats_t workers[DISPATCHER_MAX_WORKERS];
+} dispatcher_stats_t;
+
+/**
+ * 创建分发器并启动工作线程
+ * @param config 配置
+ * @return 分发器句柄，失败返回 NULL
+ */
+dispatcher_handle_t dispatcher_create(const dispatcher_config_t* config);
+
+/**
+ * 停止工作线程并销毁分发器（未处理的帧会被释放）
+ * @param handle 分发器句柄
+ */
+void dispatcher_destroy(dispatcher_handle_t handle);
+
+/**
+ * 投递一帧，立即返回
+ * @param handle 分发器句柄
+ * @param item 帧，分发器负责之后调用 release
+ * @return true 投递成功，false 分发器已停止（item 已被释放）
+ */
+bool dispatcher_post(dispatcher_handle_t handle, void* item);
+
+/**
+ * 丢弃邮箱中未处理的帧，并等待正在执行的处理结束
+ * @param handle 分发器句柄
+ */
+void dispatcher_flush(dispatcher_handle_t handle);
+
+/**
+ * 获取统计信息
+ * @param handle 分发器句柄
+ * @param stats 输出统计
+ * @return 0 成功，-1 参数无效
+ */
+int dispatcher_get_stats(dispatcher_handle_t handle, dispatcher_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_DISPATCHER_H */
@@ -0,0 +1,274 @@
+/*
+ * 逐帧追踪实现
+ *
+ * 追踪点在锁内把事件追加到当前缓冲区，写线程每个周期交换两个缓冲区后在锁外格式化写文件。
+ * 文件是 JSON 数组，每次写入后刷新；进程异常退出时缺少结尾的 ]，Perfetto 和 chrome://tracing 仍能加载。
+ * 每个线程的首个事件前插入一条线程名元数据，轨道按线程名显示（capture/output/gst 流线程等）。
+ */
+
+#define _GNU_SOURCE
+#define MODULE_TAG "frame_trace"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "frame_trace.h"
+
+#define TRACE_ENV "FRAME_TRACE_FILE"
+#define TRACE_BUFFER_EVENTS 8192        /* 每个缓冲区的事件数，30 fps 下每帧十几个事件可容纳数十秒 */
+#define TRACE_FLUSH_MS 500
+
+typedef struct {
+    const char* name;
+    int64_t ts_us;
+    int tid;
+    char ph;                            /* 'X' 区间，'b'/'e' 异步区间起止，'M' 线程名 */
+    union {
+        struct {
+            int64_t dur_us;
+            uint64_t id;
+            uint64_t frame_id;
+            uint64_t seq;
+        } span;
+        char thread_name[16];
+    };
+} trace_event_t;
+
+static struct {
+    FILE* fp;
+    char path[256];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t writer;
+    trace_event_t* events;              /* 追踪点写入的缓冲区 */
+    trace_event_t* spare;               /* 写线程正在输出的缓冲区 */
+    int count;
+    int stop;
+    int pid;
+    int written;
+    unsigned long long dropped;
+} g_trace = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+int g_frame_trace_active = 0;
+
+static __thread int t_tid;
+
+int64_t frame_trace_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void trace_push_locked(const trace_event_t* ev)
+{
+    if (g_trace.count < TRACE_BUFFER_EVENTS) {
+        g_trace.events[g_trace.count++] = *ev;
+    } else {
+        g_trace.dropped++;
+    }
+}
+
+/* 追加事件；线程的首个事件前先追加线程名 */
+static void trace_push(trace_event_t* ev)
+{
+    trace_event_t meta;
+    int first = 0;
+
+    if (t_tid == 0) {
+        t_tid = (int)syscall(SYS_gettid);
+        first = 1;
+        memset(&meta, 0, sizeof(meta));
+        meta.ph = 'M';
+        meta.tid = t_tid;
+        if (pthread_getname_np(pthread_self(), meta.thread_name, sizeof(meta.thread_name)) != 0) {
+            snprintf(meta.thread_name, sizeof(meta.thread_name), "thread-%d", t_tid);
+        }
+    }
+    ev->tid = t_tid;
+
+    pthread_mutex_lock(&g_trace.lock);
+    if (first) trace_push_locked(&meta);
+    trace_push_locked(ev);
+    pthread_mutex_unlock(&g_trace.lock);
+}
+
+void frame_trace_span(const char* name, int64_t start_us, int64_t end_us, uint64_t frame_id, uint64_t seq)
+{
+    trace_event_t ev;
+
+    if (!g_frame_trace_active) return;
+    ev.name = name;
+    ev.ph = 'X';
+    ev.ts_us = start_us;
+    ev.span.dur_us = end_us > start_us ? end_us - start_us : 0;
+    ev.span.id = 0;
+    ev.span.frame_id = frame_id;
+    ev.span.seq = seq;
+    trace_push(&ev);
+}
+
+void frame_trace_async(const char* name, uint64_t id, int64_t start_us, int64_t end_us,
+                       uint64_t frame_id, uint64_t seq)
+{
+    trace_event_t ev;
+
+    if (!g_frame_trace_active) return;
+    ev.name = name;
+    ev.ph = 'b';
+    ev.ts_us = start_us;
+    ev.span.dur_us = 0;
+    ev.span.id = id;
+    ev.span.frame_id = frame_id;
+    ev.span.seq = seq;
+    trace_push(&ev);
+
+    ev.ph = 'e';
+    ev.ts_us = end_us > start_us ? end_us : start_us;
+    trace_push(&ev);
+}
+
+/* 帧号和序号参数，两者都未知时不输出 args */
+static void write_args(FILE* fp, const trace_event_t* ev)
+{
+    uint64_t frame_id = ev->span.frame_id, seq = ev->span.seq;
+
+    if (frame_id == FRAME_TRACE_NO_ID && seq == FRAME_TRACE_NO_ID) return;
+    fputs(",\"args\":{", fp);
+    if (frame_id != FRAME_TRACE_NO_ID) {
+        fprintf(fp, "\"frame\":%llu", (unsigned long long)frame_id);
+    }
+    if (seq != FRAME_TRACE_NO_ID) {
+        fprintf(fp, "%s\"seq\":%llu", frame_id != FRAME_TRACE_NO_ID ? "," : "", (unsigned long long)seq);
+    }
+    fputc('}', fp);
+}
+
+static void write_event(FILE* fp, const trace_event_t* ev)
+{
+    fputs(g_trace.written++ ? ",\n" : "", fp);
+
+    if (ev->ph == 'M') {
+        char name[sizeof(ev->thread_name)];
+        snprintf(name, sizeof(name), "%s", ev->thread_name);
+        for (char* p = name; *p; p++) {
+            if (*p == '"' || *p == '\\' || (unsigned char)*p < 0x20) *p = '_';
+        }
+        fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                g_trace.pid, ev->tid, name);
+        return;
+    }
+
+    fprintf(fp, "{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":%d",
+            ev->name, ev->ph, (long long)ev->ts_us, g_trace.pid, ev->tid);
+    if (ev->ph == 'X') {
+        fprintf(fp, ",\"dur\":%lld", (long long)ev->span.dur_us);
+    } else {
+        fprintf(fp, ",\"id\":\"0x%llx\"", (unsigned long long)ev->span.id);
+    }
+    if (ev->ph != 'e') write_args(fp, ev);
+    fputc('}', fp);
+}
+
+/* 写线程：定期交换缓冲区并写出（停止时写完剩余事件后结束） */
+static void* trace_writer_func(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_trace.lock);
+    for (;;) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)TRACE_FLUSH_MS * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        while (!g_trace.stop &&
+               pthread_cond_timedwait(&g_trace.cond, &g_trace.lock, &deadline) != ETIMEDOUT) {
+        }
+
+        trace_event_t* batch = g_trace.events;
+        int count = g_trace.count;
+        int stop = g_trace.stop;
+        g_trace.events = g_trace.spare;
+        g_trace.spare = batch;
+        g_trace.count = 0;
+        pthread_mutex_unlock(&g_trace.lock);
+
+        for (int i = 0; i < count; i++) {
+            write_event(g_trace.fp, &batch[i]);
+        }
+        if (count > 0) fflush(g_trace.fp);
+
+        pthread_mutex_lock(&g_trace.lock);
+        if (stop) break;
+    }
+    pthread_mutex_unlock(&g_trace.lock);
+    return NULL;
+}
+
+/* 库加载时按环境变量开启追踪 */
+__attribute__((constructor))
+static void frame_trace_init(void)
+{
+    const char* path = getenv(TRACE_ENV);
+
+    if (!path || !*path) return;
+
+    g_trace.events = (trace_event_t*)calloc(TRACE_BUFFER_EVENTS, sizeof(trace_event_t));
+    g_trace.spare = (trace_event_t*)calloc(TRACE_BUFFER_EVENTS, sizeof(trace_event_t));
+    g_trace.fp = fopen(path, "w");
+    if (!g_trace.events || !g_trace.spare || !g_trace.fp) {
+        fprintf(stderr, "[%s] Cannot open trace file %s: %s\n", MODULE_TAG, path, strerror(errno));
+        goto fail;
+    }
+    snprintf(g_trace.path, sizeof(g_trace.path), "%s", path);
+    g_trace.pid = (int)getpid();
+    fputs("[\n", g_trace.fp);
+
+    if (pthread_create(&g_trace.writer, NULL, trace_writer_func, NULL) != 0) {
+        fprintf(stderr, "[%s] Failed to create trace writer thread\n", MODULE_TAG);
+        goto fail;
+    }
+    pthread_setname_np(g_trace.writer, "frame_trace");
+
+    g_frame_trace_active = 1;
+    printf("[%s] Tracing to %s\n", MODULE_TAG, g_trace.path);
+    return;
+
+fail:
+    if (g_trace.fp) fclose(g_trace.fp);
+    free(g_trace.events);
+    free(g_trace.spare);
+    g_trace.fp = NULL;
+    g_trace.events = NULL;
+    g_trace.spare = NULL;
+}
+
+/* 进程退出时写完剩余事件并闭合 JSON 数组 */
+__attribute__((destructor))
+static void frame_trace_shutdown(void)
+{
+    if (!g_frame_trace_active) return;
+    g_frame_trace_active = 0;
+
+    pthread_mutex_lock(&g_trace.lock);
+    g_trace.stop = 1;
+    pthread_cond_signal(&g_trace.cond);
+    pthread_mutex_unlock(&g_trace.lock);
+    pthread_join(g_trace.writer, NULL);
+
+    fputs("\n]\n", g_trace.fp);
+    fclose(g_trace.fp);
+    g_trace.fp = NULL;
+    printf("[%s] Trace written to %s (%d events, %llu dropped)\n",
+           MODULE_TAG, g_trace.path, g_trace.written, g_trace.dropped);
+}
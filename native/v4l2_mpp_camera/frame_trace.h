@@ -0,0 +1,74 @@
+/*
+ * 逐帧追踪 - 采集、解码、转换、回调和叠加各阶段的耗时区间，输出 Chrome JSON 追踪格式（Perfetto 直接打开）
+ *
+ * 1. 编译选项 ENABLE_FRAME_TRACE（定义 FRAME_TRACE）关闭时宏展开为空，参数不求值，没有任何开销
+ * 2. 编译后由环境变量 FRAME_TRACE_FILE 指定输出文件，未设置时每个追踪点只多一次全局变量判断
+ * 3. 区间带帧号（frame_id）和驱动帧序号（V4L2 buf.sequence），按帧号可把同一帧在各线程中的区间串起来
+ * 4. 追踪点只把事件写入内存缓冲区，后台线程定期写文件；缓冲区满时丢弃事件并计数，不阻塞帧路径
+ */
+
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 帧号/序号未知（尚未分配或该阶段不对应单帧） */
+#define FRAME_TRACE_NO_ID UINT64_MAX
+
+#ifdef FRAME_TRACE
+
+/* 追踪是否已开启（库加载时按环境变量设置，之后只读） */
+extern int g_frame_trace_active;
+
+/**
+ * 当前时间（CLOCK_MONOTONIC 微秒，与帧信息中的时间同一时基）
+ */
+int64_t frame_trace_now_us(void);
+
+/**
+ * 记录当前线程中的一个区间（同一线程的区间应嵌套或不重叠）
+ * @param name 区间名（字符串常量，只保存指针）
+ * @param frame_id 帧号，FRAME_TRACE_NO_ID 表示未知
+ * @param seq 驱动帧序号，FRAME_TRACE_NO_ID 表示未知
+ */
+void frame_trace_span(const char* name, int64_t start_us, int64_t end_us, uint64_t frame_id, uint64_t seq);
+
+/**
+ * 记录一个异步区间（起止可在不同线程或与其他区间重叠，例如硬件解码中的在途任务）
+ * @param id 区间标识，同名区间中唯一
+ */
+void frame_trace_async(const char* name, uint64_t id, int64_t start_us, int64_t end_us,
+                       uint64_t frame_id, uint64_t seq);
+
+/* 在作用域内开始计时，未开启追踪时变量为 0 */
+#define FRAME_TRACE_BEGIN(var) int64_t var = g_frame_trace_active ? frame_trace_now_us() : 0
+
+/* 结束 FRAME_TRACE_BEGIN 开始的区间 */
+#define FRAME_TRACE_END(var, name, frame_id, seq) \
+    do { if (var) frame_trace_span(name, var, frame_trace_now_us(), frame_id, seq); } while (0)
+
+/* 用已有的时间戳记录区间 */
+#define FRAME_TRACE_SPAN(name, start_us, end_us, frame_id, seq) \
+    do { if (g_frame_trace_active) frame_trace_span(name, start_us, end_us, frame_id, seq); } while (0)
+
+#define FRAME_TRACE_ASYNC(name, id, start_us, end_us, frame_id, seq) \
+    do { if (g_frame_trace_active) frame_trace_async(name, id, start_us, end_us, frame_id, seq); } while (0)
+
+#else
+
+#define FRAME_TRACE_BEGIN(var) do { } while (0)
+#define FRAME_TRACE_END(var, name, frame_id, seq) do { } while (0)
+#define FRAME_TRACE_SPAN(name, start_us, end_us, frame_id, seq) do { } while (0)
+#define FRAME_TRACE_ASYNC(name, id, start_us, end_us, frame_id, seq) do { } while (0)
+
+#endif /* FRAME_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_TRACE_H */
@@ -0,0 +1,163 @@
+/*
+ * 流线程任务池实现
+ *
+ * 默认任务池用 GThreadPool 复用线程，线程继承创建者的调度且无法指定属性；本任务池每次 push 创建一个
+ * pthread（流任务在元素停止前一直运行，复用意义不大），join 时回收。
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gst_task_pool.h"
+#include "thread_sched.h"
+
+#define MODULE_TAG "gst_task_pool"
+
+struct _PlayerTaskPool {
+    GstTaskPool parent;
+
+    char name[12];
+    camera_thread_config_t config;
+    GMutex lock;                        /* 保护 report */
+    gst_player_thread_report_t report;
+};
+
+G_DEFINE_TYPE(PlayerTaskPool, player_task_pool, GST_TYPE_TASK_POOL)
+
+/* 一个流线程 */
+typedef struct {
+    pthread_t thread;
+    GstTaskPoolFunction func;
+    gpointer data;
+} pool_thread_t;
+
+static void* pool_thread_func(void* arg)
+{
+    pool_thread_t* t = (pool_thread_t*)arg;
+    t->func(t->data);
+    return NULL;
+}
+
+/* 不使用默认实现的 GThreadPool */
+static void player_task_pool_prepare(GstTaskPool* pool, GError** error)
+{
+    (void)pool;
+    (void)error;
+}
+
+static void player_task_pool_cleanup(GstTaskPool* pool)
+{
+    (void)pool;
+}
+
+static gpointer player_task_pool_push(GstTaskPool* pool, GstTaskPoolFunction func, gpointer data, GError** error)
+{
+    PlayerTaskPool* self = PLAYER_TASK_POOL(pool);
+    pool_thread_t* t = g_new0(pool_thread_t, 1);
+    camera_thread_status_t status;
+    char thread_name[16];
+
+    t->func = func;
+    t->data = data;
+
+    g_mutex_lock(&self->lock);
+    int index = self->report.streaming_threads;
+    g_mutex_unlock(&self->lock);
+    snprintf(thread_name, sizeof(thread_name), "%s-%d", self->name, index);
+
+    int ret = thread_sched_create(&t->thread, thread_name, &self->config, pool_thread_func, t, &status);
+    if (ret != 0) {
+        g_set_error(error, G_THREAD_ERROR, G_THREAD_ERROR_AGAIN, "流线程创建失败: %s", g_strerror(ret));
+        g_free(t);
+        return NULL;
+    }
+
+    g_mutex_lock(&self->lock);
+    self->report.streaming_threads++;
+    if (status.sched_applied) self->report.sched_applied++;
+    if (status.affinity_applied) self->report.affinity_applied++;
+    self->report.last = status;
+    g_mutex_unlock(&self->lock);
+    return t;
+}
+
+static void player_task_pool_join(GstTaskPool* pool, gpointer id)
+{
+    pool_thread_t* t = (pool_thread_t*)id;
+    (void)pool;
+
+    if (!t) return;
+    pthread_join(t->thread, NULL);
+    g_free(t);
+}
+
+static void player_task_pool_finalize(GObject* object)
+{
+    PlayerTaskPool* self = PLAYER_TASK_POOL(object);
+
+    g_mutex_clear(&self->lock);
+    G_OBJECT_CLASS(player_task_pool_parent_class)->finalize(object);
+}
+
+static void player_task_pool_class_init(PlayerTaskPoolClass* klass)
+{
+    GObjectClass* object_class = G_OBJECT_CLASS(klass);
+    GstTaskPoolClass* pool_class = GST_TASK_POOL_CLASS(klass);
+
+    object_class->finalize = player_task_pool_finalize;
+    pool_class->prepare = player_task_pool_prepare;
+    pool_class->cleanup = player_task_pool_cleanup;
+    pool_class->push = player_task_pool_push;
+    pool_class->join = player_task_pool_join;
+}
+
+static void player_task_pool_init(PlayerTaskPool* self)
+{
+    g_mutex_init(&self->lock);
+}
+
+GstTaskPool* player_task_pool_new(const char* name, const camera_thread_config_t* config)
+{
+    PlayerTaskPool* self = (PlayerTaskPool*)g_object_new(PLAYER_TYPE_TASK_POOL, NULL);
+
+    g_strlcpy(self->name, name ? name : "gst", sizeof(self->name));
+    if (config) self->config = *config;
+
+    /* 任务池不属于任何 bin，去掉浮动引用由调用方持有 */
+    gst_object_ref_sink(self);
+    return GST_TASK_POOL(self);
+}
+
+void player_task_pool_get_report(GstTaskPool* pool, gst_player_thread_report_t* report)
+{
+    PlayerTaskPool* self = PLAYER_TASK_POOL(pool);
+
+    g_mutex_lock(&self->lock);
+    report->streaming_threads = self->report.streaming_threads;
+    report->sched_applied = self->report.sched_applied;
+    report->affinity_applied = self->report.affinity_applied;
+    report->last = self->report.last;
+    g_mutex_unlock(&self->lock);
+}
+
+GstBusSyncReply player_task_pool_bus_sync(GstBus* bus, GstMessage* message, gpointer user_data)
+{
+    GstTaskPool* pool = GST_TASK_POOL(user_data);
+    (void)bus;
+
+    if (GST_MESSAGE_TYPE(message) != GST_MESSAGE_STREAM_STATUS) return GST_BUS_PASS;
+
+    GstStreamStatusType type;
+    GstElement* owner = NULL;
+    gst_message_parse_stream_status(message, &type, &owner);
+    if (type == GST_STREAM_STATUS_TYPE_CREATE) {
+        const GValue* value = gst_message_get_stream_status_object(message);
+        if (value && G_VALUE_HOLDS(value, GST_TYPE_TASK)) {
+            gst_task_set_pool(GST_TASK(g_value_get_object(value)), pool);
+        }
+    }
+
+    /* 没有人读取总线上的流状态消息，直接丢弃 */
+    return GST_BUS_DROP;
+}
@@ -0,0 +1,45 @@
+/*
+ * 流线程任务池 - 按 camera_thread_config_t 创建 GStreamer 流线程的 GstTaskPool
+ *
+ * 1. 管道总线的同步处理中，元素创建任务（STREAM_STATUS CREATE）时把任务的线程池换成本任务池
+ * 2. 每个任务对应一个 pthread，创建时设置 RT 调度（PTHREAD_EXPLICIT_SCHED）和 CPU 亲和性，不被允许时退回普通调度
+ * 3. 统计创建的线程数和其中设置生效的线程数
+ */
+
+#ifndef GST_TASK_POOL_H
+#define GST_TASK_POOL_H
+
+#include <gst/gst.h>
+
+#include "gst_video_player.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLAYER_TYPE_TASK_POOL (player_task_pool_get_type())
+G_DECLARE_FINAL_TYPE(PlayerTaskPool, player_task_pool, PLAYER, TASK_POOL, GstTaskPool)
+
+/**
+ * 创建任务池
+ * @param name 线程名前缀（最长 11 字符，线程名为 前缀-序号）
+ * @param config 调度配置
+ * @return 任务池（gst_object_unref 释放）
+ */
+GstTaskPool* player_task_pool_new(const char* name, const camera_thread_config_t* config);
+
+/**
+ * 获取线程调度统计（只填写流线程相关字段）
+ */
+void player_task_pool_get_report(GstTaskPool* pool, gst_player_thread_report_t* report);
+
+/**
+ * 总线同步处理：把新创建的流任务交给任务池（user_data 为任务池），流状态消息不再排入总线
+ */
+GstBusSyncReply player_task_pool_bus_sync(GstBus* bus, GstMessage* message, gpointer user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GST_TASK_POOL_H */
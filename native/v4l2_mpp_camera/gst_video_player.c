@@ -1,39 +1,159 @@
 /*
- * GStreamer 原生视频播放器 - cairooverlay 人脸框版本
+ * GStreamer 原生视频播放器
  * 
  * 架构：
- * - 显示分支：cairooverlay → glimagesink
- * - 检测分支：appsink → 人脸检测
+ * - 显示分支（GL）：mppjpegdec → glimagesink，人脸框作为
+ *   GstVideoOverlayCompositionMeta 附加到缓冲区，由 GPU 合成（无 CPU 颜色转换）
+ * - 显示分支（Cairo 回退）：jpegdec → videoconvert → cairooverlay → videoconvert → xvimagesink
+ * - 检测分支：appsink → 人脸检测（可选：帧回调在绑核的工作线程池中执行，流线程只投递最新帧）
+ * - 共享采集：camera_handle_t 的解码帧以 dmabuf GstBuffer 经 appsrc 进入显示分支，
+ *   检测帧来自同一次解码的相机检测流（每帧只硬解一次）
+ * - 运行中切换分辨率/帧率（低功耗空闲模式）：管道退回 READY 后修改源 caps 重新协商，不重建管道
+ * - 预启动：应用启动时在后台把管道切到 PAUSED（打开设备、协商源格式、创建 GL 上下文），
+ *   窗口可以之后再设置，start 只需进入 PLAYING；停止后回到 PAUSED 保持预热
+ * - 管道用代码逐个创建元素：源链（v4l2src/appsrc → 解码 → tee）+ 可插拔分支（显示、检测），
+ *   分支运行中可通过 tee 的空闲探针断开并移出管道，不用的分支不占用线程和缓冲区
+ * - 运动门控（可选）：检测分支降帧率后比较亮度网格，画面静止时在缩放/颜色转换之前丢帧，只按心跳间隔交付
+ * - 录像分支（可选）：解码帧经 MPP 硬件编码，码流在内存中保留最近几秒（event_recorder），
+ *   触发时把事件前后的码流封装成 MP4 写入文件，不经过 CPU 编码
+ * - 帧号和时间：最近帧历史记录每帧的 V4L2 序号、采集时刻和解码完成时刻（CLOCK_MONOTONIC），
+ *   检测帧按 PTS 找回帧号，人脸框按检测帧的采集时刻外推到显示帧的采集时刻
+ * - 多实例：除一次性的 GStreamer 初始化外所有状态都在句柄中，每个播放器一条独立命名的管道；
+ *   多路共享采集时各相机加入同一相机组，共享解码缓冲池和 RGA 调度
+ * - 流线程调度（可选）：总线同步处理把各元素的流任务交给自定义 GstTaskPool，按配置设置 RT 策略和 CPU 亲和性
+ * - 人脸裁剪：按最近的人脸框从检测帧（NV12 dmabuf 用 RGA）裁出固定尺寸的人脸图，识别不再处理整帧
+ * - 检测自适应（可选）：按回调执行时间、检测丢帧和系统 CPU 占用在配置的上下限之间调整检测帧率（PTS 限速）
+ *   和缩放尺寸（运行中修改缩放 capsfilter），负载高时识别延迟仍有上界
+ * - 拉取模式：消费者注册固定缓冲区后检测帧只保留最新一帧的引用，消费者等待 eventfd 后按自己的节奏复制取走，
+ *   托管端不需要每帧反向 P/Invoke
+ * - 逐帧追踪（可选，ENABLE_FRAME_TRACE）：appsink 交付、检测回调、Cairo 绘制和 GL 叠加合成记录带帧号的区间，
+ *   与 v4l2_mpp_camera 的采集/解码/转换区间写入同一个追踪文件
  * - 人脸框有延迟但能显示
  */
 
 #include "gst_video_player.h"
+#include "motion_gate.h"
+#include "event_recorder.h"
+#include "gst_task_pool.h"
+#include "thread_sched.h"
+#include "face_crop.h"
+#include "detect_qos.h"
+#include "frame_trace.h"
 #include <gst/gst.h>
 #include <gst/video/videooverlay.h>
+#include <gst/video/video-overlay-composition.h>
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/allocators/gstdmabuf.h>
 #include <cairo/cairo.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #define MODULE_TAG "gst_video_player"
-#define MAX_FACE_BOXES 10
+#define DEFAULT_MAX_FACE_BOXES 10
+#define FACE_BOXES_LIMIT 256
+#define FACE_MOTION_MAX_GAP_US 500000   /* 两次检测间隔超过此值时不估计人脸框速度 */
+#define FACE_BOX_LINE_WIDTH 3
+#define SHARED_MAX_IN_FLIGHT 2      /* 共享模式下显示分支最多持有的解码缓冲区数 */
+#define DEFAULT_IDLE_WIDTH 320
+#define DEFAULT_IDLE_HEIGHT 240
+#define DEFAULT_IDLE_FPS 5
+#define DEFAULT_RECORD_BITRATE_KBPS 2000
+#define FRAME_HISTORY_SIZE 32       /* 最近帧历史长度，需覆盖检测分支排队和人脸检测耗时 */
 
+/* CLOCK_MONOTONIC，与 V4L2 驱动时间戳和 GStreamer 系统时钟同一时基 */
 static int64_t get_time_us(void)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
+/* 人脸框运动速度（源图像像素/微秒） */
+typedef struct {
+    float vx;
+    float vy;
+    float vw;
+    float vh;
+} face_box_motion_t;
+
+/* 人脸框快照 */
+typedef struct {
+    int count;
+    int source_width;
+    int source_height;
+    int64_t timestamp_us;               /* 检测帧的采集时刻（未指明检测帧时为设置时刻） */
+    gst_face_box_t* boxes;              /* max_face_boxes 个 */
+    face_box_motion_t* motion;          /* 与上一次检测匹配估计的速度，匹配不到时为 0 */
+} face_box_snapshot_t;
+
+/* 显示坐标下的人脸框 */
+typedef struct {
+    int x;
+    int y;
+    int w;
+    int h;
+    int score;                          /* 置信度百分数，0 表示不显示 */
+} face_rect_t;
+
+/* GL 路径的置信度文本缓存 */
+typedef struct {
+    GstBuffer* pixels;
+    int score;
+    int width;
+    int height;
+} face_text_t;
+
+/* tee 之后的一个分支：运行中可以断开/重新连接，断开的分支移出管道，不占用线程和缓冲区 */
+typedef struct {
+    GstElement* bin;                    /* 分支 bin（播放器持有引用，断开后仍保留） */
+    GstPad* tee_pad;                    /* tee 的 request pad，NULL 表示已断开 */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool unlinked;                      /* 空闲探针已断开分支 */
+} player_branch_t;
+
+#define PLAYER_BRANCH_COUNT (GST_PLAYER_BRANCH_RECORD + 1)
+
+/* 最近帧历史的一项 */
+typedef struct {
+    bool valid;
+    GstClockTime pts;                   /* 源缓冲区 PTS，共享采集为 GST_CLOCK_TIME_NONE（按帧号查找） */
+    gst_player_frame_info_t info;
+} frame_history_entry_t;
+
 typedef struct {
     GstElement* pipeline;
+    GstElement* tee;
+    player_branch_t branches[PLAYER_BRANCH_COUNT];  /* 按 gst_player_branch_t 索引，未创建的分支 bin 为 NULL */
     GstElement* video_sink;
     GstElement* app_sink;
     GstElement* overlay;
     GstBus* bus;
+    GstTaskPool* task_pool;             /* 流线程任务池，NULL 表示使用 GStreamer 默认线程池 */
+    gst_player_thread_report_t memory_report;   /* 只用内存锁定字段 */
+    gst_player_display_mode_t display_mode;
+    gulong overlay_probe_id;
+    
+    /* 共享采集 */
+    camera_handle_t shared_camera;
+    GstElement* app_src;
+    GstAllocator* dmabuf_allocator;
+    camera_pixel_format_t shared_format;    /* 已设置到 appsrc 的格式，NONE 表示尚未设置 caps */
+    int shared_width;                       /* 已设置到 appsrc 的尺寸（相机切换分辨率后重新设置 caps） */
+    int shared_height;
+    atomic_int shared_in_flight;
+    bool shared_detect;                     /* 帧回调由相机检测流驱动 */
+    int face_detect_fps;
+    int64_t last_detect_us;
     
     char device[64];
     int width;
@@ -42,48 +162,481 @@ typedef struct {
     gst_player_format_t format;
     bool use_hardware_decode;
     
+    /* 工作模式：空闲时检测分支的 valve 丢弃所有帧 */
+    gst_player_mode_t mode;
+    int active_width;
+    int active_height;
+    int active_fps;
+    int idle_width;
+    int idle_height;
+    int idle_fps;
+    GstElement* src_caps;               /* v4l2src 后的 capsfilter，切换格式时修改 */
+    GstElement* detect_valve;
+    volatile bool detect_paused;
+    volatile bool detect_disabled;      /* 检测分支已断开（共享采集的检测回调同样停止） */
+    motion_gate_t* motion_gate;         /* 运动门控，NULL 表示不启用 */
+    detect_qos_t* detect_qos;           /* 检测自适应，NULL 表示不启用（face_detect_fps 随档位变化） */
+    GstElement* detect_scale;           /* 检测分支缩放后的 capsfilter，档位改变尺寸时修改 */
+    int face_detect_max_fps;            /* 配置的检测帧率（自适应的上限，videorate 按此输出） */
+    GstClockTime last_detect_pts;       /* 检测分支上一帧放行的 PTS（档位帧率低于 videorate 时限速） */
+    atomic_uint_fast64_t detect_overruns;   /* 消费者处理不及丢弃的检测帧（零拷贝帧持有过多、拉取前被替换） */
+    event_recorder_t* recorder;         /* 预录缓冲，NULL 表示没有录像分支 */
+    GstElement* record_sink;
+    
     unsigned long x11_window_id;
     
     gst_frame_callback_t frame_callback;
     void* callback_user_data;
+    gst_frame_info_callback_t frame_info_callback;
+    void* callback_info_user_data;
+    gst_frame_ex_callback_t frame_callback_ex;
+    void* callback_ex_user_data;
+    gst_player_pixel_format_t face_detect_format;
+    atomic_int held_frames;             /* 消费者尚未归还的零拷贝帧 */
+    dispatcher_handle_t detect_dispatcher;  /* 帧回调工作线程池，NULL 表示在流线程中回调 */
+    
+    /* 人脸框：双缓冲快照 + 序号（seqlock），写入方之间用 face_box_mutex 串行，显示线程读取不加锁 */
+    int max_face_boxes;
+    int64_t face_box_predict_us;        /* 人脸框最长外推时间，0 表示不外推 */
+    face_box_snapshot_t face_snapshots[2];
+    atomic_uint face_box_seq;           /* face_snapshots[(seq >> 1) & 1] 为已发布的快照，奇数表示正在写另一个 */
+    pthread_mutex_t face_box_mutex;
+    
+    /* 人脸裁剪：首次裁剪时创建，配置变化后重建；face_crop_lock 串行化裁剪（输出缓冲区只有一组） */
+    face_crop_t* face_crop;
+    gst_face_crop_config_t face_crop_config;
+    bool face_crop_dirty;
+    pthread_mutex_t face_crop_lock;
     
-    /* 人脸框 */
-    gst_face_box_t face_boxes[MAX_FACE_BOXES];
-    int face_box_count;
-    int face_source_width;
-    int face_source_height;
+    /* 拉取模式：只保留最新一帧检测帧的引用（held_frame_t，不计入 held_frames），消费者拉取时复制到其注册的缓冲区 */
+    void* pull_buffers[GST_PLAYER_MAX_PULL_BUFFERS];
+    int pull_buffer_count;
+    size_t pull_buffer_size;
+    atomic_bool pull_enabled;
+    struct held_frame* pull_latest;     /* 未被拉取的最新帧，NULL 表示没有新帧 */
+    pthread_mutex_t pull_lock;          /* 保护缓冲区表和 pull_latest */
+    int pull_fd;                        /* eventfd，保留新帧时置位，拉取时清零 */
+    atomic_uint pull_skipped;           /* 上次拉取以来未被拉取就被新帧替换的帧数 */
+    atomic_int_fast64_t pull_return_us; /* 上次成功拉取返回的时间，消费者回来等待/拉取时结算处理时间，0 表示无 */
+    
+    /* 最近帧历史：源/解码线程写入，检测、显示和设置人脸框时查找 */
+    frame_history_entry_t frame_history[FRAME_HISTORY_SIZE];
+    int frame_history_next;
+    pthread_mutex_t frame_history_lock;
+    
+    /* 以下仅由显示线程访问 */
+    face_box_snapshot_t face_view;      /* 读出的快照副本 */
+    face_rect_t* face_rects;            /* 本帧的人脸框 */
     int video_width;
     int video_height;
-    pthread_mutex_t face_box_mutex;
+    
+    /* GL 显示路径：人脸框合成缓存，人脸框位置变化时才重建 */
+    GstVideoOverlayComposition* composition;
+    GstBuffer* box_pixel;           /* 1x1 绿色像素，缩放成框线 */
+    face_rect_t* composed_rects;    /* composition 对应的人脸框 */
+    int composed_count;
+    face_text_t* score_texts;
+    atomic_bool composition_dirty;  /* 显示尺寸变化，需要重建（任意线程设置） */
     
     volatile bool running;
     volatile bool playing;
+    bool prerolled;                     /* 已预启动：停止时回到 PAUSED 而不是 NULL */
     
     int face_detect_width;
     int face_detect_height;
     
-    int frame_count;
     int64_t start_time;
+    
+    /* 性能统计 */
+    atomic_int frame_count;
+    atomic_uint_fast64_t frames_detected;
+    atomic_uint_fast64_t display_queue_drops;
+    atomic_uint_fast64_t detect_queue_drops;
+    atomic_uint_fast64_t sequence_gaps;
+    atomic_uint_fast64_t frames_lost;
+    atomic_uint_fast64_t frames_gated;
+    int64_t last_v4l2_sequence;         /* 上一帧的 v4l2src 序号（buffer offset），-1 表示尚无帧 */
+    int64_t last_display_us;
+    int64_t first_frame_us;             /* start 到首帧送达显示 sink，0 表示尚无帧 */
+    latency_stats_t lat_display;
+    latency_stats_t lat_interval;
+    latency_stats_t lat_callback;
 } gst_player_context_t;
 
+/* 进程内只初始化一次，多个播放器可在不同线程中同时创建 */
+static pthread_mutex_t g_gst_init_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool g_gst_initialized = false;
 
+/* 管道名编号（player0、player1…），多路播放器的调试输出和 GST_DEBUG 日志可以区分 */
+static atomic_int g_pipeline_count;
+
+/* 管道可能用到的元素，初始化时预先加载插件，创建管道时不再 dlopen */
+static const char* const g_preload_elements[] = {
+    "v4l2src", "mppjpegdec", "jpegdec", "glimagesink", "xvimagesink", "cairooverlay",
+    "videoconvert", "videoscale", "videorate", "v4l2convert",
+    "appsrc", "appsink", "tee", "queue", "valve", "capsfilter",
+    "mpph264enc", "h264parse", "mp4mux", "filesink",
+};
+
+/* 用户缓存目录中是否已有注册表（GST_REGISTRY 指定时检查该文件） */
+static bool registry_cache_exists(void)
+{
+    const char* path = g_getenv("GST_REGISTRY");
+    if (path) return g_file_test(path, G_FILE_TEST_EXISTS);
+    
+    char* dir_path = g_build_filename(g_get_user_cache_dir(), "gstreamer-1.0", NULL);
+    GDir* dir = g_dir_open(dir_path, 0, NULL);
+    bool found = false;
+    g_free(dir_path);
+    if (!dir) return false;
+    
+    const char* name;
+    while (!found && (name = g_dir_read_name(dir))) {
+        found = g_str_has_prefix(name, "registry.") && g_str_has_suffix(name, ".bin");
+    }
+    g_dir_close(dir);
+    return found;
+}
+
 gst_player_error_t gst_player_global_init(void)
 {
-    if (g_gst_initialized) return GST_PLAYER_OK;
+    pthread_mutex_lock(&g_gst_init_lock);
+    if (g_gst_initialized) {
+        pthread_mutex_unlock(&g_gst_init_lock);
+        return GST_PLAYER_OK;
+    }
+    
+    int64_t start = get_time_us();
+    
+    /* 已有注册表缓存时直接使用，不再逐个检查插件文件（首次运行仍会扫描并生成缓存）；
+     * 升级插件后删除缓存或设置 GST_REGISTRY_UPDATE=yes。需要扫描时在本进程中进行，不 fork 扫描器 */
+    if (!g_getenv("GST_REGISTRY_UPDATE") && registry_cache_exists()) {
+        g_setenv("GST_REGISTRY_UPDATE", "no", FALSE);
+    }
+    gst_registry_fork_set_enabled(FALSE);
     
     GError* error = NULL;
     if (!gst_init_check(NULL, NULL, &error)) {
         printf("[%s] GStreamer 初始化失败\n", MODULE_TAG);
         if (error) g_error_free(error);
+        pthread_mutex_unlock(&g_gst_init_lock);
         return GST_PLAYER_ERROR_INIT_FAILED;
     }
     
+    GstRegistry* registry = gst_registry_get();
+    for (size_t i = 0; i < sizeof(g_preload_elements) / sizeof(g_preload_elements[0]); i++) {
+        GstPluginFeature* feature = gst_registry_lookup_feature(registry, g_preload_elements[i]);
+        if (!feature) continue;
+        GstPluginFeature* loaded = gst_plugin_feature_load(feature);
+        if (loaded) gst_object_unref(loaded);
+        gst_object_unref(feature);
+    }
+    
     g_gst_initialized = true;
-    printf("[%s] GStreamer 初始化成功\n", MODULE_TAG);
+    pthread_mutex_unlock(&g_gst_init_lock);
+    printf("[%s] GStreamer 初始化成功（%lld ms）\n", MODULE_TAG, (long long)(get_time_us() - start) / 1000);
     return GST_PLAYER_OK;
 }
 
+/* 分配人脸框缓冲区（按 max_face_boxes） */
+static bool face_boxes_init(gst_player_context_t* ctx)
+{
+    int n = ctx->max_face_boxes;
+    face_box_snapshot_t* snaps[] = { &ctx->face_snapshots[0], &ctx->face_snapshots[1], &ctx->face_view };
+    
+    for (int i = 0; i < 3; i++) {
+        snaps[i]->boxes = (gst_face_box_t*)calloc(n, sizeof(gst_face_box_t));
+        snaps[i]->motion = (face_box_motion_t*)calloc(n, sizeof(face_box_motion_t));
+        if (!snaps[i]->boxes || !snaps[i]->motion) return false;
+    }
+    ctx->face_rects = (face_rect_t*)calloc(n, sizeof(face_rect_t));
+    ctx->composed_rects = (face_rect_t*)calloc(n, sizeof(face_rect_t));
+    ctx->score_texts = (face_text_t*)calloc(n, sizeof(face_text_t));
+    atomic_init(&ctx->face_box_seq, 0);
+    atomic_init(&ctx->composition_dirty, false);
+    return ctx->face_rects && ctx->composed_rects && ctx->score_texts;
+}
+
+static void face_boxes_free(gst_player_context_t* ctx)
+{
+    face_box_snapshot_t* snaps[] = { &ctx->face_snapshots[0], &ctx->face_snapshots[1], &ctx->face_view };
+    
+    for (int i = 0; i < 3; i++) {
+        free(snaps[i]->boxes);
+        free(snaps[i]->motion);
+        snaps[i]->boxes = NULL;
+        snaps[i]->motion = NULL;
+    }
+    if (ctx->score_texts) {
+        for (int i = 0; i < ctx->max_face_boxes; i++) {
+            if (ctx->score_texts[i].pixels) gst_buffer_unref(ctx->score_texts[i].pixels);
+        }
+    }
+    free(ctx->score_texts);
+    free(ctx->face_rects);
+    free(ctx->composed_rects);
+    ctx->score_texts = NULL;
+    ctx->face_rects = NULL;
+    ctx->composed_rects = NULL;
+}
+
+/* 锁定/解锁显示和检测线程每帧访问的内存：播放器上下文 + 人脸框缓冲区（视频帧缓冲区来自解码器和 dmabuf） */
+static void player_lock_memory(gst_player_context_t* ctx, bool lock)
+{
+    const face_box_snapshot_t* snaps[] = { &ctx->face_snapshots[0], &ctx->face_snapshots[1], &ctx->face_view };
+    size_t n = (size_t)ctx->max_face_boxes;
+    struct { const void* addr; size_t len; } regions[3 * 2 + 4] = {
+        { ctx, sizeof(*ctx) },
+        { ctx->face_rects, n * sizeof(face_rect_t) },
+        { ctx->composed_rects, n * sizeof(face_rect_t) },
+        { ctx->score_texts, n * sizeof(face_text_t) },
+    };
+    int count = 4;
+    for (int i = 0; i < 3; i++) {
+        regions[count].addr = snaps[i]->boxes;
+        regions[count++].len = n * sizeof(gst_face_box_t);
+        regions[count].addr = snaps[i]->motion;
+        regions[count++].len = n * sizeof(face_box_motion_t);
+    }
+    
+    if (!lock) {
+        for (int i = 0; i < count; i++) thread_sched_unlock_memory(regions[i].addr, regions[i].len);
+        return;
+    }
+    
+    gst_player_thread_report_t* report = &ctx->memory_report;
+    report->lock_requested = true;
+    report->memory_locked = true;
+    report->locked_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        if (thread_sched_lock_memory(regions[i].addr, regions[i].len) == 0) {
+            report->locked_bytes += regions[i].len;
+        } else {
+            report->memory_locked = false;
+        }
+    }
+    printf("[%s] 已锁定内存 %zu 字节%s\n", MODULE_TAG, report->locked_bytes,
+           report->memory_locked ? "" : "（部分失败，检查 RLIMIT_MEMLOCK）");
+}
+
+/* 与上一次检测结果按中心距离匹配，估计每个人脸框的运动速度（写入方调用） */
+static void face_motion_estimate(const face_box_snapshot_t* prev, face_box_snapshot_t* next)
+{
+    int64_t dt = next->timestamp_us - prev->timestamp_us;
+    bool valid = prev->count > 0 && dt > 0 && dt <= FACE_MOTION_MAX_GAP_US &&
+                 prev->source_width == next->source_width && prev->source_height == next->source_height;
+    
+    for (int i = 0; i < next->count; i++) {
+        const gst_face_box_t* b = &next->boxes[i];
+        face_box_motion_t* m = &next->motion[i];
+        memset(m, 0, sizeof(*m));
+        if (!valid) continue;
+        
+        /* 中心移动不超过一个框的尺寸才认为是同一张脸 */
+        float limit = b->width > b->height ? b->width : b->height;
+        float best = limit * limit;
+        const gst_face_box_t* match = NULL;
+        for (int j = 0; j < prev->count; j++) {
+            const gst_face_box_t* p = &prev->boxes[j];
+            float dx = b->center_x - p->center_x;
+            float dy = b->center_y - p->center_y;
+            float d2 = dx * dx + dy * dy;
+            if (d2 < best) {
+                best = d2;
+                match = p;
+            }
+        }
+        if (!match) continue;
+        
+        m->vx = (b->center_x - match->center_x) / dt;
+        m->vy = (b->center_y - match->center_y) / dt;
+        m->vw = (b->width - match->width) / dt;
+        m->vh = (b->height - match->height) / dt;
+    }
+}
+
+/* 发布人脸框（持有 face_box_mutex）：写入未发布的缓冲区，序号为奇数期间表示正在写 */
+static void face_boxes_publish(gst_player_context_t* ctx, const gst_face_box_t* boxes, int count,
+                               int source_width, int source_height, int64_t timestamp_us)
+{
+    unsigned seq = atomic_load_explicit(&ctx->face_box_seq, memory_order_relaxed);
+    const face_box_snapshot_t* prev = &ctx->face_snapshots[(seq >> 1) & 1];
+    face_box_snapshot_t* next = &ctx->face_snapshots[((seq >> 1) + 1) & 1];
+    
+    atomic_store_explicit(&ctx->face_box_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    next->count = count;
+    next->source_width = source_width;
+    next->source_height = source_height;
+    next->timestamp_us = timestamp_us;
+    if (count > 0) memcpy(next->boxes, boxes, count * sizeof(gst_face_box_t));
+    face_motion_estimate(prev, next);
+    
+    atomic_store_explicit(&ctx->face_box_seq, seq + 2, memory_order_release);
+}
+
+/* 显示线程：无锁读出最新的人脸框快照 */
+static void face_boxes_read(gst_player_context_t* ctx, face_box_snapshot_t* out)
+{
+    for (;;) {
+        unsigned s1 = atomic_load_explicit(&ctx->face_box_seq, memory_order_acquire);
+        const face_box_snapshot_t* snap = &ctx->face_snapshots[(s1 >> 1) & 1];
+        
+        int count = snap->count;
+        if (count < 0) count = 0;
+        if (count > ctx->max_face_boxes) count = ctx->max_face_boxes;
+        out->count = count;
+        out->source_width = snap->source_width;
+        out->source_height = snap->source_height;
+        out->timestamp_us = snap->timestamp_us;
+        memcpy(out->boxes, snap->boxes, count * sizeof(gst_face_box_t));
+        memcpy(out->motion, snap->motion, count * sizeof(face_box_motion_t));
+        
+        /* 期间写入方至多发布了另一个缓冲区，读到的缓冲区没有被改写 */
+        atomic_thread_fence(memory_order_acquire);
+        unsigned s2 = atomic_load_explicit(&ctx->face_box_seq, memory_order_relaxed);
+        if (s2 - (s1 & ~1u) <= 2) return;
+    }
+}
+
+/* 把快照中的人脸框外推到 target_us（显示帧的采集时刻）并换算成显示坐标，返回矩形数（显示线程调用） */
+static int face_boxes_layout(gst_player_context_t* ctx, const face_box_snapshot_t* snap, int64_t target_us,
+                             face_rect_t* rects)
+{
+    if (snap->count <= 0 || ctx->video_width <= 0 || snap->source_width <= 0 || snap->source_height <= 0) {
+        return 0;
+    }
+    
+    double scale_x = (double)ctx->video_width / snap->source_width;
+    double scale_y = (double)ctx->video_height / snap->source_height;
+    double dt = 0;
+    if (ctx->face_box_predict_us > 0) {
+        int64_t age = target_us - snap->timestamp_us;
+        dt = (double)(age < 0 ? 0 : (age > ctx->face_box_predict_us ? ctx->face_box_predict_us : age));
+    }
+    
+    int n = 0;
+    for (int i = 0; i < snap->count; i++) {
+        const gst_face_box_t* box = &snap->boxes[i];
+        const face_box_motion_t* m = &snap->motion[i];
+        double w = (box->width + m->vw * dt) * scale_x;
+        double h = (box->height + m->vh * dt) * scale_y;
+        if (w <= 0 || h <= 0) continue;
+        
+        face_rect_t* r = &rects[n++];
+        r->w = (int)w;
+        r->h = (int)h;
+        r->x = (int)((box->center_x + m->vx * dt) * scale_x) - r->w / 2;
+        r->y = (int)((box->center_y + m->vy * dt) * scale_y) - r->h / 2;
+        r->score = box->score > 0 ? (int)(box->score * 100 + 0.5f) : 0;
+    }
+    return n;
+}
+
+/* 记录一帧到历史，覆盖最旧的一项 */
+static void frame_history_add(gst_player_context_t* ctx, GstClockTime pts, const gst_player_frame_info_t* info)
+{
+    pthread_mutex_lock(&ctx->frame_history_lock);
+    frame_history_entry_t* e = &ctx->frame_history[ctx->frame_history_next];
+    e->valid = true;
+    e->pts = pts;
+    e->info = *info;
+    ctx->frame_history_next = (ctx->frame_history_next + 1) % FRAME_HISTORY_SIZE;
+    pthread_mutex_unlock(&ctx->frame_history_lock);
+}
+
+/* 按帧号查找 */
+static bool frame_history_find_id(gst_player_context_t* ctx, uint64_t frame_id, gst_player_frame_info_t* out)
+{
+    bool found = false;
+    
+    pthread_mutex_lock(&ctx->frame_history_lock);
+    for (int i = 0; i < FRAME_HISTORY_SIZE && !found; i++) {
+        const frame_history_entry_t* e = &ctx->frame_history[i];
+        if (e->valid && e->info.frame_id == frame_id) {
+            *out = e->info;
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&ctx->frame_history_lock);
+    return found;
+}
+
+/* 按 PTS 查找最接近的一帧（videorate 输出的 PTS 按输出帧率重排，不一定与源缓冲区完全相同）
+ * @param tolerance 允许的最大偏差 */
+static bool frame_history_find_pts(gst_player_context_t* ctx, GstClockTime pts, GstClockTime tolerance,
+                                   gst_player_frame_info_t* out)
+{
+    GstClockTime best = tolerance + 1;
+    
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) return false;
+    
+    pthread_mutex_lock(&ctx->frame_history_lock);
+    for (int i = 0; i < FRAME_HISTORY_SIZE; i++) {
+        const frame_history_entry_t* e = &ctx->frame_history[i];
+        if (!e->valid || !GST_CLOCK_TIME_IS_VALID(e->pts)) continue;
+        GstClockTime diff = e->pts > pts ? e->pts - pts : pts - e->pts;
+        if (diff < best) {
+            best = diff;
+            *out = e->info;
+        }
+    }
+    pthread_mutex_unlock(&ctx->frame_history_lock);
+    return best <= tolerance;
+}
+
+/* 记录 PTS 对应帧的解码完成时刻 */
+static void frame_history_set_decoded(gst_player_context_t* ctx, GstClockTime pts, int64_t decode_us)
+{
+    pthread_mutex_lock(&ctx->frame_history_lock);
+    for (int i = 0; i < FRAME_HISTORY_SIZE; i++) {
+        frame_history_entry_t* e = &ctx->frame_history[i];
+        if (e->valid && e->pts == pts) {
+            e->info.decode_us = decode_us;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ctx->frame_history_lock);
+}
+
+/* 相机帧信息转换为播放器帧信息（交付时刻在回调前填写） */
+static void frame_info_from_camera(gst_player_frame_info_t* out, const camera_frame_info_t* in)
+{
+    out->frame_id = in->frame_id;
+    out->capture_us = in->capture_us > 0 ? in->capture_us : in->dequeue_us;
+    out->decode_us = in->decode_us;
+    out->deliver_us = 0;
+}
+
+/* 显示帧的采集时刻：共享采集按 buffer offset（相机帧序号）查历史，
+ * 否则 base_time + PTS（直播源 PTS 为采集时刻的运行时间，管道时钟为单调系统时钟） */
+static int64_t frame_capture_us(gst_player_context_t* ctx, guint64 offset, GstClockTime pts)
+{
+    gst_player_frame_info_t info;
+    
+    if (ctx->shared_camera && offset != GST_BUFFER_OFFSET_NONE &&
+        frame_history_find_id(ctx, offset, &info) && info.capture_us > 0) {
+        return info.capture_us;
+    }
+    if (GST_CLOCK_TIME_IS_VALID(pts)) {
+        return (int64_t)GST_TIME_AS_USECONDS(gst_element_get_base_time(ctx->pipeline) + pts);
+    }
+    return get_time_us();
+}
+
+#ifdef FRAME_TRACE
+/* 追踪用：显示帧的帧号（共享采集为 buffer offset，否则按 PTS 查历史），找不到时为 FRAME_TRACE_NO_ID */
+static uint64_t trace_display_frame_id(gst_player_context_t* ctx, guint64 offset, GstClockTime pts)
+{
+    gst_player_frame_info_t info;
+    
+    if (ctx->shared_camera && offset != GST_BUFFER_OFFSET_NONE) return offset;
+    if (frame_history_find_pts(ctx, pts, GST_SECOND / (ctx->fps > 0 ? ctx->fps : 30), &info)) return info.frame_id;
+    return FRAME_TRACE_NO_ID;
+}
+#endif
+
 /* cairooverlay 绘制回调 */
 static void on_cairo_draw(GstElement* overlay, cairo_t* cr,
                           guint64 timestamp, guint64 duration,
@@ -91,46 +644,33 @@ static void on_cairo_draw(GstElement* overlay, cairo_t* cr,
 {
     gst_player_context_t* ctx = (gst_player_context_t*)user_data;
     if (!ctx) return;
+    FRAME_TRACE_BEGIN(trace_draw);
     
-    pthread_mutex_lock(&ctx->face_box_mutex);
-    
-    if (ctx->face_box_count <= 0 || ctx->video_width <= 0 || ctx->face_source_width <= 0) {
-        pthread_mutex_unlock(&ctx->face_box_mutex);
-        return;
-    }
-    
-    double scale_x = (double)ctx->video_width / ctx->face_source_width;
-    double scale_y = (double)ctx->video_height / ctx->face_source_height;
+    face_boxes_read(ctx, &ctx->face_view);
+    int n = face_boxes_layout(ctx, &ctx->face_view, frame_capture_us(ctx, GST_BUFFER_OFFSET_NONE, timestamp),
+                              ctx->face_rects);
     
     /* 绘制所有人脸框 */
-    for (int i = 0; i < ctx->face_box_count && i < MAX_FACE_BOXES; i++) {
-        gst_face_box_t* box = &ctx->face_boxes[i];
-        
-        double cx = box->center_x * scale_x;
-        double cy = box->center_y * scale_y;
-        double w = box->width * scale_x;
-        double h = box->height * scale_y;
-        
-        double x = cx - w / 2;
-        double y = cy - h / 2;
+    for (int i = 0; i < n; i++) {
+        const face_rect_t* r = &ctx->face_rects[i];
         
         /* 绿色框 */
         cairo_set_source_rgb(cr, 0.0, 1.0, 0.0);
         cairo_set_line_width(cr, 3.0);
-        cairo_rectangle(cr, x, y, w, h);
+        cairo_rectangle(cr, r->x, r->y, r->w, r->h);
         cairo_stroke(cr);
         
         /* 置信度文本 */
-        if (box->score > 0) {
+        if (r->score > 0) {
             char text[32];
-            snprintf(text, sizeof(text), "%.0f%%", box->score * 100);
+            snprintf(text, sizeof(text), "%d%%", r->score);
             cairo_set_font_size(cr, 16);
-            cairo_move_to(cr, x, y > 20 ? y - 5 : y + h + 15);
+            cairo_move_to(cr, r->x, r->y > 20 ? r->y - 5 : r->y + r->h + 15);
             cairo_show_text(cr, text);
         }
     }
-    
-    pthread_mutex_unlock(&ctx->face_box_mutex);
+    FRAME_TRACE_END(trace_draw, "cairo_draw", trace_display_frame_id(ctx, GST_BUFFER_OFFSET_NONE, timestamp),
+                    FRAME_TRACE_NO_ID);
 }
 
 /* caps 变化回调 */
@@ -147,160 +687,1541 @@ static void on_caps_changed(GstElement* overlay, GstCaps* caps, gpointer user_da
     }
 }
 
-/* appsink 回调 */
-static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data)
+/* 检查 GStreamer 元素是否可用 */
+static bool element_available(const char* name)
 {
-    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
-    if (!ctx || !ctx->running) return GST_FLOW_OK;
-    
-    GstSample* sample = gst_app_sink_pull_sample(sink);
-    if (!sample) return GST_FLOW_OK;
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) return false;
+    gst_object_unref(factory);
+    return true;
+}
+
+/* 创建带视频元数据的 BGRA 像素缓冲区（overlay 合成要求 GstVideoMeta） */
+static GstBuffer* overlay_pixels_new(int width, int height)
+{
+    GstBuffer* buffer = gst_buffer_new_allocate(NULL, (gsize)width * height * 4, NULL);
+    if (!buffer) return NULL;
+    gst_buffer_add_video_meta(buffer, GST_VIDEO_FRAME_FLAG_NONE,
+                              GST_VIDEO_OVERLAY_COMPOSITION_FORMAT_RGB, width, height);
+    return buffer;
+}
+
+/* 将矩形加入合成（首个矩形创建合成对象） */
+static void composition_add(GstVideoOverlayComposition** comp, GstBuffer* pixels,
+                            int x, int y, int w, int h, GstVideoOverlayFormatFlags flags)
+{
+    if (w <= 0 || h <= 0) return;
     
-    GstBuffer* buffer = gst_sample_get_buffer(sample);
-    if (!buffer) {
-        gst_sample_unref(sample);
-        return GST_FLOW_OK;
+    GstVideoOverlayRectangle* rect = gst_video_overlay_rectangle_new_raw(pixels, x, y, w, h, flags);
+    if (!*comp) {
+        *comp = gst_video_overlay_composition_new(rect);
+    } else {
+        gst_video_overlay_composition_add_rectangle(*comp, rect);
     }
+    gst_video_overlay_rectangle_unref(rect);
+}
+
+/* 用 Cairo 把置信度文本渲染成小图（人脸框变化时才调用，不是逐帧） */
+static GstBuffer* render_score_text(const char* text, int* out_w, int* out_h)
+{
+    const int w = 64, h = 20;
+    GstBuffer* buffer = overlay_pixels_new(w, h);
+    if (!buffer) return NULL;
     
     GstMapInfo map;
-    if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-        if (ctx->frame_callback) {
-            ctx->frame_callback(ctx->callback_user_data,
-                               map.data,
-                               ctx->face_detect_width,
-                               ctx->face_detect_height,
-                               ctx->face_detect_width * 4);
-        }
-        gst_buffer_unmap(buffer, &map);
+    if (!gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
+        gst_buffer_unref(buffer);
+        return NULL;
     }
+    memset(map.data, 0, map.size);
     
-    gst_sample_unref(sample);
-    return GST_FLOW_OK;
+    /* CAIRO_FORMAT_ARGB32 在小端上即预乘 BGRA */
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(map.data, CAIRO_FORMAT_ARGB32, w, h, w * 4);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_source_rgb(cr, 0.0, 1.0, 0.0);
+    cairo_set_font_size(cr, 16);
+    cairo_move_to(cr, 0, h - 4);
+    cairo_show_text(cr, text);
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    cairo_surface_destroy(surface);
+    
+    gst_buffer_unmap(buffer, &map);
+    *out_w = w;
+    *out_h = h;
+    return buffer;
 }
 
-static char* build_pipeline_string(const gst_player_config_t* config)
+/* 根据人脸框矩形重建合成对象（显示线程调用） */
+static void rebuild_composition(gst_player_context_t* ctx, const face_rect_t* rects, int count)
 {
-    char* pipeline = (char*)malloc(1024);
-    if (!pipeline) return NULL;
-    
-    char* p = pipeline;
-    int remaining = 1024;
-    int written;
+    if (ctx->composition) {
+        gst_video_overlay_composition_unref(ctx->composition);
+        ctx->composition = NULL;
+    }
     
-    written = snprintf(p, remaining, "v4l2src device=%s ! ", config->device);
-    p += written; remaining -= written;
+    if (count <= 0) return;
     
-    switch (config->format) {
-        case GST_PLAYER_FORMAT_MJPEG:
-            written = snprintf(p, remaining,
-                "image/jpeg,width=%d,height=%d,framerate=%d/1 ! ",
-                config->width, config->height, config->fps);
-            break;
-        case GST_PLAYER_FORMAT_YUY2:
-            written = snprintf(p, remaining,
-                "video/x-raw,format=YUY2,width=%d,height=%d,framerate=%d/1 ! ",
-                config->width, config->height, config->fps);
-            break;
-        default:
-            free(pipeline);
-            return NULL;
+    if (!ctx->box_pixel) {
+        ctx->box_pixel = overlay_pixels_new(1, 1);
+        if (!ctx->box_pixel) return;
+        static const guint8 green[4] = { 0x00, 0xff, 0x00, 0xff };  /* B G R A */
+        gst_buffer_fill(ctx->box_pixel, 0, green, sizeof(green));
     }
-    p += written; remaining -= written;
     
-    if (config->format == GST_PLAYER_FORMAT_MJPEG) {
-        /* 使用软件解码以兼容 cairooverlay */
-        written = snprintf(p, remaining, "jpegdec ! ");
-        p += written; remaining -= written;
+    const int lw = FACE_BOX_LINE_WIDTH;
+    
+    for (int i = 0; i < count; i++) {
+        int x = rects[i].x, y = rects[i].y, w = rects[i].w, h = rects[i].h;
+        
+        /* 裁到画面内，合成矩形不能越界 */
+        if (x < 0) { w += x; x = 0; }
+        if (y < 0) { h += y; y = 0; }
+        if (x + w > ctx->video_width) w = ctx->video_width - x;
+        if (y + h > ctx->video_height) h = ctx->video_height - y;
+        if (w <= 2 * lw || h <= 2 * lw) continue;
+        
+        /* 四条边各是一个被缩放的单像素矩形 */
+        composition_add(&ctx->composition, ctx->box_pixel, x, y, w, lw, GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+        composition_add(&ctx->composition, ctx->box_pixel, x, y + h - lw, w, lw, GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+        composition_add(&ctx->composition, ctx->box_pixel, x, y + lw, lw, h - 2 * lw, GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+        composition_add(&ctx->composition, ctx->box_pixel, x + w - lw, y + lw, lw, h - 2 * lw, GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+        
+        /* 置信度文本：按框缓存，置信度不变时框移动也不重新渲染 */
+        face_text_t* text = &ctx->score_texts[i];
+        if (rects[i].score > 0 && (!text->pixels || text->score != rects[i].score)) {
+            char str[32];
+            snprintf(str, sizeof(str), "%d%%", rects[i].score);
+            if (text->pixels) gst_buffer_unref(text->pixels);
+            text->pixels = render_score_text(str, &text->width, &text->height);
+            text->score = rects[i].score;
+        }
+        if (rects[i].score > 0 && text->pixels) {
+            int tw = text->width, th = text->height;
+            int ty = y > th + 5 ? y - th - 5 : y + h + 5;
+            if (x + tw > ctx->video_width) tw = ctx->video_width - x;
+            if (ty + th <= ctx->video_height) {
+                composition_add(&ctx->composition, text->pixels, x, ty, tw, th,
+                                GST_VIDEO_OVERLAY_FORMAT_FLAG_PREMULTIPLIED_ALPHA);
+            }
+        }
     }
+}
+
+/* GL 显示分支 sink pad 探针：给每帧附加人脸框合成元数据，由 glimagesink 在 GPU 上绘制
+ * 人脸框位置（含外推）不变时复用上一次的合成对象 */
+static GstPadProbeReturn on_display_buffer(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
     
-    written = snprintf(p, remaining, "tee name=t ! ");
-    p += written; remaining -= written;
+    if (ctx->video_width <= 0) {
+        GstCaps* caps = gst_pad_get_current_caps(pad);
+        if (caps) {
+            on_caps_changed(NULL, caps, ctx);
+            gst_caps_unref(caps);
+        }
+    }
     
-    /* 显示分支 - 使用 cairooverlay 绘制人脸框 */
-    written = snprintf(p, remaining,
-        "queue max-size-buffers=2 leaky=downstream ! "
-        "videoconvert ! "
-        "cairooverlay name=overlay ! "
-        "videoconvert ! "
-        "xvimagesink name=videosink sync=false force-aspect-ratio=false ");
-    p += written; remaining -= written;
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    FRAME_TRACE_BEGIN(trace_compose);
+    face_boxes_read(ctx, &ctx->face_view);
+    int n = face_boxes_layout(ctx, &ctx->face_view,
+                              frame_capture_us(ctx, GST_BUFFER_OFFSET(buffer), GST_BUFFER_PTS(buffer)),
+                              ctx->face_rects);
+    bool dirty = atomic_exchange(&ctx->composition_dirty, false);
+    if (dirty || n != ctx->composed_count || memcmp(ctx->face_rects, ctx->composed_rects, n * sizeof(face_rect_t))) {
+        rebuild_composition(ctx, ctx->face_rects, n);
+        face_rect_t* tmp = ctx->composed_rects;
+        ctx->composed_rects = ctx->face_rects;
+        ctx->face_rects = tmp;
+        ctx->composed_count = n;
+    }
     
-    /* 检测分支 */
-    int face_w = config->face_detect_width > 0 ? config->face_detect_width : config->width;
-    int face_h = config->face_detect_height > 0 ? config->face_detect_height : config->height;
-    int face_fps = config->face_detect_fps > 0 ? config->face_detect_fps : 10;
+    /* tee 之后缓冲区是共享的，make_writable 只复制 GstBuffer 结构，不复制像素数据 */
+    if (ctx->composition) {
+        buffer = gst_buffer_make_writable(buffer);
+        gst_buffer_add_video_overlay_composition_meta(buffer, ctx->composition);
+        GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    }
+    FRAME_TRACE_END(trace_compose, "overlay_compose",
+                    trace_display_frame_id(ctx, GST_BUFFER_OFFSET(buffer), GST_BUFFER_PTS(buffer)), FRAME_TRACE_NO_ID);
     
-    written = snprintf(p, remaining,
-        "t. ! queue max-size-buffers=1 leaky=downstream ! "
-        "videorate ! video/x-raw,framerate=%d/1 ! "
-        "videoscale ! video/x-raw,width=%d,height=%d ! "
-        "videoconvert ! video/x-raw,format=BGRA ! "
-        "appsink name=facesink emit-signals=true max-buffers=1 drop=true sync=false",
-        face_fps, face_w, face_h);
+    return GST_PAD_PROBE_OK;
+}
+
+/* 零拷贝帧的来源 */
+typedef enum {
+    HELD_FRAME_SAMPLE = 0,      /* appsink 样本 */
+    HELD_FRAME_DECODED = 1,     /* 共享采集的 MPP 解码帧 */
+    HELD_FRAME_CAMERA = 2,      /* 共享采集的相机检测流帧 */
+} held_frame_kind_t;
+
+/* 交付给消费者的零拷贝帧及其持有的资源 */
+typedef struct held_frame {
+    gst_player_frame_t frame;
+    gst_player_context_t* ctx;
+    held_frame_kind_t kind;
+    GstSample* sample;
+    GstMapInfo map;
+    camera_decoded_frame_t decoded;
+    camera_frame_t camera_frame;
+} held_frame_t;
+
+/* 检测帧限速（共享采集下相机按采集帧率输出） */
+static bool detect_rate_ok(gst_player_context_t* ctx)
+{
+    int64_t now = get_time_us();
+    if (ctx->face_detect_fps > 0 && now - ctx->last_detect_us < 1000000 / ctx->face_detect_fps) return false;
+    ctx->last_detect_us = now;
+    return true;
+}
+
+/* 运动门控：画面静止（且不在保持期或心跳时刻）时返回 false，本帧不交付检测 */
+static bool detect_motion_ok(gst_player_context_t* ctx, const uint8_t* luma, int width, int height,
+                             int stride, int pixel_step)
+{
+    if (!ctx->motion_gate) return true;
+    if (motion_gate_check(ctx->motion_gate, luma, width, height, stride, pixel_step, get_time_us())) return true;
+    atomic_fetch_add(&ctx->frames_gated, 1);
+    return false;
+}
+
+/* 检测分支：档位帧率低于 videorate 输出帧率时按 PTS 间隔丢帧（容差半个 videorate 帧间隔） */
+static bool detect_pts_rate_ok(gst_player_context_t* ctx, GstClockTime pts)
+{
+    int fps = ctx->face_detect_fps;
+    if (fps >= ctx->face_detect_max_fps || !GST_CLOCK_TIME_IS_VALID(pts)) return true;
     
-    return pipeline;
+    GstClockTime interval = GST_SECOND / fps - GST_SECOND / ctx->face_detect_max_fps / 2;
+    if (GST_CLOCK_TIME_IS_VALID(ctx->last_detect_pts) && pts >= ctx->last_detect_pts &&
+        pts - ctx->last_detect_pts < interval) return false;
+    ctx->last_detect_pts = pts;
+    return true;
 }
 
-gst_player_handle_t gst_player_create(const gst_player_config_t* config)
+/* 检测自适应：修改缩放 capsfilter 的尺寸，下游（RGA/videoscale、appsink）随之重新协商 */
+static void detect_scale_apply(gst_player_context_t* ctx, int width, int height)
 {
-    if (!config || !config->device) return NULL;
-    if (gst_player_global_init() != GST_PLAYER_OK) return NULL;
+    GstCaps* caps = NULL;
     
-    gst_player_context_t* ctx = (gst_player_context_t*)calloc(1, sizeof(gst_player_context_t));
-    if (!ctx) return NULL;
+    g_object_get(ctx->detect_scale, "caps", &caps, NULL);
+    if (!caps) return;
+    caps = gst_caps_make_writable(caps);
+    gst_caps_set_simple(caps, "width", G_TYPE_INT, width, "height", G_TYPE_INT, height, NULL);
+    g_object_set(ctx->detect_scale, "caps", caps, NULL);
+    gst_caps_unref(caps);
+}
+
+/* 检测自适应：到评估时刻时汇总丢帧并评估，档位变化后更新限速帧率和缩放尺寸（检测路径的流线程调用） */
+static void detect_qos_tick(gst_player_context_t* ctx)
+{
+    int64_t now = get_time_us();
+    detect_qos_state_t state;
     
-    strncpy(ctx->device, config->device, sizeof(ctx->device) - 1);
-    ctx->width = config->width;
-    ctx->height = config->height;
-    ctx->fps = config->fps;
-    ctx->format = config->format;
-    ctx->use_hardware_decode = config->use_hardware_decode;
-    ctx->face_detect_width = config->face_detect_width > 0 ? config->face_detect_width : config->width;
-    ctx->face_detect_height = config->face_detect_height > 0 ? config->face_detect_height : config->height;
-    ctx->face_source_width = ctx->face_detect_width;
-    ctx->face_source_height = ctx->face_detect_height;
+    if (!detect_qos_due(ctx->detect_qos, now)) return;
     
-    pthread_mutex_init(&ctx->face_box_mutex, NULL);
+    uint64_t drops = atomic_load(&ctx->detect_queue_drops) + atomic_load(&ctx->detect_overruns);
+    dispatcher_stats_t dstats;
+    if (ctx->detect_dispatcher && dispatcher_get_stats(ctx->detect_dispatcher, &dstats) == 0) {
+        drops += dstats.frames_dropped;
+    }
+    if (!detect_qos_update(ctx->detect_qos, drops, now, &state)) return;
     
-    char* pipeline_str = build_pipeline_string(config);
-    if (!pipeline_str) {
-        free(ctx);
+    ctx->face_detect_fps = state.fps;
+    if (ctx->detect_scale) detect_scale_apply(ctx, state.width, state.height);
+    printf("[%s] 检测自适应: 档位 %d/%d → %d fps %dx%d（回调 %d us，CPU %d%%）\n", MODULE_TAG,
+           state.level, state.level_count - 1, state.fps, state.width, state.height, state.callback_us,
+           state.cpu_percent);
+}
+
+/* 分配零拷贝帧（不计入 held_frames） */
+static held_frame_t* held_frame_alloc(gst_player_context_t* ctx, held_frame_kind_t kind)
+{
+    held_frame_t* held = (held_frame_t*)calloc(1, sizeof(held_frame_t));
+    if (!held) return NULL;
+    held->ctx = ctx;
+    held->kind = kind;
+    held->frame.dmabuf_fd = -1;
+    held->frame.priv = held;
+    return held;
+}
+
+/* 分配交付给消费者的零拷贝帧，消费者持有过多时返回 NULL（丢弃本帧） */
+static held_frame_t* held_frame_new(gst_player_context_t* ctx, held_frame_kind_t kind)
+{
+    if (atomic_load(&ctx->held_frames) >= GST_PLAYER_MAX_HELD_FRAMES) {
+        atomic_fetch_add(&ctx->detect_overruns, 1);
         return NULL;
     }
     
-    printf("[%s] 管道: %s\n", MODULE_TAG, pipeline_str);
-    
-    GError* error = NULL;
-    ctx->pipeline = gst_parse_launch(pipeline_str, &error);
-    free(pipeline_str);
+    held_frame_t* held = held_frame_alloc(ctx, kind);
+    if (!held) return NULL;
+    atomic_fetch_add(&ctx->held_frames, 1);
+    return held;
+}
+
+/* 归还帧持有的样本/解码缓冲区/检测流槽位并释放 */
+static void held_frame_free(held_frame_t* held)
+{
+    gst_player_context_t* ctx = held->ctx;
     
-    if (!ctx->pipeline || error) {
-        printf("[%s] 创建管道失败: %s\n", MODULE_TAG, error ? error->message : "");
-        if (error) g_error_free(error);
-        free(ctx);
-        return NULL;
+    switch (held->kind) {
+        case HELD_FRAME_SAMPLE:
+            gst_buffer_unmap(gst_sample_get_buffer(held->sample), &held->map);
+            gst_sample_unref(held->sample);
+            break;
+        case HELD_FRAME_DECODED:
+            camera_release_decoded_frame(ctx->shared_camera, &held->decoded);
+            break;
+        case HELD_FRAME_CAMERA:
+            camera_release_frame(ctx->shared_camera, &held->camera_frame);
+            break;
     }
+    free(held);
+}
+
+void gst_player_release_frame(gst_player_frame_t* frame)
+{
+    if (!frame || !frame->priv) return;
     
-    ctx->video_sink = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "videosink");
-    ctx->app_sink = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "facesink");
-    ctx->overlay = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "overlay");
+    held_frame_t* held = (held_frame_t*)frame->priv;
+    gst_player_context_t* ctx = held->ctx;
     
-    if (ctx->overlay) {
-        g_signal_connect(ctx->overlay, "draw", G_CALLBACK(on_cairo_draw), ctx);
-        g_signal_connect(ctx->overlay, "caps-changed", G_CALLBACK(on_caps_changed), ctx);
-        printf("[%s] cairooverlay 已连接\n", MODULE_TAG);
-    } else {
-        printf("[%s] 警告: 未找到 cairooverlay\n", MODULE_TAG);
+    /* 消费者持有检测帧的时间即其处理时间 */
+    detect_qos_record(ctx->detect_qos, get_time_us() - held->frame.info.deliver_us);
+    held_frame_free(held);
+    atomic_fetch_sub(&ctx->held_frames, 1);
+}
+
+/* 映射 appsink 样本并填写帧描述（保留样本引用），失败时不持有任何资源 */
+static bool held_frame_fill_sample(held_frame_t* held, GstSample* sample, const gst_player_frame_info_t* frame_info)
+{
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstVideoInfo info;
+    
+    if (!buffer || !gst_video_info_from_caps(&info, gst_sample_get_caps(sample))) return false;
+    if (!gst_buffer_map(buffer, &held->map, GST_MAP_READ)) return false;
+    held->sample = gst_sample_ref(sample);
+    
+    gst_player_frame_t* frame = &held->frame;
+    frame->data = held->map.data;
+    frame->size = held->map.size;
+    frame->width = GST_VIDEO_INFO_WIDTH(&info);
+    frame->height = GST_VIDEO_INFO_HEIGHT(&info);
+    frame->format = GST_VIDEO_INFO_FORMAT(&info) == GST_VIDEO_FORMAT_NV12 ? GST_PLAYER_PIXEL_NV12 : GST_PLAYER_PIXEL_BGRA;
+    frame->n_planes = GST_VIDEO_INFO_N_PLANES(&info) > 2 ? 2 : GST_VIDEO_INFO_N_PLANES(&info);
+    
+    /* 上游带 GstVideoMeta 时以其平面布局为准（硬件缓冲区常有行对齐） */
+    GstVideoMeta* meta = gst_buffer_get_video_meta(buffer);
+    for (int i = 0; i < frame->n_planes; i++) {
+        frame->offset[i] = meta ? meta->offset[i] : GST_VIDEO_INFO_PLANE_OFFSET(&info, i);
+        frame->stride[i] = meta ? meta->stride[i] : GST_VIDEO_INFO_PLANE_STRIDE(&info, i);
     }
     
-    if (ctx->app_sink) {
-        GstAppSinkCallbacks callbacks = { NULL, NULL, on_new_sample };
-        gst_app_sink_set_callbacks(GST_APP_SINK(ctx->app_sink), &callbacks, ctx, NULL);
+    if (gst_buffer_n_memory(buffer) == 1) {
+        GstMemory* mem = gst_buffer_peek_memory(buffer, 0);
+        if (gst_is_dmabuf_memory(mem)) {
+            frame->dmabuf_fd = gst_dmabuf_memory_get_fd(mem);
+        }
     }
+    frame->info = *frame_info;
+    frame->info.deliver_us = get_time_us();
+    return true;
+}
+
+/* 引用相机检测流的最新帧并填写帧描述，失败或不是 BGRA/NV12 检测流时不持有任何资源 */
+static bool held_frame_fill_camera(held_frame_t* held)
+{
+    gst_player_context_t* ctx = held->ctx;
+    camera_frame_t* cf = &held->camera_frame;
+    
+    if (camera_acquire_stream_frame(ctx->shared_camera, CAMERA_STREAM_DETECT, cf, 0, 0) != CAMERA_OK) return false;
+    if (cf->format != CAMERA_PIXEL_FORMAT_BGRA8888 && cf->format != CAMERA_PIXEL_FORMAT_NV12) {
+        camera_release_frame(ctx->shared_camera, cf);
+        return false;
+    }
+    
+    gst_player_frame_t* frame = &held->frame;
+    frame->data = cf->data;
+    frame->width = cf->width;
+    frame->height = cf->height;
+    frame->stride[0] = cf->stride;
+    if (cf->format == CAMERA_PIXEL_FORMAT_NV12) {
+        frame->format = GST_PLAYER_PIXEL_NV12;
+        frame->n_planes = 2;
+        frame->offset[1] = (size_t)cf->stride * cf->height;
+        frame->stride[1] = cf->stride;
+        frame->size = (size_t)cf->stride * cf->height * 3 / 2;
+    } else {
+        frame->format = GST_PLAYER_PIXEL_BGRA;
+        frame->n_planes = 1;
+        frame->size = (size_t)cf->stride * cf->height;
+    }
+    frame_info_from_camera(&frame->info, &cf->info);
+    frame->info.deliver_us = get_time_us();
+    return true;
+}
+
+/* 把 appsink 样本作为零拷贝帧交付（样本引用一直保留到消费者归还） */
+static void deliver_sample_frame(gst_player_context_t* ctx, GstSample* sample, const gst_player_frame_info_t* frame_info)
+{
+    held_frame_t* held = held_frame_new(ctx, HELD_FRAME_SAMPLE);
+    if (!held) return;
+    
+    if (!held_frame_fill_sample(held, sample, frame_info)) {
+        atomic_fetch_sub(&ctx->held_frames, 1);
+        free(held);
+        return;
+    }
+    ctx->frame_callback_ex(ctx->callback_ex_user_data, &held->frame);
+}
+
+/* 共享模式：把解码帧（全分辨率 NV12 dmabuf）作为零拷贝帧交付 */
+static void deliver_decoded_frame(gst_player_context_t* ctx, const camera_decoded_frame_t* decoded)
+{
+    if (decoded->format != CAMERA_PIXEL_FORMAT_NV12) return;
+    if (ctx->detect_qos) detect_qos_tick(ctx);
+    if (!detect_rate_ok(ctx)) return;
+    if (!detect_motion_ok(ctx, decoded->data, decoded->width, decoded->height, decoded->hor_stride, 1)) return;
+    
+    held_frame_t* held = held_frame_new(ctx, HELD_FRAME_DECODED);
+    if (!held) return;
+    
+    held->decoded = *decoded;
+    camera_hold_decoded_frame(ctx->shared_camera, decoded);
+    
+    gst_player_frame_t* frame = &held->frame;
+    frame->data = decoded->data;
+    frame->dmabuf_fd = decoded->dmabuf_fd;
+    frame->size = decoded->size;
+    frame->width = decoded->width;
+    frame->height = decoded->height;
+    frame->format = GST_PLAYER_PIXEL_NV12;
+    frame->n_planes = 2;
+    frame->offset[0] = 0;
+    frame->offset[1] = (size_t)decoded->hor_stride * decoded->ver_stride;
+    frame->stride[0] = decoded->hor_stride;
+    frame->stride[1] = decoded->hor_stride;
+    frame_info_from_camera(&frame->info, &decoded->info);
+    frame->info.deliver_us = get_time_us();
+    
+    ctx->frame_callback_ex(ctx->callback_ex_user_data, frame);
+}
+
+/* 共享模式：引用相机检测流的最新帧作为零拷贝帧交付 */
+static void deliver_camera_frame(gst_player_context_t* ctx)
+{
+    held_frame_t* held = held_frame_new(ctx, HELD_FRAME_CAMERA);
+    if (!held) return;
+    
+    if (!held_frame_fill_camera(held)) {
+        atomic_fetch_sub(&ctx->held_frames, 1);
+        free(held);
+        return;
+    }
+    ctx->frame_callback_ex(ctx->callback_ex_user_data, &held->frame);
+}
+
+/* 拉取模式：替换保留的最新检测帧（未被拉取的旧帧直接释放）并置位 pull_fd */
+static void pull_store(gst_player_context_t* ctx, held_frame_t* held)
+{
+    uint64_t one = 1;
+    
+    pthread_mutex_lock(&ctx->pull_lock);
+    held_frame_t* old = ctx->pull_latest;
+    ctx->pull_latest = held;
+    pthread_mutex_unlock(&ctx->pull_lock);
+    
+    if (old) {
+        held_frame_free(old);
+        atomic_fetch_add(&ctx->pull_skipped, 1);
+        atomic_fetch_add(&ctx->detect_overruns, 1);
+    }
+    if (write(ctx->pull_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[%s] 拉取通知写入失败: %s\n", MODULE_TAG, strerror(errno));
+    }
+}
+
+/* 拉取模式：保留 appsink 样本 */
+static void pull_store_sample(gst_player_context_t* ctx, GstSample* sample, const gst_player_frame_info_t* info)
+{
+    held_frame_t* held = held_frame_alloc(ctx, HELD_FRAME_SAMPLE);
+    if (!held) return;
+    
+    if (!held_frame_fill_sample(held, sample, info)) {
+        free(held);
+        return;
+    }
+    pull_store(ctx, held);
+}
+
+/* 拉取模式（共享采集）：保留相机检测流的最新帧 */
+static void pull_store_camera(gst_player_context_t* ctx)
+{
+    held_frame_t* held = held_frame_alloc(ctx, HELD_FRAME_CAMERA);
+    if (!held) return;
+    
+    if (!held_frame_fill_camera(held)) {
+        free(held);
+        return;
+    }
+    pull_store(ctx, held);
+}
+
+/* 拉取模式：丢弃保留的帧（停止、注销缓冲区和销毁时，之后不再引用相机槽位和样本） */
+static void pull_drop(gst_player_context_t* ctx)
+{
+    pthread_mutex_lock(&ctx->pull_lock);
+    held_frame_t* held = ctx->pull_latest;
+    ctx->pull_latest = NULL;
+    pthread_mutex_unlock(&ctx->pull_lock);
+    
+    if (held) held_frame_free(held);
+}
+
+/* 拉取模式：消费者回来等待或拉取下一帧时，从上次拉取返回起的时间（扣除等待）即上一帧的处理时间，
+ * 与帧回调的执行时间一样计入回调统计和检测自适应 */
+static void pull_account_consumer(gst_player_context_t* ctx)
+{
+    int64_t last = atomic_exchange(&ctx->pull_return_us, 0);
+    if (last <= 0) return;
+    
+    int64_t duration = get_time_us() - last;
+    latency_stats_record(&ctx->lat_callback, (long)duration);
+    detect_qos_record(ctx->detect_qos, duration);
+}
+
+/* 逐行复制一个平面（行字节数一致时整块复制） */
+static void copy_plane(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int row_bytes, int rows)
+{
+    if (rows <= 0) return;
+    if (src_stride == dst_stride) {
+        memcpy(dst, src, (size_t)dst_stride * (rows - 1) + row_bytes);
+        return;
+    }
+    for (int y = 0; y < rows; y++) {
+        memcpy(dst + (size_t)y * dst_stride, src + (size_t)y * src_stride, row_bytes);
+    }
+}
+
+/* 共享模式：显示分支释放 GstBuffer 时归还解码缓冲区 */
+typedef struct {
+    gst_player_context_t* ctx;
+    camera_decoded_frame_t frame;
+} shared_frame_t;
+
+static void on_shared_buffer_freed(gpointer user_data, GstMiniObject* obj)
+{
+    shared_frame_t* held = (shared_frame_t*)user_data;
+    (void)obj;
+    
+    camera_release_decoded_frame(held->ctx->shared_camera, &held->frame);
+    atomic_fetch_sub(&held->ctx->shared_in_flight, 1);
+    free(held);
+}
+
+/* 共享模式：相机输出线程中把解码帧包装成 dmabuf GstBuffer 推入 appsrc（不拷贝像素） */
+static void on_camera_decoded(void* user_data, const camera_decoded_frame_t* frame)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    if (!ctx || !ctx->running) return;
+    
+    /* 显示帧和 gst_player_set_face_boxes_ex 按帧号（buffer offset）找回采集时刻 */
+    gst_player_frame_info_t info;
+    frame_info_from_camera(&info, &frame->info);
+    frame_history_add(ctx, GST_CLOCK_TIME_NONE, &info);
+    
+    /* NV12 检测帧直接使用全分辨率解码结果，不做任何缩放和转换 */
+    if (ctx->frame_callback_ex && ctx->face_detect_format == GST_PLAYER_PIXEL_NV12 && !ctx->shared_detect &&
+        !ctx->detect_paused && !ctx->detect_disabled) {
+        deliver_decoded_frame(ctx, frame);
+    }
+    
+    if (!ctx->app_src) return;
+    
+    /* 显示跟不上时丢帧，保证解码器始终有空闲缓冲区 */
+    if (atomic_load(&ctx->shared_in_flight) >= SHARED_MAX_IN_FLIGHT) {
+        atomic_fetch_add(&ctx->display_queue_drops, 1);
+        return;
+    }
+    
+    GstVideoFormat format = frame->format == CAMERA_PIXEL_FORMAT_NV16 ? GST_VIDEO_FORMAT_NV16 : GST_VIDEO_FORMAT_NV12;
+    if (ctx->shared_format != frame->format || ctx->shared_width != frame->width ||
+        ctx->shared_height != frame->height) {
+        GstCaps* caps = gst_caps_new_simple("video/x-raw",
+            "format", G_TYPE_STRING, gst_video_format_to_string(format),
+            "width", G_TYPE_INT, frame->width,
+            "height", G_TYPE_INT, frame->height,
+            "framerate", GST_TYPE_FRACTION, ctx->fps, 1,
+            NULL);
+        gst_app_src_set_caps(GST_APP_SRC(ctx->app_src), caps);
+        gst_caps_unref(caps);
+        ctx->shared_format = frame->format;
+        ctx->shared_width = frame->width;
+        ctx->shared_height = frame->height;
+        printf("[%s] 共享采集: %s %dx%d (stride %d)\n", MODULE_TAG,
+               gst_video_format_to_string(format), frame->width, frame->height, frame->hor_stride);
+    }
+    
+    shared_frame_t* held = (shared_frame_t*)malloc(sizeof(shared_frame_t));
+    if (!held) return;
+    held->ctx = ctx;
+    held->frame = *frame;
+    
+    GstMemory* mem = gst_dmabuf_allocator_alloc_with_flags(ctx->dmabuf_allocator, frame->dmabuf_fd,
+                                                           frame->size, GST_FD_MEMORY_FLAG_DONT_CLOSE);
+    if (!mem) {
+        free(held);
+        return;
+    }
+    camera_hold_decoded_frame(ctx->shared_camera, frame);
+    atomic_fetch_add(&ctx->shared_in_flight, 1);
+    
+    GstBuffer* buffer = gst_buffer_new();
+    gst_buffer_append_memory(buffer, mem);
+    
+    gsize offset[2] = { 0, (gsize)frame->hor_stride * frame->ver_stride };
+    gint stride[2] = { frame->hor_stride, frame->hor_stride };
+    gst_buffer_add_video_meta_full(buffer, GST_VIDEO_FRAME_FLAG_NONE, format,
+                                   frame->width, frame->height, 2, offset, stride);
+    GST_BUFFER_OFFSET(buffer) = frame->sequence;
+    
+    /* GstBuffer 最终释放时才归还解码缓冲区 */
+    gst_mini_object_weak_ref(GST_MINI_OBJECT(buffer), on_shared_buffer_freed, held);
+    
+    gst_app_src_push_buffer(GST_APP_SRC(ctx->app_src), buffer);
+}
+
+/* 共享模式：断开与相机的回调并释放 dmabuf 分配器 */
+static void shared_camera_detach(gst_player_context_t* ctx)
+{
+    if (!ctx->shared_camera) return;
+    
+    camera_set_decoded_callback(ctx->shared_camera, NULL, NULL);
+    if (ctx->shared_detect) camera_set_frame_info_callback(ctx->shared_camera, CAMERA_STREAM_DETECT, NULL, NULL);
+    if (ctx->dmabuf_allocator) {
+        gst_object_unref(ctx->dmabuf_allocator);
+        ctx->dmabuf_allocator = NULL;
+    }
+}
+
+/* 设置了 BGRA 帧回调（普通或带时间信息） */
+static bool has_frame_callback(gst_player_context_t* ctx)
+{
+    return ctx->frame_callback || ctx->frame_info_callback;
+}
+
+/* 调用帧回调并记录执行时间，设置了带时间信息的回调时优先使用 */
+static void invoke_frame_callback(gst_player_context_t* ctx, uint8_t* data, int width, int height, int stride,
+                                  const gst_player_frame_info_t* info)
+{
+    gst_frame_info_callback_t info_callback = ctx->frame_info_callback;
+    gst_frame_callback_t callback = ctx->frame_callback;
+    int64_t start = get_time_us();
+    
+    if (info_callback) {
+        gst_player_frame_info_t delivered = *info;
+        delivered.deliver_us = start;
+        info_callback(ctx->callback_info_user_data, data, width, height, stride, &delivered);
+    } else if (callback) {
+        callback(ctx->callback_user_data, data, width, height, stride);
+    } else {
+        return;
+    }
+    int64_t duration = get_time_us() - start;
+    FRAME_TRACE_SPAN("detect_callback", start, start + duration, info->frame_id, FRAME_TRACE_NO_ID);
+    latency_stats_record(&ctx->lat_callback, (long)duration);
+    detect_qos_record(ctx->detect_qos, duration);
+    atomic_fetch_add(&ctx->frames_detected, 1);
+}
+
+/* 工作线程中的一帧检测任务：持有 appsink 样本或相机检测流帧的引用 */
+typedef struct {
+    gst_player_context_t* ctx;
+    GstSample* sample;
+    int width;                          /* 样本的尺寸（检测自适应可能改变缩放尺寸） */
+    int height;
+    camera_frame_t camera_frame;
+    gst_player_frame_info_t info;
+} detect_job_t;
+
+static void detect_job_run(void* user_data, void* item)
+{
+    detect_job_t* job = (detect_job_t*)item;
+    gst_player_context_t* ctx = job->ctx;
+    (void)user_data;
+    
+    if (!has_frame_callback(ctx) || !ctx->running) return;
+    
+    if (job->sample) {
+        GstMapInfo map;
+        GstBuffer* buffer = gst_sample_get_buffer(job->sample);
+        if (buffer && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+            invoke_frame_callback(ctx, map.data, job->width, job->height, job->width * 4, &job->info);
+            gst_buffer_unmap(buffer, &map);
+        }
+    } else {
+        invoke_frame_callback(ctx, job->camera_frame.data, job->camera_frame.width, job->camera_frame.height,
+                              job->camera_frame.stride, &job->info);
+    }
+}
+
+static void detect_job_release(void* user_data, void* item)
+{
+    detect_job_t* job = (detect_job_t*)item;
+    (void)user_data;
+    
+    if (job->sample) {
+        gst_sample_unref(job->sample);
+    } else {
+        camera_release_frame(job->ctx->shared_camera, &job->camera_frame);
+    }
+    free(job);
+}
+
+/* 共享模式：引用相机检测流最新帧投递给工作线程 */
+static void post_camera_detect_job(gst_player_context_t* ctx)
+{
+    detect_job_t* job = (detect_job_t*)calloc(1, sizeof(detect_job_t));
+    if (!job) return;
+    
+    job->ctx = ctx;
+    if (camera_acquire_stream_frame(ctx->shared_camera, CAMERA_STREAM_DETECT, &job->camera_frame, 0, 0) != CAMERA_OK) {
+        free(job);
+        return;
+    }
+    frame_info_from_camera(&job->info, &job->camera_frame.info);
+    dispatcher_post(ctx->detect_dispatcher, job);
+}
+
+/* 共享模式：相机检测流回调，按 face_detect_fps 限速后转发给人脸识别 */
+static void on_camera_detect(void* user_data, uint8_t* data, int width, int height, int stride,
+                             const camera_frame_info_t* camera_info)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    if (!ctx || !ctx->running || ctx->detect_paused || ctx->detect_disabled ||
+        (!has_frame_callback(ctx) && !ctx->frame_callback_ex && !atomic_load(&ctx->pull_enabled))) return;
+    if (ctx->detect_qos) detect_qos_tick(ctx);
+    if (!detect_rate_ok(ctx)) return;
+    
+    /* 检测流行无对齐，按行字节数区分 BGRA/BGR（取 G 通道）和 NV12（取 Y 平面） */
+    int pixel_step = stride >= width * 4 ? 4 : (stride >= width * 3 ? 3 : 1);
+    if (!detect_motion_ok(ctx, pixel_step > 1 ? data + 1 : data, width, height, stride, pixel_step)) return;
+    
+    if (has_frame_callback(ctx) && ctx->detect_dispatcher) {
+        post_camera_detect_job(ctx);
+    } else if (has_frame_callback(ctx)) {
+        gst_player_frame_info_t info;
+        frame_info_from_camera(&info, camera_info);
+        invoke_frame_callback(ctx, data, width, height, stride, &info);
+    }
+    if (ctx->frame_callback_ex) {
+        deliver_camera_frame(ctx);
+    }
+    if (atomic_load(&ctx->pull_enabled)) {
+        pull_store_camera(ctx);
+    }
+}
+
+/* appsink 回调 */
+static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    if (!ctx || !ctx->running) return GST_FLOW_OK;
+    FRAME_TRACE_BEGIN(trace_sample);
+    
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (sample && (ctx->detect_paused || ctx->detect_disabled)) {
+        gst_sample_unref(sample);   /* 切换到空闲模式前已在 valve 之后排队的帧 */
+        return GST_FLOW_OK;
+    }
+    if (!sample) return GST_FLOW_OK;
+    
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    if (!buffer) {
+        gst_sample_unref(sample);
+        return GST_FLOW_OK;
+    }
+    
+    /* 按 PTS 找回源帧的帧号和时间，偏差不超过一个源帧间隔 */
+    gst_player_frame_info_t info = { 0 };
+    frame_history_find_pts(ctx, GST_BUFFER_PTS(buffer), GST_SECOND / (ctx->fps > 0 ? ctx->fps : 30), &info);
+    
+    if (ctx->frame_callback_ex) {
+        deliver_sample_frame(ctx, sample, &info);
+    }
+    if (atomic_load(&ctx->pull_enabled)) {
+        pull_store_sample(ctx, sample, &info);
+    }
+    
+    /* 尺寸以样本 caps 为准（检测自适应运行中修改缩放尺寸） */
+    GstVideoInfo vinfo;
+    int detect_width = ctx->face_detect_width;
+    int detect_height = ctx->face_detect_height;
+    if (gst_video_info_from_caps(&vinfo, gst_sample_get_caps(sample))) {
+        detect_width = GST_VIDEO_INFO_WIDTH(&vinfo);
+        detect_height = GST_VIDEO_INFO_HEIGHT(&vinfo);
+    }
+    
+    GstMapInfo map;
+    if (has_frame_callback(ctx) && ctx->face_detect_format == GST_PLAYER_PIXEL_BGRA && ctx->detect_dispatcher) {
+        /* 样本引用随任务交给工作线程，流线程立即返回 */
+        detect_job_t* job = (detect_job_t*)calloc(1, sizeof(detect_job_t));
+        if (job) {
+            job->ctx = ctx;
+            job->sample = gst_sample_ref(sample);
+            job->width = detect_width;
+            job->height = detect_height;
+            job->info = info;
+            dispatcher_post(ctx->detect_dispatcher, job);
+        }
+    } else if (has_frame_callback(ctx) && ctx->face_detect_format == GST_PLAYER_PIXEL_BGRA &&
+        gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        invoke_frame_callback(ctx, map.data, detect_width, detect_height, detect_width * 4, &info);
+        gst_buffer_unmap(buffer, &map);
+    }
+    
+    gst_sample_unref(sample);
+    FRAME_TRACE_END(trace_sample, "appsink_sample", info.frame_id, FRAME_TRACE_NO_ID);
+    return GST_FLOW_OK;
+}
+
+/* 录像分支 appsink 回调：编码包加入预录缓冲 */
+static GstFlowReturn on_record_sample(GstAppSink* sink, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    
+    if (!sample) return GST_FLOW_OK;
+    if (ctx->running) event_recorder_push(ctx->recorder, sample);
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+/* 检测分支 videorate 输出：超出档位帧率的帧和画面静止的帧在缩放和颜色转换之前丢弃 */
+static GstPadProbeReturn on_detect_buffer(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstVideoInfo vinfo;
+    GstVideoFrame frame;
+    
+    if (!buffer) return GST_PAD_PROBE_OK;
+    if (ctx->detect_qos) {
+        detect_qos_tick(ctx);
+        if (!detect_pts_rate_ok(ctx, GST_BUFFER_PTS(buffer))) return GST_PAD_PROBE_DROP;
+    }
+    if (!ctx->motion_gate) return GST_PAD_PROBE_OK;
+    
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (!caps) return GST_PAD_PROBE_OK;
+    gboolean valid = gst_video_info_from_caps(&vinfo, caps);
+    gst_caps_unref(caps);
+    if (!valid || !gst_video_frame_map(&frame, &vinfo, buffer, GST_MAP_READ)) return GST_PAD_PROBE_OK;
+    
+    /* YUV 取 Y 分量（NV12/I420 为平面，YUY2 间隔 2 字节），RGB 取最接近亮度的 G 分量 */
+    int comp = GST_VIDEO_INFO_IS_RGB(&vinfo) ? GST_VIDEO_COMP_G : GST_VIDEO_COMP_Y;
+    bool pass = detect_motion_ok(ctx, (const uint8_t*)GST_VIDEO_FRAME_COMP_DATA(&frame, comp),
+                                 GST_VIDEO_FRAME_COMP_WIDTH(&frame, comp), GST_VIDEO_FRAME_COMP_HEIGHT(&frame, comp),
+                                 GST_VIDEO_FRAME_COMP_STRIDE(&frame, comp), GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, comp));
+    gst_video_frame_unmap(&frame);
+    return pass ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+}
+
+/* leaky 队列满时每丢弃一个缓冲区发出一次 overrun */
+static void on_queue_overrun(GstElement* queue, gpointer user_data)
+{
+    (void)queue;
+    atomic_fetch_add((atomic_uint_fast64_t*)user_data, 1);
+}
+
+/* v4l2src 输出：buffer offset 即 V4L2 buf.sequence，不连续说明驱动侧丢帧；每帧记入最近帧历史 */
+static GstPadProbeReturn on_source_buffer(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    (void)pad;
+    
+    if (!buffer || GST_BUFFER_OFFSET(buffer) == GST_BUFFER_OFFSET_NONE) return GST_PAD_PROBE_OK;
+    
+    int64_t seq = (int64_t)GST_BUFFER_OFFSET(buffer);
+    if (ctx->last_v4l2_sequence >= 0 && seq > ctx->last_v4l2_sequence + 1) {
+        atomic_fetch_add(&ctx->sequence_gaps, 1);
+        atomic_fetch_add(&ctx->frames_lost, seq - ctx->last_v4l2_sequence - 1);
+    }
+    ctx->last_v4l2_sequence = seq;
+    
+    GstClockTime pts = GST_BUFFER_PTS(buffer);
+    gst_player_frame_info_t frame_info = { .frame_id = (uint64_t)seq };
+    if (GST_CLOCK_TIME_IS_VALID(pts)) {
+        frame_info.capture_us = (int64_t)GST_TIME_AS_USECONDS(gst_element_get_base_time(ctx->pipeline) + pts);
+    }
+    frame_history_add(ctx, pts, &frame_info);
+    return GST_PAD_PROBE_OK;
+}
+
+/* tee 输入（解码输出）：记录解码完成时刻，解码器保留 PTS */
+static GstPadProbeReturn on_decoded_buffer(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    (void)pad;
+    
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer)) {
+        frame_history_set_decoded(ctx, GST_BUFFER_PTS(buffer), get_time_us());
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+/* 显示 sink 输入：帧计数、送显间隔和采集到送显的延迟 */
+static GstPadProbeReturn on_display_stats(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)user_data;
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    int64_t now = get_time_us();
+    (void)pad;
+    
+    if (ctx->frame_count == 0 && ctx->start_time > 0) {
+        ctx->first_frame_us = now - ctx->start_time;
+        printf("[%s] 首帧送显: %lld ms\n", MODULE_TAG, (long long)ctx->first_frame_us / 1000);
+    }
+    ctx->frame_count++;
+    if (ctx->last_display_us > 0) {
+        latency_stats_record(&ctx->lat_interval, (long)(now - ctx->last_display_us));
+    }
+    ctx->last_display_us = now;
+    
+    /* 直播源的 PTS 是采集时刻的运行时间 */
+    GstClock* clock = buffer ? gst_element_get_clock(ctx->pipeline) : NULL;
+    if (clock) {
+        GstClockTime running = gst_clock_get_time(clock) - gst_element_get_base_time(ctx->pipeline);
+        GstClockTime pts = GST_BUFFER_PTS(buffer);
+        if (GST_CLOCK_TIME_IS_VALID(pts) && running >= pts) {
+            latency_stats_record(&ctx->lat_display, (long)GST_TIME_AS_USECONDS(running - pts));
+        }
+        gst_object_unref(clock);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+/* 显示 sink 的 QoS 丢帧数（basesink stats 属性） */
+static uint64_t display_sink_dropped(gst_player_context_t* ctx)
+{
+    GstStructure* s = NULL;
+    guint64 dropped = 0;
+    
+    if (!ctx->video_sink) return 0;
+    g_object_get(ctx->video_sink, "stats", &s, NULL);
+    if (s) {
+        gst_structure_get_uint64(s, "dropped", &dropped);
+        gst_structure_free(s);
+    }
+    return dropped;
+}
+
+/* 连接统计探针和队列信号 */
+static void attach_stats(gst_player_context_t* ctx)
+{
+    GstElement* element;
+    GstPad* pad;
+    
+    if ((element = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "displayqueue"))) {
+        g_signal_connect(element, "overrun", G_CALLBACK(on_queue_overrun), &ctx->display_queue_drops);
+        gst_object_unref(element);
+    }
+    if ((element = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "detectqueue"))) {
+        g_signal_connect(element, "overrun", G_CALLBACK(on_queue_overrun), &ctx->detect_queue_drops);
+        gst_object_unref(element);
+    }
+    if ((element = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "v4l2src"))) {
+        if ((pad = gst_element_get_static_pad(element, "src"))) {
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_source_buffer, ctx, NULL);
+            gst_object_unref(pad);
+        }
+        gst_object_unref(element);
+        
+        if (ctx->tee && (pad = gst_element_get_static_pad(ctx->tee, "sink"))) {
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_decoded_buffer, ctx, NULL);
+            gst_object_unref(pad);
+        }
+    }
+    if (ctx->video_sink && (pad = gst_element_get_static_pad(ctx->video_sink, "sink"))) {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_display_stats, ctx, NULL);
+        gst_object_unref(pad);
+    }
+}
+
+/* 创建元素，缺少插件时打印工厂名 */
+static GstElement* element_new(const char* factory, const char* name)
+{
+    GstElement* element = gst_element_factory_make(factory, name);
+    if (!element) printf("[%s] 缺少元素: %s\n", MODULE_TAG, factory);
+    return element;
+}
+
+/* 创建 capsfilter（接管 caps 的引用） */
+static GstElement* capsfilter_new(const char* name, GstCaps* caps)
+{
+    GstElement* filter = element_new("capsfilter", name);
+    if (filter) g_object_set(filter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    return filter;
+}
+
+/* 队列：只保留最新的 max_buffers 帧，满时丢弃旧帧（tee 的推送永不阻塞） */
+static GstElement* leaky_queue_new(const char* name, int max_buffers)
+{
+    GstElement* queue = element_new("queue", name);
+    if (queue) {
+        g_object_set(queue, "max-size-buffers", (guint)max_buffers, NULL);
+        gst_util_set_object_arg(G_OBJECT(queue), "leaky", "downstream");
+    }
+    return queue;
+}
+
+/* 把元素加入 bin 并依次连接，有元素创建失败或连接失败时返回 false（已加入的元素随 bin 释放） */
+static bool bin_add_chain(GstBin* bin, GstElement* const* elements, int n)
+{
+    bool ok = true;
+    
+    for (int i = 0; i < n; i++) {
+        if (elements[i]) {
+            gst_bin_add(bin, elements[i]);
+        } else {
+            ok = false;
+        }
+    }
+    for (int i = 0; ok && i + 1 < n; i++) {
+        if (!gst_element_link(elements[i], elements[i + 1])) {
+            printf("[%s] 连接失败: %s -> %s\n", MODULE_TAG,
+                   GST_ELEMENT_NAME(elements[i]), GST_ELEMENT_NAME(elements[i + 1]));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/* 创建分支 bin：元素依次连接，第一个元素的 sink pad 作为 bin 的 ghost pad
+ * @return 非浮动引用（由播放器持有），失败返回 NULL
+ */
+static GstElement* branch_bin_new(const char* name, GstElement* const* elements, int n)
+{
+    GstElement* bin = gst_object_ref_sink(gst_bin_new(name));
+    
+    if (!bin_add_chain(GST_BIN(bin), elements, n)) {
+        gst_object_unref(bin);
+        return NULL;
+    }
+    
+    GstPad* pad = gst_element_get_static_pad(elements[0], "sink");
+    gst_element_add_pad(bin, gst_ghost_pad_new("sink", pad));
+    gst_object_unref(pad);
+    return bin;
+}
+
+/* 显示分支 */
+static GstElement* display_branch_new(gst_player_display_mode_t display_mode)
+{
+    GstElement* queue = leaky_queue_new("displayqueue", 2);
+    
+    if (display_mode == GST_PLAYER_DISPLAY_GL) {
+        /* glimagesink 在 GPU 上完成 YUV 转换和人脸框合成 */
+        GstElement* sink = element_new("glimagesink", "videosink");
+        if (sink) g_object_set(sink, "sync", FALSE, "force-aspect-ratio", FALSE, NULL);
+        GstElement* chain[] = { queue, sink };
+        return branch_bin_new("display", chain, 2);
+    }
+    
+    /* 软件路径：使用 cairooverlay 绘制人脸框 */
+    GstElement* sink = element_new("xvimagesink", "videosink");
+    if (sink) g_object_set(sink, "sync", FALSE, "force-aspect-ratio", FALSE, NULL);
+    GstElement* chain[] = {
+        queue,
+        element_new("videoconvert", NULL),
+        element_new("cairooverlay", "overlay"),
+        element_new("videoconvert", NULL),
+        sink,
+    };
+    return branch_bin_new("display", chain, 5);
+}
+
+/* 检测分支 - 先降帧率再缩放，颜色转换只作用于小图；valve 在空闲模式下丢弃所有帧，
+ * 运动门控和检测自适应的探针挂在 detectrate 的输出上，自适应修改 detectscale 的尺寸 */
+static GstElement* detect_branch_new(const gst_player_config_t* config)
+{
+    int face_w = config->face_detect_width > 0 ? config->face_detect_width : config->width;
+    int face_h = config->face_detect_height > 0 ? config->face_detect_height : config->height;
+    int face_fps = config->face_detect_fps > 0 ? config->face_detect_fps : 10;
+    const char* face_fmt = config->face_detect_format == GST_PLAYER_PIXEL_NV12 ? "NV12" : "BGRA";
+    
+    GstElement* valve = element_new("valve", "detectvalve");
+    GstElement* queue = leaky_queue_new("detectqueue", 1);
+    GstElement* rate = element_new("videorate", "detectrate");
+    if (rate) g_object_set(rate, "drop-only", TRUE, NULL);    /* 只丢帧不复制，同一源帧不会交付两次 */
+    GstElement* rate_caps = capsfilter_new(NULL, gst_caps_new_simple("video/x-raw",
+        "framerate", GST_TYPE_FRACTION, face_fps, 1, NULL));
+    GstElement* sink = element_new("appsink", "facesink");
+    if (sink) g_object_set(sink, "emit-signals", TRUE, "max-buffers", 1, "drop", TRUE, "sync", FALSE, NULL);
+    
+    if (config->use_rga && element_available("v4l2convert")) {
+        /* RGA（V4L2 mem2mem）一次完成缩放和格式转换 */
+        GstElement* chain[] = {
+            valve, queue, rate, rate_caps,
+            element_new("v4l2convert", NULL),
+            capsfilter_new("detectscale", gst_caps_new_simple("video/x-raw",
+                "format", G_TYPE_STRING, face_fmt,
+                "width", G_TYPE_INT, face_w,
+                "height", G_TYPE_INT, face_h,
+                NULL)),
+            sink,
+        };
+        return branch_bin_new("detect", chain, 7);
+    }
+    
+    /* 解码输出本身是 NV12 时 videoconvert 直通 */
+    GstElement* chain[] = {
+        valve, queue, rate, rate_caps,
+        element_new("videoscale", NULL),
+        capsfilter_new("detectscale", gst_caps_new_simple("video/x-raw",
+            "width", G_TYPE_INT, face_w,
+            "height", G_TYPE_INT, face_h,
+            NULL)),
+        element_new("videoconvert", NULL),
+        capsfilter_new(NULL, gst_caps_new_simple("video/x-raw",
+            "format", G_TYPE_STRING, face_fmt,
+            NULL)),
+        sink,
+    };
+    return branch_bin_new("detect", chain, 9);
+}
+
+/* 录像分支 - 硬件编码 → parse（每个 IDR 前重复 SPS/PPS，任意关键帧都可作为片段起点）→ appsink
+ * 队列只留 1 帧：共享采集下显示和录像共用有限的解码缓冲区 */
+static GstElement* record_branch_new(const gst_player_config_t* config)
+{
+    bool h265 = config->record_codec == GST_PLAYER_RECORD_H265;
+    int kbps = config->record_bitrate_kbps > 0 ? config->record_bitrate_kbps : DEFAULT_RECORD_BITRATE_KBPS;
+    
+    GstElement* encoder = element_new(h265 ? "mpph265enc" : "mpph264enc", "recordenc");
+    if (encoder) {
+        g_object_set(encoder, "gop", config->fps > 0 ? config->fps : 30, "bps", (guint)kbps * 1000, NULL);
+    }
+    GstElement* parser = element_new(h265 ? "h265parse" : "h264parse", NULL);
+    if (parser) g_object_set(parser, "config-interval", -1, NULL);
+    GstElement* sink = element_new("appsink", "recordsink");
+    if (sink) g_object_set(sink, "sync", FALSE, NULL);
+    
+    GstElement* chain[] = {
+        leaky_queue_new("recordqueue", 1),
+        encoder,
+        parser,
+        capsfilter_new(NULL, gst_caps_new_simple(h265 ? "video/x-h265" : "video/x-h264",
+            "stream-format", G_TYPE_STRING, "byte-stream",
+            "alignment", G_TYPE_STRING, "au",
+            NULL)),
+        sink,
+    };
+    return branch_bin_new("record", chain, 5);
+}
+
+/* 源 → 解码 → tee 加入管道，返回 tee，失败返回 NULL */
+static GstElement* source_chain_add(GstBin* pipeline, const gst_player_config_t* config,
+                                    gst_player_display_mode_t display_mode)
+{
+    if (config->shared_camera) {
+        /* 共享采集：caps 在收到第一帧解码结果后设置（NV12/NV16 取决于 MJPEG 采样） */
+        GstElement* src = element_new("appsrc", "camsrc");
+        if (src) g_object_set(src, "is-live", TRUE, "do-timestamp", TRUE, "format", GST_FORMAT_TIME, NULL);
+        GstElement* tee = element_new("tee", "t");
+        if (tee) g_object_set(tee, "allow-not-linked", TRUE, NULL);
+        GstElement* chain[] = { src, tee };
+        printf("[%s] 源: 共享采集 appsrc\n", MODULE_TAG);
+        return bin_add_chain(pipeline, chain, 2) ? tee : NULL;
+    }
+    
+    /* 源 caps 使用命名的 capsfilter，切换分辨率/帧率时直接修改 */
+    GstCaps* caps;
+    switch (config->format) {
+        case GST_PLAYER_FORMAT_MJPEG:
+            caps = gst_caps_new_simple("image/jpeg",
+                "width", G_TYPE_INT, config->width,
+                "height", G_TYPE_INT, config->height,
+                "framerate", GST_TYPE_FRACTION, config->fps, 1,
+                NULL);
+            break;
+        case GST_PLAYER_FORMAT_YUY2:
+            caps = gst_caps_new_simple("video/x-raw",
+                "format", G_TYPE_STRING, "YUY2",
+                "width", G_TYPE_INT, config->width,
+                "height", G_TYPE_INT, config->height,
+                "framerate", GST_TYPE_FRACTION, config->fps, 1,
+                NULL);
+            break;
+        default:
+            printf("[%s] 不支持的视频格式: %d\n", MODULE_TAG, config->format);
+            return NULL;
+    }
+    
+    GstElement* chain[4];
+    int n = 0;
+    const char* decoder = NULL;
+    
+    chain[n] = element_new("v4l2src", "v4l2src");
+    if (chain[n]) g_object_set(chain[n], "device", config->device, NULL);
+    n++;
+    chain[n++] = capsfilter_new("srccaps", caps);
+    if (config->format == GST_PLAYER_FORMAT_MJPEG) {
+        /* cairooverlay 只能画在 CPU 可访问的 RGB 帧上，软件路径使用 jpegdec */
+        bool hw_decode = config->use_hardware_decode && display_mode == GST_PLAYER_DISPLAY_GL &&
+                         element_available("mppjpegdec");
+        decoder = hw_decode ? "mppjpegdec" : "jpegdec";
+        chain[n++] = element_new(decoder, NULL);
+    }
+    GstElement* tee = element_new("tee", "t");
+    if (tee) g_object_set(tee, "allow-not-linked", TRUE, NULL);   /* 所有分支都断开时源继续运行 */
+    chain[n++] = tee;
+    
+    printf("[%s] 源: %s%s%s\n", MODULE_TAG, config->device, decoder ? " -> " : "", decoder ? decoder : "");
+    return bin_add_chain(pipeline, chain, n) ? tee : NULL;
+}
+
+/* 把分支连接到 tee；管道运行中也可调用，新的 tee pad 会先收到 caps 等 sticky 事件 */
+static bool branch_attach(gst_player_context_t* ctx, player_branch_t* branch)
+{
+    if (branch->tee_pad) return true;
+    
+    gst_bin_add(GST_BIN(ctx->pipeline), branch->bin);
+    
+    GstPad* sink = gst_element_get_static_pad(branch->bin, "sink");
+    branch->tee_pad = gst_element_get_request_pad(ctx->tee, "src_%u");
+    if (!branch->tee_pad || gst_pad_link(branch->tee_pad, sink) != GST_PAD_LINK_OK) {
+        printf("[%s] 分支 %s 连接失败\n", MODULE_TAG, GST_ELEMENT_NAME(branch->bin));
+        if (branch->tee_pad) {
+            gst_element_release_request_pad(ctx->tee, branch->tee_pad);
+            gst_object_unref(branch->tee_pad);
+            branch->tee_pad = NULL;
+        }
+        gst_object_unref(sink);
+        gst_element_set_state(branch->bin, GST_STATE_NULL);
+        gst_bin_remove(GST_BIN(ctx->pipeline), branch->bin);
+        return false;
+    }
+    gst_object_unref(sink);
+    gst_element_sync_state_with_parent(branch->bin);
+    return true;
+}
+
+/* tee pad 空闲（两次推送之间）时在流线程中断开分支 */
+static GstPadProbeReturn on_branch_idle(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    player_branch_t* branch = (player_branch_t*)user_data;
+    GstPad* peer = gst_pad_get_peer(pad);
+    (void)info;
+    
+    if (peer) {
+        gst_pad_unlink(pad, peer);
+        gst_object_unref(peer);
+    }
+    
+    pthread_mutex_lock(&branch->lock);
+    branch->unlinked = true;
+    pthread_cond_broadcast(&branch->cond);
+    pthread_mutex_unlock(&branch->lock);
+    return GST_PAD_PROBE_REMOVE;
+}
+
+/* 断开分支并移出管道，分支元素回到 NULL（不再占用任何线程和缓冲区） */
+static void branch_detach(gst_player_context_t* ctx, player_branch_t* branch)
+{
+    if (!branch->tee_pad) return;
+    
+    /* 各分支都以 leaky 队列开头，tee 的推送不会阻塞，空闲探针很快触发（管道未运行时立即触发） */
+    branch->unlinked = false;
+    gst_pad_add_probe(branch->tee_pad, GST_PAD_PROBE_TYPE_IDLE, on_branch_idle, branch, NULL);
+    pthread_mutex_lock(&branch->lock);
+    while (!branch->unlinked) {
+        pthread_cond_wait(&branch->cond, &branch->lock);
+    }
+    pthread_mutex_unlock(&branch->lock);
+    
+    gst_element_release_request_pad(ctx->tee, branch->tee_pad);
+    gst_object_unref(branch->tee_pad);
+    branch->tee_pad = NULL;
+    
+    gst_element_set_state(branch->bin, GST_STATE_NULL);
+    gst_bin_remove(GST_BIN(ctx->pipeline), branch->bin);
+}
+
+/* 创建管道：源链 + 各分支（detect_branch 为 false 时不创建检测分支）
+ * 录像分支在 record_pre_ms > 0 时创建，缺少硬件编码器时只打印警告 */
+static bool pipeline_build(gst_player_context_t* ctx, const gst_player_config_t* config, bool detect_branch)
+{
+    const char* encoder = config->record_codec == GST_PLAYER_RECORD_H265 ? "mpph265enc" : "mpph264enc";
+    bool wanted[PLAYER_BRANCH_COUNT] = { true, detect_branch, config->record_pre_ms > 0 };
+    
+    if (wanted[GST_PLAYER_BRANCH_RECORD] && !element_available(encoder)) {
+        printf("[%s] 警告: 缺少 %s，不创建录像分支\n", MODULE_TAG, encoder);
+        wanted[GST_PLAYER_BRANCH_RECORD] = false;
+    }
+    
+    char name[32];
+    snprintf(name, sizeof(name), "player%d", atomic_fetch_add(&g_pipeline_count, 1));
+    ctx->pipeline = gst_object_ref_sink(gst_pipeline_new(name));
+    ctx->tee = source_chain_add(GST_BIN(ctx->pipeline), config, ctx->display_mode);
+    if (!ctx->tee) return false;
+    
+    ctx->branches[GST_PLAYER_BRANCH_DISPLAY].bin = display_branch_new(ctx->display_mode);
+    if (wanted[GST_PLAYER_BRANCH_DETECT]) {
+        ctx->branches[GST_PLAYER_BRANCH_DETECT].bin = detect_branch_new(config);
+    }
+    if (wanted[GST_PLAYER_BRANCH_RECORD]) {
+        ctx->branches[GST_PLAYER_BRANCH_RECORD].bin = record_branch_new(config);
+    }
+    
+    for (int i = 0; i < PLAYER_BRANCH_COUNT; i++) {
+        player_branch_t* branch = &ctx->branches[i];
+        if (!branch->bin) {
+            if (wanted[i]) return false;
+            continue;
+        }
+        if (!branch_attach(ctx, branch)) return false;
+        printf("[%s] 分支: %s\n", MODULE_TAG, GST_ELEMENT_NAME(branch->bin));
+    }
+    return true;
+}
+
+/* 释放管道和所有分支（包括已断开的分支） */
+static void pipeline_free(gst_player_context_t* ctx)
+{
+    if (ctx->pipeline) {
+        gst_element_set_state(ctx->pipeline, GST_STATE_NULL);
+    }
+    for (int i = 0; i < PLAYER_BRANCH_COUNT; i++) {
+        player_branch_t* branch = &ctx->branches[i];
+        if (branch->tee_pad) {
+            gst_element_release_request_pad(ctx->tee, branch->tee_pad);
+            gst_object_unref(branch->tee_pad);
+            branch->tee_pad = NULL;
+        }
+        if (branch->bin) {
+            gst_element_set_state(branch->bin, GST_STATE_NULL);
+            gst_object_unref(branch->bin);
+            branch->bin = NULL;
+        }
+    }
+    if (ctx->pipeline) {
+        gst_object_unref(ctx->pipeline);
+        ctx->pipeline = NULL;
+    }
+    ctx->tee = NULL;
+}
+
+static void player_branches_destroy(gst_player_context_t* ctx)
+{
+    for (int i = 0; i < PLAYER_BRANCH_COUNT; i++) {
+        pthread_mutex_destroy(&ctx->branches[i].lock);
+        pthread_cond_destroy(&ctx->branches[i].cond);
+    }
+}
+
+gst_player_handle_t gst_player_create(const gst_player_config_t* config)
+{
+    if (!config || (!config->device && !config->shared_camera)) return NULL;
+    if (gst_player_global_init() != GST_PLAYER_OK) return NULL;
+    
+    gst_player_context_t* ctx = (gst_player_context_t*)calloc(1, sizeof(gst_player_context_t));
+    if (!ctx) return NULL;
+    
+    if (config->device) strncpy(ctx->device, config->device, sizeof(ctx->device) - 1);
+    ctx->width = config->width;
+    ctx->height = config->height;
+    ctx->fps = config->fps;
+    ctx->format = config->format;
+    ctx->use_hardware_decode = config->use_hardware_decode;
+    ctx->mode = GST_PLAYER_MODE_ACTIVE;
+    ctx->active_width = config->width;
+    ctx->active_height = config->height;
+    ctx->active_fps = config->fps;
+    ctx->idle_width = config->idle_width > 0 ? config->idle_width : DEFAULT_IDLE_WIDTH;
+    ctx->idle_height = config->idle_height > 0 ? config->idle_height : DEFAULT_IDLE_HEIGHT;
+    ctx->idle_fps = config->idle_fps > 0 ? config->idle_fps : DEFAULT_IDLE_FPS;
+    ctx->face_detect_width = config->face_detect_width > 0 ? config->face_detect_width : config->width;
+    ctx->face_detect_height = config->face_detect_height > 0 ? config->face_detect_height : config->height;
+    ctx->max_face_boxes = config->max_face_boxes > 0 ? config->max_face_boxes : DEFAULT_MAX_FACE_BOXES;
+    if (ctx->max_face_boxes > FACE_BOXES_LIMIT) ctx->max_face_boxes = FACE_BOXES_LIMIT;
+    ctx->face_box_predict_us = config->face_box_predict_ms > 0 ? (int64_t)config->face_box_predict_ms * 1000 : 0;
+    if (!face_boxes_init(ctx)) {
+        face_boxes_free(ctx);
+        free(ctx);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&ctx->face_box_mutex, NULL);
+    pthread_mutex_init(&ctx->frame_history_lock, NULL);
+    pthread_mutex_init(&ctx->face_crop_lock, NULL);
+    pthread_mutex_init(&ctx->pull_lock, NULL);
+    ctx->pull_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    latency_stats_init(&ctx->lat_display);
+    latency_stats_init(&ctx->lat_interval);
+    latency_stats_init(&ctx->lat_callback);
+    
+    ctx->display_mode = config->display_mode;
+    if (ctx->display_mode == GST_PLAYER_DISPLAY_AUTO) {
+        ctx->display_mode = element_available("glimagesink") ? GST_PLAYER_DISPLAY_GL : GST_PLAYER_DISPLAY_CAIRO;
+    }
+    
+    /* 共享采集：相机有检测流时直接使用，不再在 GStreamer 中缩放 */
+    ctx->shared_camera = config->shared_camera;
+    ctx->face_detect_fps = config->face_detect_fps > 0 ? config->face_detect_fps : 10;
+    ctx->face_detect_max_fps = ctx->face_detect_fps;
+    ctx->last_detect_pts = GST_CLOCK_TIME_NONE;
+    ctx->face_detect_format = config->face_detect_format;
+    if (ctx->shared_camera) {
+        ctx->shared_detect = camera_set_frame_info_callback(ctx->shared_camera, CAMERA_STREAM_DETECT,
+                                                            on_camera_detect, ctx) == CAMERA_OK;
+        ctx->dmabuf_allocator = gst_dmabuf_allocator_new();
+    }
+    
+    /* 共享采集 + NV12 检测帧直接取自解码输出，也不需要 GStreamer 检测分支 */
+    bool detect_branch = !ctx->shared_camera ||
+                         (!ctx->shared_detect && ctx->face_detect_format != GST_PLAYER_PIXEL_NV12);
+    for (int i = 0; i < PLAYER_BRANCH_COUNT; i++) {
+        pthread_mutex_init(&ctx->branches[i].lock, NULL);
+        pthread_cond_init(&ctx->branches[i].cond, NULL);
+    }
+    if (!pipeline_build(ctx, config, detect_branch)) {
+        printf("[%s] 创建管道失败\n", MODULE_TAG);
+        pipeline_free(ctx);
+        player_branches_destroy(ctx);
+        shared_camera_detach(ctx);
+        face_boxes_free(ctx);
+        pthread_mutex_destroy(&ctx->face_box_mutex);
+        pthread_mutex_destroy(&ctx->frame_history_lock);
+        pthread_mutex_destroy(&ctx->face_crop_lock);
+        pthread_mutex_destroy(&ctx->pull_lock);
+        if (ctx->pull_fd >= 0) close(ctx->pull_fd);
+        free(ctx);
+        return NULL;
+    }
+    
+    ctx->video_sink = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "videosink");
+    ctx->app_sink = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "facesink");
+    ctx->overlay = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "overlay");
+    ctx->app_src = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "camsrc");
+    ctx->src_caps = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "srccaps");
+    ctx->detect_valve = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "detectvalve");
+    
+    if (ctx->shared_camera && ctx->app_src) {
+        camera_set_decoded_callback(ctx->shared_camera, on_camera_decoded, ctx);
+        printf("[%s] 共享采集已连接（检测帧来自%s）\n", MODULE_TAG,
+               ctx->shared_detect ? "相机检测流" : "GStreamer 缩放");
+    }
+    
+    if (ctx->display_mode == GST_PLAYER_DISPLAY_GL) {
+        GstPad* pad = ctx->video_sink ? gst_element_get_static_pad(ctx->video_sink, "sink") : NULL;
+        if (pad) {
+            ctx->overlay_probe_id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+                                                      on_display_buffer, ctx, NULL);
+            gst_object_unref(pad);
+            printf("[%s] GL 人脸框合成已连接\n", MODULE_TAG);
+        } else {
+            printf("[%s] 警告: 未找到 glimagesink sink pad\n", MODULE_TAG);
+        }
+    } else if (ctx->overlay) {
+        g_signal_connect(ctx->overlay, "draw", G_CALLBACK(on_cairo_draw), ctx);
+        g_signal_connect(ctx->overlay, "caps-changed", G_CALLBACK(on_caps_changed), ctx);
+        printf("[%s] cairooverlay 已连接\n", MODULE_TAG);
+    } else {
+        printf("[%s] 警告: 未找到 cairooverlay\n", MODULE_TAG);
+    }
+    
+    if (ctx->app_sink) {
+        GstAppSinkCallbacks callbacks = { NULL, NULL, on_new_sample };
+        gst_app_sink_set_callbacks(GST_APP_SINK(ctx->app_sink), &callbacks, ctx, NULL);
+    }
+    
+    ctx->record_sink = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "recordsink");
+    if (ctx->record_sink) {
+        /* 预录缓冲上限：按码率估算的两倍，另加两个 GOP 的余量 */
+        int kbps = config->record_bitrate_kbps > 0 ? config->record_bitrate_kbps : DEFAULT_RECORD_BITRATE_KBPS;
+        event_recorder_config_t rcfg = {
+            .pre_ms = config->record_pre_ms,
+            .max_bytes = (size_t)kbps * 125 * ((size_t)config->record_pre_ms + 2000) / 1000 * 2,
+        };
+        ctx->recorder = event_recorder_create(&rcfg);
+        GstAppSinkCallbacks callbacks = { NULL, NULL, on_record_sample };
+        gst_app_sink_set_callbacks(GST_APP_SINK(ctx->record_sink), &callbacks, ctx, NULL);
+        printf("[%s] 录像分支已连接（预录 %d ms，%d kbps）\n", MODULE_TAG, config->record_pre_ms, kbps);
+    }
+    
+    if (config->detect_workers > 0) {
+        dispatcher_config_t dcfg = {
+            .name = "gst-detect",
+            .worker_count = config->detect_workers,
+            .cpu_mask = config->detect_cpu_mask,
+            .run = detect_job_run,
+            .release = detect_job_release,
+            .user_data = ctx,
+        };
+        ctx->detect_dispatcher = dispatcher_create(&dcfg);
+        if (!ctx->detect_dispatcher) {
+            printf("[%s] 警告: 检测工作线程创建失败，回调将在流线程中执行\n", MODULE_TAG);
+        }
+    }
+    
+    if (config->motion_gate) {
+        motion_gate_config_t gcfg = {
+            .pixel_threshold = config->motion_threshold,
+            .area_permille = config->motion_area_permille,
+            .heartbeat_ms = config->motion_heartbeat_ms,
+            .hold_ms = config->motion_hold_ms,
+        };
+        ctx->motion_gate = motion_gate_create(&gcfg);
+        if (!ctx->motion_gate) {
+            printf("[%s] 警告: 运动门控创建失败，检测帧将全部交付\n", MODULE_TAG);
+        }
+    }
+    if (config->adaptive_detect) {
+        /* 检测帧不经过 GStreamer 缩放时（共享采集）尺寸固定，只调整帧率 */
+        ctx->detect_scale = gst_bin_get_by_name(GST_BIN(ctx->pipeline), "detectscale");
+        detect_qos_config_t qcfg = {
+            .max_fps = ctx->face_detect_max_fps,
+            .min_fps = config->detect_min_fps,
+            .max_width = ctx->face_detect_width,
+            .max_height = ctx->face_detect_height,
+            .min_width = ctx->detect_scale ? config->detect_min_width : ctx->face_detect_width,
+            .budget_ms = config->detect_budget_ms,
+        };
+        ctx->detect_qos = detect_qos_create(&qcfg);
+        if (!ctx->detect_qos) {
+            printf("[%s] 警告: 检测自适应创建失败，检测帧率和尺寸保持不变\n", MODULE_TAG);
+        }
+    }
+    GstElement* detect_rate = ctx->motion_gate || ctx->detect_qos ?
+                              gst_bin_get_by_name(GST_BIN(ctx->pipeline), "detectrate") : NULL;
+    if (detect_rate) {
+        GstPad* pad = gst_element_get_static_pad(detect_rate, "src");
+        if (pad) {
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_detect_buffer, ctx, NULL);
+            gst_object_unref(pad);
+        }
+        gst_object_unref(detect_rate);
+    }
+    
+    attach_stats(ctx);
     
     ctx->bus = gst_element_get_bus(ctx->pipeline);
     
-    printf("[%s] 播放器创建成功 %dx%d\n", MODULE_TAG, ctx->width, ctx->height);
+    /* 流任务在元素进入 PAUSED 时创建，总线同步处理在创建时把任务交给任务池 */
+    const camera_thread_config_t* sched = &config->streaming_thread;
+    if (sched->policy != CAMERA_SCHED_NORMAL || sched->cpu_mask != 0) {
+        ctx->task_pool = player_task_pool_new(GST_ELEMENT_NAME(ctx->pipeline), sched);
+        gst_bus_set_sync_handler(ctx->bus, player_task_pool_bus_sync, ctx->task_pool, NULL);
+    }
+    
+    if (config->lock_memory) player_lock_memory(ctx, true);
+    
+    printf("[%s] 播放器创建成功 %s %dx%d\n", MODULE_TAG, GST_ELEMENT_NAME(ctx->pipeline), ctx->width, ctx->height);
     return ctx;
 }
 
@@ -311,16 +2232,48 @@ void gst_player_destroy(gst_player_handle_t handle)
     
     gst_player_stop(handle);
     
+    /* 先于 shared_camera_detach：未处理的任务可能持有相机检测流帧 */
+    dispatcher_destroy(ctx->detect_dispatcher);
+    ctx->detect_dispatcher = NULL;
+    
+    shared_camera_detach(ctx);
+    
+    /* 相机回调已移除、流线程已停止，之后不会再保留新帧 */
+    pull_drop(ctx);
+    if (ctx->pull_fd >= 0) close(ctx->pull_fd);
+    
+    if (ctx->app_src) gst_object_unref(ctx->app_src);
+    if (ctx->src_caps) gst_object_unref(ctx->src_caps);
+    if (ctx->detect_valve) gst_object_unref(ctx->detect_valve);
+    if (ctx->detect_scale) gst_object_unref(ctx->detect_scale);
     if (ctx->overlay) gst_object_unref(ctx->overlay);
     if (ctx->app_sink) gst_object_unref(ctx->app_sink);
+    if (ctx->record_sink) gst_object_unref(ctx->record_sink);
     if (ctx->video_sink) gst_object_unref(ctx->video_sink);
-    if (ctx->bus) gst_object_unref(ctx->bus);
-    if (ctx->pipeline) {
-        gst_element_set_state(ctx->pipeline, GST_STATE_NULL);
-        gst_object_unref(ctx->pipeline);
+    pipeline_free(ctx);
+    if (ctx->bus) {
+        gst_bus_set_sync_handler(ctx->bus, NULL, NULL, NULL);
+        gst_object_unref(ctx->bus);
     }
+    if (ctx->task_pool) gst_object_unref(ctx->task_pool);   /* 管道已释放，流线程都已 join */
+    player_branches_destroy(ctx);
+    event_recorder_destroy(ctx->recorder);     /* 管道已停止，不会再有编码包 */
+    
+    if (ctx->composition) gst_video_overlay_composition_unref(ctx->composition);
+    if (ctx->box_pixel) gst_buffer_unref(ctx->box_pixel);
+    if (ctx->memory_report.lock_requested) player_lock_memory(ctx, false);
+    face_boxes_free(ctx);
+    motion_gate_destroy(ctx->motion_gate);
+    detect_qos_destroy(ctx->detect_qos);
+    face_crop_destroy(ctx->face_crop);
     
     pthread_mutex_destroy(&ctx->face_box_mutex);
+    pthread_mutex_destroy(&ctx->frame_history_lock);
+    pthread_mutex_destroy(&ctx->face_crop_lock);
+    pthread_mutex_destroy(&ctx->pull_lock);
+    latency_stats_destroy(&ctx->lat_display);
+    latency_stats_destroy(&ctx->lat_interval);
+    latency_stats_destroy(&ctx->lat_callback);
     free(ctx);
     printf("[%s] 播放器已销毁\n", MODULE_TAG);
 }
@@ -349,6 +2302,30 @@ gst_player_error_t gst_player_set_frame_callback(gst_player_handle_t handle,
     return GST_PLAYER_OK;
 }
 
+gst_player_error_t gst_player_set_frame_info_callback(gst_player_handle_t handle,
+                                                        gst_frame_info_callback_t callback,
+                                                        void* user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    ctx->callback_info_user_data = user_data;
+    ctx->frame_info_callback = callback;
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_set_frame_callback_ex(gst_player_handle_t handle,
+                                                      gst_frame_ex_callback_t callback,
+                                                      void* user_data)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    ctx->callback_ex_user_data = user_data;
+    ctx->frame_callback_ex = callback;
+    return GST_PLAYER_OK;
+}
+
 gst_player_error_t gst_player_start(gst_player_handle_t handle)
 {
     gst_player_context_t* ctx = (gst_player_context_t*)handle;
@@ -359,6 +2336,23 @@ gst_player_error_t gst_player_start(gst_player_handle_t handle)
     ctx->playing = true;
     ctx->start_time = get_time_us();
     ctx->frame_count = 0;
+    atomic_store(&ctx->frames_detected, 0);
+    atomic_store(&ctx->display_queue_drops, 0);
+    atomic_store(&ctx->detect_queue_drops, 0);
+    atomic_store(&ctx->sequence_gaps, 0);
+    atomic_store(&ctx->frames_lost, 0);
+    atomic_store(&ctx->frames_gated, 0);
+    atomic_store(&ctx->detect_overruns, 0);
+    atomic_store(&ctx->pull_return_us, 0);
+    detect_qos_reset(ctx->detect_qos);
+    ctx->last_detect_pts = GST_CLOCK_TIME_NONE;
+    ctx->last_v4l2_sequence = -1;
+    ctx->last_display_us = 0;
+    ctx->first_frame_us = 0;
+    latency_stats_reset(&ctx->lat_display);
+    latency_stats_reset(&ctx->lat_interval);
+    latency_stats_reset(&ctx->lat_callback);
+    ctx->shared_format = CAMERA_PIXEL_FORMAT_NONE;  /* 重新启动后重新设置 appsrc caps */
     
     GstStateChangeReturn ret = gst_element_set_state(ctx->pipeline, GST_STATE_PLAYING);
     if (ret == GST_STATE_CHANGE_FAILURE) {
@@ -367,7 +2361,32 @@ gst_player_error_t gst_player_start(gst_player_handle_t handle)
         return GST_PLAYER_ERROR_PIPELINE_FAILED;
     }
     
-    printf("[%s] 播放启动（cairooverlay 人脸框）\n", MODULE_TAG);
+    printf("[%s] 播放启动（%s 人脸框%s）\n", MODULE_TAG,
+           ctx->display_mode == GST_PLAYER_DISPLAY_GL ? "GL 合成" : "cairooverlay",
+           ctx->prerolled ? "，已预启动" : "");
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_preroll(gst_player_handle_t handle)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !ctx->pipeline) return GST_PLAYER_ERROR_INVALID_PARAM;
+    if (ctx->playing || ctx->prerolled) return GST_PLAYER_OK;
+    
+    int64_t start = get_time_us();
+    
+    /* 直播源在 PAUSED 不产生数据（返回 NO_PREROLL），sink 不会等待预卷，显示窗口也不会被创建 */
+    GstStateChangeReturn ret = gst_element_set_state(ctx->pipeline, GST_STATE_PAUSED);
+    if (ret == GST_STATE_CHANGE_ASYNC) {
+        ret = gst_element_get_state(ctx->pipeline, NULL, NULL, GST_SECOND);
+    }
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        gst_element_set_state(ctx->pipeline, GST_STATE_NULL);
+        return GST_PLAYER_ERROR_PIPELINE_FAILED;
+    }
+    
+    ctx->prerolled = true;
+    printf("[%s] 预启动完成（%lld ms）\n", MODULE_TAG, (long long)(get_time_us() - start) / 1000);
     return GST_PLAYER_OK;
 }
 
@@ -380,13 +2399,242 @@ gst_player_error_t gst_player_stop(gst_player_handle_t handle)
     ctx->running = false;
     ctx->playing = false;
     
+    /* 预启动过的管道回到 PAUSED，设备和解码器保持打开，下次 start 同样快速 */
     if (ctx->pipeline)
-        gst_element_set_state(ctx->pipeline, GST_STATE_NULL);
+        gst_element_set_state(ctx->pipeline, ctx->prerolled ? GST_STATE_PAUSED : GST_STATE_NULL);
+    
+    /* 丢弃未处理的检测帧，等待正在执行的回调返回 */
+    dispatcher_flush(ctx->detect_dispatcher);
+    
+    /* 码流中断，预录缓冲不能与重新开始后的码流拼接；正在写的片段收尾 */
+    event_recorder_reset(ctx->recorder);
+    
+    /* 停止前保留的帧不再交给拉取方 */
+    pull_drop(ctx);
     
     printf("[%s] 播放停止\n", MODULE_TAG);
     return GST_PLAYER_OK;
 }
 
+/* 切换格式前暂停：管道退回 READY，显示分支持有的缓冲区随之释放
+ * @return 之前的目标状态（PLAYING、预启动的 PAUSED），未启动返回 GST_STATE_NULL
+ */
+static GstState player_suspend(gst_player_context_t* ctx)
+{
+    GstState state = ctx->playing ? GST_STATE_PLAYING : (ctx->prerolled ? GST_STATE_PAUSED : GST_STATE_NULL);
+    if (state == GST_STATE_NULL) return state;
+    
+    ctx->running = false;
+    gst_element_set_state(ctx->pipeline, GST_STATE_READY);
+    
+    /* 工作线程中的检测任务可能持有共享相机的帧 */
+    dispatcher_flush(ctx->detect_dispatcher);
+    
+    /* 拉取模式保留的最新帧同样引用检测流槽位，不释放时相机认为帧仍被持有而拒绝切换 */
+    pull_drop(ctx);
+    return state;
+}
+
+/* 切换格式后恢复：caps 和人脸框合成按新尺寸重建，窗口句柄保持不变 */
+static gst_player_error_t player_resume(gst_player_context_t* ctx, GstState state)
+{
+    if (ctx->shared_camera) {
+        camera_get_format(ctx->shared_camera, &ctx->width, &ctx->height, &ctx->fps);
+    }
+    ctx->shared_format = CAMERA_PIXEL_FORMAT_NONE;
+    motion_gate_reset(ctx->motion_gate);    /* 新格式的第一帧没有可比较的参考帧 */
+    
+    ctx->video_width = 0;       /* 下一帧从 caps 重新读取（显示线程此时已停止） */
+    ctx->video_height = 0;
+    atomic_store(&ctx->composition_dirty, true);
+    
+    if (state == GST_STATE_NULL) return GST_PLAYER_OK;
+    
+    if (ctx->x11_window_id && ctx->video_sink) {
+        gst_video_overlay_set_window_handle(GST_VIDEO_OVERLAY(ctx->video_sink), ctx->x11_window_id);
+    }
+    ctx->running = state == GST_STATE_PLAYING;
+    if (gst_element_set_state(ctx->pipeline, state) == GST_STATE_CHANGE_FAILURE) {
+        ctx->running = false;
+        ctx->playing = false;
+        ctx->prerolled = false;
+        return GST_PLAYER_ERROR_PIPELINE_FAILED;
+    }
+    return GST_PLAYER_OK;
+}
+
+/* 修改 v4l2src 的源 caps（管道不在 PLAYING/PAUSED 时） */
+static void source_caps_set(gst_player_context_t* ctx, int width, int height, int fps)
+{
+    GstCaps* caps;
+    
+    if (ctx->format == GST_PLAYER_FORMAT_YUY2) {
+        caps = gst_caps_new_simple("video/x-raw",
+            "format", G_TYPE_STRING, "YUY2",
+            "width", G_TYPE_INT, width,
+            "height", G_TYPE_INT, height,
+            "framerate", GST_TYPE_FRACTION, fps, 1,
+            NULL);
+    } else {
+        caps = gst_caps_new_simple("image/jpeg",
+            "width", G_TYPE_INT, width,
+            "height", G_TYPE_INT, height,
+            "framerate", GST_TYPE_FRACTION, fps, 1,
+            NULL);
+    }
+    g_object_set(ctx->src_caps, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    
+    ctx->width = width;
+    ctx->height = height;
+    ctx->fps = fps;
+}
+
+static gst_player_error_t camera_error_to_player(camera_error_t err)
+{
+    switch (err) {
+        case CAMERA_OK: return GST_PLAYER_OK;
+        case CAMERA_ERROR_DEVICE_BUSY: return GST_PLAYER_ERROR_BUSY;
+        case CAMERA_ERROR_INVALID_PARAM:
+        case CAMERA_ERROR_NOT_SUPPORTED: return GST_PLAYER_ERROR_INVALID_PARAM;
+        default: return GST_PLAYER_ERROR_DEVICE_NOT_FOUND;
+    }
+}
+
+gst_player_error_t gst_player_reconfigure(gst_player_handle_t handle, int width, int height, int fps)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !ctx->pipeline || width <= 0 || height <= 0 || fps <= 0) return GST_PLAYER_ERROR_INVALID_PARAM;
+    if (!ctx->shared_camera && !ctx->src_caps) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    ctx->active_width = width;
+    ctx->active_height = height;
+    ctx->active_fps = fps;
+    if (ctx->mode != GST_PLAYER_MODE_ACTIVE) return GST_PLAYER_OK;
+    if (!ctx->shared_camera && width == ctx->width && height == ctx->height && fps == ctx->fps) return GST_PLAYER_OK;
+    
+    /* 零拷贝帧引用 v4l2src/RGA/相机的缓冲区，管道退回 READY 前必须全部归还 */
+    if (atomic_load(&ctx->held_frames) > 0) {
+        fprintf(stderr, "[%s] 仍有 %d 个零拷贝帧未归还，不能切换格式\n", MODULE_TAG, atomic_load(&ctx->held_frames));
+        return GST_PLAYER_ERROR_BUSY;
+    }
+    
+    gst_player_error_t err = GST_PLAYER_OK;
+    GstState state = player_suspend(ctx);
+    if (ctx->shared_camera) {
+        err = camera_error_to_player(camera_reconfigure(ctx->shared_camera, width, height, fps));
+    } else {
+        source_caps_set(ctx, width, height, fps);
+    }
+    gst_player_error_t resume_err = player_resume(ctx, state);
+    if (err == GST_PLAYER_OK) err = resume_err;
+    
+    printf("[%s] 格式切换为 %dx%d@%dfps (%s)\n", MODULE_TAG, ctx->width, ctx->height, ctx->fps,
+           gst_player_get_error_string(err));
+    return err;
+}
+
+gst_player_error_t gst_player_set_mode(gst_player_handle_t handle, gst_player_mode_t mode)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !ctx->pipeline || (mode != GST_PLAYER_MODE_ACTIVE && mode != GST_PLAYER_MODE_IDLE)) {
+        return GST_PLAYER_ERROR_INVALID_PARAM;
+    }
+    if (!ctx->shared_camera && !ctx->src_caps) return GST_PLAYER_ERROR_INVALID_PARAM;
+    if (mode == ctx->mode) return GST_PLAYER_OK;
+    if (atomic_load(&ctx->held_frames) > 0) {
+        fprintf(stderr, "[%s] 仍有 %d 个零拷贝帧未归还，不能切换模式\n", MODULE_TAG, atomic_load(&ctx->held_frames));
+        return GST_PLAYER_ERROR_BUSY;
+    }
+    
+    bool idle = mode == GST_PLAYER_MODE_IDLE;
+    
+    /* 先关闭检测分支，格式切换期间也不再交付检测帧 */
+    if (idle) {
+        ctx->detect_paused = true;
+        if (ctx->detect_valve) g_object_set(ctx->detect_valve, "drop", TRUE, NULL);
+    }
+    
+    gst_player_error_t err = GST_PLAYER_OK;
+    GstState state = player_suspend(ctx);
+    if (ctx->shared_camera) {
+        err = camera_error_to_player(camera_set_mode(ctx->shared_camera, idle ? CAMERA_MODE_IDLE : CAMERA_MODE_ACTIVE));
+    } else if (idle) {
+        source_caps_set(ctx, ctx->idle_width, ctx->idle_height, ctx->idle_fps);
+    } else {
+        source_caps_set(ctx, ctx->active_width, ctx->active_height, ctx->active_fps);
+    }
+    
+    /* 相机忙未能切换时保持原模式 */
+    if (err == GST_PLAYER_ERROR_BUSY) {
+        idle = ctx->mode == GST_PLAYER_MODE_IDLE;
+    } else {
+        ctx->mode = mode;
+    }
+    ctx->detect_paused = idle;
+    if (ctx->detect_valve) g_object_set(ctx->detect_valve, "drop", idle ? TRUE : FALSE, NULL);
+    
+    /* 空闲时不再检测，清除残留的人脸框 */
+    if (idle) {
+        gst_player_clear_face_boxes(handle);
+    }
+    
+    gst_player_error_t resume_err = player_resume(ctx, state);
+    if (err == GST_PLAYER_OK) err = resume_err;
+    
+    printf("[%s] 切换到%s模式 %dx%d@%dfps (%s)\n", MODULE_TAG, ctx->mode == GST_PLAYER_MODE_IDLE ? "空闲" : "正常",
+           ctx->width, ctx->height, ctx->fps, gst_player_get_error_string(err));
+    return err;
+}
+
+gst_player_mode_t gst_player_get_mode(gst_player_handle_t handle)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    return ctx ? ctx->mode : GST_PLAYER_MODE_ACTIVE;
+}
+
+gst_player_error_t gst_player_set_branch_enabled(gst_player_handle_t handle, gst_player_branch_t branch, bool enabled)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !ctx->pipeline || branch < 0 || branch >= PLAYER_BRANCH_COUNT) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    player_branch_t* b = &ctx->branches[branch];
+    bool detect = branch == GST_PLAYER_BRANCH_DETECT;
+    
+    /* 共享采集的检测帧不经过 GStreamer 分支，只切换回调 */
+    if (!b->bin) {
+        if (!detect || !ctx->shared_camera) return GST_PLAYER_ERROR_INVALID_PARAM;
+        ctx->detect_disabled = !enabled;
+        if (enabled) motion_gate_reset(ctx->motion_gate);
+        printf("[%s] 检测%s\n", MODULE_TAG, enabled ? "已开启" : "已关闭");
+        return GST_PLAYER_OK;
+    }
+    if (enabled == (b->tee_pad != NULL)) return GST_PLAYER_OK;
+    
+    if (enabled) {
+        if (detect) motion_gate_reset(ctx->motion_gate);
+        if (!branch_attach(ctx, b)) return GST_PLAYER_ERROR_PIPELINE_FAILED;
+        if (detect) ctx->detect_disabled = false;
+    } else {
+        if (detect) ctx->detect_disabled = true;
+        branch_detach(ctx, b);
+        if (branch == GST_PLAYER_BRANCH_RECORD) event_recorder_reset(ctx->recorder);
+    }
+    
+    printf("[%s] 分支 %s %s\n", MODULE_TAG, GST_ELEMENT_NAME(b->bin), enabled ? "已连接" : "已断开");
+    return GST_PLAYER_OK;
+}
+
+bool gst_player_is_branch_enabled(gst_player_handle_t handle, gst_player_branch_t branch)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || branch < 0 || branch >= PLAYER_BRANCH_COUNT) return false;
+    if (!ctx->branches[branch].bin) {
+        return branch == GST_PLAYER_BRANCH_DETECT && ctx->shared_camera && !ctx->detect_disabled;
+    }
+    return ctx->branches[branch].tee_pad != NULL;
+}
+
 bool gst_player_is_playing(gst_player_handle_t handle)
 {
     gst_player_context_t* ctx = (gst_player_context_t*)handle;
@@ -403,6 +2651,8 @@ const char* gst_player_get_error_string(gst_player_error_t error)
         case GST_PLAYER_ERROR_PIPELINE_FAILED: return "管道失败";
         case GST_PLAYER_ERROR_NO_DISPLAY: return "无显示";
         case GST_PLAYER_ERROR_WINDOW_INVALID: return "窗口无效";
+        case GST_PLAYER_ERROR_BUSY: return "帧未归还或录像进行中";
+        case GST_PLAYER_ERROR_NO_DATA: return "没有数据";
         default: return "未知错误";
     }
 }
@@ -416,9 +2666,94 @@ void gst_player_get_stats(gst_player_handle_t handle, float* fps, int* dropped_f
         return;
     }
     int64_t elapsed = get_time_us() - ctx->start_time;
-    if (fps && elapsed > 0)
-        *fps = (float)ctx->frame_count * 1000000.0f / elapsed;
-    if (dropped_frames) *dropped_frames = 0;
+    if (fps)
+        *fps = elapsed > 0 ? (float)ctx->frame_count * 1000000.0f / elapsed : 0;
+    if (dropped_frames)
+        *dropped_frames = (int)(atomic_load(&ctx->display_queue_drops) + display_sink_dropped(ctx));
+}
+
+gst_player_error_t gst_player_get_perf_stats(gst_player_handle_t handle, gst_player_perf_stats_t* stats)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !stats) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    memset(stats, 0, sizeof(*stats));
+    gst_player_get_stats(handle, &stats->fps, NULL);
+    stats->frames_displayed = (uint64_t)ctx->frame_count;
+    stats->frames_detected = atomic_load(&ctx->frames_detected);
+    stats->display_queue_drops = atomic_load(&ctx->display_queue_drops);
+    stats->detect_queue_drops = atomic_load(&ctx->detect_queue_drops);
+    stats->sink_dropped = display_sink_dropped(ctx);
+    stats->sequence_gaps = atomic_load(&ctx->sequence_gaps);
+    stats->frames_lost = atomic_load(&ctx->frames_lost);
+    stats->frames_gated = atomic_load(&ctx->frames_gated);
+    stats->first_frame_us = ctx->first_frame_us;
+    
+    event_recorder_stats_t rstats;
+    event_recorder_get_stats(ctx->recorder, &rstats);
+    stats->clips_recorded = rstats.clips_written;
+    stats->record_buffer_bytes = rstats.buffered_bytes;
+    latency_stats_summary(&ctx->lat_display, &stats->display_latency);
+    latency_stats_summary(&ctx->lat_interval, &stats->frame_interval);
+    latency_stats_summary(&ctx->lat_callback, &stats->callback);
+    
+    if (ctx->detect_qos) {
+        detect_qos_state_t qstate;
+        detect_qos_get_state(ctx->detect_qos, &qstate);
+        stats->detect_level = qstate.level;
+        stats->detect_fps = qstate.fps;
+        stats->detect_width = qstate.width;
+        stats->detect_height = qstate.height;
+        stats->cpu_percent = qstate.cpu_percent;
+        stats->detect_adjustments = qstate.adjustments;
+    } else {
+        stats->detect_fps = ctx->face_detect_fps;
+        stats->detect_width = ctx->face_detect_width;
+        stats->detect_height = ctx->face_detect_height;
+        stats->cpu_percent = -1;
+    }
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_get_thread_report(gst_player_handle_t handle, gst_player_thread_report_t* report)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !report) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    *report = ctx->memory_report;
+    report->streaming_threads = 0;
+    report->sched_applied = 0;
+    report->affinity_applied = 0;
+    memset(&report->last, 0, sizeof(report->last));
+    if (ctx->task_pool) player_task_pool_get_report(ctx->task_pool, report);
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_get_dispatch_stats(gst_player_handle_t handle, dispatcher_stats_t* stats)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !stats || !ctx->detect_dispatcher) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    dispatcher_get_stats(ctx->detect_dispatcher, stats);
+    return GST_PLAYER_OK;
+}
+
+/* 发布人脸框，timestamp_us 为检测帧的采集时刻 */
+static void face_boxes_set(gst_player_context_t* ctx, const gst_face_box_t* boxes, int count,
+                           int source_width, int source_height, int64_t timestamp_us)
+{
+    pthread_mutex_lock(&ctx->face_box_mutex);
+    if (boxes && count > 0) {
+        face_boxes_publish(ctx, boxes, count < ctx->max_face_boxes ? count : ctx->max_face_boxes,
+                           source_width > 0 ? source_width : ctx->face_detect_width,
+                           source_height > 0 ? source_height : ctx->face_detect_height, timestamp_us);
+    } else {
+        face_boxes_publish(ctx, NULL, 0, ctx->face_detect_width, ctx->face_detect_height, timestamp_us);
+    }
+    pthread_mutex_unlock(&ctx->face_box_mutex);
+    
+    /* 有人脸时保持交付检测帧，人站着不动也不会被运动门控挡住 */
+    if (boxes && count > 0) motion_gate_hold(ctx->motion_gate, get_time_us());
 }
 
 gst_player_error_t gst_player_set_face_boxes(gst_player_handle_t handle,
@@ -430,28 +2765,317 @@ gst_player_error_t gst_player_set_face_boxes(gst_player_handle_t handle,
     gst_player_context_t* ctx = (gst_player_context_t*)handle;
     if (!ctx) return GST_PLAYER_ERROR_INVALID_PARAM;
     
-    pthread_mutex_lock(&ctx->face_box_mutex);
+    face_boxes_set(ctx, boxes, count, source_width, source_height, get_time_us());
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_set_face_boxes_ex(gst_player_handle_t handle,
+                                                 const gst_face_box_t* boxes,
+                                                 int count,
+                                                 int source_width,
+                                                 int source_height,
+                                                 uint64_t frame_id)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx) return GST_PLAYER_ERROR_INVALID_PARAM;
     
-    if (boxes && count > 0) {
-        int n = count < MAX_FACE_BOXES ? count : MAX_FACE_BOXES;
-        memcpy(ctx->face_boxes, boxes, n * sizeof(gst_face_box_t));
-        ctx->face_box_count = n;
-        ctx->face_source_width = source_width > 0 ? source_width : ctx->face_detect_width;
-        ctx->face_source_height = source_height > 0 ? source_height : ctx->face_detect_height;
-    } else {
-        ctx->face_box_count = 0;
+    /* 检测耗时内人脸已经移动，外推从检测帧的采集时刻算起 */
+    gst_player_frame_info_t info;
+    int64_t timestamp_us = get_time_us();
+    if (frame_history_find_id(ctx, frame_id, &info) && info.capture_us > 0 && info.capture_us < timestamp_us) {
+        timestamp_us = info.capture_us;
     }
     
-    pthread_mutex_unlock(&ctx->face_box_mutex);
+    face_boxes_set(ctx, boxes, count, source_width, source_height, timestamp_us);
     return GST_PLAYER_OK;
 }
 
 void gst_player_clear_face_boxes(gst_player_handle_t handle)
+{
+    gst_player_set_face_boxes(handle, NULL, 0, 0, 0);
+}
+
+gst_player_error_t gst_player_set_face_crop_config(gst_player_handle_t handle, const gst_face_crop_config_t* config)
 {
     gst_player_context_t* ctx = (gst_player_context_t*)handle;
-    if (!ctx) return;
+    if (!ctx) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    pthread_mutex_lock(&ctx->face_crop_lock);
+    if (config) {
+        ctx->face_crop_config = *config;
+    } else {
+        memset(&ctx->face_crop_config, 0, sizeof(ctx->face_crop_config));
+    }
+    ctx->face_crop_dirty = true;
+    pthread_mutex_unlock(&ctx->face_crop_lock);
+    return GST_PLAYER_OK;
+}
+
+/* 持有 face_crop_lock：按当前配置准备裁剪器 */
+static face_crop_t* face_crop_prepare(gst_player_context_t* ctx)
+{
+    if (ctx->face_crop && !ctx->face_crop_dirty) return ctx->face_crop;
+    
+    face_crop_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.size = ctx->face_crop_config.size;
+    config.margin_percent = ctx->face_crop_config.margin_percent;
+    config.layout = ctx->face_crop_config.layout == GST_FACE_CROP_RGB_F32 ? FACE_CROP_LAYOUT_RGB_F32
+                                                                          : FACE_CROP_LAYOUT_BGR888;
+    memcpy(config.mean, ctx->face_crop_config.mean, sizeof(config.mean));
+    memcpy(config.std, ctx->face_crop_config.std, sizeof(config.std));
+    
+    face_crop_destroy(ctx->face_crop);
+    ctx->face_crop = face_crop_create(&config);
+    ctx->face_crop_dirty = false;
+    if (!ctx->face_crop) printf("[%s] 创建人脸裁剪器失败\n", MODULE_TAG);
+    return ctx->face_crop;
+}
+
+/* 最近发布的人脸框换算到 width x height 的帧坐标（左上角 + 尺寸），返回数量 */
+static int face_crop_boxes(gst_player_context_t* ctx, int width, int height, face_crop_rect_t* rects, float* scores)
+{
+    int count = 0;
     
+    /* 写入方都持有 face_box_mutex，持锁期间已发布的快照不会被改写 */
     pthread_mutex_lock(&ctx->face_box_mutex);
-    ctx->face_box_count = 0;
+    unsigned seq = atomic_load_explicit(&ctx->face_box_seq, memory_order_acquire);
+    const face_box_snapshot_t* snap = &ctx->face_snapshots[(seq >> 1) & 1];
+    if (snap->source_width > 0 && snap->source_height > 0) {
+        float sx = (float)width / snap->source_width;
+        float sy = (float)height / snap->source_height;
+        for (int i = 0; i < snap->count && count < FACE_CROP_MAX; i++) {
+            const gst_face_box_t* box = &snap->boxes[i];
+            rects[count].x = (box->center_x - box->width / 2) * sx;
+            rects[count].y = (box->center_y - box->height / 2) * sy;
+            rects[count].width = box->width * sx;
+            rects[count].height = box->height * sy;
+            scores[count] = box->score;
+            count++;
+        }
+    }
     pthread_mutex_unlock(&ctx->face_box_mutex);
+    return count;
+}
+
+/* 裁剪并填写输出数组 */
+static gst_player_error_t face_crop_frame(gst_player_context_t* ctx, const face_crop_source_t* src,
+                                          gst_face_crop_t* crops, int max_crops, int* count)
+{
+    face_crop_rect_t rects[FACE_CROP_MAX];
+    float scores[FACE_CROP_MAX];
+    face_crop_result_t results[FACE_CROP_MAX];
+    
+    *count = 0;
+    int n = face_crop_boxes(ctx, src->width, src->height, rects, scores);
+    if (n == 0) return GST_PLAYER_OK;
+    
+    pthread_mutex_lock(&ctx->face_crop_lock);
+    face_crop_t* crop = face_crop_prepare(ctx);
+    int produced = crop ? face_crop_run(crop, src, rects, n, results) : -1;
+    if (produced < 0) {
+        pthread_mutex_unlock(&ctx->face_crop_lock);
+        return crop ? GST_PLAYER_ERROR_INVALID_PARAM : GST_PLAYER_ERROR_INIT_FAILED;
+    }
+    
+    face_crop_config_t config;
+    face_crop_get_config(crop, &config);
+    if (max_crops > GST_PLAYER_MAX_FACE_CROPS) max_crops = GST_PLAYER_MAX_FACE_CROPS;
+    for (int i = 0; i < produced && i < max_crops; i++) {
+        const face_crop_result_t* r = &results[i];
+        gst_face_crop_t* out = &crops[i];
+        out->data = r->data;
+        out->size = r->size;
+        out->width = config.size;
+        out->height = config.size;
+        out->stride = r->stride;
+        out->box.center_x = r->region.x + r->region.width / 2;
+        out->box.center_y = r->region.y + r->region.height / 2;
+        out->box.width = r->region.width;
+        out->box.height = r->region.height;
+        out->box.score = scores[r->box_index];
+        (*count)++;
+    }
+    pthread_mutex_unlock(&ctx->face_crop_lock);
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_crop_faces(gst_player_handle_t handle, const gst_player_frame_t* frame,
+                                         gst_face_crop_t* crops, int max_crops, int* count)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !frame || !frame->data || !crops || max_crops <= 0 || !count) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    face_crop_source_t src;
+    memset(&src, 0, sizeof(src));
+    src.data = frame->data;
+    src.width = frame->width;
+    src.height = frame->height;
+    src.stride = frame->stride[0];
+    if (frame->format == GST_PLAYER_PIXEL_NV12) {
+        /* CPU 地址指向缓冲区起始，Y 平面不在起始处时按平面地址描述，只走 CPU 路径 */
+        src.format = FACE_CROP_SOURCE_NV12;
+        src.data = frame->data + frame->offset[0];
+        src.uv_offset = frame->offset[1] - frame->offset[0];
+        src.dmabuf_fd = frame->offset[0] == 0 && frame->stride[1] == frame->stride[0] ? frame->dmabuf_fd : -1;
+        src.color_space = YUV_BT601_FULL;   /* MJPEG 解码输出 */
+    } else {
+        src.format = FACE_CROP_SOURCE_BGRA;
+        src.data = frame->data + frame->offset[0];
+        src.dmabuf_fd = frame->offset[0] == 0 ? frame->dmabuf_fd : -1;
+    }
+    return face_crop_frame(ctx, &src, crops, max_crops, count);
+}
+
+gst_player_error_t gst_player_crop_faces_bgra(gst_player_handle_t handle, const uint8_t* data,
+                                              int width, int height, int stride,
+                                              gst_face_crop_t* crops, int max_crops, int* count)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !data || width <= 0 || height <= 0 || stride < width * 4 || !crops || max_crops <= 0 || !count) {
+        return GST_PLAYER_ERROR_INVALID_PARAM;
+    }
+    
+    face_crop_source_t src;
+    memset(&src, 0, sizeof(src));
+    src.format = FACE_CROP_SOURCE_BGRA;
+    src.data = data;
+    src.dmabuf_fd = -1;
+    src.width = width;
+    src.height = height;
+    src.stride = stride;
+    return face_crop_frame(ctx, &src, crops, max_crops, count);
+}
+
+gst_player_error_t gst_player_register_frame_buffers(gst_player_handle_t handle, void* const* buffers,
+                                                     int count, size_t buffer_size)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || count < 0 || count > GST_PLAYER_MAX_PULL_BUFFERS) return GST_PLAYER_ERROR_INVALID_PARAM;
+    if (count > 0 && (!buffers || buffer_size == 0)) return GST_PLAYER_ERROR_INVALID_PARAM;
+    for (int i = 0; i < count; i++) {
+        if (!buffers[i]) return GST_PLAYER_ERROR_INVALID_PARAM;
+    }
+    if (ctx->pull_fd < 0) return GST_PLAYER_ERROR_INIT_FAILED;
+    
+    /* 先停止保留新帧，拉取中的调用已取得的缓冲区地址在锁外使用，由调用方保证注销时没有拉取 */
+    atomic_store(&ctx->pull_enabled, false);
+    pthread_mutex_lock(&ctx->pull_lock);
+    for (int i = 0; i < GST_PLAYER_MAX_PULL_BUFFERS; i++) {
+        ctx->pull_buffers[i] = i < count ? buffers[i] : NULL;
+    }
+    ctx->pull_buffer_count = count;
+    ctx->pull_buffer_size = count > 0 ? buffer_size : 0;
+    pthread_mutex_unlock(&ctx->pull_lock);
+    pull_drop(ctx);
+    atomic_store(&ctx->pull_skipped, 0);
+    atomic_store(&ctx->pull_return_us, 0);
+    atomic_store(&ctx->pull_enabled, count > 0);
+    
+    if (count > 0) {
+        printf("[%s] 拉取模式已开启: %d 个缓冲区，每个 %zu 字节\n", MODULE_TAG, count, buffer_size);
+    } else {
+        printf("[%s] 拉取模式已关闭\n", MODULE_TAG);
+    }
+    return GST_PLAYER_OK;
+}
+
+gst_player_error_t gst_player_get_latest_frame_into(gst_player_handle_t handle, int slot,
+                                                    gst_player_pulled_frame_t* frame)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    uint64_t pending;
+    
+    if (!ctx || !frame) return GST_PLAYER_ERROR_INVALID_PARAM;
+    pull_account_consumer(ctx);
+    
+    /* 先清零通知再取帧：取帧之后保留的帧会重新置位，不会漏掉 */
+    if (ctx->pull_fd >= 0 && read(ctx->pull_fd, &pending, sizeof(pending)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[%s] 拉取通知读取失败: %s\n", MODULE_TAG, strerror(errno));
+    }
+    
+    pthread_mutex_lock(&ctx->pull_lock);
+    if (slot < 0 || slot >= ctx->pull_buffer_count) {
+        pthread_mutex_unlock(&ctx->pull_lock);
+        return GST_PLAYER_ERROR_INVALID_PARAM;
+    }
+    uint8_t* dst = (uint8_t*)ctx->pull_buffers[slot];
+    size_t capacity = ctx->pull_buffer_size;
+    held_frame_t* held = ctx->pull_latest;
+    ctx->pull_latest = NULL;
+    pthread_mutex_unlock(&ctx->pull_lock);
+    
+    if (!held) return GST_PLAYER_ERROR_NO_DATA;
+    
+    /* 复制在锁外进行，流线程同时保留的下一帧不用等待 */
+    const gst_player_frame_t* src = &held->frame;
+    bool nv12 = src->format == GST_PLAYER_PIXEL_NV12;
+    int row_bytes = nv12 ? src->width : src->width * 4;
+    int chroma_rows = nv12 ? (src->height + 1) / 2 : 0;
+    
+    frame->width = src->width;
+    frame->height = src->height;
+    frame->stride = row_bytes;
+    frame->format = src->format;
+    frame->size = (size_t)row_bytes * (src->height + chroma_rows);
+    frame->skipped = atomic_exchange(&ctx->pull_skipped, 0);
+    frame->info = src->info;
+    frame->info.deliver_us = get_time_us();
+    
+    gst_player_error_t err = GST_PLAYER_OK;
+    if (frame->size > capacity) {
+        err = GST_PLAYER_ERROR_INVALID_PARAM;
+    } else {
+        copy_plane(dst, row_bytes, src->data + src->offset[0], src->stride[0], row_bytes, src->height);
+        if (nv12) {
+            copy_plane(dst + (size_t)row_bytes * src->height, row_bytes, src->data + src->offset[1], src->stride[1],
+                       row_bytes, chroma_rows);
+        }
+    }
+    held_frame_free(held);
+    
+    if (err == GST_PLAYER_OK) {
+        atomic_fetch_add(&ctx->frames_detected, 1);
+        atomic_store(&ctx->pull_return_us, get_time_us());
+    }
+    return err;
+}
+
+int gst_player_get_frame_fd(gst_player_handle_t handle)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    return ctx ? ctx->pull_fd : -1;
+}
+
+gst_player_error_t gst_player_wait_frame(gst_player_handle_t handle, int timeout_ms)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || ctx->pull_fd < 0) return GST_PLAYER_ERROR_INVALID_PARAM;
+    pull_account_consumer(ctx);
+    
+    struct pollfd pfd = { .fd = ctx->pull_fd, .events = POLLIN };
+    return poll(&pfd, 1, timeout_ms) > 0 ? GST_PLAYER_OK : GST_PLAYER_ERROR_NO_DATA;
+}
+
+gst_player_error_t gst_player_record_event(gst_player_handle_t handle, const char* path, int pre_ms, int post_ms)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    if (!ctx || !ctx->recorder || !path || !path[0]) return GST_PLAYER_ERROR_INVALID_PARAM;
+    
+    switch (event_recorder_trigger(ctx->recorder, path, pre_ms, post_ms)) {
+        case EVENT_RECORDER_OK: return GST_PLAYER_OK;
+        case EVENT_RECORDER_BUSY: return GST_PLAYER_ERROR_BUSY;
+        case EVENT_RECORDER_NO_DATA: return GST_PLAYER_ERROR_NO_DATA;
+        default: return GST_PLAYER_ERROR_PIPELINE_FAILED;
+    }
+}
+
+bool gst_player_is_recording(gst_player_handle_t handle)
+{
+    gst_player_context_t* ctx = (gst_player_context_t*)handle;
+    event_recorder_stats_t stats;
+    
+    if (!ctx || !ctx->recorder) return false;
+    event_recorder_get_stats(ctx->recorder, &stats);
+    return stats.writing;
 }
@@ -14,7 +14,8 @@
  *    ↓
  *   tee
  *    ├── glimagesink (渲染到 X11 窗口)
- *    └── appsink (人脸识别)
+ *    ├── appsink (人脸识别)
+ *    └── mpph264enc → 预录缓冲 → MP4 (事件录像，可选)
  */
 
 #ifndef GST_VIDEO_PLAYER_H
@@ -23,6 +24,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "v4l2_mpp_camera.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -39,6 +42,42 @@ typedef void* gst_player_handle_t;
  */
 typedef void (*gst_frame_callback_t)(void* user_data, uint8_t* data, int width, int height, int stride);
 
+/* 检测帧的来源和时间（时间均为 CLOCK_MONOTONIC 微秒，0 表示未知） */
+typedef struct {
+    uint64_t frame_id;            /* 帧号：V4L2 buf.sequence（共享采集为相机帧序号），传回 gst_player_set_face_boxes_ex */
+    int64_t capture_us;           /* 采集时刻（驱动时间戳） */
+    int64_t decode_us;            /* 解码完成时刻 */
+    int64_t deliver_us;           /* 交给回调的时刻 */
+} gst_player_frame_info_t;
+
+/* 带时间信息的帧回调函数类型，参数同 gst_frame_callback_t */
+typedef void (*gst_frame_info_callback_t)(void* user_data, uint8_t* data, int width, int height, int stride,
+                                          const gst_player_frame_info_t* info);
+
+/* 检测帧像素格式 */
+typedef enum {
+    GST_PLAYER_PIXEL_BGRA = 0,    /* 兼容 gst_frame_callback_t */
+    GST_PLAYER_PIXEL_NV12 = 1,    /* 省去 BGRA 转换，只能通过 gst_frame_ex_callback_t 获取 */
+} gst_player_pixel_format_t;
+
+/* 检测帧（零拷贝，必须用 gst_player_release_frame 归还，可在回调返回后继续持有） */
+typedef struct {
+    uint8_t* data;                /* CPU 映射地址（缓冲区起始） */
+    int dmabuf_fd;                /* dmabuf fd，-1 表示不是 dmabuf；归播放器所有，不要关闭 */
+    size_t size;                  /* 缓冲区字节数 */
+    int width;
+    int height;
+    gst_player_pixel_format_t format;
+    int n_planes;                 /* BGRA 为 1，NV12 为 2 */
+    size_t offset[2];             /* 各平面相对 data / dmabuf 起始的偏移 */
+    int stride[2];                /* 各平面行字节数 */
+    void* priv;                   /* 内部使用 */
+    gst_player_frame_info_t info; /* 帧号和时间 */
+} gst_player_frame_t;
+
+/* 零拷贝帧回调函数类型 - frame 在 gst_player_release_frame 之前一直有效 */
+typedef void (*gst_frame_ex_callback_t)(void* user_data, gst_player_frame_t* frame);
+
 /* 错误码 */
 typedef enum {
     GST_PLAYER_OK = 0,
@@ -48,6 +87,8 @@ typedef enum {
     GST_PLAYER_ERROR_PIPELINE_FAILED = -4,
     GST_PLAYER_ERROR_NO_DISPLAY = -5,
     GST_PLAYER_ERROR_WINDOW_INVALID = -6,
+    GST_PLAYER_ERROR_BUSY = -7,           /* 仍有帧未归还，不能切换格式；上一个录像片段还在写 */
+    GST_PLAYER_ERROR_NO_DATA = -8,        /* 预录缓冲中还没有码流 */
 } gst_player_error_t;
 
 /* 视频格式 */
@@ -57,6 +98,32 @@ typedef enum {
     GST_PLAYER_FORMAT_NV12 = 2,   /* NV12 格式 */
 } gst_player_format_t;
 
+/* 显示路径 */
+typedef enum {
+    GST_PLAYER_DISPLAY_AUTO = 0,  /* 有 glimagesink 时使用 GL，否则回退 cairooverlay */
+    GST_PLAYER_DISPLAY_CAIRO = 1, /* 软件路径：videoconvert ! cairooverlay ! videoconvert ! xvimagesink */
+    GST_PLAYER_DISPLAY_GL = 2,    /* 硬件路径：解码输出直接送 glimagesink，人脸框由 GPU 合成 */
+} gst_player_display_mode_t;
+
+/* 工作模式 */
+typedef enum {
+    GST_PLAYER_MODE_ACTIVE = 0,   /* 正常模式：配置（或 gst_player_reconfigure 设置）的分辨率/帧率，检测开启 */
+    GST_PLAYER_MODE_IDLE = 1,     /* 低功耗空闲模式：低分辨率/低帧率，检测分支暂停 */
+} gst_player_mode_t;
+
+/* 管道分支（tee 之后，可在运行中断开/重新连接） */
+typedef enum {
+    GST_PLAYER_BRANCH_DISPLAY = 0, /* 显示分支 */
+    GST_PLAYER_BRANCH_DETECT = 1,  /* 检测分支（共享采集直接使用相机检测流时只是开关帧回调） */
+    GST_PLAYER_BRANCH_RECORD = 2,  /* 录像分支（record_pre_ms > 0 时创建），断开时丢弃预录缓冲 */
+} gst_player_branch_t;
+
+/* 录像编码格式 */
+typedef enum {
+    GST_PLAYER_RECORD_H264 = 0,   /* mpph264enc */
+    GST_PLAYER_RECORD_H265 = 1,   /* mpph265enc */
+} gst_player_record_codec_t;
+
 /* 播放器配置 */
 typedef struct {
     const char* device;           /* 设备路径，如 /dev/video12 */
@@ -69,10 +136,58 @@ typedef struct {
     int face_detect_fps;          /* 人脸检测帧率（0 表示不需要 appsink） */
     int face_detect_width;        /* 人脸检测缩放宽度（0 表示使用原始尺寸） */
     int face_detect_height;       /* 人脸检测缩放高度 */
+    gst_player_display_mode_t display_mode; /* 显示路径（0 表示自动） */
+    
+    /* 共享采集：非 NULL 时不打开 device，由该相机的 MPP 解码输出（dmabuf）经 appsrc 送显示分支。
+     * 相机配置了检测流（建议 BGRA、face_detect 尺寸）时帧回调直接读取检测流，不再经过 GStreamer 缩放。
+     * 相机由调用方创建和启动；销毁播放器前应先 camera_stop。
+     * 多路相机（每路一个播放器）时各相机加入同一 camera_group_t，解码缓冲区和 RGA 按相机优先级共享。 */
+    camera_handle_t shared_camera;
+    
+    gst_player_pixel_format_t face_detect_format; /* 检测帧格式（NV12 时共享采集直接交付全分辨率解码帧） */
+    
+    /* 检测回调工作线程：>0 时帧回调在原生线程池中执行，流线程只投递最新帧 */
+    int detect_workers;           /* 工作线程数（0 表示在流线程中直接回调） */
+    uint32_t detect_cpu_mask;     /* 工作线程绑定的 CPU 核心位掩码（0 表示不绑定） */
+    
+    /* 低功耗空闲模式（gst_player_set_mode 切换），0 表示默认 320x240@5fps；共享采集时使用相机配置的空闲格式 */
+    int idle_width;
+    int idle_height;
+    int idle_fps;
+    
+    /* 运动门控：画面静止时检测分支不交付帧（每 motion_heartbeat_ms 仍交付一帧），以下阈值 0 表示默认值 */
+    bool motion_gate;             /* 是否启用 */
+    int motion_threshold;         /* 格子亮度均值变化阈值（默认 12） */
+    int motion_area_permille;     /* 变化格子占比阈值，千分比（默认 20） */
+    int motion_heartbeat_ms;      /* 静止时的交付间隔（默认 1000，<0 表示静止时不交付） */
+    int motion_hold_ms;           /* 运动或检测到人脸后持续交付的时间（默认 1500） */
+    
+    /* 人脸框叠加 */
+    int max_face_boxes;           /* 最多显示的人脸框数（0 表示默认 10，上限 256） */
+    int face_box_predict_ms;      /* 两次检测之间按人脸框运动速度外推的最长时间（0 表示不外推，建议为检测间隔的 1~2 倍） */
+    
+    /* 事件录像：解码帧由 MPP 硬件编码，码流在内存中保留最近 record_pre_ms，gst_player_record_event 写出 MP4 */
+    int record_pre_ms;            /* 预录时长（0 表示不创建录像分支，建议 5000） */
+    gst_player_record_codec_t record_codec; /* 编码格式 */
+    int record_bitrate_kbps;      /* 码率（0 表示默认 2000），预录缓冲上限按码率估算 */
+    
+    /* 流线程调度：配置了 RT 策略或 CPU 掩码时，管道的流线程从自定义 GstTaskPool 创建并按此设置，
+     * 实际结果用 gst_player_get_thread_report 查询（共享采集的相机线程见 camera_config_t） */
+    camera_thread_config_t streaming_thread;
+    bool lock_memory;             /* mlock 播放器上下文和人脸框缓冲区（受 RLIMIT_MEMLOCK 限制） */
+    
+    /* 检测自适应：按回调执行时间、检测丢帧和系统 CPU 占用在上下限之间调整检测帧率和缩放尺寸，
+     * face_detect_fps / face_detect_width / face_detect_height 为上限，当前工作点见 gst_player_get_perf_stats。
+     * 共享采集的检测帧尺寸由相机决定，只调整帧率 */
+    bool adaptive_detect;         /* 是否启用 */
+    int detect_min_fps;           /* 帧率下限（0 表示默认 2） */
+    int detect_min_width;         /* 宽度下限，高度按比例（0 表示上限的一半） */
+    int detect_budget_ms;         /* 回调执行时间预算，超出时降档（0 表示默认 300） */
 } gst_player_config_t;
 
 /**
- * 初始化 GStreamer（全局，只需调用一次）
+ * 初始化 GStreamer（全局，只需调用一次，可在多个线程中同时调用）
+ * 已有注册表缓存时跳过插件扫描，并预先加载管道用到的插件；建议在应用启动时于后台线程调用
  * @return 错误码
  */
 gst_player_error_t gst_player_global_init(void);
@@ -91,7 +206,7 @@ gst_player_handle_t gst_player_create(const gst_player_config_t* config);
 void gst_player_destroy(gst_player_handle_t handle);
 
 /**
- * 设置 X11 窗口句柄（必须在 start 之前调用）
+ * 设置 X11 窗口句柄（必须在 start 之前调用，可以在 gst_player_preroll 之后）
  * @param handle 播放器句柄
  * @param x11_window_id X11 窗口 ID
  * @return 错误码
@@ -109,6 +224,46 @@ gst_player_error_t gst_player_set_frame_callback(gst_player_handle_t handle,
                                                    gst_frame_callback_t callback,
                                                    void* user_data);
 
+/**
+ * 设置带时间信息的帧回调（替代 gst_player_set_frame_callback 设置的回调，可选）
+ * @param handle 播放器句柄
+ * @param callback 回调函数，NULL 表示取消
+ * @param user_data 用户数据
+ * @return 错误码
+ */
+gst_player_error_t gst_player_set_frame_info_callback(gst_player_handle_t handle,
+                                                        gst_frame_info_callback_t callback,
+                                                        void* user_data);
+
+/**
+ * 设置零拷贝帧回调（NV12/dmabuf，附平面偏移和行字节数，可选）
+ * 未及时归还的帧超过 GST_PLAYER_MAX_HELD_FRAMES 时新帧被丢弃
+ * @param handle 播放器句柄
+ * @param callback 回调函数，NULL 表示取消
+ * @param user_data 用户数据
+ * @return 错误码
+ */
+gst_player_error_t gst_player_set_frame_callback_ex(gst_player_handle_t handle,
+                                                      gst_frame_ex_callback_t callback,
+                                                      void* user_data);
+
+/**
+ * 归还零拷贝帧（可在任意线程调用，必须在 gst_player_destroy 之前归还）
+ * @param frame 回调收到的帧
+ */
+void gst_player_release_frame(gst_player_frame_t* frame);
+
+/* 同时持有的最大零拷贝帧数 */
+#define GST_PLAYER_MAX_HELD_FRAMES 2
+
+/**
+ * 获取检测回调分发统计（每个工作线程的占用率、邮箱丢帧数）
+ * @param handle 播放器句柄
+ * @param stats 输出统计
+ * @return 错误码，未启用检测工作线程时返回 GST_PLAYER_ERROR_INVALID_PARAM
+ */
+gst_player_error_t gst_player_get_dispatch_stats(gst_player_handle_t handle, dispatcher_stats_t* stats);
+
 /**
  * 启动播放
  * @param handle 播放器句柄
@@ -116,6 +271,15 @@ gst_player_error_t gst_player_set_frame_callback(gst_player_handle_t handle,
  */
 gst_player_error_t gst_player_start(gst_player_handle_t handle);
 
+/**
+ * 预启动：管道切换到 PAUSED（打开设备、协商源格式、分配缓冲区、初始化解码器和 GL 上下文），
+ * 之后的 gst_player_start 只需进入 PLAYING。阻塞到状态切换完成，应在后台线程调用。
+ * 预启动后 gst_player_stop 回到 PAUSED（设备保持打开），需要释放摄像头时调用 gst_player_destroy。
+ * @param handle 播放器句柄
+ * @return 错误码
+ */
+gst_player_error_t gst_player_preroll(gst_player_handle_t handle);
+
 /**
  * 停止播放
  * @param handle 播放器句柄
@@ -123,6 +287,52 @@ gst_player_error_t gst_player_start(gst_player_handle_t handle);
  */
 gst_player_error_t gst_player_stop(gst_player_handle_t handle);
 
+/**
+ * 运行中修改正常模式的分辨率/帧率，不重建管道
+ * 管道退回 READY（元素、X11 窗口和 GL 上下文保留），修改源 caps 后重新协商并恢复播放；
+ * 共享采集时改为调用 camera_reconfigure。空闲模式下只记录，切回正常模式时生效。
+ * 不能在帧回调中调用；零拷贝帧需先全部归还。
+ * @param handle 播放器句柄
+ * @param width 分辨率宽度
+ * @param height 分辨率高度
+ * @param fps 帧率
+ * @return 错误码，GST_PLAYER_ERROR_BUSY 表示仍有帧未归还（格式未改变）
+ */
+gst_player_error_t gst_player_reconfigure(gst_player_handle_t handle, int width, int height, int fps);
+
+/**
+ * 切换正常/低功耗空闲模式（空闲时降低采集分辨率和帧率，检测分支丢弃所有帧并清除人脸框）
+ * 限制与返回值同 gst_player_reconfigure
+ * @param handle 播放器句柄
+ * @param mode 工作模式
+ */
+gst_player_error_t gst_player_set_mode(gst_player_handle_t handle, gst_player_mode_t mode);
+
+/**
+ * 获取当前工作模式
+ * @param handle 播放器句柄
+ * @return 工作模式，句柄无效时返回 GST_PLAYER_MODE_ACTIVE
+ */
+gst_player_mode_t gst_player_get_mode(gst_player_handle_t handle);
+
+/**
+ * 连接或断开管道分支，断开的分支移出管道（不再占用线程、缓冲区和 CPU），重新连接后自动协商
+ * 播放中也可调用；与 start/stop/set_mode 在同一线程中调用
+ * @param handle 播放器句柄
+ * @param branch 分支
+ * @param enabled true 连接，false 断开
+ * @return 错误码，分支不存在时返回 GST_PLAYER_ERROR_INVALID_PARAM
+ */
+gst_player_error_t gst_player_set_branch_enabled(gst_player_handle_t handle, gst_player_branch_t branch, bool enabled);
+
+/**
+ * 检查分支是否已连接
+ * @param handle 播放器句柄
+ * @param branch 分支
+ * @return true 已连接，false 已断开或不存在
+ */
+bool gst_player_is_branch_enabled(gst_player_handle_t handle, gst_player_branch_t branch);
+
 /**
  * 检查是否正在播放
  * @param handle 播放器句柄
@@ -141,10 +351,62 @@ const char* gst_player_get_error_string(gst_player_error_t error);
  * 获取性能统计信息
  * @param handle 播放器句柄
  * @param fps 输出当前帧率
- * @param dropped_frames 输出丢帧数
+ * @param dropped_frames 输出显示分支丢帧数（队列丢弃 + sink QoS 丢弃）
  */
 void gst_player_get_stats(gst_player_handle_t handle, float* fps, int* dropped_frames);
 
+/* 播放器详细性能统计（自 gst_player_start 起累计，延迟单位微秒） */
+typedef struct {
+    float fps;                          /* 显示帧率 */
+    uint64_t frames_displayed;          /* 送达显示 sink 的帧数 */
+    uint64_t frames_detected;           /* 交给帧回调或被拉取的检测帧数 */
+    uint64_t display_queue_drops;       /* 显示分支 leaky 队列丢弃（共享模式含显示在途已满丢弃） */
+    uint64_t detect_queue_drops;        /* 检测分支 leaky 队列丢弃 */
+    uint64_t sink_dropped;              /* 显示 sink QoS 丢弃的迟到帧 */
+    uint64_t sequence_gaps;             /* v4l2src 帧序号不连续的次数（共享模式见 camera_get_stats） */
+    uint64_t frames_lost;               /* 序号缺口累计的驱动侧丢帧数 */
+    latency_summary_t display_latency;  /* 采集时间戳 -> 送达显示 sink */
+    latency_summary_t frame_interval;   /* 相邻两帧送显间隔 */
+    latency_summary_t callback;         /* 帧回调执行时间（拉取模式为两次拉取之间扣除等待的处理时间） */
+    uint64_t frames_gated;              /* 运动门控判定为静止而未交付的检测帧 */
+    int64_t first_frame_us;             /* gst_player_start 到首帧送达显示 sink，0 表示尚无帧 */
+    uint64_t clips_recorded;            /* 已写完的事件录像片段数 */
+    uint64_t record_buffer_bytes;       /* 预录缓冲当前字节数 */
+    int detect_level;                   /* 检测自适应当前档位（0 为上限，未启用时为 0） */
+    int detect_fps;                     /* 当前检测帧率 */
+    int detect_width;                   /* 当前检测尺寸 */
+    int detect_height;
+    int cpu_percent;                    /* 检测自适应最近一个周期的系统 CPU 占用，-1 表示未知或未启用 */
+    uint64_t detect_adjustments;        /* 检测档位调整次数 */
+} gst_player_perf_stats_t;
+
+/**
+ * 获取详细性能统计（可在任意线程轮询）
+ * @param handle 播放器句柄
+ * @param stats 输出统计
+ * @return 错误码
+ */
+gst_player_error_t gst_player_get_perf_stats(gst_player_handle_t handle, gst_player_perf_stats_t* stats);
+
+/* 流线程调度和内存锁定的实际状态 */
+typedef struct {
+    int streaming_threads;              /* 从任务池创建的流线程数（未配置 streaming_thread 时为 0） */
+    int sched_applied;                  /* 其中策略和优先级生效的线程数 */
+    int affinity_applied;               /* 其中亲和性生效的线程数 */
+    camera_thread_status_t last;        /* 最近创建的流线程的实际设置 */
+    bool lock_requested;                /* 配置了 lock_memory */
+    bool memory_locked;                 /* 全部锁定成功 */
+    size_t locked_bytes;                /* 已锁定的字节数 */
+} gst_player_thread_report_t;
+
+/**
+ * 获取流线程调度和内存锁定的实际状态（流线程在管道进入 PAUSED 时创建）
+ * @param handle 播放器句柄
+ * @param report 输出
+ * @return 错误码
+ */
+gst_player_error_t gst_player_get_thread_report(gst_player_handle_t handle, gst_player_thread_report_t* report);
+
 /* 人脸框信息 */
 typedef struct {
     float center_x;     /* 中心点 X 坐标（像素） */
@@ -155,7 +417,8 @@ typedef struct {
 } gst_face_box_t;
 
 /**
- * 设置人脸框（用于视频叠加绘制）
+ * 设置人脸框（用于视频叠加绘制，启用运动门控时有人脸会重新开始保持期）
+ * 可在任意线程调用，不会阻塞显示线程；超过 max_face_boxes 的部分被忽略
  * @param handle 播放器句柄
  * @param boxes 人脸框数组
  * @param count 人脸框数量
@@ -169,12 +432,148 @@ gst_player_error_t gst_player_set_face_boxes(gst_player_handle_t handle,
                                               int source_width,
                                               int source_height);
 
+/**
+ * 设置人脸框，并指明检测所用的帧（外推以该帧的采集时刻为起点，补偿检测耗时）
+ * @param frame_id 检测帧的 gst_player_frame_info_t.frame_id，帧已不在历史中时按当前时刻计
+ * 其余参数同 gst_player_set_face_boxes
+ */
+gst_player_error_t gst_player_set_face_boxes_ex(gst_player_handle_t handle,
+                                                 const gst_face_box_t* boxes,
+                                                 int count,
+                                                 int source_width,
+                                                 int source_height,
+                                                 uint64_t frame_id);
+
 /**
  * 清除人脸框
  * @param handle 播放器句柄
  */
 void gst_player_clear_face_boxes(gst_player_handle_t handle);
 
+/* 人脸裁剪图布局 */
+typedef enum {
+    GST_FACE_CROP_BGR = 0,        /* uint8 BGR 交织（OpenCV Mat / 百度 SDK 输入），行字节数 size * 3 */
+    GST_FACE_CROP_RGB_F32 = 1,    /* float RGB 平面（CHW），(v - mean) / std */
+} gst_face_crop_layout_t;
+
+/* 人脸裁剪配置，0 表示使用默认值 */
+typedef struct {
+    int size;                     /* 输出边长（默认 112） */
+    int margin_percent;           /* 正方形边长 = 人脸框长边 * (100 + margin) / 100（默认 40） */
+    gst_face_crop_layout_t layout;
+    float mean[3];                /* RGB_F32 的 R/G/B 均值和标准差，std 全为 0 时使用 127.5 / 128 */
+    float std[3];
+} gst_face_crop_config_t;
+
+/* 一张人脸裁剪图（播放器持有，下一次裁剪前有效） */
+typedef struct {
+    const void* data;
+    size_t size;                  /* 字节数 */
+    int width;                    /* 等于 size */
+    int height;
+    int stride;                   /* 行字节数 */
+    gst_face_box_t box;           /* 实际裁剪的区域（帧像素，中心 + 尺寸），score 为人脸框置信度 */
+} gst_face_crop_t;
+
+/* 一次最多裁剪的人脸数 */
+#define GST_PLAYER_MAX_FACE_CROPS 8
+
+/**
+ * 设置人脸裁剪配置（下一次裁剪时生效）
+ * @param config 配置，NULL 表示恢复默认值
+ */
+gst_player_error_t gst_player_set_face_crop_config(gst_player_handle_t handle, const gst_face_crop_config_t* config);
+
+/**
+ * 按最近一次设置的人脸框裁出对齐的固定尺寸人脸图，识别只需处理小图
+ * 人脸框按其 source_width/height 换算到帧尺寸；NV12 dmabuf 帧由 RGA 完成裁剪 + 缩放 + 转换，其余走 CPU
+ * 裁剪图由播放器持有，下一次调用 gst_player_crop_faces / gst_player_crop_faces_bgra 前有效
+ * @param frame 零拷贝帧（gst_frame_ex_callback_t 交付，尚未归还）
+ * @param crops 输出数组
+ * @param max_crops 数组长度（超过 GST_PLAYER_MAX_FACE_CROPS 的部分不使用）
+ * @param count 输出裁剪图数量（没有人脸框时为 0）
+ * @return 错误码
+ */
+gst_player_error_t gst_player_crop_faces(gst_player_handle_t handle, const gst_player_frame_t* frame,
+                                         gst_face_crop_t* crops, int max_crops, int* count);
+
+/**
+ * 同 gst_player_crop_faces，源为 BGRA 帧回调交付的数据（只走 CPU 路径，需在回调返回前调用）
+ */
+gst_player_error_t gst_player_crop_faces_bgra(gst_player_handle_t handle, const uint8_t* data,
+                                              int width, int height, int stride,
+                                              gst_face_crop_t* crops, int max_crops, int* count);
+
+/* 拉取模式最多注册的缓冲区数 */
+#define GST_PLAYER_MAX_PULL_BUFFERS 4
+
+/* 拉取到的检测帧（像素已复制到调用方注册的缓冲区，行间无填充） */
+typedef struct {
+    int width;
+    int height;
+    int stride;                   /* 行字节数：BGRA 为 width * 4，NV12 为 width（UV 平面紧跟 Y 平面） */
+    gst_player_pixel_format_t format;
+    size_t size;                  /* 帧字节数，大于缓冲区时只填写本结构，不复制像素 */
+    unsigned int skipped;         /* 上次拉取以来未被拉取就被替换的帧数 */
+    gst_player_frame_info_t info; /* 帧号和时间，deliver_us 为拉取时刻 */
+} gst_player_pulled_frame_t;
+
+/**
+ * 注册拉取模式的帧缓冲区（托管端固定的数组、pinned 内存或共享映射），注册后检测帧只保留最新一帧，
+ * 由消费者按自己的节奏拉取，不再需要每帧回调；可与帧回调同时使用
+ * 缓冲区由调用方持有，注销（count 为 0）或 gst_player_destroy 之前必须一直有效
+ * @param buffers 缓冲区地址数组
+ * @param count 缓冲区数量（不超过 GST_PLAYER_MAX_PULL_BUFFERS），0 表示注销并关闭拉取模式
+ * @param buffer_size 每个缓冲区的字节数（BGRA 检测帧至少 face_detect_width * face_detect_height * 4）
+ * @return 错误码，无法创建通知 fd 时返回 GST_PLAYER_ERROR_INIT_FAILED
+ */
+gst_player_error_t gst_player_register_frame_buffers(gst_player_handle_t handle, void* const* buffers,
+                                                     int count, size_t buffer_size);
+
+/**
+ * 把最新的检测帧复制到注册的第 slot 个缓冲区，每帧只能拉取一次（可在任意线程调用，不要并发拉取同一缓冲区）
+ * 从拉取返回到下一次调用本函数或 gst_player_wait_frame 的时间记为该帧的处理时间（计入 callback 统计和检测自适应），
+ * 处理完一帧后应立即回来等待；用 gst_player_get_frame_fd 自行 poll 时等待时间也会计入
+ * @param slot 缓冲区序号
+ * @param frame 输出帧信息
+ * @return 错误码，上次拉取以来没有新帧时返回 GST_PLAYER_ERROR_NO_DATA，
+ *         帧大于缓冲区时返回 GST_PLAYER_ERROR_INVALID_PARAM（frame 已填写，本帧被丢弃）
+ */
+gst_player_error_t gst_player_get_latest_frame_into(gst_player_handle_t handle, int slot,
+                                                    gst_player_pulled_frame_t* frame);
+
+/**
+ * 获取新帧通知 fd（eventfd，有未拉取的帧时可读），可加入调用方的 poll/epoll；fd 归播放器所有，不要读写或关闭
+ * @return fd，失败返回 -1
+ */
+int gst_player_get_frame_fd(gst_player_handle_t handle);
+
+/**
+ * 等待新的检测帧
+ * @param timeout_ms 超时（毫秒），-1 表示一直等待
+ * @return 有新帧返回 GST_PLAYER_OK，超时或被信号中断返回 GST_PLAYER_ERROR_NO_DATA
+ */
+gst_player_error_t gst_player_wait_frame(gst_player_handle_t handle, int timeout_ms);
+
+/**
+ * 触发事件录像：写出事件前 pre_ms 到事件后 post_ms 的 MP4 片段（不重新编码），立即返回
+ * 预录缓冲从关键帧开始，实际的事件前时长向前取整到 GOP（1 秒）
+ * @param handle 播放器句柄
+ * @param path 输出文件路径
+ * @param pre_ms 事件前时长（不超过 record_pre_ms）
+ * @param post_ms 事件后时长
+ * @return 错误码，未创建录像分支时返回 GST_PLAYER_ERROR_INVALID_PARAM，
+ *         上一个片段还在写时返回 GST_PLAYER_ERROR_BUSY，缓冲中还没有码流时返回 GST_PLAYER_ERROR_NO_DATA
+ */
+gst_player_error_t gst_player_record_event(gst_player_handle_t handle, const char* path, int pre_ms, int post_ms);
+
+/**
+ * 是否正在写事件录像片段
+ * @param handle 播放器句柄
+ * @return true 正在写
+ */
+bool gst_player_is_recording(gst_player_handle_t handle);
+
 #ifdef __cplusplus
 }
 #endif
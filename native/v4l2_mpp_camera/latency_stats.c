@@ -0,0 +1,77 @@
+/*
+ * 延迟统计实现
+ *
+ * 采样路径只更新累计值和环形窗口，排序求 p95 放在读取端（轮询频率远低于帧率）。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency_stats.h"
+
+void latency_stats_init(latency_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_init(&stats->lock, NULL);
+}
+
+void latency_stats_destroy(latency_stats_t* stats)
+{
+    pthread_mutex_destroy(&stats->lock);
+}
+
+void latency_stats_reset(latency_stats_t* stats)
+{
+    pthread_mutex_lock(&stats->lock);
+    stats->count = 0;
+    stats->sum_us = 0;
+    stats->min_us = 0;
+    stats->max_us = 0;
+    stats->window_pos = 0;
+    pthread_mutex_unlock(&stats->lock);
+}
+
+void latency_stats_record(latency_stats_t* stats, long us)
+{
+    uint32_t v = us < 0 ? 0 : (us > (long)UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+    
+    pthread_mutex_lock(&stats->lock);
+    if (stats->count == 0 || v < stats->min_us) stats->min_us = v;
+    if (v > stats->max_us) stats->max_us = v;
+    stats->count++;
+    stats->sum_us += v;
+    stats->window[stats->window_pos] = v;
+    stats->window_pos = (stats->window_pos + 1) % LATENCY_STATS_WINDOW;
+    pthread_mutex_unlock(&stats->lock);
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : (x > y);
+}
+
+void latency_stats_summary(latency_stats_t* stats, latency_summary_t* summary)
+{
+    uint32_t sorted[LATENCY_STATS_WINDOW];
+    int n;
+    
+    memset(summary, 0, sizeof(*summary));
+    
+    pthread_mutex_lock(&stats->lock);
+    summary->count = stats->count;
+    if (stats->count > 0) {
+        summary->min_us = stats->min_us;
+        summary->max_us = stats->max_us;
+        summary->avg_us = (uint32_t)(stats->sum_us / stats->count);
+    }
+    n = stats->count < LATENCY_STATS_WINDOW ? (int)stats->count : LATENCY_STATS_WINDOW;
+    memcpy(sorted, stats->window, n * sizeof(uint32_t));
+    pthread_mutex_unlock(&stats->lock);
+    
+    if (n > 0) {
+        qsort(sorted, n, sizeof(uint32_t), compare_u32);
+        summary->p95_us = sorted[(n * 95 + 99) / 100 - 1];
+    }
+}
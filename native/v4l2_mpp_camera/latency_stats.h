@@ -0,0 +1,58 @@
+/*
+ * 延迟统计 - 每个句柄独立的 min/avg/p95/max
+ *
+ * 1. 累计值（次数、总和、最小、最大）覆盖整个统计周期
+ * 2. p95 取自最近 LATENCY_STATS_WINDOW 个样本，反映当前状态
+ * 3. 记录只需一次无竞争加锁，可在采集/输出/回调线程中调用，读取可在任意线程
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* p95 统计窗口样本数 */
+#define LATENCY_STATS_WINDOW 256
+
+/* 延迟摘要（微秒） */
+typedef struct {
+    uint64_t count;             /* 样本数 */
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t p95_us;            /* 最近 LATENCY_STATS_WINDOW 个样本的 95 分位 */
+    uint32_t max_us;
+} latency_summary_t;
+
+/* 延迟统计器（嵌入在句柄上下文中，字段不应直接访问） */
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t count;
+    uint64_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t window[LATENCY_STATS_WINDOW];
+    int window_pos;
+} latency_stats_t;
+
+void latency_stats_init(latency_stats_t* stats);
+void latency_stats_destroy(latency_stats_t* stats);
+
+/* 清零（统计周期重新开始） */
+void latency_stats_reset(latency_stats_t* stats);
+
+/* 记录一个样本，负值按 0 计 */
+void latency_stats_record(latency_stats_t* stats, long us);
+
+/* 获取摘要，无样本时全部为 0 */
+void latency_stats_summary(latency_stats_t* stats, latency_summary_t* summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_STATS_H */
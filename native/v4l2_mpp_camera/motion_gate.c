@@ -0,0 +1,245 @@
+/*
+ * 运动门控实现
+ *
+ * 每格最多采样 MOTION_GATE_ROWS_PER_CELL 行，1080p 每帧只读约 1/5 的 Y 平面，
+ * 格子均值以 1/16 亮度级定点保存。参考帧和当前帧网格只在检查线程中访问，
+ * 复位请求、保持期截止时间和统计为原子变量，可从其他线程读写。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "motion_gate.h"
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define USE_NEON 1
+#endif
+
+#define DEFAULT_GRID_WIDTH 32
+#define DEFAULT_GRID_HEIGHT 24
+#define DEFAULT_PIXEL_THRESHOLD 12
+#define DEFAULT_AREA_PERMILLE 20
+#define DEFAULT_HEARTBEAT_MS 1000
+#define DEFAULT_HOLD_MS 1500
+#define MOTION_GATE_ROWS_PER_CELL 8     /* 每格采样的最大行数 */
+#define MOTION_GATE_FRAC_BITS 4         /* 格子均值的小数位 */
+
+struct motion_gate {
+    motion_gate_config_t cfg;
+    
+    /* 仅检查线程访问 */
+    uint16_t grid[2][MOTION_GATE_MAX_GRID * MOTION_GATE_MAX_GRID];
+    int ref;                        /* 参考帧网格下标，-1 表示没有参考帧 */
+    int ref_width;                  /* 参考帧的图像尺寸和网格尺寸，变化时参考帧失效 */
+    int ref_height;
+    int ref_grid_width;
+    int ref_grid_height;
+    int64_t last_pass_us;
+    
+    atomic_bool reset_pending;
+    atomic_int_fast64_t hold_until_us;
+    
+    atomic_uint_fast64_t frames_checked;
+    atomic_uint_fast64_t frames_passed;
+    atomic_uint_fast64_t frames_skipped;
+    atomic_int last_score;
+};
+
+#ifdef USE_NEON
+/* NEON 版本：每次累加 16 个样本，返回已处理的样本数
+ * 多通道加载会读到最后一个样本之后的字节，pixel_step > 1 时最后一个样本留给标量处理，保证不越界 */
+static int segment_sum_neon(const uint8_t* p, int n, int step, uint32_t* sum)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    int limit = step > 1 ? n - 1 : n;
+    int i = 0;
+    
+    switch (step) {
+        case 1:
+            for (; i + 16 <= limit; i += 16) acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(p + i)));
+            break;
+        case 2:
+            for (; i + 16 <= limit; i += 16) acc = vpadalq_u16(acc, vpaddlq_u8(vld2q_u8(p + i * 2).val[0]));
+            break;
+        case 3:
+            for (; i + 16 <= limit; i += 16) acc = vpadalq_u16(acc, vpaddlq_u8(vld3q_u8(p + i * 3).val[0]));
+            break;
+        case 4:
+            for (; i + 16 <= limit; i += 16) acc = vpadalq_u16(acc, vpaddlq_u8(vld4q_u8(p + i * 4).val[0]));
+            break;
+        default:
+            return 0;
+    }
+    
+    uint64x2_t total = vpaddlq_u32(acc);
+    *sum += (uint32_t)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+    return i;
+}
+#endif
+
+/* 一行中连续 n 个样本之和 */
+static uint32_t segment_sum(const uint8_t* p, int n, int step)
+{
+    uint32_t sum = 0;
+    int i = 0;
+
+#ifdef USE_NEON
+    i = segment_sum_neon(p, n, step, &sum);
+#endif
+    for (; i < n; i++) {
+        sum += p[(size_t)i * step];
+    }
+    return sum;
+}
+
+/* 计算各格亮度均值（定点，MOTION_GATE_FRAC_BITS 位小数） */
+static void grid_compute(const uint8_t* luma, int width, int height, int stride, int step,
+                         int grid_width, int grid_height, uint16_t* cells)
+{
+    uint32_t sums[MOTION_GATE_MAX_GRID];
+    int col[MOTION_GATE_MAX_GRID + 1];
+    
+    for (int gx = 0; gx <= grid_width; gx++) {
+        col[gx] = gx * width / grid_width;
+    }
+    
+    for (int gy = 0; gy < grid_height; gy++) {
+        int y0 = gy * height / grid_height;
+        int y1 = (gy + 1) * height / grid_height;
+        int row_step = (y1 - y0) / MOTION_GATE_ROWS_PER_CELL;
+        int rows = 0;
+        if (row_step < 1) row_step = 1;
+        
+        memset(sums, 0, sizeof(uint32_t) * grid_width);
+        for (int y = y0; y < y1; y += row_step, rows++) {
+            const uint8_t* row = luma + (size_t)y * stride;
+            for (int gx = 0; gx < grid_width; gx++) {
+                sums[gx] += segment_sum(row + (size_t)col[gx] * step, col[gx + 1] - col[gx], step);
+            }
+        }
+        
+        uint16_t* out = cells + gy * grid_width;
+        for (int gx = 0; gx < grid_width; gx++) {
+            uint32_t count = (uint32_t)rows * (col[gx + 1] - col[gx]);
+            out[gx] = count ? (uint16_t)((((uint64_t)sums[gx] << MOTION_GATE_FRAC_BITS) + count / 2) / count) : 0;
+        }
+    }
+}
+
+/* 变化格子的千分比：先减去所有格子的平均变化，整体亮度漂移（自动曝光、灯光）不计为运动 */
+static int grid_compare(const uint16_t* cur, const uint16_t* ref, int n, int pixel_threshold)
+{
+    int64_t total = 0;
+    int changed = 0;
+    int threshold = pixel_threshold << MOTION_GATE_FRAC_BITS;
+    
+    for (int i = 0; i < n; i++) {
+        total += (int)cur[i] - (int)ref[i];
+    }
+    int mean = (int)(total / n);
+    
+    for (int i = 0; i < n; i++) {
+        int d = (int)cur[i] - (int)ref[i] - mean;
+        if (d > threshold || d < -threshold) changed++;
+    }
+    return changed * 1000 / n;
+}
+
+motion_gate_t* motion_gate_create(const motion_gate_config_t* config)
+{
+    motion_gate_t* gate = (motion_gate_t*)calloc(1, sizeof(motion_gate_t));
+    if (!gate) return NULL;
+    
+    if (config) gate->cfg = *config;
+    motion_gate_config_t* cfg = &gate->cfg;
+    if (cfg->grid_width <= 0) cfg->grid_width = DEFAULT_GRID_WIDTH;
+    if (cfg->grid_height <= 0) cfg->grid_height = DEFAULT_GRID_HEIGHT;
+    if (cfg->grid_width > MOTION_GATE_MAX_GRID) cfg->grid_width = MOTION_GATE_MAX_GRID;
+    if (cfg->grid_height > MOTION_GATE_MAX_GRID) cfg->grid_height = MOTION_GATE_MAX_GRID;
+    if (cfg->pixel_threshold <= 0) cfg->pixel_threshold = DEFAULT_PIXEL_THRESHOLD;
+    if (cfg->area_permille <= 0) cfg->area_permille = DEFAULT_AREA_PERMILLE;
+    if (cfg->heartbeat_ms == 0) cfg->heartbeat_ms = DEFAULT_HEARTBEAT_MS;
+    if (cfg->hold_ms == 0) cfg->hold_ms = DEFAULT_HOLD_MS;
+    
+    gate->ref = -1;
+    atomic_init(&gate->reset_pending, false);
+    atomic_init(&gate->hold_until_us, 0);
+    atomic_init(&gate->frames_checked, 0);
+    atomic_init(&gate->frames_passed, 0);
+    atomic_init(&gate->frames_skipped, 0);
+    atomic_init(&gate->last_score, 0);
+    return gate;
+}
+
+void motion_gate_destroy(motion_gate_t* gate)
+{
+    free(gate);
+}
+
+bool motion_gate_check(motion_gate_t* gate, const uint8_t* luma, int width, int height, int stride,
+                       int pixel_step, int64_t now_us)
+{
+    if (!gate || !luma || width <= 0 || height <= 0) return true;
+    if (pixel_step < 1) pixel_step = 1;
+    
+    /* 图像比网格还小时每个像素一格 */
+    int grid_width = gate->cfg.grid_width < width ? gate->cfg.grid_width : width;
+    int grid_height = gate->cfg.grid_height < height ? gate->cfg.grid_height : height;
+    int cur = gate->ref == 0 ? 1 : 0;
+    
+    grid_compute(luma, width, height, stride, pixel_step, grid_width, grid_height, gate->grid[cur]);
+    
+    /* 没有可比较的参考帧时视为运动（首帧、复位后、尺寸变化后） */
+    int score = 1000;
+    bool reset = atomic_exchange(&gate->reset_pending, false);
+    if (!reset && gate->ref >= 0 && gate->ref_width == width && gate->ref_height == height &&
+        gate->ref_grid_width == grid_width && gate->ref_grid_height == grid_height) {
+        score = grid_compare(gate->grid[cur], gate->grid[gate->ref], grid_width * grid_height,
+                             gate->cfg.pixel_threshold);
+    }
+    bool motion = score >= gate->cfg.area_permille;
+    
+    /* 与相邻帧比较，参考帧每帧更新 */
+    gate->ref = cur;
+    gate->ref_width = width;
+    gate->ref_height = height;
+    gate->ref_grid_width = grid_width;
+    gate->ref_grid_height = grid_height;
+    
+    if (motion) motion_gate_hold(gate, now_us);
+    
+    bool pass = motion || now_us < atomic_load(&gate->hold_until_us) ||
+                (gate->cfg.heartbeat_ms >= 0 && now_us - gate->last_pass_us >= (int64_t)gate->cfg.heartbeat_ms * 1000);
+    if (pass) gate->last_pass_us = now_us;
+    
+    atomic_store(&gate->last_score, score);
+    atomic_fetch_add(&gate->frames_checked, 1);
+    atomic_fetch_add(pass ? &gate->frames_passed : &gate->frames_skipped, 1);
+    return pass;
+}
+
+void motion_gate_reset(motion_gate_t* gate)
+{
+    if (!gate) return;
+    atomic_store(&gate->reset_pending, true);
+}
+
+void motion_gate_hold(motion_gate_t* gate, int64_t now_us)
+{
+    if (!gate || gate->cfg.hold_ms < 0) return;
+    atomic_store(&gate->hold_until_us, now_us + (int64_t)gate->cfg.hold_ms * 1000);
+}
+
+void motion_gate_get_stats(motion_gate_t* gate, motion_gate_stats_t* stats)
+{
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!gate) return;
+    
+    stats->frames_checked = atomic_load(&gate->frames_checked);
+    stats->frames_passed = atomic_load(&gate->frames_passed);
+    stats->frames_skipped = atomic_load(&gate->frames_skipped);
+    stats->last_score = atomic_load(&gate->last_score);
+}
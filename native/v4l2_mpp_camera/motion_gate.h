@@ -0,0 +1,88 @@
+/*
+ * 运动门控 - 检测前的廉价预过滤，画面静止时跳过人脸检测
+ *
+ * 1. 亮度平面按 grid_width x grid_height 分格求均值（隔行采样，ARM 上使用 NEON），与上一帧逐格比较
+ * 2. 先减去全局平均变化（自动曝光/灯光渐变），变化超过 pixel_threshold 的格子占比达到 area_permille 即视为运动
+ * 3. 运动后 hold_ms 内持续放行（人走近后静止），无运动时每 heartbeat_ms 放行一帧（静止的人仍能被识别）
+ * 4. 输入可以是 NV12 的 Y 平面、YUYV 的 Y 分量或 BGR/BGRA 的 G 通道（pixel_step 指定相邻样本间隔）
+ */
+
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 网格最大边长 */
+#define MOTION_GATE_MAX_GRID 64
+
+/* 门控配置，0 表示使用默认值 */
+typedef struct {
+    int grid_width;             /* 网格列数（默认 32） */
+    int grid_height;            /* 网格行数（默认 24） */
+    int pixel_threshold;        /* 格子均值变化阈值，亮度级（默认 12） */
+    int area_permille;          /* 变化格子占比阈值，千分比（默认 20，即 2%） */
+    int heartbeat_ms;           /* 无运动时的放行间隔（默认 1000，<0 表示从不放行） */
+    int hold_ms;                /* 检测到运动后持续放行的时间（默认 1500，<0 表示不保持） */
+} motion_gate_config_t;
+
+/* 门控统计 */
+typedef struct {
+    uint64_t frames_checked;    /* 检查的帧数 */
+    uint64_t frames_passed;     /* 放行的帧数（运动、保持期或心跳） */
+    uint64_t frames_skipped;    /* 判定为静止而跳过的帧数 */
+    int last_score;             /* 最近一帧的变化格子千分比 */
+} motion_gate_stats_t;
+
+/* 门控句柄 */
+typedef struct motion_gate motion_gate_t;
+
+/**
+ * 创建门控
+ * @param config 配置，NULL 表示全部使用默认值
+ * @return 门控，失败返回 NULL
+ */
+motion_gate_t* motion_gate_create(const motion_gate_config_t* config);
+
+/**
+ * 销毁门控
+ */
+void motion_gate_destroy(motion_gate_t* gate);
+
+/**
+ * 检查一帧，同一门控只能在一个线程中调用
+ * @param luma 第一个亮度样本的地址
+ * @param width 图像宽度（像素）
+ * @param height 图像高度
+ * @param stride 行字节数
+ * @param pixel_step 相邻样本的字节间隔（Y 平面 1，YUYV 2，BGR 3，BGRA 4）
+ * @param now_us 当前时间（微秒）
+ * @return true 放行（交给检测），false 画面静止应跳过
+ */
+bool motion_gate_check(motion_gate_t* gate, const uint8_t* luma, int width, int height, int stride,
+                       int pixel_step, int64_t now_us);
+
+/**
+ * 丢弃参考帧，下一帧无条件放行（切换分辨率或模式后调用，可在任意线程调用）
+ */
+void motion_gate_reset(motion_gate_t* gate);
+
+/**
+ * 从 now_us 起重新开始保持期（检测到人脸时调用，人静止不动也持续检测，可在任意线程调用）
+ */
+void motion_gate_hold(motion_gate_t* gate, int64_t now_us);
+
+/**
+ * 获取统计（可在任意线程调用）
+ */
+void motion_gate_get_stats(motion_gate_t* gate, motion_gate_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_GATE_H */
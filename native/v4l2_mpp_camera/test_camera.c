@@ -13,8 +13,24 @@
 
 static volatile int g_running = 1;
 static int g_frame_count = 0;
+static int g_detect_count = 0;
+static int g_second_count = 0;
 static struct timespec g_start_time;
 
+static void print_latency(const char* name, const latency_summary_t* s)
+{
+    if (s->count == 0) return;
+    printf("  %-11s min %6.2f  avg %6.2f  p95 %6.2f  max %6.2f ms\n", name,
+           s->min_us / 1000.0, s->avg_us / 1000.0, s->p95_us / 1000.0, s->max_us / 1000.0);
+}
+
+static void print_thread_status(const char* name, const camera_thread_status_t* s)
+{
+    static const char* policy_names[] = { "normal", "fifo", "rr" };
+    printf("%s: %s priority %d, cpu mask 0x%x%s\n", name, policy_names[s->policy], s->priority, s->cpu_mask,
+           s->sched_applied && s->affinity_applied ? "" : " (requested settings not in effect)");
+}
+
 static void signal_handler(int sig)
 {
     (void)sig;
@@ -43,6 +59,41 @@ static void frame_callback(void* user_data, uint8_t* bgra_data, int width, int h
     }
 }
 
+static void detect_callback(void* user_data, uint8_t* data, int width, int height, int stride)
+{
+    (void)user_data;
+    (void)data;
+    (void)width;
+    (void)height;
+    (void)stride;
+    
+    g_detect_count++;
+}
+
+/* 第二路相机只计数 */
+static void second_callback(void* user_data, uint8_t* bgra_data, int width, int height, int stride)
+{
+    (void)user_data;
+    (void)bgra_data;
+    (void)width;
+    (void)height;
+    (void)stride;
+    
+    g_second_count++;
+}
+
+/* 在正常/低功耗空闲模式之间切换一次 */
+static void toggle_mode(camera_handle_t camera)
+{
+    camera_mode_t mode = camera_get_mode(camera) == CAMERA_MODE_IDLE ? CAMERA_MODE_ACTIVE : CAMERA_MODE_IDLE;
+    camera_error_t err = camera_set_mode(camera, mode);
+    int w = 0, h = 0, f = 0;
+    
+    camera_get_format(camera, &w, &h, &f);
+    printf("Mode -> %s: %dx%d@%dfps (%s)\n", mode == CAMERA_MODE_IDLE ? "idle" : "active",
+           w, h, f, camera_get_error_string(err));
+}
+
 int main(int argc, char* argv[])
 {
     const char* device = "/dev/video12";
@@ -50,6 +101,23 @@ int main(int argc, char* argv[])
     int height = 480;
     int fps = 30;
     int duration = 10;  /* 测试持续时间（秒） */
+    int capture_mode = CAMERA_CAPTURE_AUTO;
+    int queue_depth = 0;
+    int pull_mode = 0;  /* 使用 camera_acquire_frame 拉取而不是回调 */
+    int detect_width = 0;   /* 检测流尺寸，0 表示不启用 */
+    int detect_height = 0;
+    int workers = 0;    /* 回调工作线程数，0 表示在输出线程中回调 */
+    int convert_threads = 0;
+    int color_space = CAMERA_COLOR_SPACE_AUTO;
+    int input_format = CAMERA_INPUT_FORMAT_MJPEG;
+    int buffer_count = 0;
+    int idle_toggle = 0;    /* 每隔多少秒切换一次空闲/正常模式，0 表示不切换 */
+    const char* second_device = NULL;   /* 第二路相机，与第一路加入同一相机组（优先级较低） */
+    int rt_priority = 0;    /* 采集/输出线程的 SCHED_FIFO 优先级，0 表示普通调度 */
+    uint32_t cpu_mask = 0;  /* 采集/输出线程的 CPU 掩码 */
+    int lock_memory = 0;
+    static const char* format_names[] = { "mjpeg", "yuyv", "nv12", "auto" };
+    static const char* mode_names[] = { "auto", "mmap", "dmabuf", "expbuf" };
     
     /* 解析命令行参数 */
     for (int i = 1; i < argc; i++) {
@@ -63,6 +131,39 @@ int main(int argc, char* argv[])
             fps = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
             duration = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            capture_mode = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queue_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            pull_mode = 1;
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            detect_width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            detect_height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            convert_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            color_space = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            for (int f = 0; f < 4; f++) {
+                if (strcmp(name, format_names[f]) == 0) input_format = f;
+            }
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            buffer_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            idle_toggle = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            second_device = argv[++i];
+        } else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            rt_priority = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            cpu_mask = (uint32_t)strtoul(argv[++i], NULL, 16);
+        } else if (strcmp(argv[i], "-L") == 0) {
+            lock_memory = 1;
         } else if (strcmp(argv[i], "--help") == 0) {
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
@@ -71,6 +172,21 @@ int main(int argc, char* argv[])
             printf("  -h <height>    Video height (default: 480)\n");
             printf("  -f <fps>       Frame rate (default: 30)\n");
             printf("  -t <seconds>   Test duration (default: 10)\n");
+            printf("  -m <mode>      Capture mode 0=auto 1=mmap 2=dmabuf 3=expbuf (default: 0)\n");
+            printf("  -q <depth>     Decode frames in flight (default: 2)\n");
+            printf("  -p             Pull frames with camera_acquire_frame instead of callback\n");
+            printf("  -W <width>     Enable BGR detect stream with this width\n");
+            printf("  -H <height>    Detect stream height\n");
+            printf("  -j <workers>   Run callbacks in a native worker pool (default: 0, inline)\n");
+            printf("  -c <threads>   CPU color conversion threads (default: 1)\n");
+            printf("  -F <format>    Capture format: mjpeg, yuyv, nv12, auto (default: mjpeg)\n");
+            printf("  -b <buffers>   V4L2 capture buffers (default: 4)\n");
+            printf("  -i <seconds>   Toggle idle (320x240@5fps, no detect) / active mode every N seconds\n");
+            printf("  -s <space>     Color space 0=auto 1=601 full 2=601 limited 3=709 full 4=709 limited\n");
+            printf("  -D <device>    Second camera sharing a camera group (buffer pool + RGA, lower priority)\n");
+            printf("  -R <priority>  Run capture/output threads with SCHED_FIFO at this priority\n");
+            printf("  -A <hex mask>  CPU affinity mask for capture/output threads\n");
+            printf("  -L             mlock camera context and output buffers\n");
             return 0;
         }
     }
@@ -86,33 +202,137 @@ int main(int argc, char* argv[])
     printf("============================\n\n");
     
     /* 初始化相机 */
-    camera_handle_t camera = camera_init(device, width, height, fps);
+    if (capture_mode < CAMERA_CAPTURE_AUTO || capture_mode > CAMERA_CAPTURE_EXPBUF) {
+        fprintf(stderr, "Invalid capture mode: %d\n", capture_mode);
+        return 1;
+    }
+    
+    camera_config_t config = {
+        .device = device,
+        .width = width,
+        .height = height,
+        .fps = fps,
+        .capture_mode = (camera_capture_mode_t)capture_mode,
+        .v4l2_buffer_count = buffer_count,
+        .decode_queue_depth = queue_depth,
+        .detect_format = (detect_width > 0 && detect_height > 0) ? CAMERA_PIXEL_FORMAT_BGR888
+                                                                 : CAMERA_PIXEL_FORMAT_NONE,
+        .detect_width = detect_width,
+        .detect_height = detect_height,
+        .callback_workers = workers,
+        .input_format = (camera_input_format_t)input_format,
+        .color_space = (camera_color_space_t)color_space,
+        .convert_threads = convert_threads,
+        .capture_thread = { .policy = rt_priority > 0 ? CAMERA_SCHED_FIFO : CAMERA_SCHED_NORMAL,
+                            .priority = rt_priority, .cpu_mask = cpu_mask },
+        .output_thread = { .policy = rt_priority > 0 ? CAMERA_SCHED_FIFO : CAMERA_SCHED_NORMAL,
+                           .priority = rt_priority > 1 ? rt_priority - 1 : rt_priority, .cpu_mask = cpu_mask },
+        .lock_memory = lock_memory != 0,
+    };
+    
+    /* 两路相机共享缓冲池，缓冲区按两路中较大的分辨率分配 */
+    camera_group_t* group = NULL;
+    if (second_device) {
+        camera_group_config_t group_config = { .max_width = width, .max_height = height };
+        group = camera_group_create(&group_config);
+        if (!group) {
+            fprintf(stderr, "Failed to create camera group\n");
+            return 1;
+        }
+        config.group = group;
+        config.priority = 1;
+    }
+    
+    camera_handle_t camera = camera_init_ex(&config);
     if (!camera) {
         fprintf(stderr, "Failed to initialize camera\n");
+        camera_group_destroy(group);
         return 1;
     }
     
+    camera_handle_t second = NULL;
+    if (second_device) {
+        camera_config_t second_config = config;
+        second_config.device = second_device;
+        second_config.priority = 0;
+        second_config.detect_format = CAMERA_PIXEL_FORMAT_NONE;
+        second = camera_init_ex(&second_config);
+        if (!second || camera_start(second, second_callback, NULL) != CAMERA_OK) {
+            fprintf(stderr, "Failed to start second camera %s\n", second_device);
+        }
+    }
+    
+    printf("Capture mode: %s\n", mode_names[camera_get_capture_mode(camera)]);
+    printf("Capture format: %s\n", format_names[camera_get_input_format(camera)]);
+    if (config.detect_format != CAMERA_PIXEL_FORMAT_NONE) {
+        printf("Detect stream: %dx%d BGR\n", detect_width, detect_height);
+        camera_set_detect_callback(camera, detect_callback, NULL);
+    }
+    
     /* 启动采集 */
     clock_gettime(CLOCK_MONOTONIC, &g_start_time);
     
-    camera_error_t err = camera_start(camera, frame_callback, NULL);
+    camera_error_t err = camera_start(camera, pull_mode ? NULL : frame_callback, NULL);
     if (err != CAMERA_OK) {
         fprintf(stderr, "Failed to start camera: %s\n", camera_get_error_string(err));
         camera_deinit(camera);
         return 1;
     }
     
+    camera_thread_report_t thread_report;
+    if (camera_get_thread_report(camera, &thread_report) == CAMERA_OK) {
+        print_thread_status("Capture thread", &thread_report.capture);
+        print_thread_status("Output thread", &thread_report.output);
+        if (thread_report.lock_requested) {
+            printf("Memory lock: %zu bytes%s\n", thread_report.locked_bytes,
+                   thread_report.memory_locked ? "" : " (incomplete)");
+        }
+    }
+    
     printf("Camera started. Press Ctrl+C to stop.\n\n");
     
     /* 运行指定时间 */
-    int elapsed = 0;
-    while (g_running && elapsed < duration) {
-        sleep(1);
-        elapsed++;
+    if (pull_mode) {
+        uint64_t last_seq = 0;
+        struct timespec now;
+        time_t next_toggle = g_start_time.tv_sec + idle_toggle;
+        do {
+            camera_frame_t frame;
+            if (camera_acquire_frame(camera, &frame, last_seq, 100) == CAMERA_OK) {
+                last_seq = frame.sequence;
+                frame_callback(NULL, frame.data, frame.width, frame.height, frame.stride);
+                camera_release_frame(camera, &frame);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (idle_toggle > 0 && now.tv_sec >= next_toggle) {
+                toggle_mode(camera);
+                next_toggle = now.tv_sec + idle_toggle;
+            }
+        } while (g_running && now.tv_sec - g_start_time.tv_sec < duration);
+    } else {
+        int elapsed = 0;
+        while (g_running && elapsed < duration) {
+            sleep(1);
+            elapsed++;
+            if (idle_toggle > 0 && elapsed % idle_toggle == 0) {
+                toggle_mode(camera);
+            }
+        }
     }
     
+    camera_ring_stats_t ring_stats;
+    camera_get_ring_stats(camera, &ring_stats);
+    camera_stats_t stats;
+    camera_get_stats(camera, &stats);
+    dispatcher_stats_t dispatch_stats;
+    int have_dispatch = camera_get_dispatch_stats(camera, CAMERA_STREAM_MAIN, &dispatch_stats) == CAMERA_OK;
+    
+    camera_group_stats_t group_stats;
+    int have_group = camera_group_get_stats(group, &group_stats) == CAMERA_OK;
+    
     /* 停止采集 */
     camera_stop(camera);
+    camera_stop(second);
     
     /* 打印最终统计 */
     struct timespec end_time;
@@ -124,10 +344,59 @@ int main(int argc, char* argv[])
     printf("Total frames: %d\n", g_frame_count);
     printf("Total time: %.2f seconds\n", total_time);
     printf("Average FPS: %.2f\n", g_frame_count / total_time);
+    printf("Ring: published %llu, overwritten unread %llu, dropped %llu\n",
+           (unsigned long long)ring_stats.frames_published,
+           (unsigned long long)ring_stats.frames_overwritten,
+           (unsigned long long)ring_stats.frames_dropped);
+    if (config.detect_format != CAMERA_PIXEL_FORMAT_NONE) {
+        printf("Detect frames: %d\n", g_detect_count);
+    }
+    printf("Captured %llu, decoded %llu, pipeline drops %llu, decode errors %llu, skipped %llu\n",
+           (unsigned long long)stats.frames_captured, (unsigned long long)stats.frames_decoded,
+           (unsigned long long)stats.pipeline_drops, (unsigned long long)stats.decode_errors,
+           (unsigned long long)stats.frames_skipped);
+    printf("V4L2 sequence gaps %llu (%llu frames lost)\n",
+           (unsigned long long)stats.sequence_gaps, (unsigned long long)stats.frames_lost);
+    if (stats.decode_buffers > 0) {
+        printf("Decode pool: %d/%d buffers allocated (%zu bytes), %d in use, packet buffers %zu bytes "
+               "(max frame %zu), total %zu bytes\n",
+               stats.decode_buffers_allocated, stats.decode_buffers, stats.decode_buffer_size,
+               stats.decode_buffers_in_use, stats.packet_buffer_size, stats.max_packet_size,
+               stats.decode_pool_bytes);
+    }
+    print_latency("Capture", &stats.capture);
+    print_latency("Submit", &stats.submit);
+    print_latency("Decode", &stats.decode);
+    print_latency("Convert", &stats.convert);
+    print_latency("Callback", &stats.callback);
+    print_latency("End-to-end", &stats.end_to_end);
+    if (have_dispatch) {
+        printf("Dispatch: posted %llu, dropped %llu\n",
+               (unsigned long long)dispatch_stats.frames_posted,
+               (unsigned long long)dispatch_stats.frames_dropped);
+        for (int i = 0; i < dispatch_stats.worker_count; i++) {
+            printf("  worker %d: cpu %d, frames %llu, occupancy %.1f%%\n", i,
+                   dispatch_stats.workers[i].cpu,
+                   (unsigned long long)dispatch_stats.workers[i].frames,
+                   dispatch_stats.workers[i].occupancy * 100.0f);
+        }
+    }
+    if (have_group) {
+        printf("Second camera frames: %d\n", g_second_count);
+        printf("Group: %d cameras, buffers %d allocated (%zu bytes each), %d in use, peak %d, denied %llu\n",
+               group_stats.cameras, group_stats.buffers_allocated, group_stats.buffer_size,
+               group_stats.buffers_in_use, group_stats.buffers_peak,
+               (unsigned long long)group_stats.buffers_denied);
+        printf("Group RGA: %llu jobs, %llu waited\n",
+               (unsigned long long)group_stats.rga_jobs, (unsigned long long)group_stats.rga_waits);
+        print_latency("RGA wait", &group_stats.rga_wait);
+    }
     printf("====================\n");
     
     /* 释放资源 */
+    camera_deinit(second);
     camera_deinit(camera);
+    camera_group_destroy(group);
     
     return 0;
 }
@@ -7,6 +7,11 @@
  * 3. 窗口设置（使用 X11 根窗口测试）
  * 4. 帧回调（人脸识别数据流）
  * 5. 播放/停止
+ * 6. 播放状态和统计
+ * 7. 空闲/正常模式切换（不重建管道）
+ * 8. 事件录像（预录缓冲 + 事件后片段写 MP4，缺少硬件编码器时跳过）
+ * 9. 人脸裁剪（画面中心的模拟人脸框裁出 112x112 BGR 图）
+ * 10. 拉取模式（注册两个缓冲区，等待通知 fd 后把最新检测帧复制进来）
  */
 
 #include <stdio.h>
@@ -14,12 +19,16 @@
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <X11/Xlib.h>
 
 #include "gst_video_player.h"
 
 static volatile int g_running = 1;
 static int g_frame_count = 0;
+static volatile int g_crop_pending = 0;    /* 下一帧回调中裁剪人脸 */
+static volatile int g_crop_count = -1;
+static gst_face_crop_t g_crop;
 
 /* 信号处理 */
 static void signal_handler(int sig)
@@ -28,13 +37,28 @@ static void signal_handler(int sig)
     g_running = 0;
 }
 
-/* 帧回调（模拟人脸识别） */
-static void on_frame_callback(void* user_data, uint8_t* data, int width, int height, int stride)
+/* 帧回调（模拟人脸识别），附帧号和采集到交付的延迟 */
+static void on_frame_callback(void* user_data, uint8_t* data, int width, int height, int stride,
+                              const gst_player_frame_info_t* info)
 {
     g_frame_count++;
+    
+    /* 裁剪图只在下一次裁剪前有效，测试只记录第一张的描述 */
+    if (g_crop_pending) {
+        gst_face_crop_t crops[GST_PLAYER_MAX_FACE_CROPS];
+        int count = 0;
+        if (gst_player_crop_faces_bgra((gst_player_handle_t)user_data, data, width, height, stride,
+                                       crops, GST_PLAYER_MAX_FACE_CROPS, &count) == GST_PLAYER_OK) {
+            if (count > 0) g_crop = crops[0];
+            g_crop_count = count;
+        }
+        g_crop_pending = 0;
+    }
+    
     if (g_frame_count % 30 == 0) {
-        printf("[测试] 收到人脸识别帧 #%d: %dx%d, stride=%d\n", 
-               g_frame_count, width, height, stride);
+        printf("[测试] 收到人脸识别帧 #%d: %dx%d, stride=%d, frame_id=%llu, 采集→交付 %lld us\n", 
+               g_frame_count, width, height, stride, (unsigned long long)info->frame_id,
+               info->capture_us > 0 ? (long long)(info->deliver_us - info->capture_us) : -1LL);
     }
 }
 
@@ -82,7 +106,11 @@ static gst_player_handle_t test_create_player(const char* device)
         .use_rga = 1,
         .face_detect_fps = 5,
         .face_detect_width = 320,
-        .face_detect_height = 240
+        .face_detect_height = 240,
+        .motion_gate = true,
+        .record_pre_ms = 3000,
+        .adaptive_detect = true,
+        .detect_min_width = 160
     };
     
     gst_player_handle_t player = gst_player_create(&config);
@@ -92,6 +120,14 @@ static gst_player_handle_t test_create_player(const char* device)
     }
     
     printf("✅ 播放器创建成功\n");
+    
+    /* 预启动到 PAUSED，窗口在之后的测试4中才创建 */
+    gst_player_error_t ret = gst_player_preroll(player);
+    if (ret != GST_PLAYER_OK) {
+        printf("⚠️ 预启动失败: %s（start 时再打开设备）\n", gst_player_get_error_string(ret));
+    } else {
+        printf("✅ 预启动完成\n");
+    }
     return player;
 }
 
@@ -139,7 +175,7 @@ static int test_play(gst_player_handle_t player, Window window)
     printf("\n=== 测试5: 设置窗口并播放 ===\n");
     
     /* 设置帧回调 */
-    gst_player_error_t ret = gst_player_set_frame_callback(player, on_frame_callback, NULL);
+    gst_player_error_t ret = gst_player_set_frame_info_callback(player, on_frame_callback, player);
     if (ret != GST_PLAYER_OK) {
         printf("⚠️ 设置帧回调失败: %s\n", gst_player_get_error_string(ret));
     } else {
@@ -180,6 +216,203 @@ static void test_stats(gst_player_handle_t player)
     int dropped;
     gst_player_get_stats(player, &fps, &dropped);
     printf("📊 统计: FPS=%.1f, 丢帧=%d, 人脸帧=%d\n", fps, dropped, g_frame_count);
+    
+    gst_player_perf_stats_t stats;
+    if (gst_player_get_perf_stats(player, &stats) == GST_PLAYER_OK) {
+        printf("📊 队列丢帧: 显示=%llu 检测=%llu, sink 丢帧=%llu, 序号缺口=%llu\n",
+               (unsigned long long)stats.display_queue_drops, (unsigned long long)stats.detect_queue_drops,
+               (unsigned long long)stats.sink_dropped, (unsigned long long)stats.sequence_gaps);
+        printf("📊 送显延迟 avg/p95=%.1f/%.1f ms, 回调 avg/p95=%.1f/%.1f ms\n",
+               stats.display_latency.avg_us / 1000.0, stats.display_latency.p95_us / 1000.0,
+               stats.callback.avg_us / 1000.0, stats.callback.p95_us / 1000.0);
+        printf("📊 运动门控: 交付=%llu 静止跳过=%llu\n",
+               (unsigned long long)stats.frames_detected, (unsigned long long)stats.frames_gated);
+        printf("📊 首帧送显: %.1f ms\n", stats.first_frame_us / 1000.0);
+        printf("📊 检测自适应: 档位 %d, %d fps %dx%d, CPU %d%%, 调整 %llu 次\n", stats.detect_level,
+               stats.detect_fps, stats.detect_width, stats.detect_height, stats.cpu_percent,
+               (unsigned long long)stats.detect_adjustments);
+    }
+}
+
+/* 播放指定时间并处理 X11 事件 */
+static void run_for(Display* display, int ms)
+{
+    for (int i = 0; i < ms / 100 && g_running; i++) {
+        usleep(100000);
+        while (XPending(display)) {
+            XEvent event;
+            XNextEvent(display, &event);
+        }
+    }
+}
+
+/* 测试7: 空闲/正常模式切换、检测分支断开/连接 */
+static int test_mode_switch(gst_player_handle_t player, Display* display)
+{
+    printf("\n=== 测试7: 空闲/正常模式切换 ===\n");
+    
+    int before = g_frame_count;
+    gst_player_error_t ret = gst_player_set_mode(player, GST_PLAYER_MODE_IDLE);
+    if (ret != GST_PLAYER_OK) {
+        printf("❌ 切换到空闲模式失败: %s\n", gst_player_get_error_string(ret));
+        return -1;
+    }
+    run_for(display, 2000);
+    int delivered = g_frame_count - before;
+    if (delivered > 1) {    /* 切换时最多还有一帧在途 */
+        printf("❌ 空闲模式 2 秒仍交付了 %d 个人脸帧\n", delivered);
+        return -1;
+    }
+    printf("✅ 空闲模式 2 秒，人脸帧 +%d\n", delivered);
+    
+    before = g_frame_count;
+    ret = gst_player_set_mode(player, GST_PLAYER_MODE_ACTIVE);
+    if (ret != GST_PLAYER_OK) {
+        printf("❌ 切换回正常模式失败: %s\n", gst_player_get_error_string(ret));
+        return -1;
+    }
+    run_for(display, 2000);
+    printf("✅ 正常模式 2 秒，人脸帧 +%d\n", g_frame_count - before);
+    
+    /* 运行中断开再连接检测分支 */
+    ret = gst_player_set_branch_enabled(player, GST_PLAYER_BRANCH_DETECT, false);
+    if (ret != GST_PLAYER_OK) {
+        printf("❌ 断开检测分支失败: %s\n", gst_player_get_error_string(ret));
+        return -1;
+    }
+    before = g_frame_count;
+    run_for(display, 2000);
+    delivered = g_frame_count - before;
+    if (delivered > 1) {
+        printf("❌ 检测分支断开 2 秒仍交付了 %d 个人脸帧\n", delivered);
+        return -1;
+    }
+    printf("✅ 检测分支断开 2 秒，人脸帧 +%d\n", delivered);
+    
+    ret = gst_player_set_branch_enabled(player, GST_PLAYER_BRANCH_DETECT, true);
+    if (ret != GST_PLAYER_OK) {
+        printf("❌ 重新连接检测分支失败: %s\n", gst_player_get_error_string(ret));
+        return -1;
+    }
+    before = g_frame_count;
+    run_for(display, 2000);
+    printf("✅ 检测分支重新连接 2 秒，人脸帧 +%d\n", g_frame_count - before);
+    
+    return gst_player_is_playing(player) ? 0 : -1;
+}
+
+/* 测试8: 事件录像 - 事件前 3 秒 + 事件后 2 秒 */
+static int test_record(gst_player_handle_t player, Display* display)
+{
+    const char* path = "/tmp/gst_player_event.mp4";
+    printf("\n=== 测试8: 事件录像 ===\n");
+    
+    unlink(path);
+    gst_player_error_t ret = gst_player_record_event(player, path, 3000, 2000);
+    if (ret == GST_PLAYER_ERROR_INVALID_PARAM) {
+        printf("⚠️ 未创建录像分支（缺少硬件编码器），跳过\n");
+        return 0;
+    }
+    if (ret != GST_PLAYER_OK) {
+        printf("❌ 触发录像失败: %s\n", gst_player_get_error_string(ret));
+        return -1;
+    }
+    
+    for (int i = 0; i < 50 && gst_player_is_recording(player); i++) {
+        run_for(display, 100);
+    }
+    if (gst_player_is_recording(player)) {
+        printf("❌ 5 秒后片段仍未写完\n");
+        return -1;
+    }
+    
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size == 0) {
+        printf("❌ 片段文件为空: %s\n", path);
+        return -1;
+    }
+    
+    gst_player_perf_stats_t stats;
+    gst_player_get_perf_stats(player, &stats);
+    printf("✅ 片段已写入 %s（%lld 字节，预录缓冲 %llu 字节）\n", path, (long long)st.st_size,
+           (unsigned long long)stats.record_buffer_bytes);
+    return 0;
+}
+
+/* 测试9: 人脸裁剪 - 检测帧中心放一个模拟人脸框 */
+static int test_face_crop(gst_player_handle_t player, Display* display)
+{
+    printf("\n=== 测试9: 人脸裁剪 ===\n");
+    
+    gst_face_box_t box = { .center_x = 160, .center_y = 120, .width = 80, .height = 100, .score = 0.9f };
+    gst_player_set_face_boxes(player, &box, 1, 320, 240);
+    
+    g_crop_count = -1;
+    g_crop_pending = 1;
+    for (int i = 0; i < 20 && g_crop_pending && g_running; i++) {
+        run_for(display, 100);
+    }
+    gst_player_clear_face_boxes(player);
+    
+    if (g_crop_count < 0) {
+        printf("❌ 2 秒内没有检测帧或裁剪失败\n");
+        return -1;
+    }
+    if (g_crop_count != 1 || g_crop.size != (size_t)g_crop.width * g_crop.height * 3) {
+        printf("❌ 裁剪结果不符: %d 张, %dx%d %zu 字节\n", g_crop_count, g_crop.width, g_crop.height, g_crop.size);
+        return -1;
+    }
+    printf("✅ 裁剪 %dx%d BGR，源区域 (%.0f, %.0f) %.0fx%.0f\n", g_crop.width, g_crop.height,
+           g_crop.box.center_x, g_crop.box.center_y, g_crop.box.width, g_crop.box.height);
+    return 0;
+}
+
+/* 测试10: 拉取模式 - 检测帧复制到注册的缓冲区 */
+static int test_frame_pull(gst_player_handle_t player, Display* display)
+{
+    printf("\n=== 测试10: 拉取模式 ===\n");
+    
+    size_t size = 320 * 240 * 4;
+    void* buffers[2] = { malloc(size), malloc(size) };
+    gst_player_pulled_frame_t frame;
+    gst_player_error_t ret = GST_PLAYER_ERROR_NO_DATA;
+    int result = -1;
+    
+    if (!buffers[0] || !buffers[1] ||
+        gst_player_register_frame_buffers(player, buffers, 2, size) != GST_PLAYER_OK) {
+        printf("❌ 注册缓冲区失败\n");
+        goto out;
+    }
+    
+    /* 等待期间继续处理 X11 事件 */
+    for (int i = 0; i < 20 && ret == GST_PLAYER_ERROR_NO_DATA && g_running; i++) {
+        if (gst_player_wait_frame(player, 100) == GST_PLAYER_OK) {
+            ret = gst_player_get_latest_frame_into(player, i & 1, &frame);
+        }
+        while (XPending(display)) {
+            XEvent event;
+            XNextEvent(display, &event);
+        }
+    }
+    gst_player_register_frame_buffers(player, NULL, 0, 0);
+    
+    if (ret != GST_PLAYER_OK) {
+        printf("❌ 2 秒内没有拉取到检测帧: %s\n", gst_player_get_error_string(ret));
+        goto out;
+    }
+    if (frame.format != GST_PLAYER_PIXEL_BGRA || frame.stride != frame.width * 4 ||
+        frame.size != (size_t)frame.stride * frame.height) {
+        printf("❌ 拉取结果不符: %dx%d stride=%d %zu 字节\n", frame.width, frame.height, frame.stride, frame.size);
+        goto out;
+    }
+    printf("✅ 拉取 %dx%d BGRA，frame_id=%llu，跳过 %u 帧，采集→拉取 %lld us\n", frame.width, frame.height,
+           (unsigned long long)frame.info.frame_id, frame.skipped,
+           frame.info.capture_us > 0 ? (long long)(frame.info.deliver_us - frame.info.capture_us) : -1LL);
+    result = 0;
+out:
+    free(buffers[0]);
+    free(buffers[1]);
+    return result;
 }
 
 /* 主函数 */
@@ -208,7 +441,7 @@ int main(int argc, char* argv[])
     if (test_device(device) != 0) {
         printf("\n⚠️ 跳过后续测试（设备不存在）\n");
         printf("========================================\n");
-        printf("测试结果: 部分通过 (1/6)\n");
+        printf("测试结果: 部分通过 (1/10)\n");
         printf("========================================\n");
         return 0;
     }
@@ -256,6 +489,19 @@ int main(int argc, char* argv[])
     /* 测试6: 最终统计 */
     test_stats(player);
     
+    /* 测试7: 模式切换 */
+    int mode_ok = g_running ? test_mode_switch(player, display) == 0 : 1;
+    
+    /* 测试8: 事件录像（模式切换后预录缓冲重新积累） */
+    if (g_running) run_for(display, 3000);
+    int record_ok = g_running ? test_record(player, display) == 0 : 1;
+    
+    /* 测试9: 人脸裁剪 */
+    int crop_ok = g_running ? test_face_crop(player, display) == 0 : 1;
+    
+    /* 测试10: 拉取模式 */
+    int pull_ok = g_running ? test_frame_pull(player, display) == 0 : 1;
+    
     /* 停止并销毁 */
     printf("\n>>> 停止播放...\n");
     gst_player_stop(player);
@@ -268,8 +514,13 @@ int main(int argc, char* argv[])
     }
     
     printf("\n========================================\n");
-    printf("测试结果: 全部通过 (6/6)\n");
+    int passed = 6 + mode_ok + record_ok + crop_ok + pull_ok;
+    if (passed == 10) {
+        printf("测试结果: 全部通过 (10/10)\n");
+    } else {
+        printf("测试结果: 部分通过 (%d/10)\n", passed);
+    }
     printf("========================================\n");
     
-    return 0;
+    return passed == 10 ? 0 : 1;
 }
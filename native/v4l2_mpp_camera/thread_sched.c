@@ -0,0 +1,152 @@
+/*
+ * 线程调度实现
+ *
+ * RT 属性只在创建时设置一次：pthread_attr 默认 PTHREAD_INHERIT_SCHED，不设置 EXPLICIT 时策略和优先级被忽略。
+ * 创建被拒绝（EPERM）时用默认属性重新创建，线程照常运行，只是调度不满足请求。
+ */
+
+#define _GNU_SOURCE
+#define MODULE_TAG "thread_sched"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "thread_sched.h"
+
+/* 未指定优先级时的 RT 优先级：低于内核中断线程（50），不影响驱动的中断处理 */
+#define DEFAULT_RT_PRIORITY 40
+
+static int native_policy(camera_sched_policy_t policy)
+{
+    switch (policy) {
+        case CAMERA_SCHED_FIFO:
+            return SCHED_FIFO;
+        case CAMERA_SCHED_RR:
+            return SCHED_RR;
+        default:
+            return SCHED_OTHER;
+    }
+}
+
+static const char* policy_name(camera_sched_policy_t policy)
+{
+    switch (policy) {
+        case CAMERA_SCHED_FIFO:
+            return "SCHED_FIFO";
+        case CAMERA_SCHED_RR:
+            return "SCHED_RR";
+        default:
+            return "SCHED_OTHER";
+    }
+}
+
+/* 请求的优先级截断到策略允许的范围 */
+static int requested_priority(const camera_thread_config_t* config)
+{
+    int policy = native_policy(config->policy);
+    int priority = config->priority > 0 ? config->priority : DEFAULT_RT_PRIORITY;
+    int min = sched_get_priority_min(policy);
+    int max = sched_get_priority_max(policy);
+
+    if (priority < min) priority = min;
+    if (priority > max) priority = max;
+    return priority;
+}
+
+/* 查询线程实际的调度设置，并与请求比较 */
+static void thread_sched_query(pthread_t thread, const camera_thread_config_t* config, camera_thread_status_t* status)
+{
+    struct sched_param param;
+    int policy;
+    cpu_set_t cpus;
+
+    memset(status, 0, sizeof(*status));
+    status->started = true;
+    if (pthread_getschedparam(thread, &policy, &param) == 0) {
+        status->policy = policy == SCHED_FIFO ? CAMERA_SCHED_FIFO :
+                         policy == SCHED_RR ? CAMERA_SCHED_RR : CAMERA_SCHED_NORMAL;
+        status->priority = param.sched_priority;
+    }
+    CPU_ZERO(&cpus);
+    if (pthread_getaffinity_np(thread, sizeof(cpus), &cpus) == 0) {
+        for (int cpu = 0; cpu < 32; cpu++) {
+            if (CPU_ISSET(cpu, &cpus)) status->cpu_mask |= 1u << cpu;
+        }
+    }
+
+    status->sched_applied = !config || config->policy == CAMERA_SCHED_NORMAL ||
+                            (status->policy == config->policy && status->priority == requested_priority(config));
+    status->affinity_applied = !config || config->cpu_mask == 0 ||
+                               (status->cpu_mask != 0 && (status->cpu_mask & ~config->cpu_mask) == 0);
+}
+
+int thread_sched_create(pthread_t* thread, const char* name, const camera_thread_config_t* config,
+                        void* (*func)(void*), void* arg, camera_thread_status_t* status)
+{
+    int ret = EPERM;
+
+    if (config && config->policy != CAMERA_SCHED_NORMAL) {
+        pthread_attr_t attr;
+        struct sched_param param;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = requested_priority(config);
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, native_policy(config->policy));
+        pthread_attr_setschedparam(&attr, &param);
+        ret = pthread_create(thread, &attr, func, arg);
+        pthread_attr_destroy(&attr);
+        if (ret != 0) {
+            fprintf(stderr, "[%s] %s: %s priority %d not permitted (%s), using normal scheduling\n", MODULE_TAG,
+                    name, policy_name(config->policy), param.sched_priority, strerror(ret));
+        }
+    }
+    if (ret != 0) {
+        ret = pthread_create(thread, NULL, func, arg);
+        if (ret != 0) return ret;
+    }
+
+    pthread_setname_np(*thread, name);
+
+    if (config && config->cpu_mask != 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 32; cpu++) {
+            if (config->cpu_mask & (1u << cpu)) CPU_SET(cpu, &cpus);
+        }
+        int err = pthread_setaffinity_np(*thread, sizeof(cpus), &cpus);
+        if (err != 0) {
+            fprintf(stderr, "[%s] %s: failed to set CPU mask 0x%x (%s)\n", MODULE_TAG, name, config->cpu_mask,
+                    strerror(err));
+        }
+    }
+
+    camera_thread_status_t local;
+    if (!status) status = &local;
+    thread_sched_query(*thread, config, status);
+    printf("[%s] %s: %s priority %d, cpu mask 0x%x%s\n", MODULE_TAG, name, policy_name(status->policy),
+           status->priority, status->cpu_mask,
+           status->sched_applied && status->affinity_applied ? "" : " (requested settings not in effect)");
+    return 0;
+}
+
+int thread_sched_lock_memory(const void* addr, size_t len)
+{
+    if (!addr || len == 0) return 0;
+    if (mlock(addr, len) != 0) {
+        fprintf(stderr, "[%s] mlock of %zu bytes failed (%s)\n", MODULE_TAG, len, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void thread_sched_unlock_memory(const void* addr, size_t len)
+{
+    if (!addr || len == 0) return;
+    munlock(addr, len);
+}
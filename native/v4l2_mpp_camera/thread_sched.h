@@ -0,0 +1,47 @@
+/*
+ * 线程调度 - 按 camera_thread_config_t 创建线程并报告实际生效的设置（库内部接口，类型见 v4l2_mpp_camera.h）
+ *
+ * 1. RT 策略通过 PTHREAD_EXPLICIT_SCHED 在创建时设置，没有 CAP_SYS_NICE/RLIMIT_RTPRIO 时退回普通调度
+ * 2. CPU 亲和性在线程创建后设置，内核只保留掩码中实际存在的核心
+ * 3. 创建后查询线程的实际策略、优先级和亲和性，与请求不符时在状态中标记并打印
+ * 4. 热点内存 mlock，RLIMIT_MEMLOCK 不足时失败但不影响运行
+ */
+
+#ifndef THREAD_SCHED_H
+#define THREAD_SCHED_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "v4l2_mpp_camera.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 创建线程，按配置设置调度策略、优先级、亲和性和线程名
+ * @param name 线程名（最长 15 字符），也用于日志
+ * @param config 调度配置（NULL 表示继承创建者的调度）
+ * @param status 输出实际生效的设置（可为 NULL）
+ * @return 0 成功，否则为 pthread_create 的错误码
+ */
+int thread_sched_create(pthread_t* thread, const char* name, const camera_thread_config_t* config,
+                        void* (*func)(void*), void* arg, camera_thread_status_t* status);
+
+/**
+ * 锁定内存页，不被换出
+ * @return 0 成功，-1 失败（已打印原因）
+ */
+int thread_sched_lock_memory(const void* addr, size_t len);
+
+/**
+ * 解锁 thread_sched_lock_memory 锁定的内存（未锁定时无影响）
+ */
+void thread_sched_unlock_memory(const void* addr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREAD_SCHED_H */
@@ -5,8 +5,22 @@
  * 优化点：
  * 1. 减少 V4L2 缓冲区数量降低延迟
  * 2. 复用 MPP 缓冲区避免频繁分配
- * 3. 非阻塞解码 + 流水线处理
- * 4. 优化的 YUV 转 BGRA（NEON 加速）
+ * 3. 非阻塞解码 + 流水线处理（采集/提交线程 + 输出/转换线程，多帧在途）
+ * 4. 优化的 YUV 转 BGRA（NEON 加速，420SP/422SP 及 VU 变体，BT.601/709，可多线程按行分块）
+ * 5. V4L2 DMABUF/EXPBUF 零拷贝送入 MPP（不支持时回退 MMAP + memcpy）
+ * 6. RGA 缓冲区句柄在初始化时导入并缓存，BGRA 输出使用 DMA 内存
+ * 7. N 槽位无锁帧环 + 引用计数零拷贝读取接口，采集线程从不等待读者
+ * 8. 检测流：RGA 在同一转换阶段输出裁剪/缩放后的 BGR/BGRA/NV12 小图
+ * 9. 解码帧共享：dmabuf 形式的 YUV 解码输出可交给 GStreamer 显示，一次解码多处使用
+ * 10. 可选回调分发器：用户回调在绑核的工作线程池中执行，输出线程从不运行用户代码
+ * 11. 每个句柄独立的性能统计：各阶段延迟 min/avg/p95/max、丢帧和 V4L2 序号缺口
+ * 12. 原始格式采集（YUYV/NV12）：不创建解码器，采集缓冲区直接送 RGA/NEON 转换，无解码延迟
+ * 13. 多平面（MPLANE）采集节点（rkisp/MIPI 摄像头），逐平面导出 dmabuf；单平面 NV12 采集缓冲区可直接共享给显示
+ * 14. 运行中切换分辨率/帧率（低功耗空闲模式），只重建 V4L2 缓冲区，解码器/分发器/足够大的缓冲区保留
+ * 15. 多实例：所有状态都在句柄中；加入相机组时解码输出缓冲区从组缓冲池按帧借用，RGA 作业按相机优先级排队
+ * 16. 采集/输出线程可配置 RT 调度和 CPU 亲和性，热点内存可 mlock，实际生效的设置可查询
+ * 17. 采集线程用 epoll 等待 V4L2 fd 和 eventfd：停止命令和缓冲区归还立即唤醒，空闲时没有周期性唤醒
+ * 18. 可选逐帧追踪（ENABLE_FRAME_TRACE）：出队、MPP 入队/出队、RGA/NEON 转换和用户回调记录带帧号的区间
  */
 
 #define MODULE_TAG "v4l2_mpp_camera"
@@ -18,9 +32,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <time.h>
 #include <linux/videodev2.h>
 
@@ -35,6 +51,10 @@
 #endif
 
 #include "v4l2_mpp_camera.h"
+#include "camera_group.h"
+#include "thread_sched.h"
+#include "yuv_convert.h"
+#include "frame_trace.h"
 
 /* 对齐宏 */
 #ifndef ALIGN
@@ -44,16 +64,59 @@
 /* MPP 错误码 */
 #define MPP_ERR_BUFFER_FULL (-1012)
 
-/* V4L2 缓冲区数量 - 4个平衡延迟和吞吐量 */
+/* 默认 V4L2 缓冲区数量 - 4个平衡延迟和吞吐量 */
 #define V4L2_BUFFER_COUNT 4
 
-/* MPP 解码缓冲区数量 - 增加以支持流水线 */
+/* V4L2 缓冲区数量上限（ISP 驱动可能返回比请求更多的缓冲区） */
+#define V4L2_MAX_BUFFER_COUNT 16
+
+/* 每个 V4L2 缓冲区的最大平面数（NV12M 为 2） */
+#define V4L2_MAX_PLANES 3
+
+/* MPP 解码缓冲区槽位上限 - 增加以支持流水线（实际使用 decode_buffer_count 个，按需分配） */
 #define MPP_BUFFER_COUNT 8
 
-/* 帧缓冲区结构 */
+/* 默认解码缓冲区数：在途解码帧数之外留给外部持有和正在转换的帧 */
+#define DEFAULT_DECODE_BUFFER_EXTRA 4
+
+/* 包缓冲区相对观察到的最大 MJPEG 帧的余量（1/4）和对齐 */
+#define PACKET_BUFFER_HEADROOM_SHIFT 2
+#define PACKET_BUFFER_ALIGN 4096
+
+/* RGA 源句柄缓存容量：解码输出缓冲区 + 原始格式的采集缓冲区 */
+#define RGA_SRC_CACHE_SIZE (MPP_BUFFER_COUNT + V4L2_MAX_BUFFER_COUNT)
+
+/* 默认在途解码帧数 */
+#define DEFAULT_DECODE_QUEUE_DEPTH 2
+
+/* 默认 BGRA 帧环槽位数：一个最新帧 + 一个正在写入 + 一个供慢读者持有 */
+#define DEFAULT_FRAME_RING_SLOTS 3
+
+/* 帧槽写入中标记（refcount） */
+#define SLOT_WRITING (-1)
+
+/* 默认低功耗空闲模式格式 */
+#define DEFAULT_IDLE_WIDTH 320
+#define DEFAULT_IDLE_HEIGHT 240
+#define DEFAULT_IDLE_FPS 5
+
+/* 输出端口轮询超时（毫秒），用于响应停止请求 */
+#define MPP_OUTPUT_POLL_TIMEOUT_MS 100
+
+/* 帧缓冲区的一个平面 */
 typedef struct {
     void* start;
     size_t length;
+    int dmabuf_fd;          /* EXPBUF 模式导出的 dmabuf fd（其他模式为 -1） */
+} v4l2_plane_t;
+
+/* 帧缓冲区结构 */
+typedef struct {
+    v4l2_plane_t planes[V4L2_MAX_PLANES];
+    MppBuffer mpp_buf;      /* 零拷贝模式下平面 0 对应的 MPP 缓冲区（MMAP 模式和多平面格式为 NULL） */
+    atomic_int queued;      /* 是否在驱动队列中 */
+    atomic_int refs;        /* 原始格式：输出线程 + 共享帧持有者的引用，0 时才能重新入队 */
+    atomic_int requeue_pending; /* 原始格式：共享帧在其他线程归还，等待采集线程重新入队 */
 } v4l2_buffer_t;
 
 /* MPP 解码缓冲区 */
@@ -62,62 +125,238 @@ typedef struct {
     MppBuffer frm_buf;
     size_t pkt_buf_size;
     size_t frm_buf_size;
+    atomic_int refs;        /* 解码器在途 + 外部持有的引用，0 时才能提交新的解码 */
+    atomic_int borrowed;    /* frm_buf 借自相机组缓冲池，最后一个引用归还时放回，清零后才能重新借用 */
 } mpp_decode_buffer_t;
 
+/* 解码流水线中的在途任务 */
+typedef struct {
+    int slot;                       /* decode_bufs 索引 */
+    int v4l2_index;                 /* 解码完成后需归还的 V4L2 缓冲区索引，-1 表示无 */
+    size_t bytesused;               /* 原始格式：采集缓冲区有效字节数 */
+    MppPacket packet;
+    MppFrame frame;
+    struct timespec ts_capture;     /* V4L2 出队的时刻 */
+    struct timespec ts_submit;      /* 送入 MPP 的时刻 */
+    camera_frame_info_t info;       /* 出队时填写驱动序号和时间戳，输出时补齐帧序号和解码时间 */
+} decode_job_t;
+
+#ifdef USE_RGA
+/* RGA 源缓冲区句柄缓存项（按 MPP 缓冲区 fd 索引） */
+typedef struct {
+    int fd;
+    rga_buffer_handle_t handle;
+} rga_handle_entry_t;
+#endif
+
+/* 输出帧槽 */
+typedef struct {
+    uint8_t* data;
+    MppBuffer dma_buf;              /* DMA 内存（RGA 可直接按 fd 访问），分配失败时为 NULL 并使用 malloc */
+#ifdef USE_RGA
+    rga_buffer_handle_t rga_handle;
+#endif
+    atomic_int refcount;            /* 读者引用计数，SLOT_WRITING 表示生产者正在写入 */
+    atomic_int consumed;            /* 发布后是否已被读取 */
+    atomic_uint_fast64_t sequence;  /* 槽内帧序号，0 表示空 */
+    camera_frame_info_t info;       /* 槽内帧的时间信息，发布前写入 */
+} frame_slot_t;
+
+/* 输出帧环 - 生产者只写非最新且无读者的槽位 */
+typedef struct {
+    frame_slot_t slots[CAMERA_MAX_FRAME_SLOTS];
+    int slot_count;                 /* 0 表示该输出流未启用 */
+    int last_write_slot;
+    int width;
+    int height;
+    int stride;
+    camera_pixel_format_t format;
+    int buffer_size;
+    int capacity;                   /* 已分配的每槽字节数，切换到更小分辨率时保留原缓冲区 */
+    atomic_uint_fast64_t latest;    /* (sequence << 8) | slot，0 表示尚无帧 */
+    atomic_uint_fast64_t published;
+    atomic_uint_fast64_t overwritten;
+    atomic_uint_fast64_t dropped;
+} frame_ring_t;
+
+/* 一帧 YUV 转换源（MPP 解码输出或原始格式采集缓冲区） */
+typedef struct {
+    yuv_image_t img;                /* CPU 转换描述 */
+    yuv_color_space_t color_space;
+#ifdef USE_RGA
+    rga_buffer_handle_t rga_handle; /* 0 表示不可用（直接走 CPU） */
+    int rga_format;
+    int rga_wstride;                /* 像素 */
+    int rga_hstride;
+#endif
+} convert_source_t;
+
 /* 相机上下文结构 */
 typedef struct {
     /* V4L2 相关 */
     int v4l2_fd;
-    v4l2_buffer_t v4l2_buffers[4];  /* 最大支持4个缓冲区 */
+    enum v4l2_buf_type buf_type;    /* 单平面或多平面（rkisp/MIPI）采集 */
+    int plane_count;                /* 每个缓冲区的平面数 */
+    v4l2_buffer_t* v4l2_buffers;    /* REQBUFS 后按驱动返回的数量分配 */
     int buffer_count;
+    int v4l2_buffer_request;        /* 请求的缓冲区数量 */
+    atomic_int v4l2_queued;         /* 驱动队列中的缓冲区数，0 时不能等待出队 */
     int width;
     int height;
     int fps;
+    size_t v4l2_sizeimage;          /* 驱动报告的单帧最大字节数 */
+    camera_capture_mode_t capture_mode;
+    enum v4l2_memory v4l2_memory;
+    camera_input_format_t input_format;
+    int raw_input;                  /* 原始 YUV 采集：不创建解码器，采集缓冲区直接转换 */
+    int v4l2_bytesperline;
+    bool raw_limited_range;         /* 驱动报告的量化范围和矩阵（原始格式颜色空间自动时使用） */
+    bool raw_bt709;
     
     /* MPP 解码相关 */
     MppCtx mpp_ctx;
     MppApi* mpp_mpi;
     MppBufferGroup frm_grp;
     mpp_decode_buffer_t decode_bufs[MPP_BUFFER_COUNT];
+    int decode_buffer_count;        /* 使用的槽位数 */
     int current_buf_idx;
-    int mpp_initialized;
     
-    /* 输出帧缓冲 - 双缓冲 */
-    uint8_t* bgra_buffer[2];
-    int bgra_write_idx;
-    int bgra_buffer_size;
-    pthread_mutex_t frame_mutex;
+    /* 解码缓冲池：输出缓冲区在槽位首次使用时分配，大小按首帧实际格式确定，包缓冲区按观察到的帧大小增长 */
+    atomic_int frame_bpp_x2;        /* 输出每像素字节数 x2（首帧前按 NV16 为 4，NV12 为 3） */
+    int frame_bpp_applied;          /* 采集线程上次据此决定是否使用共享缓冲区的值 */
+    size_t max_packet_size;         /* 观察到的最大 MJPEG 帧（采集线程） */
+    atomic_int pool_frm_allocated;
+    atomic_size_t pool_frm_size;
+    atomic_size_t pool_pkt_size;
+    atomic_size_t pool_max_packet;
+    atomic_size_t pool_bytes;
+    int mpp_initialized;
+    bool frame_info_logged;         /* 已打印首帧格式 */
+    
+    /* 相机组：pooled 时 decode_bufs 不预分配 frm_buf，每次提交解码时从组缓冲池借用 */
+    camera_group_member_t* group_member;
+    int pooled;
+    
+    /* 解码流水线 - 按提交顺序的在途任务 FIFO（MJPEG 按序输出） */
+    decode_job_t jobs[MPP_BUFFER_COUNT];
+    int job_head;
+    int job_tail;
+    int in_flight;
+    int queue_depth;
+    pthread_mutex_t pipe_mutex;
+    pthread_cond_t pipe_cond;
+    
+    /* 输出帧环（主输出 + 检测流），同一解码帧在各流中使用相同序号 */
+    frame_ring_t rings[CAMERA_STREAM_COUNT];
+    MppBufferGroup ring_grp;
+    uint64_t next_sequence;
+    camera_rect_t detect_roi;
+    camera_rect_t detect_roi_base;  /* 初始化时校验后的 ROI，切换分辨率时按比例换算 */
+    int roi_base_width;
+    int roi_base_height;
+    atomic_int detect_paused;       /* 低功耗空闲模式下不输出检测流 */
+    
+    /* 工作模式：正常模式使用请求的格式，空闲模式使用低分辨率/低帧率 */
+    camera_mode_t mode;
+    int active_width;
+    int active_height;
+    int active_fps;
+    int idle_width;
+    int idle_height;
+    int idle_fps;
+    
+    /* CPU 颜色转换 */
+    camera_color_space_t color_space;
+    yuv_converter_t* converter;     /* 多线程按行分块转换，NULL 表示单线程 */
+    
+    /* 等待新帧的读者（仅读者之间竞争，生产者只在有等待者时短暂加锁通知） */
+    pthread_mutex_t wait_mutex;
+    pthread_cond_t wait_cond;
+    atomic_int waiters;
+
+#ifdef USE_RGA
+    /* RGA 句柄缓存 - 生命周期与相机一致，每帧只需调用 imcvtcolor */
+    rga_handle_entry_t rga_src_cache[RGA_SRC_CACHE_SIZE];
+    int rga_src_count;
+    pthread_mutex_t rga_src_lock;   /* 输出线程查找/导入，采集线程替换输出缓冲区时移除 */
+#endif
     
     /* 线程相关 */
     pthread_t capture_thread;
-    volatile int running;
+    pthread_t output_thread;
+    volatile int running;           /* camera_start 到 camera_stop 之间为 1，只由这两个函数修改 */
+    volatile int pipeline_exit;     /* 输出线程排空在途帧后退出：停止或采集线程异常退出时置位（配合 pipe_mutex） */
     volatile int thread_started;
+    volatile int output_thread_started;
+    pthread_cond_t start_cond;      /* 采集线程已启动或已退出（配合 pipe_mutex） */
+    int wake_fd;                    /* eventfd：停止命令和驱动队列由空变为非空时唤醒采集线程 */
+    camera_thread_config_t capture_sched;
+    camera_thread_config_t output_sched;
+    bool lock_memory;
+    camera_thread_report_t thread_report;   /* camera_start 时填写 */
     
     /* 回调相关 */
     frame_callback_t callback;
     void* user_data;
+    frame_callback_t detect_callback;
+    void* detect_user_data;
+    frame_info_callback_t info_callbacks[CAMERA_STREAM_COUNT];  /* 非 NULL 时替代该流的普通回调 */
+    void* info_user_data[CAMERA_STREAM_COUNT];
+    decoded_frame_callback_t decoded_callback;
+    void* decoded_user_data;
+    dispatcher_handle_t dispatchers[CAMERA_STREAM_COUNT];
     
     /* 性能统计 */
-    int frame_count;
-    int decode_count;
+    atomic_int frame_count;
+    atomic_int decode_count;
+    atomic_int pipeline_drops;      /* 流水线已满而丢弃的帧数 */
+    atomic_int decode_errors;
+    atomic_int frames_skipped;      /* 解码成功但没有输出流发布的帧数（例如槽位全被读者占用） */
+    atomic_uint_fast64_t sequence_gaps;
+    atomic_uint_fast64_t frames_lost;
+    int64_t last_v4l2_sequence;     /* 上一帧的 buf.sequence，-1 表示尚无帧（仅采集线程访问） */
+    latency_stats_t lat_capture;
+    latency_stats_t lat_submit;
+    latency_stats_t lat_decode;
+    latency_stats_t lat_convert;
+    latency_stats_t lat_callback;
+    latency_stats_t lat_end_to_end;
     
 } camera_context_t;
 
 /* 内部函数声明 */
 static int v4l2_init(camera_context_t* ctx, const char* device);
+static int v4l2_set_format(camera_context_t* ctx);
+static void v4l2_set_fps(camera_context_t* ctx);
+static int v4l2_setup_buffers(camera_context_t* ctx);
 static void v4l2_deinit(camera_context_t* ctx);
 static int v4l2_start_streaming(camera_context_t* ctx);
 static void v4l2_stop_streaming(camera_context_t* ctx);
+static void v4l2_release_queue(camera_context_t* ctx, enum v4l2_memory memory);
+static void v4l2_free_buffers(camera_context_t* ctx);
+static int raw_sharing_supported(camera_context_t* ctx);
 static int mpp_decoder_init(camera_context_t* ctx);
+static void mpp_setup_frame_buffers(camera_context_t* ctx);
 static void mpp_decoder_deinit(camera_context_t* ctx);
-static int decode_mjpeg_to_bgra_fast(camera_context_t* ctx, void* mjpeg_data, size_t mjpeg_size);
-static void* capture_thread_func(void* arg);
-
-/* NEON 优化的 YUV 转 BGRA */
-#if defined(__ARM_NEON) || defined(__aarch64__)
-#include <arm_neon.h>
-#define USE_NEON 1
+static void ring_compute_layout(frame_ring_t* ring);
+static int ring_buffers_alloc(camera_context_t* ctx, frame_ring_t* ring);
+static void ring_buffers_free(frame_ring_t* ring);
+#ifdef USE_RGA
+static void rga_cache_init(camera_context_t* ctx);
+static void rga_cache_deinit(camera_context_t* ctx);
+static void rga_cache_forget(camera_context_t* ctx, MppBuffer buf);
 #endif
+static int decode_submit_mjpeg(camera_context_t* ctx, int v4l2_index, size_t mjpeg_size,
+                               const struct timespec* ts_capture, const camera_frame_info_t* info);
+static int decode_collect_frame(camera_context_t* ctx);
+static void decode_pipeline_flush(camera_context_t* ctx);
+static void decode_buffer_unref(camera_context_t* ctx, int index);
+static void dispatch_run(void* user_data, void* item);
+static void dispatch_release(void* user_data, void* item);
+static void* capture_thread_func(void* arg);
+static void capture_wake(camera_context_t* ctx);
+static void* output_thread_func(void* arg);
+static const char* input_format_name(camera_input_format_t format);
 
 /* V4L2 ioctl 包装函数 */
 static int xioctl(int fd, int request, void* arg)
@@ -131,10 +370,26 @@ static int xioctl(int fd, int request, void* arg)
 
 /* 初始化相机 */
 camera_handle_t camera_init(const char* device, int width, int height, int fps)
+{
+    camera_config_t config;
+    
+    memset(&config, 0, sizeof(config));
+    config.device = device;
+    config.width = width;
+    config.height = height;
+    config.fps = fps;
+    config.capture_mode = CAMERA_CAPTURE_AUTO;
+    
+    return camera_init_ex(&config);
+}
+
+/* 使用完整配置初始化相机 */
+camera_handle_t camera_init_ex(const camera_config_t* config)
 {
     camera_context_t* ctx = NULL;
+    int i;
     
-    if (!device || width <= 0 || height <= 0 || fps <= 0) {
+    if (!config || !config->device || config->width <= 0 || config->height <= 0 || config->fps <= 0) {
         fprintf(stderr, "[%s] Invalid parameters\n", MODULE_TAG);
         return NULL;
     }
@@ -145,39 +400,193 @@ camera_handle_t camera_init(const char* device, int width, int height, int fps)
         return NULL;
     }
     
-    ctx->width = width;
-    ctx->height = height;
-    ctx->fps = fps;
+    ctx->width = config->width;
+    ctx->height = config->height;
+    ctx->fps = config->fps;
+    ctx->mode = CAMERA_MODE_ACTIVE;
+    ctx->active_width = config->width;
+    ctx->active_height = config->height;
+    ctx->active_fps = config->fps;
+    ctx->idle_width = config->idle_width > 0 ? config->idle_width : DEFAULT_IDLE_WIDTH;
+    ctx->idle_height = config->idle_height > 0 ? config->idle_height : DEFAULT_IDLE_HEIGHT;
+    ctx->idle_fps = config->idle_fps > 0 ? config->idle_fps : DEFAULT_IDLE_FPS;
+    ctx->capture_mode = config->capture_mode;
+    ctx->input_format = config->input_format;
+    ctx->capture_sched = config->capture_thread;
+    ctx->output_sched = config->output_thread;
+    ctx->lock_memory = config->lock_memory;
+    ctx->queue_depth = config->decode_queue_depth > 0 ? config->decode_queue_depth : DEFAULT_DECODE_QUEUE_DEPTH;
+    if (ctx->queue_depth > MPP_BUFFER_COUNT) ctx->queue_depth = MPP_BUFFER_COUNT;
+    ctx->decode_buffer_count = config->decode_buffer_count > 0 ? config->decode_buffer_count
+                                                               : ctx->queue_depth + DEFAULT_DECODE_BUFFER_EXTRA;
+    if (ctx->decode_buffer_count < ctx->queue_depth + 1) ctx->decode_buffer_count = ctx->queue_depth + 1;
+    if (ctx->decode_buffer_count > MPP_BUFFER_COUNT) ctx->decode_buffer_count = MPP_BUFFER_COUNT;
+    atomic_init(&ctx->frame_bpp_x2, 4);
+    ctx->v4l2_memory = V4L2_MEMORY_MMAP;
+    int slot_count = config->frame_ring_slots > 0 ? config->frame_ring_slots : DEFAULT_FRAME_RING_SLOTS;
+    if (slot_count < 2) slot_count = 2;
+    if (config->callback_workers > 0) {
+        /* 每个工作线程和邮箱各持有一帧，另需最新帧 + 写入槽，避免分发时帧环丢帧 */
+        int needed = config->callback_workers + 3;
+        if (slot_count < needed) slot_count = needed;
+    }
+    if (slot_count > CAMERA_MAX_FRAME_SLOTS) slot_count = CAMERA_MAX_FRAME_SLOTS;
+    if (!config->skip_main_output) {
+        ctx->rings[CAMERA_STREAM_MAIN].slot_count = slot_count;
+        ctx->rings[CAMERA_STREAM_MAIN].format = CAMERA_PIXEL_FORMAT_BGRA8888;
+    }
+    if (config->detect_format != CAMERA_PIXEL_FORMAT_NONE) {
+        if (config->detect_width <= 0 || config->detect_height <= 0) {
+            fprintf(stderr, "[%s] Invalid detect stream size %dx%d\n", MODULE_TAG,
+                    config->detect_width, config->detect_height);
+            free(ctx);
+            return NULL;
+        }
+        frame_ring_t* detect = &ctx->rings[CAMERA_STREAM_DETECT];
+        detect->slot_count = slot_count;
+        detect->format = config->detect_format;
+        detect->width = config->detect_width;
+        detect->height = config->detect_height;
+        if (detect->format == CAMERA_PIXEL_FORMAT_NV12) {
+            detect->width &= ~1;
+            detect->height &= ~1;
+        }
+        ctx->detect_roi = config->detect_roi;
+    }
+    ctx->color_space = config->color_space;
+    for (i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        ctx->rings[i].last_write_slot = -1;
+    }
+    ctx->next_sequence = 1;
     ctx->v4l2_fd = -1;
-    ctx->bgra_write_idx = 0;
-    
-    pthread_mutex_init(&ctx->frame_mutex, NULL);
+    ctx->wake_fd = -1;
+    ctx->v4l2_buffer_request = config->v4l2_buffer_count > 0 ? config->v4l2_buffer_count : V4L2_BUFFER_COUNT;
+    if (ctx->v4l2_buffer_request < 2) ctx->v4l2_buffer_request = 2;
+    if (ctx->v4l2_buffer_request > V4L2_MAX_BUFFER_COUNT) ctx->v4l2_buffer_request = V4L2_MAX_BUFFER_COUNT;
+    
+    pthread_mutex_init(&ctx->wait_mutex, NULL);
+    pthread_cond_init(&ctx->wait_cond, NULL);
+    pthread_mutex_init(&ctx->pipe_mutex, NULL);
+    pthread_cond_init(&ctx->pipe_cond, NULL);
+    pthread_cond_init(&ctx->start_cond, NULL);
+#ifdef USE_RGA
+    pthread_mutex_init(&ctx->rga_src_lock, NULL);
+#endif
+    latency_stats_init(&ctx->lat_capture);
+    latency_stats_init(&ctx->lat_submit);
+    latency_stats_init(&ctx->lat_decode);
+    latency_stats_init(&ctx->lat_convert);
+    latency_stats_init(&ctx->lat_callback);
+    latency_stats_init(&ctx->lat_end_to_end);
+    
+    ctx->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ctx->wake_fd < 0) {
+        fprintf(stderr, "[%s] eventfd failed: %s\n", MODULE_TAG, strerror(errno));
+        camera_deinit(ctx);
+        return NULL;
+    }
     
-    /* 初始化 V4L2 */
-    if (v4l2_init(ctx, device) != 0) {
+    /* 初始化 V4L2（格式协商） */
+    if (v4l2_init(ctx, config->device) != 0) {
         fprintf(stderr, "[%s] V4L2 init failed\n", MODULE_TAG);
         camera_deinit(ctx);
         return NULL;
     }
     
-    /* 初始化 MPP 解码器 */
-    if (mpp_decoder_init(ctx) != 0) {
+    /* 加入相机组：在途解码和转换中的缓冲区为本相机保留（原始格式不借用解码缓冲区，只参与 RGA 调度） */
+    if (config->group) {
+        ctx->group_member = camera_group_join(config->group, config->priority,
+                                              ctx->raw_input ? 0 : ctx->queue_depth + 1);
+        if (!ctx->group_member) {
+            camera_deinit(ctx);
+            return NULL;
+        }
+    }
+    
+    /* 初始化 MPP 解码器（原始格式只需要缓冲组，用于 DMABUF 采集缓冲区） */
+    if (ctx->raw_input) {
+        if (mpp_buffer_group_get_internal(&ctx->frm_grp, MPP_BUFFER_TYPE_ION) != MPP_OK) {
+            fprintf(stderr, "[%s] mpp_buffer_group_get failed\n", MODULE_TAG);
+            camera_deinit(ctx);
+            return NULL;
+        }
+    } else if (mpp_decoder_init(ctx) != 0) {
         fprintf(stderr, "[%s] MPP decoder init failed\n", MODULE_TAG);
         camera_deinit(ctx);
         return NULL;
     }
     
-    /* 分配双 BGRA 输出缓冲区 */
-    ctx->bgra_buffer_size = width * height * 4;
-    ctx->bgra_buffer[0] = (uint8_t*)malloc(ctx->bgra_buffer_size);
-    ctx->bgra_buffer[1] = (uint8_t*)malloc(ctx->bgra_buffer_size);
-    if (!ctx->bgra_buffer[0] || !ctx->bgra_buffer[1]) {
-        fprintf(stderr, "[%s] Failed to allocate BGRA buffer\n", MODULE_TAG);
+    /* 分配 V4L2 缓冲区（DMABUF 模式需要 MPP 缓冲组已就绪） */
+    if (v4l2_setup_buffers(ctx) != 0) {
+        fprintf(stderr, "[%s] V4L2 buffer setup failed\n", MODULE_TAG);
         camera_deinit(ctx);
         return NULL;
     }
     
-    printf("[%s] Camera initialized: %s %dx%d@%dfps (optimized)\n", MODULE_TAG, device, width, height, fps);
+    /* 原始格式的在途帧直接占用采集缓冲区，至少保留一个在驱动中 */
+    if (ctx->raw_input && ctx->queue_depth > ctx->buffer_count - 1) {
+        ctx->queue_depth = ctx->buffer_count - 1;
+    }
+    
+    /* 分配输出帧环（主输出尺寸在格式协商后才确定） */
+    ctx->rings[CAMERA_STREAM_MAIN].width = ctx->width;
+    ctx->rings[CAMERA_STREAM_MAIN].height = ctx->height;
+    if (ctx->detect_roi.width <= 0 || ctx->detect_roi.height <= 0 ||
+        ctx->detect_roi.x < 0 || ctx->detect_roi.y < 0 ||
+        ctx->detect_roi.x + ctx->detect_roi.width > ctx->width ||
+        ctx->detect_roi.y + ctx->detect_roi.height > ctx->height) {
+        if (ctx->detect_roi.width > 0 || ctx->detect_roi.height > 0) {
+            fprintf(stderr, "[%s] Detect ROI out of range, using full frame\n", MODULE_TAG);
+        }
+        ctx->detect_roi.x = 0;
+        ctx->detect_roi.y = 0;
+        ctx->detect_roi.width = ctx->width;
+        ctx->detect_roi.height = ctx->height;
+    }
+    ctx->detect_roi_base = ctx->detect_roi;
+    ctx->roi_base_width = ctx->width;
+    ctx->roi_base_height = ctx->height;
+    for (i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        if (ctx->rings[i].slot_count > 0 && ring_buffers_alloc(ctx, &ctx->rings[i]) != 0) {
+            fprintf(stderr, "[%s] Failed to allocate output buffers (stream %d)\n", MODULE_TAG, i);
+            camera_deinit(ctx);
+            return NULL;
+        }
+    }
+
+#ifdef USE_RGA
+    /* 源/目标缓冲区在相机生命周期内固定，一次性导入 RGA */
+    rga_cache_init(ctx);
+#endif
+    
+    /* CPU 转换线程：RGA 构建中只在 RGA 失败时使用，线程平时处于等待状态 */
+    if (config->convert_threads > 1 && ctx->rings[CAMERA_STREAM_MAIN].slot_count > 0) {
+        ctx->converter = yuv_converter_create(config->convert_threads);
+    }
+    
+    /* 回调分发器：每个启用的输出流一个，回调在工作线程中执行 */
+    if (config->callback_workers > 0) {
+        for (i = 0; i < CAMERA_STREAM_COUNT; i++) {
+            if (ctx->rings[i].slot_count == 0) continue;
+            dispatcher_config_t dcfg = {
+                .name = i == CAMERA_STREAM_MAIN ? "cam-main" : "cam-detect",
+                .worker_count = config->callback_workers,
+                .cpu_mask = config->callback_cpu_mask,
+                .run = dispatch_run,
+                .release = dispatch_release,
+                .user_data = ctx,
+            };
+            ctx->dispatchers[i] = dispatcher_create(&dcfg);
+            if (!ctx->dispatchers[i]) {
+                fprintf(stderr, "[%s] Failed to create callback dispatcher (stream %d)\n", MODULE_TAG, i);
+                camera_deinit(ctx);
+                return NULL;
+            }
+        }
+    }
+    
+    printf("[%s] Camera initialized: %s %dx%d@%dfps %s (optimized)\n", MODULE_TAG,
+           config->device, ctx->width, ctx->height, ctx->fps, input_format_name(ctx->input_format));
     return (camera_handle_t)ctx;
 }
 
@@ -191,42 +600,148 @@ void camera_deinit(camera_handle_t handle)
     /* 确保停止采集 */
     camera_stop(handle);
     
-    /* 释放 BGRA 缓冲区 */
-    if (ctx->bgra_buffer[0]) {
-        free(ctx->bgra_buffer[0]);
-        ctx->bgra_buffer[0] = NULL;
+    /* 销毁回调分发器（归还其持有的帧环引用） */
+    for (int i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        dispatcher_destroy(ctx->dispatchers[i]);
+        ctx->dispatchers[i] = NULL;
+    }
+    
+    yuv_converter_destroy(ctx->converter);
+    ctx->converter = NULL;
+
+#ifdef USE_RGA
+    /* 释放 RGA 句柄（先于其引用的缓冲区） */
+    rga_cache_deinit(ctx);
+#endif
+    
+    /* 释放输出帧环 */
+    for (int i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        ring_buffers_free(&ctx->rings[i]);
     }
-    if (ctx->bgra_buffer[1]) {
-        free(ctx->bgra_buffer[1]);
-        ctx->bgra_buffer[1] = NULL;
+    if (ctx->ring_grp) {
+        mpp_buffer_group_put(ctx->ring_grp);
+        ctx->ring_grp = NULL;
     }
     
+    /* 释放 V4L2 资源（先于 MPP，DMABUF 模式的缓冲区属于 MPP 缓冲组） */
+    v4l2_deinit(ctx);
+    
     /* 释放 MPP 解码器 */
     mpp_decoder_deinit(ctx);
     
-    /* 释放 V4L2 资源 */
-    v4l2_deinit(ctx);
+    camera_group_leave(ctx->group_member);
+    ctx->group_member = NULL;
     
-    pthread_mutex_destroy(&ctx->frame_mutex);
+    if (ctx->wake_fd >= 0) {
+        close(ctx->wake_fd);
+        ctx->wake_fd = -1;
+    }
+    
+    pthread_mutex_destroy(&ctx->wait_mutex);
+    pthread_cond_destroy(&ctx->wait_cond);
+    pthread_mutex_destroy(&ctx->pipe_mutex);
+    pthread_cond_destroy(&ctx->pipe_cond);
+    pthread_cond_destroy(&ctx->start_cond);
+#ifdef USE_RGA
+    pthread_mutex_destroy(&ctx->rga_src_lock);
+#endif
+    latency_stats_destroy(&ctx->lat_capture);
+    latency_stats_destroy(&ctx->lat_submit);
+    latency_stats_destroy(&ctx->lat_decode);
+    latency_stats_destroy(&ctx->lat_convert);
+    latency_stats_destroy(&ctx->lat_callback);
+    latency_stats_destroy(&ctx->lat_end_to_end);
     
     free(ctx);
     printf("[%s] Camera deinitialized\n", MODULE_TAG);
 }
 
+/* 锁定/解锁热点内存：相机上下文（帧环、解码缓冲区表、统计）+ 非 DMA 输出帧缓冲区，
+ * DMA/ION 缓冲区和 V4L2 MMAP 缓冲区本身不会被换出 */
+static void camera_lock_memory(camera_context_t* ctx, bool lock)
+{
+    camera_thread_report_t* report = &ctx->thread_report;
+    bool all_locked = true;
+    size_t locked = 0;
+    
+    if (!lock) {
+        thread_sched_unlock_memory(ctx, sizeof(*ctx));
+        for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+            for (int i = 0; i < ctx->rings[s].slot_count; i++) {
+                frame_slot_t* slot = &ctx->rings[s].slots[i];
+                if (!slot->dma_buf) thread_sched_unlock_memory(slot->data, ctx->rings[s].capacity);
+            }
+        }
+        return;
+    }
+    
+    if (thread_sched_lock_memory(ctx, sizeof(*ctx)) == 0) {
+        locked += sizeof(*ctx);
+    } else {
+        all_locked = false;
+    }
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        for (int i = 0; i < ctx->rings[s].slot_count; i++) {
+            frame_slot_t* slot = &ctx->rings[s].slots[i];
+            if (slot->dma_buf || !slot->data) continue;
+            if (thread_sched_lock_memory(slot->data, ctx->rings[s].capacity) == 0) {
+                locked += ctx->rings[s].capacity;
+            } else {
+                all_locked = false;
+            }
+        }
+    }
+    
+    report->lock_requested = true;
+    report->memory_locked = all_locked;
+    report->locked_bytes = locked;
+    printf("[%s] Locked %zu bytes of camera memory%s\n", MODULE_TAG, locked,
+           all_locked ? "" : " (incomplete, check RLIMIT_MEMLOCK)");
+}
+
+/* 正在采集：已启动且采集线程没有因错误退出 */
+static int camera_capturing(const camera_context_t* ctx)
+{
+    return ctx->running && !ctx->pipeline_exit;
+}
+
 /* 启动相机采集 */
 camera_error_t camera_start(camera_handle_t handle, frame_callback_t callback, void* user_data)
 {
     camera_context_t* ctx = (camera_context_t*)handle;
     
     if (!ctx) return CAMERA_ERROR_INVALID_PARAM;
-    if (ctx->running) return CAMERA_OK;
+    if (camera_capturing(ctx)) return CAMERA_OK;
+    
+    /* 采集线程异常退出后先回收上次的线程和在途任务 */
+    if (ctx->running) camera_stop(handle);
     
     ctx->callback = callback;
     ctx->user_data = user_data;
     ctx->running = 1;
+    ctx->pipeline_exit = 0;
     ctx->thread_started = 0;
+    ctx->output_thread_started = 0;
     ctx->frame_count = 0;
     ctx->decode_count = 0;
+    ctx->pipeline_drops = 0;
+    ctx->decode_errors = 0;
+    ctx->frames_skipped = 0;
+    atomic_store(&ctx->sequence_gaps, 0);
+    atomic_store(&ctx->frames_lost, 0);
+    ctx->last_v4l2_sequence = -1;
+    latency_stats_reset(&ctx->lat_capture);
+    latency_stats_reset(&ctx->lat_submit);
+    latency_stats_reset(&ctx->lat_decode);
+    latency_stats_reset(&ctx->lat_convert);
+    latency_stats_reset(&ctx->lat_callback);
+    latency_stats_reset(&ctx->lat_end_to_end);
+    ctx->job_head = 0;
+    ctx->job_tail = 0;
+    ctx->in_flight = 0;
+    for (int i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        atomic_store(&ctx->rings[i].latest, 0);  /* 不向新的会话返回上次的旧帧 */
+    }
     
     /* 启动 V4L2 流 */
     if (v4l2_start_streaming(ctx) != 0) {
@@ -234,35 +749,45 @@ camera_error_t camera_start(camera_handle_t handle, frame_callback_t callback, v
         return CAMERA_ERROR_V4L2_INIT_FAILED;
     }
     
-    /* 启动采集线程 - 高优先级 */
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
+    /* 锁定热点内存，避免 RT 线程访问时缺页 */
+    memset(&ctx->thread_report, 0, sizeof(ctx->thread_report));
+    if (ctx->lock_memory) camera_lock_memory(ctx, true);
     
-    struct sched_param param;
-    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
-    pthread_attr_setschedparam(&attr, &param);
+    /* 启动输出/转换线程 - 与采集线程并行，吞吐量取决于最慢的一级 */
+    if (thread_sched_create(&ctx->output_thread, "cam-output", &ctx->output_sched, output_thread_func, ctx,
+                            &ctx->thread_report.output) != 0) {
+        fprintf(stderr, "[%s] Failed to create output thread\n", MODULE_TAG);
+        v4l2_stop_streaming(ctx);
+        if (ctx->lock_memory) camera_lock_memory(ctx, false);
+        ctx->running = 0;
+        return CAMERA_ERROR_V4L2_INIT_FAILED;
+    }
+    ctx->output_thread_started = 1;
     
-    if (pthread_create(&ctx->capture_thread, &attr, capture_thread_func, ctx) != 0) {
-        /* 如果高优先级失败，尝试普通优先级 */
-        pthread_attr_destroy(&attr);
-        pthread_attr_init(&attr);
-        if (pthread_create(&ctx->capture_thread, &attr, capture_thread_func, ctx) != 0) {
-            fprintf(stderr, "[%s] Failed to create capture thread\n", MODULE_TAG);
-            v4l2_stop_streaming(ctx);
-            ctx->running = 0;
-            pthread_attr_destroy(&attr);
-            return CAMERA_ERROR_V4L2_INIT_FAILED;
-        }
+    /* 启动采集线程（RT 调度不被允许时以普通调度运行） */
+    if (thread_sched_create(&ctx->capture_thread, "cam-capture", &ctx->capture_sched, capture_thread_func, ctx,
+                            &ctx->thread_report.capture) != 0) {
+        fprintf(stderr, "[%s] Failed to create capture thread\n", MODULE_TAG);
+        ctx->running = 0;
+        pthread_mutex_lock(&ctx->pipe_mutex);
+        ctx->pipeline_exit = 1;
+        pthread_cond_broadcast(&ctx->pipe_cond);
+        pthread_mutex_unlock(&ctx->pipe_mutex);
+        pthread_join(ctx->output_thread, NULL);
+        ctx->output_thread_started = 0;
+        v4l2_stop_streaming(ctx);
+        if (ctx->lock_memory) camera_lock_memory(ctx, false);
+        return CAMERA_ERROR_V4L2_INIT_FAILED;
     }
-    pthread_attr_destroy(&attr);
     
     /* 等待线程启动 */
-    while (!ctx->thread_started && ctx->running) {
-        usleep(100);
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    while (!ctx->thread_started) {
+        pthread_cond_wait(&ctx->start_cond, &ctx->pipe_mutex);
     }
+    pthread_mutex_unlock(&ctx->pipe_mutex);
     
-    printf("[%s] Camera started\n", MODULE_TAG);
+    printf("[%s] Camera started (decode queue depth %d)\n", MODULE_TAG, ctx->queue_depth);
     return CAMERA_OK;
 }
 
@@ -272,21 +797,48 @@ camera_error_t camera_stop(camera_handle_t handle)
     camera_context_t* ctx = (camera_context_t*)handle;
     
     if (!ctx) return CAMERA_ERROR_INVALID_PARAM;
-    if (!ctx->running) return CAMERA_OK;
+    /* 采集线程异常退出后 running 仍为 1，线程和 V4L2 流同样在这里回收 */
+    if (!ctx->running && !ctx->thread_started && !ctx->output_thread_started) return CAMERA_OK;
     
     ctx->running = 0;
     
-    /* 等待采集线程结束 */
+    /* 唤醒并等待采集线程结束 */
+    capture_wake(ctx);
     if (ctx->thread_started) {
         pthread_join(ctx->capture_thread, NULL);
         ctx->thread_started = 0;
     }
     
+    /* 唤醒并等待输出线程（会先排空在途帧） */
+    if (ctx->output_thread_started) {
+        pthread_mutex_lock(&ctx->pipe_mutex);
+        ctx->pipeline_exit = 1;
+        pthread_cond_broadcast(&ctx->pipe_cond);
+        pthread_mutex_unlock(&ctx->pipe_mutex);
+        pthread_join(ctx->output_thread, NULL);
+        ctx->output_thread_started = 0;
+    }
+    
+    /* 回收未能排空的任务 */
+    decode_pipeline_flush(ctx);
+    
+    /* 丢弃未处理的回调帧并等待正在执行的回调结束，返回后不再有回调 */
+    for (int i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        dispatcher_flush(ctx->dispatchers[i]);
+    }
+    
+    /* 唤醒等待新帧的读者 */
+    pthread_mutex_lock(&ctx->wait_mutex);
+    pthread_cond_broadcast(&ctx->wait_cond);
+    pthread_mutex_unlock(&ctx->wait_mutex);
+    
     /* 停止 V4L2 流 */
     v4l2_stop_streaming(ctx);
     
-    printf("[%s] Camera stopped (frames: %d, decoded: %d)\n", 
-           MODULE_TAG, ctx->frame_count, ctx->decode_count);
+    if (ctx->lock_memory) camera_lock_memory(ctx, false);
+    
+    printf("[%s] Camera stopped (frames: %d, decoded: %d, pipeline drops: %d)\n", 
+           MODULE_TAG, ctx->frame_count, ctx->decode_count, ctx->pipeline_drops);
     return CAMERA_OK;
 }
 
@@ -294,802 +846,2814 @@ camera_error_t camera_stop(camera_handle_t handle)
 bool camera_is_running(camera_handle_t handle)
 {
     camera_context_t* ctx = (camera_context_t*)handle;
-    return ctx && ctx->running;
+    return ctx && camera_capturing(ctx);
 }
 
-/* 获取最新的一帧 */
-camera_error_t camera_capture_frame(camera_handle_t handle, uint8_t* bgra_data, 
-                                     int buffer_size, int* width, int* height, int timeout_ms)
+/* 尝试引用指定帧环的最新帧，成功返回 0 */
+static int ring_try_acquire(frame_ring_t* ring, camera_stream_t stream, uint64_t last_sequence,
+                            camera_frame_t* frame)
+{
+    for (;;) {
+        uint64_t packed = atomic_load_explicit(&ring->latest, memory_order_acquire);
+        if (packed == 0) return -1;
+        
+        uint64_t seq = packed >> 8;
+        int idx = (int)(packed & 0xff);
+        if (seq <= last_sequence) return -1;
+        
+        frame_slot_t* slot = &ring->slots[idx];
+        int ref = atomic_load_explicit(&slot->refcount, memory_order_relaxed);
+        if (ref == SLOT_WRITING) continue;  /* 槽位已被复用，重新读取最新帧 */
+        if (!atomic_compare_exchange_weak_explicit(&slot->refcount, &ref, ref + 1,
+                                                   memory_order_acquire, memory_order_relaxed)) {
+            continue;
+        }
+        
+        /* 加引用后再确认槽内仍是该帧（引用期间生产者不会再写入此槽） */
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != seq) {
+            atomic_fetch_sub_explicit(&slot->refcount, 1, memory_order_release);
+            continue;
+        }
+        
+        atomic_store_explicit(&slot->consumed, 1, memory_order_relaxed);
+        frame->data = slot->data;
+        frame->width = ring->width;
+        frame->height = ring->height;
+        frame->stride = ring->stride;
+        frame->format = ring->format;
+        frame->sequence = seq;
+        frame->stream = stream;
+        frame->slot = idx;
+        frame->info = slot->info;
+        return 0;
+    }
+}
+
+/* 获取指定输出流最新一帧的零拷贝引用 */
+camera_error_t camera_acquire_stream_frame(camera_handle_t handle, camera_stream_t stream,
+                                            camera_frame_t* frame, uint64_t last_sequence,
+                                            int timeout_ms)
 {
     camera_context_t* ctx = (camera_context_t*)handle;
     
-    if (!ctx || !bgra_data) return CAMERA_ERROR_INVALID_PARAM;
-    if (!ctx->running) return CAMERA_ERROR_NOT_RUNNING;
-    if (buffer_size < ctx->bgra_buffer_size) return CAMERA_ERROR_INVALID_PARAM;
+    if (!ctx || !frame || stream < 0 || stream >= CAMERA_STREAM_COUNT) return CAMERA_ERROR_INVALID_PARAM;
     
-    /* 读取最新帧（使用不是当前写入的那个） */
-    int read_idx = 1 - ctx->bgra_write_idx;
+    frame_ring_t* ring = &ctx->rings[stream];
+    if (ring->slot_count == 0) return CAMERA_ERROR_NOT_SUPPORTED;
     
-    pthread_mutex_lock(&ctx->frame_mutex);
-    memcpy(bgra_data, ctx->bgra_buffer[read_idx], ctx->bgra_buffer_size);
-    pthread_mutex_unlock(&ctx->frame_mutex);
+    if (ring_try_acquire(ring, stream, last_sequence, frame) == 0) return CAMERA_OK;
+    if (!camera_capturing(ctx)) return CAMERA_ERROR_NOT_RUNNING;
+    if (timeout_ms <= 0) return CAMERA_ERROR_TIMEOUT;
     
-    if (width) *width = ctx->width;
-    if (height) *height = ctx->height;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
     
-    return CAMERA_OK;
+    camera_error_t result = CAMERA_ERROR_TIMEOUT;
+    pthread_mutex_lock(&ctx->wait_mutex);
+    atomic_fetch_add(&ctx->waiters, 1);
+    for (;;) {
+        if (ring_try_acquire(ring, stream, last_sequence, frame) == 0) {
+            result = CAMERA_OK;
+            break;
+        }
+        if (!camera_capturing(ctx)) {
+            result = CAMERA_ERROR_NOT_RUNNING;
+            break;
+        }
+        if (pthread_cond_timedwait(&ctx->wait_cond, &ctx->wait_mutex, &deadline) == ETIMEDOUT) {
+            if (ring_try_acquire(ring, stream, last_sequence, frame) == 0) result = CAMERA_OK;
+            break;
+        }
+    }
+    atomic_fetch_sub(&ctx->waiters, 1);
+    pthread_mutex_unlock(&ctx->wait_mutex);
+    
+    return result;
 }
 
-/* 获取错误描述 */
-const char* camera_get_error_string(camera_error_t error)
+/* 获取主输出流最新一帧的零拷贝引用 */
+camera_error_t camera_acquire_frame(camera_handle_t handle, camera_frame_t* frame,
+                                     uint64_t last_sequence, int timeout_ms)
 {
-    switch (error) {
-        case CAMERA_OK: return "OK";
-        case CAMERA_ERROR_DEVICE_NOT_FOUND: return "Device not found";
-        case CAMERA_ERROR_DEVICE_BUSY: return "Device busy";
-        case CAMERA_ERROR_NOT_SUPPORTED: return "Not supported";
-        case CAMERA_ERROR_INVALID_PARAM: return "Invalid parameter";
-        case CAMERA_ERROR_MPP_INIT_FAILED: return "MPP init failed";
-        case CAMERA_ERROR_V4L2_INIT_FAILED: return "V4L2 init failed";
-        case CAMERA_ERROR_OUT_OF_MEMORY: return "Out of memory";
-        case CAMERA_ERROR_DECODE_FAILED: return "Decode failed";
-        case CAMERA_ERROR_NOT_RUNNING: return "Not running";
-        default: return "Unknown error";
-    }
+    return camera_acquire_stream_frame(handle, CAMERA_STREAM_MAIN, frame, last_sequence, timeout_ms);
 }
 
-/* V4L2 初始化 */
-static int v4l2_init(camera_context_t* ctx, const char* device)
+/* 归还帧引用 */
+camera_error_t camera_release_frame(camera_handle_t handle, const camera_frame_t* frame)
 {
-    struct v4l2_capability cap;
-    struct v4l2_format fmt;
-    struct v4l2_requestbuffers req;
-    struct v4l2_streamparm parm;
-    int i;
-    
-    /* 打开设备 - 使用 O_NONBLOCK 非阻塞模式 */
-    ctx->v4l2_fd = open(device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
-    if (ctx->v4l2_fd < 0) {
-        fprintf(stderr, "[%s] Cannot open device %s: %s\n", MODULE_TAG, device, strerror(errno));
-        return -1;
-    }
-    
-    /* 查询设备能力 */
-    if (xioctl(ctx->v4l2_fd, VIDIOC_QUERYCAP, &cap) < 0) {
-        fprintf(stderr, "[%s] VIDIOC_QUERYCAP failed: %s\n", MODULE_TAG, strerror(errno));
-        return -1;
-    }
-    
-    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
-        fprintf(stderr, "[%s] Device does not support video capture\n", MODULE_TAG);
-        return -1;
-    }
+    camera_context_t* ctx = (camera_context_t*)handle;
     
-    if (!(cap.capabilities & V4L2_CAP_STREAMING)) {
-        fprintf(stderr, "[%s] Device does not support streaming\n", MODULE_TAG);
-        return -1;
+    if (!ctx || !frame || frame->stream < 0 || frame->stream >= CAMERA_STREAM_COUNT) {
+        return CAMERA_ERROR_INVALID_PARAM;
     }
     
-    /* 设置视频格式为 MJPEG */
-    memset(&fmt, 0, sizeof(fmt));
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = ctx->width;
-    fmt.fmt.pix.height = ctx->height;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
-    fmt.fmt.pix.field = V4L2_FIELD_NONE;
-    
-    if (xioctl(ctx->v4l2_fd, VIDIOC_S_FMT, &fmt) < 0) {
-        fprintf(stderr, "[%s] VIDIOC_S_FMT failed: %s\n", MODULE_TAG, strerror(errno));
-        return -1;
+    frame_ring_t* ring = &ctx->rings[frame->stream];
+    if (frame->slot < 0 || frame->slot >= ring->slot_count) {
+        return CAMERA_ERROR_INVALID_PARAM;
     }
     
-    /* 验证格式 */
-    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_MJPEG) {
-        fprintf(stderr, "[%s] Device does not support MJPEG format\n", MODULE_TAG);
-        return -1;
-    }
+    atomic_fetch_sub_explicit(&ring->slots[frame->slot].refcount, 1, memory_order_release);
+    return CAMERA_OK;
+}
+
+/* 设置解码帧回调 */
+camera_error_t camera_set_decoded_callback(camera_handle_t handle, decoded_frame_callback_t callback,
+                                           void* user_data)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
     
-    ctx->width = fmt.fmt.pix.width;
-    ctx->height = fmt.fmt.pix.height;
+    if (!ctx) return CAMERA_ERROR_INVALID_PARAM;
     
-    printf("[%s] Video format: %dx%d MJPEG\n", MODULE_TAG, ctx->width, ctx->height);
+    /* 原始格式只有单平面 NV12 且采集缓冲区有 dmabuf fd 时才能共享 */
+    if (callback && ctx->raw_input && !raw_sharing_supported(ctx)) return CAMERA_ERROR_NOT_SUPPORTED;
     
-    /* 设置帧率 */
-    memset(&parm, 0, sizeof(parm));
-    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    parm.parm.capture.timeperframe.numerator = 1;
-    parm.parm.capture.timeperframe.denominator = ctx->fps;
+    ctx->decoded_user_data = user_data;
+    ctx->decoded_callback = callback;
+    return CAMERA_OK;
+}
+
+/* 持有解码帧 */
+camera_error_t camera_hold_decoded_frame(camera_handle_t handle, const camera_decoded_frame_t* frame)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
     
-    if (xioctl(ctx->v4l2_fd, VIDIOC_S_PARM, &parm) < 0) {
-        fprintf(stderr, "[%s] VIDIOC_S_PARM failed (fps): %s\n", MODULE_TAG, strerror(errno));
+    if (!ctx || !frame || frame->index < 0 ||
+        frame->index >= (ctx->raw_input ? ctx->buffer_count : MPP_BUFFER_COUNT)) {
+        return CAMERA_ERROR_INVALID_PARAM;
     }
     
-    /* 请求缓冲区 - 最小化延迟 */
-    memset(&req, 0, sizeof(req));
-    req.count = V4L2_BUFFER_COUNT;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    
-    if (xioctl(ctx->v4l2_fd, VIDIOC_REQBUFS, &req) < 0) {
-        fprintf(stderr, "[%s] VIDIOC_REQBUFS failed: %s\n", MODULE_TAG, strerror(errno));
-        return -1;
-    }
+    /* 原始格式共享的是采集缓冲区，持有期间不会重新入队 */
+    atomic_int* refs = ctx->raw_input ? &ctx->v4l2_buffers[frame->index].refs : &ctx->decode_bufs[frame->index].refs;
+    atomic_fetch_add_explicit(refs, 1, memory_order_relaxed);
+    return CAMERA_OK;
+}
+
+/* 归还持有的解码帧 */
+camera_error_t camera_release_decoded_frame(camera_handle_t handle, const camera_decoded_frame_t* frame)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
     
-    if (req.count < 2) {
-        fprintf(stderr, "[%s] Insufficient buffer memory\n", MODULE_TAG);
-        return -1;
+    if (!ctx || !frame || frame->index < 0 ||
+        frame->index >= (ctx->raw_input ? ctx->buffer_count : MPP_BUFFER_COUNT)) {
+        return CAMERA_ERROR_INVALID_PARAM;
     }
     
-    ctx->buffer_count = req.count;
-    
-    /* 映射缓冲区 */
-    for (i = 0; i < ctx->buffer_count; i++) {
-        struct v4l2_buffer buf;
-        
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        
-        if (xioctl(ctx->v4l2_fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            fprintf(stderr, "[%s] VIDIOC_QUERYBUF failed: %s\n", MODULE_TAG, strerror(errno));
-            return -1;
-        }
-        
-        ctx->v4l2_buffers[i].length = buf.length;
-        ctx->v4l2_buffers[i].start = mmap(NULL, buf.length,
-                                           PROT_READ | PROT_WRITE,
-                                           MAP_SHARED,
-                                           ctx->v4l2_fd, buf.m.offset);
-        
-        if (ctx->v4l2_buffers[i].start == MAP_FAILED) {
-            fprintf(stderr, "[%s] mmap failed: %s\n", MODULE_TAG, strerror(errno));
-            return -1;
+    if (ctx->raw_input) {
+        /* 最后一个引用：不在调用线程中 QBUF，交给采集线程重新入队 */
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[frame->index];
+        if (atomic_fetch_sub_explicit(&vbuf->refs, 1, memory_order_acq_rel) == 1) {
+            atomic_store_explicit(&vbuf->requeue_pending, 1, memory_order_release);
+            capture_wake(ctx);
         }
+        return CAMERA_OK;
     }
     
-    printf("[%s] V4L2 initialized with %d buffers (low latency)\n", MODULE_TAG, ctx->buffer_count);
-    return 0;
+    decode_buffer_unref(ctx, frame->index);
+    return CAMERA_OK;
 }
 
-/* V4L2 释放 */
-static void v4l2_deinit(camera_context_t* ctx)
+/* 获取回调分发器统计 */
+camera_error_t camera_get_dispatch_stats(camera_handle_t handle, camera_stream_t stream,
+                                          dispatcher_stats_t* stats)
 {
-    int i;
+    camera_context_t* ctx = (camera_context_t*)handle;
     
-    for (i = 0; i < ctx->buffer_count; i++) {
-        if (ctx->v4l2_buffers[i].start && ctx->v4l2_buffers[i].start != MAP_FAILED) {
-            munmap(ctx->v4l2_buffers[i].start, ctx->v4l2_buffers[i].length);
-            ctx->v4l2_buffers[i].start = NULL;
-        }
-    }
+    if (!ctx || !stats || stream < 0 || stream >= CAMERA_STREAM_COUNT) return CAMERA_ERROR_INVALID_PARAM;
+    if (!ctx->dispatchers[stream]) return CAMERA_ERROR_NOT_SUPPORTED;
     
-    if (ctx->v4l2_fd >= 0) {
-        close(ctx->v4l2_fd);
+    dispatcher_get_stats(ctx->dispatchers[stream], stats);
+    return CAMERA_OK;
+}
+
+/* 设置检测流回调 */
+camera_error_t camera_set_detect_callback(camera_handle_t handle, frame_callback_t callback, void* user_data)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx) return CAMERA_ERROR_INVALID_PARAM;
+    if (ctx->rings[CAMERA_STREAM_DETECT].slot_count == 0) return CAMERA_ERROR_NOT_SUPPORTED;
+    
+    ctx->detect_user_data = user_data;
+    ctx->detect_callback = callback;
+    return CAMERA_OK;
+}
+
+/* 设置带时间信息的帧回调 */
+camera_error_t camera_set_frame_info_callback(camera_handle_t handle, camera_stream_t stream,
+                                              frame_info_callback_t callback, void* user_data)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx || stream < 0 || stream >= CAMERA_STREAM_COUNT) return CAMERA_ERROR_INVALID_PARAM;
+    if (ctx->rings[stream].slot_count == 0) return CAMERA_ERROR_NOT_SUPPORTED;
+    
+    ctx->info_user_data[stream] = user_data;
+    ctx->info_callbacks[stream] = callback;
+    return CAMERA_OK;
+}
+
+/* 获取指定输出流帧环形缓冲区统计 */
+camera_error_t camera_get_stream_ring_stats(camera_handle_t handle, camera_stream_t stream,
+                                             camera_ring_stats_t* stats)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx || !stats || stream < 0 || stream >= CAMERA_STREAM_COUNT) return CAMERA_ERROR_INVALID_PARAM;
+    
+    frame_ring_t* ring = &ctx->rings[stream];
+    stats->frames_published = atomic_load(&ring->published);
+    stats->frames_overwritten = atomic_load(&ring->overwritten);
+    stats->frames_dropped = atomic_load(&ring->dropped);
+    return CAMERA_OK;
+}
+
+/* 获取相机性能统计 */
+camera_error_t camera_get_stats(camera_handle_t handle, camera_stats_t* stats)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx || !stats) return CAMERA_ERROR_INVALID_PARAM;
+    
+    stats->frames_captured = (uint64_t)ctx->frame_count;
+    stats->frames_decoded = (uint64_t)ctx->decode_count;
+    stats->pipeline_drops = (uint64_t)ctx->pipeline_drops;
+    stats->decode_errors = (uint64_t)ctx->decode_errors;
+    stats->frames_skipped = (uint64_t)ctx->frames_skipped;
+    stats->sequence_gaps = atomic_load(&ctx->sequence_gaps);
+    stats->frames_lost = atomic_load(&ctx->frames_lost);
+    latency_stats_summary(&ctx->lat_capture, &stats->capture);
+    latency_stats_summary(&ctx->lat_submit, &stats->submit);
+    latency_stats_summary(&ctx->lat_decode, &stats->decode);
+    latency_stats_summary(&ctx->lat_convert, &stats->convert);
+    latency_stats_summary(&ctx->lat_callback, &stats->callback);
+    latency_stats_summary(&ctx->lat_end_to_end, &stats->end_to_end);
+    
+    stats->decode_buffers = ctx->raw_input ? 0 : ctx->decode_buffer_count;
+    stats->decode_buffers_allocated = atomic_load(&ctx->pool_frm_allocated);
+    stats->decode_buffers_in_use = 0;
+    for (int i = 0; i < stats->decode_buffers; i++) {
+        if (atomic_load_explicit(&ctx->decode_bufs[i].refs, memory_order_acquire) > 0) stats->decode_buffers_in_use++;
+    }
+    stats->decode_buffer_size = atomic_load(&ctx->pool_frm_size);
+    stats->packet_buffer_size = atomic_load(&ctx->pool_pkt_size);
+    stats->max_packet_size = atomic_load(&ctx->pool_max_packet);
+    stats->decode_pool_bytes = atomic_load(&ctx->pool_bytes);
+    return CAMERA_OK;
+}
+
+/* 获取线程调度和内存锁定的实际状态 */
+camera_error_t camera_get_thread_report(camera_handle_t handle, camera_thread_report_t* report)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx || !report) return CAMERA_ERROR_INVALID_PARAM;
+    if (!ctx->thread_report.capture.started) return CAMERA_ERROR_NOT_RUNNING;
+    
+    *report = ctx->thread_report;
+    return CAMERA_OK;
+}
+
+/* 获取主输出流帧环形缓冲区统计 */
+camera_error_t camera_get_ring_stats(camera_handle_t handle, camera_ring_stats_t* stats)
+{
+    return camera_get_stream_ring_stats(handle, CAMERA_STREAM_MAIN, stats);
+}
+
+/* 获取最新的一帧（复制到调用方缓冲区，复制期间不持有任何锁） */
+camera_error_t camera_capture_frame(camera_handle_t handle, uint8_t* bgra_data, 
+                                     int buffer_size, int* width, int* height, int timeout_ms)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    camera_frame_t frame;
+    
+    if (!ctx || !bgra_data) return CAMERA_ERROR_INVALID_PARAM;
+    if (!camera_capturing(ctx)) return CAMERA_ERROR_NOT_RUNNING;
+    if (buffer_size < ctx->rings[CAMERA_STREAM_MAIN].buffer_size) return CAMERA_ERROR_INVALID_PARAM;
+    
+    camera_error_t err = camera_acquire_frame(handle, &frame, 0, timeout_ms);
+    if (err != CAMERA_OK) return err;
+    
+    memcpy(bgra_data, frame.data, ctx->rings[CAMERA_STREAM_MAIN].buffer_size);
+    camera_release_frame(handle, &frame);
+    
+    if (width) *width = ctx->width;
+    if (height) *height = ctx->height;
+    
+    return CAMERA_OK;
+}
+
+/* 获取实际生效的采集缓冲区模式 */
+camera_capture_mode_t camera_get_capture_mode(camera_handle_t handle)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    return ctx ? ctx->capture_mode : CAMERA_CAPTURE_AUTO;
+}
+
+/* 获取实际协商的采集格式 */
+camera_input_format_t camera_get_input_format(camera_handle_t handle)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    return ctx ? ctx->input_format : CAMERA_INPUT_FORMAT_AUTO;
+}
+
+/* 按当前分辨率换算检测流 ROI（配置的 ROI 相对于初始化时协商的分辨率） */
+static void detect_roi_scale(camera_context_t* ctx)
+{
+    const camera_rect_t* base = &ctx->detect_roi_base;
+    camera_rect_t* roi = &ctx->detect_roi;
+    
+    roi->x = base->x * ctx->width / ctx->roi_base_width;
+    roi->y = base->y * ctx->height / ctx->roi_base_height;
+    roi->width = (base->x + base->width) * ctx->width / ctx->roi_base_width - roi->x;
+    roi->height = (base->y + base->height) * ctx->height / ctx->roi_base_height - roi->y;
+    if (roi->width <= 0 || roi->height <= 0) {
+        roi->x = 0;
+        roi->y = 0;
+        roi->width = ctx->width;
+        roi->height = ctx->height;
+    }
+}
+
+/* 是否还有帧环槽位或解码/采集缓冲区被读者持有（此时不能重建缓冲区） */
+static int camera_frames_held(camera_context_t* ctx)
+{
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        for (int i = 0; i < ctx->rings[s].slot_count; i++) {
+            if (atomic_load_explicit(&ctx->rings[s].slots[i].refcount, memory_order_acquire) != 0) return 1;
+        }
+    }
+    for (int i = 0; i < MPP_BUFFER_COUNT; i++) {
+        if (atomic_load_explicit(&ctx->decode_bufs[i].refs, memory_order_acquire) > 0) return 1;
+    }
+    for (int i = 0; i < ctx->buffer_count; i++) {
+        if (atomic_load_explicit(&ctx->v4l2_buffers[i].refs, memory_order_acquire) > 0) return 1;
+    }
+    return 0;
+}
+
+/* 在已停止的相机上切换采集格式：只改帧率时只设置 S_PARM；
+ * 改分辨率时重新协商格式并重建 V4L2 缓冲区，解码缓冲区和输出帧环够大时复用
+ */
+static camera_error_t camera_apply_format(camera_context_t* ctx, int width, int height, int fps)
+{
+    camera_error_t err = CAMERA_OK;
+    int old_width = ctx->width;
+    int old_height = ctx->height;
+    
+    ctx->fps = fps;
+    if (width == ctx->width && height == ctx->height) {
+        v4l2_set_fps(ctx);
+        printf("[%s] Frame rate changed to %dfps\n", MODULE_TAG, ctx->fps);
+        return CAMERA_OK;
+    }
+
+#ifdef USE_RGA
+    /* RGA 句柄按旧尺寸导入，先于其引用的缓冲区释放 */
+    rga_cache_deinit(ctx);
+#endif
+    
+    /* S_FMT 要求驱动端没有已分配的缓冲区 */
+    enum v4l2_memory memory = ctx->v4l2_memory;
+    v4l2_free_buffers(ctx);
+    v4l2_release_queue(ctx, memory);
+    
+    /* 丢弃解码器按旧尺寸解析的内部状态 */
+    if (ctx->mpp_ctx && ctx->mpp_mpi) {
+        ctx->mpp_mpi->reset(ctx->mpp_ctx);
+    }
+    
+    ctx->width = width;
+    ctx->height = height;
+    if (v4l2_set_format(ctx) != 0) {
+        /* 设备不支持新尺寸，恢复原格式 */
+        ctx->width = old_width;
+        ctx->height = old_height;
+        if (v4l2_set_format(ctx) != 0) return CAMERA_ERROR_V4L2_INIT_FAILED;
+        err = CAMERA_ERROR_NOT_SUPPORTED;
+    }
+    v4l2_set_fps(ctx);
+    
+    /* 沿用初始化时协商出的采集缓冲区模式 */
+    if (v4l2_setup_buffers(ctx) != 0) {
+        return CAMERA_ERROR_V4L2_INIT_FAILED;
+    }
+    if (ctx->raw_input && ctx->queue_depth > ctx->buffer_count - 1) {
+        ctx->queue_depth = ctx->buffer_count - 1;
+    }
+    
+    /* 解码缓冲区在下次使用时按新尺寸重新分配，包缓冲区按观察到的帧大小增长 */
+    if (!ctx->raw_input) {
+        mpp_setup_frame_buffers(ctx);
+    }
+    
+    /* 主输出帧环跟随采集尺寸，已分配的槽位放得下时不重新分配（检测流尺寸固定） */
+    frame_ring_t* main_ring = &ctx->rings[CAMERA_STREAM_MAIN];
+    if (main_ring->slot_count > 0) {
+        main_ring->width = ctx->width;
+        main_ring->height = ctx->height;
+        ring_compute_layout(main_ring);
+        if (main_ring->buffer_size > main_ring->capacity) {
+            ring_buffers_free(main_ring);
+            if (ring_buffers_alloc(ctx, main_ring) != 0) {
+                fprintf(stderr, "[%s] Failed to allocate output buffers (stream %d)\n", MODULE_TAG, CAMERA_STREAM_MAIN);
+                return CAMERA_ERROR_OUT_OF_MEMORY;
+            }
+        }
+    }
+    detect_roi_scale(ctx);
+
+#ifdef USE_RGA
+    rga_cache_init(ctx);
+#endif
+    
+    printf("[%s] Format changed: %dx%d -> %dx%d@%dfps\n", MODULE_TAG,
+           old_width, old_height, ctx->width, ctx->height, ctx->fps);
+    return err;
+}
+
+/* 停止采集 -> 切换格式 -> 恢复采集（帧回调和分发器保持不变） */
+static camera_error_t camera_switch_format(camera_context_t* ctx, int width, int height, int fps)
+{
+    int was_running = ctx->running;
+    camera_error_t err;
+    
+    if (width == ctx->width && height == ctx->height && fps == ctx->fps) return CAMERA_OK;
+    
+    camera_stop(ctx);
+    
+    /* 不再向读者返回旧格式的帧 */
+    for (int i = 0; i < CAMERA_STREAM_COUNT; i++) {
+        atomic_store(&ctx->rings[i].latest, 0);
+    }
+    
+    if (camera_frames_held(ctx)) {
+        fprintf(stderr, "[%s] Cannot change format while frames are held\n", MODULE_TAG);
+        err = CAMERA_ERROR_DEVICE_BUSY;
+    } else {
+        err = camera_apply_format(ctx, width, height, fps);
+    }
+    
+    if (was_running) {
+        camera_error_t start_err = camera_start(ctx, ctx->callback, ctx->user_data);
+        if (err == CAMERA_OK) err = start_err;
+    }
+    return err;
+}
+
+/* 修改正常模式的分辨率/帧率 */
+camera_error_t camera_reconfigure(camera_handle_t handle, int width, int height, int fps)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx || width <= 0 || height <= 0 || fps <= 0) return CAMERA_ERROR_INVALID_PARAM;
+    
+    ctx->active_width = width;
+    ctx->active_height = height;
+    ctx->active_fps = fps;
+    if (ctx->mode != CAMERA_MODE_ACTIVE) return CAMERA_OK;
+    
+    return camera_switch_format(ctx, width, height, fps);
+}
+
+/* 切换正常/低功耗空闲模式 */
+camera_error_t camera_set_mode(camera_handle_t handle, camera_mode_t mode)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    camera_error_t err;
+    
+    if (!ctx || (mode != CAMERA_MODE_ACTIVE && mode != CAMERA_MODE_IDLE)) return CAMERA_ERROR_INVALID_PARAM;
+    if (mode == ctx->mode) return CAMERA_OK;
+    
+    if (mode == CAMERA_MODE_IDLE) {
+        /* 先暂停检测流，格式切换前后都不再输出检测帧 */
+        atomic_store(&ctx->detect_paused, 1);
+        err = camera_switch_format(ctx, ctx->idle_width, ctx->idle_height, ctx->idle_fps);
+    } else {
+        err = camera_switch_format(ctx, ctx->active_width, ctx->active_height, ctx->active_fps);
+    }
+    
+    /* 格式未能切换（帧被持有）时保持原模式 */
+    if (err == CAMERA_ERROR_DEVICE_BUSY) {
+        atomic_store(&ctx->detect_paused, ctx->mode == CAMERA_MODE_IDLE);
+        return err;
+    }
+    
+    ctx->mode = mode;
+    atomic_store(&ctx->detect_paused, mode == CAMERA_MODE_IDLE);
+    printf("[%s] Switched to %s mode (%dx%d@%dfps)\n", MODULE_TAG,
+           mode == CAMERA_MODE_IDLE ? "idle" : "active", ctx->width, ctx->height, ctx->fps);
+    return err;
+}
+
+/* 获取当前工作模式 */
+camera_mode_t camera_get_mode(camera_handle_t handle)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    return ctx ? ctx->mode : CAMERA_MODE_ACTIVE;
+}
+
+/* 获取当前采集格式 */
+camera_error_t camera_get_format(camera_handle_t handle, int* width, int* height, int* fps)
+{
+    camera_context_t* ctx = (camera_context_t*)handle;
+    
+    if (!ctx) return CAMERA_ERROR_INVALID_PARAM;
+    
+    if (width) *width = ctx->width;
+    if (height) *height = ctx->height;
+    if (fps) *fps = ctx->fps;
+    return CAMERA_OK;
+}
+
+/* 获取错误描述 */
+const char* camera_get_error_string(camera_error_t error)
+{
+    switch (error) {
+        case CAMERA_OK: return "OK";
+        case CAMERA_ERROR_DEVICE_NOT_FOUND: return "Device not found";
+        case CAMERA_ERROR_DEVICE_BUSY: return "Device busy";
+        case CAMERA_ERROR_NOT_SUPPORTED: return "Not supported";
+        case CAMERA_ERROR_INVALID_PARAM: return "Invalid parameter";
+        case CAMERA_ERROR_MPP_INIT_FAILED: return "MPP init failed";
+        case CAMERA_ERROR_V4L2_INIT_FAILED: return "V4L2 init failed";
+        case CAMERA_ERROR_OUT_OF_MEMORY: return "Out of memory";
+        case CAMERA_ERROR_DECODE_FAILED: return "Decode failed";
+        case CAMERA_ERROR_NOT_RUNNING: return "Not running";
+        case CAMERA_ERROR_TIMEOUT: return "Timeout";
+        default: return "Unknown error";
+    }
+}
+
+/* 采集格式对应的 V4L2 像素格式 */
+static uint32_t input_format_fourcc(camera_input_format_t format)
+{
+    switch (format) {
+        case CAMERA_INPUT_FORMAT_YUYV: return V4L2_PIX_FMT_YUYV;
+        case CAMERA_INPUT_FORMAT_NV12: return V4L2_PIX_FMT_NV12;
+        default: return V4L2_PIX_FMT_MJPEG;
+    }
+}
+
+static const char* input_format_name(camera_input_format_t format)
+{
+    switch (format) {
+        case CAMERA_INPUT_FORMAT_YUYV: return "YUYV";
+        case CAMERA_INPUT_FORMAT_NV12: return "NV12";
+        case CAMERA_INPUT_FORMAT_AUTO: return "auto";
+        default: return "MJPEG";
+    }
+}
+
+/* 多平面（MPLANE）接口，rkisp/MIPI 摄像头的采集节点通常只提供这种接口 */
+static int v4l2_is_mplane(camera_context_t* ctx)
+{
+    return ctx->buf_type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+}
+
+/* 原始格式一帧的有效字节数（多平面格式为各平面之和） */
+static size_t raw_frame_size(camera_context_t* ctx)
+{
+    size_t luma = (size_t)ctx->v4l2_bytesperline * ctx->height;
+    return ctx->input_format == CAMERA_INPUT_FORMAT_NV12 ? luma * 3 / 2 : luma;
+}
+
+/* 设置采集格式，驱动接受该像素格式时返回 0（驱动可能调整分辨率） */
+static int v4l2_try_format(camera_context_t* ctx, camera_input_format_t format, struct v4l2_format* fmt)
+{
+    uint32_t candidates[2] = { input_format_fourcc(format), 0 };
+    
+    /* 多平面设备上优先单平面 NV12（RGA 和 dmabuf 共享按单个 fd 访问整帧），
+     * 驱动不支持时才接受 Y/UV 分开存放的 NV12M（部分 ISP 输出节点只提供这种格式，只能 CPU 转换） */
+    if (v4l2_is_mplane(ctx) && format == CAMERA_INPUT_FORMAT_NV12) {
+        candidates[1] = V4L2_PIX_FMT_NV12M;
+    }
+    
+    for (int i = 0; i < 2 && candidates[i]; i++) {
+        memset(fmt, 0, sizeof(*fmt));
+        fmt->type = ctx->buf_type;
+        if (v4l2_is_mplane(ctx)) {
+            fmt->fmt.pix_mp.width = ctx->width;
+            fmt->fmt.pix_mp.height = ctx->height;
+            fmt->fmt.pix_mp.pixelformat = candidates[i];
+            fmt->fmt.pix_mp.field = V4L2_FIELD_NONE;
+        } else {
+            fmt->fmt.pix.width = ctx->width;
+            fmt->fmt.pix.height = ctx->height;
+            fmt->fmt.pix.pixelformat = candidates[i];
+            fmt->fmt.pix.field = V4L2_FIELD_NONE;
+        }
+        
+        if (xioctl(ctx->v4l2_fd, VIDIOC_S_FMT, fmt) < 0) {
+            fprintf(stderr, "[%s] VIDIOC_S_FMT (%s) failed: %s\n", MODULE_TAG, input_format_name(format), strerror(errno));
+            return -1;
+        }
+        
+        uint32_t pixelformat = v4l2_is_mplane(ctx) ? fmt->fmt.pix_mp.pixelformat : fmt->fmt.pix.pixelformat;
+        if (pixelformat == candidates[i]) return 0;
+    }
+    
+    return -1;
+}
+
+/* 按 ctx->width/height 协商采集格式并读回驱动实际使用的尺寸和行宽（不能有已分配的缓冲区） */
+static int v4l2_set_format(camera_context_t* ctx)
+{
+    struct v4l2_format fmt;
+    uint32_t colorspace, quantization, ycbcr_enc;
+    static const camera_input_format_t auto_order[] = {
+        CAMERA_INPUT_FORMAT_MJPEG, CAMERA_INPUT_FORMAT_NV12, CAMERA_INPUT_FORMAT_YUYV
+    };
+    
+    /* 协商采集格式：AUTO 时按 MJPEG -> NV12 -> YUYV 依次尝试 */
+    int ret = -1;
+    if (ctx->input_format == CAMERA_INPUT_FORMAT_AUTO) {
+        for (size_t i = 0; i < sizeof(auto_order) / sizeof(auto_order[0]) && ret != 0; i++) {
+            ret = v4l2_try_format(ctx, auto_order[i], &fmt);
+            if (ret == 0) ctx->input_format = auto_order[i];
+        }
+    } else {
+        ret = v4l2_try_format(ctx, ctx->input_format, &fmt);
+    }
+    if (ret != 0) {
+        fprintf(stderr, "[%s] Device does not support %s format\n", MODULE_TAG, input_format_name(ctx->input_format));
+        return -1;
+    }
+    
+    ctx->raw_input = ctx->input_format != CAMERA_INPUT_FORMAT_MJPEG;
+    if (v4l2_is_mplane(ctx)) {
+        const struct v4l2_pix_format_mplane* mp = &fmt.fmt.pix_mp;
+        
+        ctx->width = mp->width;
+        ctx->height = mp->height;
+        ctx->plane_count = mp->num_planes > 0 ? mp->num_planes : 1;
+        if (ctx->plane_count > V4L2_MAX_PLANES) {
+            fprintf(stderr, "[%s] Unsupported plane count: %d\n", MODULE_TAG, ctx->plane_count);
+            return -1;
+        }
+        ctx->v4l2_bytesperline = mp->plane_fmt[0].bytesperline;
+        ctx->v4l2_sizeimage = 0;
+        for (int p = 0; p < ctx->plane_count; p++) {
+            ctx->v4l2_sizeimage += mp->plane_fmt[p].sizeimage;
+        }
+        colorspace = mp->colorspace;
+        quantization = mp->quantization;
+        ycbcr_enc = mp->ycbcr_enc;
+    } else {
+        ctx->width = fmt.fmt.pix.width;
+        ctx->height = fmt.fmt.pix.height;
+        ctx->plane_count = 1;
+        ctx->v4l2_bytesperline = fmt.fmt.pix.bytesperline;
+        ctx->v4l2_sizeimage = fmt.fmt.pix.sizeimage;
+        colorspace = fmt.fmt.pix.colorspace;
+        quantization = fmt.fmt.pix.quantization;
+        ycbcr_enc = fmt.fmt.pix.ycbcr_enc;
+    }
+    if (ctx->v4l2_bytesperline == 0) {
+        ctx->v4l2_bytesperline = ctx->input_format == CAMERA_INPUT_FORMAT_YUYV ? ctx->width * 2 : ctx->width;
+    }
+    if (ctx->v4l2_sizeimage == 0) {
+        /* 部分驱动不报告 sizeimage，按原始尺寸估算 */
+        ctx->v4l2_sizeimage = ctx->raw_input ? raw_frame_size(ctx) : (size_t)ctx->width * ctx->height * 2;
+    }
+    
+    /* YUV 默认限制范围，JPEG 颜色空间为全范围 */
+    ctx->raw_limited_range = quantization == V4L2_QUANTIZATION_LIM_RANGE ||
+                             (quantization == V4L2_QUANTIZATION_DEFAULT && colorspace != V4L2_COLORSPACE_JPEG);
+    ctx->raw_bt709 = colorspace == V4L2_COLORSPACE_REC709 || ycbcr_enc == V4L2_YCBCR_ENC_709;
+    
+    printf("[%s] Video format: %dx%d %s (sizeimage %zu, %d plane%s%s%s)\n", MODULE_TAG,
+           ctx->width, ctx->height, input_format_name(ctx->input_format), ctx->v4l2_sizeimage,
+           ctx->plane_count, ctx->plane_count > 1 ? "s" : "", v4l2_is_mplane(ctx) ? ", mplane" : "",
+           ctx->raw_input ? ", no decode" : "");
+    if (ctx->plane_count > 1) {
+        printf("[%s] Driver has no single-plane NV12, multi-plane frames use CPU conversion (no RGA, no dmabuf sharing)\n",
+               MODULE_TAG);
+    }
+    
+    return 0;
+}
+
+/* 设置帧率（不能在流传输期间调用，UVC 驱动会返回 EBUSY） */
+static void v4l2_set_fps(camera_context_t* ctx)
+{
+    struct v4l2_streamparm parm;
+    
+    /* 设置帧率（ISP 节点通常不支持，帧率由传感器驱动决定） */
+    memset(&parm, 0, sizeof(parm));
+    parm.type = ctx->buf_type;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = ctx->fps;
+    
+    if (xioctl(ctx->v4l2_fd, VIDIOC_S_PARM, &parm) < 0) {
+        fprintf(stderr, "[%s] VIDIOC_S_PARM failed (fps): %s\n", MODULE_TAG, strerror(errno));
+    }
+}
+
+/* V4L2 初始化 - 打开设备、协商格式并设置帧率（缓冲区由 v4l2_setup_buffers 分配） */
+static int v4l2_init(camera_context_t* ctx, const char* device)
+{
+    struct v4l2_capability cap;
+    uint32_t caps;
+    
+    /* 打开设备 - 使用 O_NONBLOCK 非阻塞模式 */
+    ctx->v4l2_fd = open(device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (ctx->v4l2_fd < 0) {
+        fprintf(stderr, "[%s] Cannot open device %s: %s\n", MODULE_TAG, device, strerror(errno));
+        return -1;
+    }
+    
+    /* 查询设备能力 */
+    if (xioctl(ctx->v4l2_fd, VIDIOC_QUERYCAP, &cap) < 0) {
+        fprintf(stderr, "[%s] VIDIOC_QUERYCAP failed: %s\n", MODULE_TAG, strerror(errno));
+        return -1;
+    }
+    
+    /* 设置了 DEVICE_CAPS 时 capabilities 描述整个驱动（rkisp 有多个节点），本节点的能力在 device_caps 中 */
+    caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    
+    /* 单平面接口优先（UVC），否则使用多平面接口（rkisp/MIPI） */
+    if (caps & V4L2_CAP_VIDEO_CAPTURE) {
+        ctx->buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    } else if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) {
+        ctx->buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    } else {
+        fprintf(stderr, "[%s] Device does not support video capture\n", MODULE_TAG);
+        return -1;
+    }
+    
+    if (!(caps & V4L2_CAP_STREAMING)) {
+        fprintf(stderr, "[%s] Device does not support streaming\n", MODULE_TAG);
+        return -1;
+    }
+    
+    if (v4l2_set_format(ctx) != 0) {
+        return -1;
+    }
+    
+    v4l2_set_fps(ctx);
+    return 0;
+}
+
+/* 释放驱动端缓冲区（REQBUFS count=0） */
+static void v4l2_release_queue(camera_context_t* ctx, enum v4l2_memory memory)
+{
+    struct v4l2_requestbuffers req;
+    
+    memset(&req, 0, sizeof(req));
+    req.count = 0;
+    req.type = ctx->buf_type;
+    req.memory = memory;
+    xioctl(ctx->v4l2_fd, VIDIOC_REQBUFS, &req);
+}
+
+/* 分配缓冲区表（数量由 REQBUFS 确定） */
+static int v4l2_alloc_buffer_table(camera_context_t* ctx, int count)
+{
+    ctx->v4l2_buffers = (v4l2_buffer_t*)calloc(count, sizeof(v4l2_buffer_t));
+    if (!ctx->v4l2_buffers) {
+        fprintf(stderr, "[%s] Failed to allocate %d V4L2 buffer entries\n", MODULE_TAG, count);
+        return -1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        for (int p = 0; p < V4L2_MAX_PLANES; p++) {
+            ctx->v4l2_buffers[i].planes[p].dmabuf_fd = -1;
+        }
+    }
+    ctx->buffer_count = count;
+    return 0;
+}
+
+/* 释放所有 V4L2 缓冲区及其关联的 MPP 缓冲区 / dmabuf fd */
+static void v4l2_free_buffers(camera_context_t* ctx)
+{
+    int i, p;
+    
+    for (i = 0; i < ctx->buffer_count; i++) {
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[i];
+        
+        for (p = 0; p < ctx->plane_count; p++) {
+            v4l2_plane_t* plane = &vbuf->planes[p];
+            
+            if (ctx->v4l2_memory == V4L2_MEMORY_MMAP &&
+                plane->start && plane->start != MAP_FAILED) {
+                munmap(plane->start, plane->length);
+            }
+            plane->start = NULL;
+            
+            if (plane->dmabuf_fd >= 0) {
+                close(plane->dmabuf_fd);
+                plane->dmabuf_fd = -1;
+            }
+        }
+        
+        if (vbuf->mpp_buf) {
+            mpp_buffer_put(vbuf->mpp_buf);
+            vbuf->mpp_buf = NULL;
+        }
+    }
+    
+    free(ctx->v4l2_buffers);
+    ctx->v4l2_buffers = NULL;
+    ctx->buffer_count = 0;
+}
+
+/* 入队一个 V4L2 缓冲区（已在驱动中时直接返回，允许多个线程归还同一缓冲区） */
+static int v4l2_queue_buffer(camera_context_t* ctx, int index)
+{
+    struct v4l2_buffer buf;
+    struct v4l2_plane planes[V4L2_MAX_PLANES];
+    v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[index];
+    
+    if (atomic_exchange_explicit(&vbuf->queued, 1, memory_order_acq_rel)) {
+        return 0;
+    }
+    
+    memset(&buf, 0, sizeof(buf));
+    memset(planes, 0, sizeof(planes));
+    buf.type = ctx->buf_type;
+    buf.memory = ctx->v4l2_memory;
+    buf.index = index;
+    if (v4l2_is_mplane(ctx)) {
+        buf.m.planes = planes;
+        buf.length = ctx->plane_count;
+    }
+    
+    /* DMABUF 模式只用于单平面格式 */
+    if (ctx->v4l2_memory == V4L2_MEMORY_DMABUF) {
+        int fd = mpp_buffer_get_fd(vbuf->mpp_buf);
+        if (v4l2_is_mplane(ctx)) {
+            planes[0].m.fd = fd;
+            planes[0].length = vbuf->planes[0].length;
+        } else {
+            buf.m.fd = fd;
+            buf.length = vbuf->planes[0].length;
+        }
+    }
+    
+    if (xioctl(ctx->v4l2_fd, VIDIOC_QBUF, &buf) < 0) {
+        atomic_store_explicit(&vbuf->queued, 0, memory_order_release);
+        return -1;
+    }
+    
+    /* 队列由空变为非空：采集线程此时只等待 eventfd，唤醒它重新等待 V4L2 fd */
+    if (atomic_fetch_add_explicit(&ctx->v4l2_queued, 1, memory_order_relaxed) == 0) {
+        capture_wake(ctx);
+    }
+    return 0;
+}
+
+/* 出队一个 V4L2 缓冲区，bytesused 为各平面有效字节数之和 */
+static int v4l2_dequeue_buffer(camera_context_t* ctx, struct v4l2_buffer* buf, size_t* bytesused)
+{
+    struct v4l2_plane planes[V4L2_MAX_PLANES];
+    
+    memset(buf, 0, sizeof(*buf));
+    memset(planes, 0, sizeof(planes));
+    buf->type = ctx->buf_type;
+    buf->memory = ctx->v4l2_memory;
+    if (v4l2_is_mplane(ctx)) {
+        buf->m.planes = planes;
+        buf->length = ctx->plane_count;
+    }
+    
+    if (xioctl(ctx->v4l2_fd, VIDIOC_DQBUF, buf) < 0) {
+        return -1;
+    }
+    
+    atomic_store_explicit(&ctx->v4l2_buffers[buf->index].queued, 0, memory_order_release);
+    atomic_fetch_sub_explicit(&ctx->v4l2_queued, 1, memory_order_relaxed);
+    
+    if (v4l2_is_mplane(ctx)) {
+        *bytesused = 0;
+        for (int p = 0; p < ctx->plane_count; p++) {
+            *bytesused += planes[p].bytesused;
+        }
+        buf->m.planes = NULL;   /* 指向本函数的栈 */
+    } else {
+        *bytesused = buf->bytesused;
+    }
+    return 0;
+}
+
+/* 停止 V4L2 流（驱动收回所有已入队的缓冲区） */
+static void v4l2_stop_streaming(camera_context_t* ctx)
+{
+    enum v4l2_buf_type type = ctx->buf_type;
+    
+    xioctl(ctx->v4l2_fd, VIDIOC_STREAMOFF, &type);
+    
+    for (int i = 0; i < ctx->buffer_count; i++) {
+        atomic_store_explicit(&ctx->v4l2_buffers[i].queued, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&ctx->v4l2_queued, 0, memory_order_relaxed);
+}
+
+/* DMABUF 模式：缓冲区从 MPP frm_grp 分配，V4L2 直接写入 MPP 可读的内存 */
+static int v4l2_setup_dmabuf(camera_context_t* ctx)
+{
+    struct v4l2_requestbuffers req;
+    int i;
+    
+    /* 一个 MPP 缓冲区只能对应一个平面 */
+    if (ctx->plane_count > 1) {
+        printf("[%s] V4L2_MEMORY_DMABUF needs a single-plane format\n", MODULE_TAG);
+        return -1;
+    }
+    
+    memset(&req, 0, sizeof(req));
+    req.count = ctx->v4l2_buffer_request;
+    req.type = ctx->buf_type;
+    req.memory = V4L2_MEMORY_DMABUF;
+    
+    if (xioctl(ctx->v4l2_fd, VIDIOC_REQBUFS, &req) < 0) {
+        printf("[%s] V4L2_MEMORY_DMABUF not supported: %s\n", MODULE_TAG, strerror(errno));
+        return -1;
+    }
+    
+    if (req.count < 2 || req.count > V4L2_MAX_BUFFER_COUNT) {
+        fprintf(stderr, "[%s] Unexpected DMABUF buffer count: %u\n", MODULE_TAG, req.count);
+        v4l2_release_queue(ctx, V4L2_MEMORY_DMABUF);
+        return -1;
+    }
+    
+    if (v4l2_alloc_buffer_table(ctx, req.count) != 0) {
+        v4l2_release_queue(ctx, V4L2_MEMORY_DMABUF);
+        return -1;
+    }
+    ctx->v4l2_memory = V4L2_MEMORY_DMABUF;
+    
+    for (i = 0; i < ctx->buffer_count; i++) {
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[i];
+        
+        if (mpp_buffer_get(ctx->frm_grp, &vbuf->mpp_buf, ctx->v4l2_sizeimage) != MPP_OK) {
+            fprintf(stderr, "[%s] mpp_buffer_get for DMABUF capture failed\n", MODULE_TAG);
+            goto fail;
+        }
+        vbuf->planes[0].length = ctx->v4l2_sizeimage;
+        vbuf->planes[0].start = mpp_buffer_get_ptr(vbuf->mpp_buf);
+    }
+    
+    /* 试探入队：驱动在 QBUF 时才真正 attach/map dmabuf，失败说明驱动无法使用该内存 */
+    for (i = 0; i < ctx->buffer_count; i++) {
+        if (v4l2_queue_buffer(ctx, i) < 0) {
+            printf("[%s] DMABUF QBUF rejected by driver: %s\n", MODULE_TAG, strerror(errno));
+            v4l2_stop_streaming(ctx);
+            goto fail;
+        }
+    }
+    /* STREAMOFF 将已入队的缓冲区全部归还，真正启动时再入队 */
+    v4l2_stop_streaming(ctx);
+    
+    return 0;
+
+fail:
+    v4l2_free_buffers(ctx);
+    v4l2_release_queue(ctx, V4L2_MEMORY_DMABUF);
+    ctx->v4l2_memory = V4L2_MEMORY_MMAP;
+    return -1;
+}
+
+/* MMAP 模式：驱动分配缓冲区，每个平面分别映射到用户空间 */
+static int v4l2_setup_mmap(camera_context_t* ctx)
+{
+    struct v4l2_requestbuffers req;
+    int i, p;
+    
+    /* 请求缓冲区 - 最小化延迟 */
+    memset(&req, 0, sizeof(req));
+    req.count = ctx->v4l2_buffer_request;
+    req.type = ctx->buf_type;
+    req.memory = V4L2_MEMORY_MMAP;
+    
+    if (xioctl(ctx->v4l2_fd, VIDIOC_REQBUFS, &req) < 0) {
+        fprintf(stderr, "[%s] VIDIOC_REQBUFS failed: %s\n", MODULE_TAG, strerror(errno));
+        return -1;
+    }
+    
+    if (req.count < 2 || req.count > V4L2_MAX_BUFFER_COUNT) {
+        fprintf(stderr, "[%s] Insufficient buffer memory\n", MODULE_TAG);
+        return -1;
+    }
+    
+    if (v4l2_alloc_buffer_table(ctx, req.count) != 0) {
+        return -1;
+    }
+    ctx->v4l2_memory = V4L2_MEMORY_MMAP;
+    
+    /* 映射缓冲区 */
+    for (i = 0; i < ctx->buffer_count; i++) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane planes[V4L2_MAX_PLANES];
+        
+        memset(&buf, 0, sizeof(buf));
+        memset(planes, 0, sizeof(planes));
+        buf.type = ctx->buf_type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (v4l2_is_mplane(ctx)) {
+            buf.m.planes = planes;
+            buf.length = ctx->plane_count;
+        }
+        
+        if (xioctl(ctx->v4l2_fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            fprintf(stderr, "[%s] VIDIOC_QUERYBUF failed: %s\n", MODULE_TAG, strerror(errno));
+            return -1;
+        }
+        
+        for (p = 0; p < ctx->plane_count; p++) {
+            v4l2_plane_t* plane = &ctx->v4l2_buffers[i].planes[p];
+            off_t offset = v4l2_is_mplane(ctx) ? planes[p].m.mem_offset : buf.m.offset;
+            
+            plane->length = v4l2_is_mplane(ctx) ? planes[p].length : buf.length;
+            plane->start = mmap(NULL, plane->length,
+                                PROT_READ | PROT_WRITE,
+                                MAP_SHARED,
+                                ctx->v4l2_fd, offset);
+            
+            if (plane->start == MAP_FAILED) {
+                fprintf(stderr, "[%s] mmap failed: %s\n", MODULE_TAG, strerror(errno));
+                return -1;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+/* EXPBUF 模式：在 MMAP 缓冲区基础上逐平面导出 dmabuf，单平面格式同时导入 MPP */
+static int v4l2_export_to_mpp(camera_context_t* ctx)
+{
+    int i, p;
+    
+    for (i = 0; i < ctx->buffer_count; i++) {
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[i];
+        MppBufferInfo info;
+        
+        for (p = 0; p < ctx->plane_count; p++) {
+            struct v4l2_exportbuffer expbuf;
+            
+            memset(&expbuf, 0, sizeof(expbuf));
+            expbuf.type = ctx->buf_type;
+            expbuf.index = i;
+            expbuf.plane = p;
+            expbuf.flags = O_RDWR | O_CLOEXEC;
+            
+            if (xioctl(ctx->v4l2_fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+                printf("[%s] VIDIOC_EXPBUF not supported: %s\n", MODULE_TAG, strerror(errno));
+                goto fail;
+            }
+            vbuf->planes[p].dmabuf_fd = expbuf.fd;
+        }
+        
+        /* MPP/RGA 按单个 fd 访问整帧，多平面格式（NV12M）只保留导出的 fd */
+        if (ctx->plane_count > 1) continue;
+        
+        memset(&info, 0, sizeof(info));
+        info.type = MPP_BUFFER_TYPE_EXT_DMA;
+        info.fd = vbuf->planes[0].dmabuf_fd;
+        info.ptr = vbuf->planes[0].start;
+        info.size = vbuf->planes[0].length;
+        info.index = i;
+        
+        if (mpp_buffer_import(&vbuf->mpp_buf, &info) != MPP_OK) {
+            fprintf(stderr, "[%s] mpp_buffer_import failed for V4L2 buffer %d\n", MODULE_TAG, i);
+            goto fail;
+        }
+    }
+    
+    return 0;
+
+fail:
+    /* 只撤销导出部分，MMAP 映射保留用于回退 */
+    for (i = 0; i < ctx->buffer_count; i++) {
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[i];
+        if (vbuf->mpp_buf) {
+            mpp_buffer_put(vbuf->mpp_buf);
+            vbuf->mpp_buf = NULL;
+        }
+        for (p = 0; p < ctx->plane_count; p++) {
+            if (vbuf->planes[p].dmabuf_fd >= 0) {
+                close(vbuf->planes[p].dmabuf_fd);
+                vbuf->planes[p].dmabuf_fd = -1;
+            }
+        }
+    }
+    return -1;
+}
+
+/* 按配置的采集模式分配 V4L2 缓冲区，AUTO 模式逐级回退 */
+static int v4l2_setup_buffers(camera_context_t* ctx)
+{
+    camera_capture_mode_t requested = ctx->capture_mode;
+    
+    if (requested == CAMERA_CAPTURE_AUTO || requested == CAMERA_CAPTURE_DMABUF) {
+        if (v4l2_setup_dmabuf(ctx) == 0) {
+            ctx->capture_mode = CAMERA_CAPTURE_DMABUF;
+            printf("[%s] V4L2 initialized with %d DMABUF buffers (zero-copy)\n", MODULE_TAG, ctx->buffer_count);
+            return 0;
+        }
+        if (requested == CAMERA_CAPTURE_DMABUF) {
+            fprintf(stderr, "[%s] DMABUF capture mode requested but not available\n", MODULE_TAG);
+            return -1;
+        }
+    }
+    
+    if (v4l2_setup_mmap(ctx) != 0) {
+        return -1;
+    }
+    
+    if (requested == CAMERA_CAPTURE_AUTO || requested == CAMERA_CAPTURE_EXPBUF) {
+        if (v4l2_export_to_mpp(ctx) == 0) {
+            ctx->capture_mode = CAMERA_CAPTURE_EXPBUF;
+            printf("[%s] V4L2 initialized with %d exported buffers (zero-copy%s)\n", MODULE_TAG, ctx->buffer_count,
+                   ctx->plane_count > 1 ? ", CPU convert for multi-plane" : "");
+            return 0;
+        }
+        if (requested == CAMERA_CAPTURE_EXPBUF) {
+            fprintf(stderr, "[%s] EXPBUF capture mode requested but not available\n", MODULE_TAG);
+            return -1;
+        }
+    }
+    
+    ctx->capture_mode = CAMERA_CAPTURE_MMAP;
+    printf("[%s] V4L2 initialized with %d buffers (low latency)\n", MODULE_TAG, ctx->buffer_count);
+    return 0;
+}
+
+/* V4L2 释放 */
+static void v4l2_deinit(camera_context_t* ctx)
+{
+    if (ctx->v4l2_fd >= 0 && ctx->v4l2_buffers) {
+        enum v4l2_memory memory = ctx->v4l2_memory;
+        v4l2_free_buffers(ctx);
+        v4l2_release_queue(ctx, memory);
+    }
+    
+    if (ctx->v4l2_fd >= 0) {
+        close(ctx->v4l2_fd);
         ctx->v4l2_fd = -1;
     }
 }
 
-/* 启动 V4L2 流 */
-static int v4l2_start_streaming(camera_context_t* ctx)
+/* 启动 V4L2 流 */
+static int v4l2_start_streaming(camera_context_t* ctx)
+{
+    enum v4l2_buf_type type = ctx->buf_type;
+    int i;
+    
+    /* 入队所有缓冲区 - 原始格式仍被共享帧持有者引用的缓冲区等归还后由采集线程入队 */
+    for (i = 0; i < ctx->buffer_count; i++) {
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[i];
+        
+        if (atomic_load_explicit(&vbuf->refs, memory_order_acquire) > 0) continue;
+        atomic_store_explicit(&vbuf->requeue_pending, 0, memory_order_relaxed);
+        
+        if (v4l2_queue_buffer(ctx, i) < 0) {
+            fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
+            return -1;
+        }
+    }
+    
+    /* 开始流传输 */
+    if (xioctl(ctx->v4l2_fd, VIDIOC_STREAMON, &type) < 0) {
+        fprintf(stderr, "[%s] VIDIOC_STREAMON failed: %s\n", MODULE_TAG, strerror(errno));
+        return -1;
+    }
+    
+    return 0;
+}
+
+/* 原始格式：重新入队在其他线程归还的共享帧缓冲区（只在采集线程中调用） */
+static void v4l2_requeue_released(camera_context_t* ctx)
+{
+    for (int i = 0; i < ctx->buffer_count; i++) {
+        v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[i];
+        
+        if (!atomic_exchange_explicit(&vbuf->requeue_pending, 0, memory_order_acquire)) continue;
+        if (atomic_load_explicit(&vbuf->refs, memory_order_acquire) > 0) continue;
+        
+        if (v4l2_queue_buffer(ctx, i) < 0) {
+            fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
+        }
+    }
+}
+
+/* 原始格式：归还采集缓冲区的一个引用，归零时立即重新入队（输出线程调用） */
+static void v4l2_buffer_unref(camera_context_t* ctx, int index)
+{
+    if (atomic_fetch_sub_explicit(&ctx->v4l2_buffers[index].refs, 1, memory_order_acq_rel) != 1) return;
+    
+    if (v4l2_queue_buffer(ctx, index) < 0 && ctx->running) {
+        fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
+    }
+}
+
+/* 采集缓冲区（平面 0）的 dmabuf fd，没有时返回 -1 */
+static int v4l2_buffer_fd(const v4l2_buffer_t* vbuf)
+{
+    return vbuf->mpp_buf ? mpp_buffer_get_fd(vbuf->mpp_buf) : vbuf->planes[0].dmabuf_fd;
+}
+
+/* 原始格式能否共享采集缓冲区：单平面 NV12 且有 dmabuf fd（DMABUF/EXPBUF 模式） */
+static int raw_sharing_supported(camera_context_t* ctx)
+{
+    return ctx->raw_input && ctx->input_format == CAMERA_INPUT_FORMAT_NV12 &&
+           ctx->plane_count == 1 && ctx->buffer_count > 0 && v4l2_buffer_fd(&ctx->v4l2_buffers[0]) >= 0;
+}
+
+/* MPP 解码器初始化 - 预分配缓冲区 */
+static int mpp_decoder_init(camera_context_t* ctx)
+{
+    MPP_RET ret;
+    MppDecCfg cfg = NULL;
+    
+    /* 创建 MPP 上下文 */
+    ret = mpp_create(&ctx->mpp_ctx, &ctx->mpp_mpi);
+    if (ret != MPP_OK) {
+        fprintf(stderr, "[%s] mpp_create failed: %d\n", MODULE_TAG, ret);
+        return -1;
+    }
+    
+    /* 初始化为 MJPEG 解码器 */
+    ret = mpp_init(ctx->mpp_ctx, MPP_CTX_DEC, MPP_VIDEO_CodingMJPEG);
+    if (ret != MPP_OK) {
+        fprintf(stderr, "[%s] mpp_init failed: %d\n", MODULE_TAG, ret);
+        return -1;
+    }
+    
+    /* 配置解码器 - 低延迟模式 */
+    mpp_dec_cfg_init(&cfg);
+    ret = ctx->mpp_mpi->control(ctx->mpp_ctx, MPP_DEC_GET_CFG, cfg);
+    if (ret == MPP_OK) {
+        /* 不需要分割解析，MJPEG 每帧都是完整的 */
+        mpp_dec_cfg_set_u32(cfg, "base:split_parse", 0);
+        /* 设置快速输出模式 */
+        mpp_dec_cfg_set_u32(cfg, "base:fast_out", 1);
+        ctx->mpp_mpi->control(ctx->mpp_ctx, MPP_DEC_SET_CFG, cfg);
+    }
+    mpp_dec_cfg_deinit(cfg);
+    
+    /* 创建帧缓冲组 */
+    ret = mpp_buffer_group_get_internal(&ctx->frm_grp, MPP_BUFFER_TYPE_ION);
+    if (ret != MPP_OK) {
+        fprintf(stderr, "[%s] mpp_buffer_group_get failed: %d\n", MODULE_TAG, ret);
+        return -1;
+    }
+    
+    /* 解码缓冲区在槽位首次使用时分配（包缓冲区仅 MMAP 模式需要），见 decode_frame_buffer_prepare */
+    mpp_setup_frame_buffers(ctx);
+    
+    ctx->current_buf_idx = 0;
+    ctx->mpp_initialized = 1;
+    
+    if (ctx->pooled) {
+        printf("[%s] MPP MJPEG decoder initialized (output buffers from camera group, priority reserve %d)\n",
+               MODULE_TAG, ctx->queue_depth + 1);
+    } else {
+        printf("[%s] MPP MJPEG decoder initialized (%d buffers allocated on demand)\n", MODULE_TAG,
+               ctx->decode_buffer_count);
+    }
+    return 0;
+}
+
+/* 解码输出缓冲区大小：按当前与正常模式分辨率中较大者（空闲模式切换时复用），16 对齐，
+ * 每像素字节数取首帧实际格式（首帧前按 NV16，放得下所有支持的输出格式） */
+static size_t decode_frame_size(camera_context_t* ctx)
+{
+    int width = ctx->width > ctx->active_width ? ctx->width : ctx->active_width;
+    int height = ctx->height > ctx->active_height ? ctx->height : ctx->active_height;
+    
+    return (size_t)ALIGN(width, 16) * ALIGN(height, 16) * atomic_load(&ctx->frame_bpp_x2) / 2;
+}
+
+/* 释放槽位的独立输出缓冲区（采集线程或没有帧在途时调用） */
+static void decode_frame_buffer_free(camera_context_t* ctx, mpp_decode_buffer_t* dec_buf)
+{
+#ifdef USE_RGA
+    /* fd 释放后可能被新缓冲区复用，先移除按 fd 缓存的 RGA 句柄 */
+    rga_cache_forget(ctx, dec_buf->frm_buf);
+#endif
+    mpp_buffer_put(dec_buf->frm_buf);
+    dec_buf->frm_buf = NULL;
+    atomic_fetch_sub(&ctx->pool_frm_allocated, 1);
+    atomic_fetch_sub(&ctx->pool_bytes, dec_buf->frm_buf_size);
+    dec_buf->frm_buf_size = 0;
+}
+
+/* 决定是否使用相机组的共享缓冲区（相机组的缓冲区够大时），切换到共享模式时释放独立缓冲区；
+ * 只在没有被持有的帧时调用，已分配的独立缓冲区在槽位下次使用时按需调整 */
+static void mpp_setup_frame_buffers(camera_context_t* ctx)
+{
+    size_t frm_size = decode_frame_size(ctx);
+    
+    ctx->frame_bpp_applied = atomic_load(&ctx->frame_bpp_x2);
+    ctx->pooled = camera_group_pool_fits(ctx->group_member, frm_size);
+    if (ctx->group_member && !ctx->pooled) {
+        fprintf(stderr, "[%s] %dx%d exceeds the camera group buffer size, using private buffers\n",
+                MODULE_TAG, ctx->width, ctx->height);
+    }
+    
+    for (int i = 0; ctx->pooled && i < MPP_BUFFER_COUNT; i++) {
+        mpp_decode_buffer_t* dec_buf = &ctx->decode_bufs[i];
+        if (dec_buf->frm_buf && !atomic_load(&dec_buf->borrowed)) {
+            decode_frame_buffer_free(ctx, dec_buf);
+        }
+    }
+}
+
+/* 为选中的空闲槽位准备解码输出缓冲区（采集线程）：共享模式下借用组缓冲区，
+ * 独立模式下首次使用时分配，偏小或浪费超过 1/8 时（分辨率或首帧格式变化后）重新分配
+ * @return 0 成功，1 缓冲池已满（丢弃本帧），-1 分配失败
+ */
+static int decode_frame_buffer_prepare(camera_context_t* ctx, mpp_decode_buffer_t* dec_buf)
+{
+    size_t frm_size = decode_frame_size(ctx);
+    int bpp_x2 = atomic_load_explicit(&ctx->frame_bpp_x2, memory_order_relaxed);
+    
+    /* 首帧格式确定后重新判断共享缓冲区是否够大 */
+    if (ctx->group_member && bpp_x2 != ctx->frame_bpp_applied) {
+        int pooled = camera_group_pool_fits(ctx->group_member, frm_size);
+        ctx->frame_bpp_applied = bpp_x2;
+        if (pooled != ctx->pooled) {
+            printf("[%s] Decoded format needs %zu-byte buffers, %s\n", MODULE_TAG, frm_size,
+                   pooled ? "using camera group buffers" : "switching to private buffers");
+            ctx->pooled = pooled;
+        }
+    }
+    
+    if (ctx->pooled) {
+        /* 切换到共享模式前分配的独立缓冲区 */
+        if (dec_buf->frm_buf) decode_frame_buffer_free(ctx, dec_buf);
+        
+        dec_buf->frm_buf = (MppBuffer)camera_group_buffer_get(ctx->group_member);
+        if (!dec_buf->frm_buf) return 1;
+        atomic_store_explicit(&dec_buf->borrowed, 1, memory_order_relaxed);
+        return 0;
+    }
+    
+    if (dec_buf->frm_buf && dec_buf->frm_buf_size >= frm_size && dec_buf->frm_buf_size - frm_size <= frm_size / 8) {
+        return 0;
+    }
+    if (dec_buf->frm_buf) decode_frame_buffer_free(ctx, dec_buf);
+    
+    if (mpp_buffer_get(ctx->frm_grp, &dec_buf->frm_buf, frm_size) != MPP_OK) {
+        fprintf(stderr, "[%s] mpp_buffer_get frm failed (%zu bytes)\n", MODULE_TAG, frm_size);
+        dec_buf->frm_buf = NULL;
+        return -1;
+    }
+    dec_buf->frm_buf_size = frm_size;
+    atomic_fetch_add(&ctx->pool_frm_allocated, 1);
+    atomic_fetch_add(&ctx->pool_bytes, frm_size);
+    atomic_store(&ctx->pool_frm_size, frm_size);
+    return 0;
+}
+
+/* 准备 MPP 包缓冲区 - MMAP 模式下 MJPEG 数据需要复制到 MPP 可访问的内存（采集线程）
+ * 按观察到的最大帧加 1/4 余量分配，只增不减，帧大小稳定后不再重新分配
+ * @return 0 成功，-1 分配失败
+ */
+static int decode_packet_buffer_prepare(camera_context_t* ctx, mpp_decode_buffer_t* dec_buf, size_t mjpeg_size)
+{
+    if (mjpeg_size > ctx->max_packet_size) {
+        ctx->max_packet_size = mjpeg_size;
+        atomic_store(&ctx->pool_max_packet, mjpeg_size);
+    }
+    if (dec_buf->pkt_buf && dec_buf->pkt_buf_size >= mjpeg_size) return 0;
+    
+    size_t pkt_size = ctx->max_packet_size + (ctx->max_packet_size >> PACKET_BUFFER_HEADROOM_SHIFT);
+    pkt_size = ALIGN(pkt_size, PACKET_BUFFER_ALIGN);
+    if (dec_buf->pkt_buf) {
+        mpp_buffer_put(dec_buf->pkt_buf);
+        dec_buf->pkt_buf = NULL;
+        atomic_fetch_sub(&ctx->pool_bytes, dec_buf->pkt_buf_size);
+        dec_buf->pkt_buf_size = 0;
+    }
+    
+    if (mpp_buffer_get(ctx->frm_grp, &dec_buf->pkt_buf, pkt_size) != MPP_OK) {
+        fprintf(stderr, "[%s] mpp_buffer_get pkt failed (%zu bytes)\n", MODULE_TAG, pkt_size);
+        dec_buf->pkt_buf = NULL;
+        return -1;
+    }
+    dec_buf->pkt_buf_size = pkt_size;
+    atomic_fetch_add(&ctx->pool_bytes, pkt_size);
+    atomic_store(&ctx->pool_pkt_size, pkt_size);
+    return 0;
+}
+
+/* MPP 解码器释放 */
+static void mpp_decoder_deinit(camera_context_t* ctx)
+{
+    int i;
+    
+    /* 释放已分配的缓冲区（借用的共享缓冲区此时都已归还） */
+    for (i = 0; i < MPP_BUFFER_COUNT; i++) {
+        if (ctx->decode_bufs[i].pkt_buf) {
+            mpp_buffer_put(ctx->decode_bufs[i].pkt_buf);
+            ctx->decode_bufs[i].pkt_buf = NULL;
+        }
+        if (ctx->decode_bufs[i].frm_buf && !atomic_load(&ctx->decode_bufs[i].borrowed)) {
+            mpp_buffer_put(ctx->decode_bufs[i].frm_buf);
+            ctx->decode_bufs[i].frm_buf = NULL;
+        }
+    }
+    
+    if (ctx->frm_grp) {
+        mpp_buffer_group_put(ctx->frm_grp);
+        ctx->frm_grp = NULL;
+    }
+    
+    if (ctx->mpp_ctx) {
+        if (ctx->mpp_mpi) {
+            ctx->mpp_mpi->reset(ctx->mpp_ctx);
+        }
+        mpp_destroy(ctx->mpp_ctx);
+        ctx->mpp_ctx = NULL;
+        ctx->mpp_mpi = NULL;
+    }
+}
+
+/* 按帧环的尺寸和格式计算行字节数和单帧大小 */
+static void ring_compute_layout(frame_ring_t* ring)
+{
+    switch (ring->format) {
+        case CAMERA_PIXEL_FORMAT_BGR888:
+            ring->stride = ring->width * 3;
+            ring->buffer_size = ring->stride * ring->height;
+            break;
+        case CAMERA_PIXEL_FORMAT_NV12:
+            ring->stride = ring->width;
+            ring->buffer_size = ring->width * ring->height * 3 / 2;
+            break;
+        default:
+            ring->stride = ring->width * 4;
+            ring->buffer_size = ring->stride * ring->height;
+            break;
+    }
+}
+
+/* 分配一个输出帧环的槽位内存 - RGA 可用时优先使用 DMA 内存，避免 RGA 走虚拟地址（分散/聚集）传输 */
+static int ring_buffers_alloc(camera_context_t* ctx, frame_ring_t* ring)
+{
+    int i;
+    
+    ring_compute_layout(ring);
+
+#ifdef USE_RGA
+    /* 可缓存的 DRM 内存：CPU 读取输出帧（回调/拷贝）不会因非缓存映射而变慢 */
+    if (!ctx->ring_grp) {
+        mpp_buffer_group_get_internal(&ctx->ring_grp,
+            (MppBufferType)(MPP_BUFFER_TYPE_DRM | MPP_BUFFER_FLAGS_CACHABLE));
+    }
+    if (ctx->ring_grp) {
+        for (i = 0; i < ring->slot_count; i++) {
+            if (mpp_buffer_get(ctx->ring_grp, &ring->slots[i].dma_buf, ring->buffer_size) != MPP_OK) {
+                break;
+            }
+            ring->slots[i].data = (uint8_t*)mpp_buffer_get_ptr(ring->slots[i].dma_buf);
+        }
+        if (i == ring->slot_count) {
+            ring->capacity = ring->buffer_size;
+            return 0;
+        }
+        fprintf(stderr, "[%s] DMA output buffer allocation failed, using malloc\n", MODULE_TAG);
+        ring_buffers_free(ring);
+    }
+#else
+    (void)ctx;
+#endif
+    
+    for (i = 0; i < ring->slot_count; i++) {
+        ring->slots[i].data = (uint8_t*)malloc(ring->buffer_size);
+        if (!ring->slots[i].data) {
+            return -1;
+        }
+    }
+    
+    ring->capacity = ring->buffer_size;
+    return 0;
+}
+
+/* 释放一个输出帧环的槽位内存 */
+static void ring_buffers_free(frame_ring_t* ring)
+{
+    int i;
+    
+    for (i = 0; i < ring->slot_count; i++) {
+        frame_slot_t* slot = &ring->slots[i];
+        if (slot->dma_buf) {
+            mpp_buffer_put(slot->dma_buf);
+            slot->dma_buf = NULL;
+        } else if (slot->data) {
+            free(slot->data);
+        }
+        slot->data = NULL;
+    }
+    ring->capacity = 0;
+}
+
+/* 为生产者占用一个可写槽位：跳过最新帧和有读者引用的槽位，失败返回 -1 */
+static int ring_claim_slot(frame_ring_t* ring)
+{
+    uint64_t packed = atomic_load_explicit(&ring->latest, memory_order_relaxed);
+    int latest_idx = packed ? (int)(packed & 0xff) : -1;
+    int i;
+    
+    for (i = 1; i <= ring->slot_count; i++) {
+        int idx = (ring->last_write_slot + i + ring->slot_count) % ring->slot_count;
+        int expected = 0;
+        
+        if (idx == latest_idx) continue;
+        if (atomic_compare_exchange_strong_explicit(&ring->slots[idx].refcount, &expected, SLOT_WRITING,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            ring->last_write_slot = idx;
+            return idx;
+        }
+    }
+    
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return -1;
+}
+
+/* 发布已写好的槽位为最新帧 */
+static void ring_publish_slot(frame_ring_t* ring, int idx, uint64_t seq)
+{
+    frame_slot_t* slot = &ring->slots[idx];
+    
+    atomic_store_explicit(&slot->consumed, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->refcount, 0, memory_order_release);
+    
+    uint64_t prev = atomic_exchange_explicit(&ring->latest, (seq << 8) | (uint64_t)idx, memory_order_acq_rel);
+    if (prev && !atomic_load_explicit(&ring->slots[prev & 0xff].consumed, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&ring->overwritten, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&ring->published, 1, memory_order_relaxed);
+}
+
+/* 唤醒等待新帧的读者（生产者只在有等待者时短暂加锁） */
+static void ring_notify_waiters(camera_context_t* ctx)
+{
+    if (atomic_load(&ctx->waiters) > 0) {
+        pthread_mutex_lock(&ctx->wait_mutex);
+        pthread_cond_broadcast(&ctx->wait_cond);
+        pthread_mutex_unlock(&ctx->wait_mutex);
+    }
+}
+
+#ifdef USE_RGA
+/* 导入一个 MPP 解码输出缓冲区到 RGA 并加入缓存 */
+/* 源缓冲区导入参数（原始格式按采集布局，buf 可为 NULL） */
+static void rga_src_param(camera_context_t* ctx, MppBuffer buf, im_handle_param_t* param)
+{
+    memset(param, 0, sizeof(*param));
+    if (ctx->raw_input) {
+        /* 原始格式按采集缓冲区实际布局导入，缓冲区只有 sizeimage 大小 */
+        int yuyv = ctx->input_format == CAMERA_INPUT_FORMAT_YUYV;
+        param->width = yuyv ? ctx->v4l2_bytesperline / 2 : ctx->v4l2_bytesperline;
+        param->height = ctx->height;
+        param->format = yuyv ? RK_FORMAT_YUYV_422 : RK_FORMAT_YCbCr_420_SP;
+        return;
+    }
+    
+    /* 按 4 字节/像素覆盖整个缓冲区（大小随输出格式和共享缓冲区而不同），
+     * 实际 YUV 格式在 wrapbuffer_handle 时指定 */
+    param->width = ALIGN(ctx->width, 16);
+    param->height = mpp_buffer_get_size(buf) / (param->width * 4);
+    param->format = RK_FORMAT_RGBA_8888;
+}
+
+/* rga_src_lock 内调用（初始化时单线程除外） */
+static rga_buffer_handle_t rga_cache_import_src(camera_context_t* ctx, MppBuffer buf)
+{
+    im_handle_param_t param;
+    int fd = mpp_buffer_get_fd(buf);
+    
+    rga_src_param(ctx, buf, &param);
+    rga_buffer_handle_t handle = importbuffer_fd(fd, &param);
+    if (handle == 0) {
+        fprintf(stderr, "[%s] RGA importbuffer_fd failed (fd %d)\n", MODULE_TAG, fd);
+        return 0;
+    }
+    
+    if (ctx->rga_src_count < RGA_SRC_CACHE_SIZE) {
+        ctx->rga_src_cache[ctx->rga_src_count].fd = fd;
+        ctx->rga_src_cache[ctx->rga_src_count].handle = handle;
+        ctx->rga_src_count++;
+    }
+    return handle;
+}
+
+/* 按 fd 查找源缓冲区句柄，未命中时导入（独立缓冲区已预先导入，共享缓冲区在本相机首次借到时导入） */
+static rga_buffer_handle_t rga_cache_get_src(camera_context_t* ctx, MppBuffer buf, int* transient)
+{
+    int fd = mpp_buffer_get_fd(buf);
+    rga_buffer_handle_t handle = 0;
+    int i;
+    
+    *transient = 0;
+    pthread_mutex_lock(&ctx->rga_src_lock);
+    for (i = 0; i < ctx->rga_src_count; i++) {
+        if (ctx->rga_src_cache[i].fd == fd) {
+            handle = ctx->rga_src_cache[i].handle;
+            break;
+        }
+    }
+    if (!handle) {
+        /* 缓存已满时导入的句柄需要调用方在使用后释放 */
+        *transient = ctx->rga_src_count >= RGA_SRC_CACHE_SIZE;
+        handle = rga_cache_import_src(ctx, buf);
+    }
+    pthread_mutex_unlock(&ctx->rga_src_lock);
+    return handle;
+}
+
+/* 移除即将释放的源缓冲区的句柄（解码缓冲区按新大小重新分配时） */
+static void rga_cache_forget(camera_context_t* ctx, MppBuffer buf)
+{
+    int fd = mpp_buffer_get_fd(buf);
+    
+    pthread_mutex_lock(&ctx->rga_src_lock);
+    for (int i = 0; i < ctx->rga_src_count; i++) {
+        if (ctx->rga_src_cache[i].fd == fd) {
+            releasebuffer_handle(ctx->rga_src_cache[i].handle);
+            ctx->rga_src_cache[i] = ctx->rga_src_cache[--ctx->rga_src_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ctx->rga_src_lock);
+}
+
+/* 输出帧格式对应的 RGA 格式 */
+static int rga_dst_format(camera_pixel_format_t format)
+{
+    switch (format) {
+        case CAMERA_PIXEL_FORMAT_BGR888:
+            return RK_FORMAT_BGR_888;
+        case CAMERA_PIXEL_FORMAT_NV12:
+            return RK_FORMAT_YCbCr_420_SP;
+        default:
+            return RK_FORMAT_BGRA_8888;
+    }
+}
+
+/* 建立 RGA 句柄缓存：所有解码输出缓冲区 + 各输出帧环的目标缓冲区 */
+static void rga_cache_init(camera_context_t* ctx)
+{
+    int i, s;
+    
+    /* 源缓冲区：MJPEG 为已分配的解码输出缓冲区（其余在首次转换时导入），原始格式为零拷贝模式下的采集缓冲区 */
+    ctx->rga_src_count = 0;
+    for (i = 0; i < MPP_BUFFER_COUNT; i++) {
+        if (ctx->decode_bufs[i].frm_buf) {
+            rga_cache_import_src(ctx, ctx->decode_bufs[i].frm_buf);
+        }
+    }
+    for (i = 0; ctx->raw_input && i < ctx->buffer_count; i++) {
+        if (ctx->v4l2_buffers[i].mpp_buf) {
+            rga_cache_import_src(ctx, ctx->v4l2_buffers[i].mpp_buf);
+        }
+    }
+    
+    for (s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        frame_ring_t* ring = &ctx->rings[s];
+        if (ring->slot_count == 0) continue;
+        
+        for (i = 0; i < ring->slot_count; i++) {
+            frame_slot_t* slot = &ring->slots[i];
+            im_handle_param_t param = {0};
+            param.width = ring->width;
+            param.height = ring->height;
+            param.format = rga_dst_format(ring->format);
+            
+            if (slot->dma_buf) {
+                slot->rga_handle = importbuffer_fd(mpp_buffer_get_fd(slot->dma_buf), &param);
+            } else {
+                slot->rga_handle = importbuffer_virtualaddr(slot->data, &param);
+            }
+            if (slot->rga_handle == 0) {
+                fprintf(stderr, "[%s] RGA import of output buffer %d (stream %d) failed\n", MODULE_TAG, i, s);
+            }
+        }
+        
+        printf("[%s] RGA handle cache: stream %d, %d %s %dx%d destination buffers\n", MODULE_TAG, s,
+               ring->slot_count, ring->slots[0].dma_buf ? "DMA" : "virtual-address",
+               ring->width, ring->height);
+    }
+    printf("[%s] RGA handle cache: %d source buffers\n", MODULE_TAG, ctx->rga_src_count);
+}
+
+/* 释放 RGA 句柄缓存 */
+static void rga_cache_deinit(camera_context_t* ctx)
+{
+    int i;
+    
+    for (i = 0; i < ctx->rga_src_count; i++) {
+        releasebuffer_handle(ctx->rga_src_cache[i].handle);
+        ctx->rga_src_cache[i].handle = 0;
+        ctx->rga_src_cache[i].fd = -1;
+    }
+    ctx->rga_src_count = 0;
+    
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        frame_ring_t* ring = &ctx->rings[s];
+        for (i = 0; i < ring->slot_count; i++) {
+            if (ring->slots[i].rga_handle) {
+                releasebuffer_handle(ring->slots[i].rga_handle);
+                ring->slots[i].rga_handle = 0;
+            }
+        }
+    }
+}
+
+/* MPP 解码输出格式对应的 RGA 输入格式 */
+static int rga_src_format(MppFrameFormat format)
+{
+    switch (format & MPP_FRAME_FMT_MASK) {
+        case MPP_FMT_YUV420SP:
+            return RK_FORMAT_YCbCr_420_SP;
+        case MPP_FMT_YUV420SP_VU:
+            return RK_FORMAT_YCrCb_420_SP;
+        case MPP_FMT_YUV422SP:
+            return RK_FORMAT_YCbCr_422_SP;
+        case MPP_FMT_YUV422SP_VU:
+            return RK_FORMAT_YCrCb_422_SP;
+        default:
+            return RK_FORMAT_YCbCr_420_SP;
+    }
+}
+
+/* RGA 硬件加速的 YUV 转 BGRA - 超快！句柄来自缓存，每帧只有 imcvtcolor */
+static int yuv_to_bgra_rga(const convert_source_t* csrc, rga_buffer_handle_t dst_handle)
+{
+    IM_STATUS ret;
+    rga_buffer_t src = {0};
+    rga_buffer_t dst = {0};
+    int width = csrc->img.width;
+    int height = csrc->img.height;
+    
+    if (csrc->rga_handle == 0 || dst_handle == 0) {
+        return -1;
+    }
+    
+    /* 配置源图像 */
+    src = wrapbuffer_handle(csrc->rga_handle, width, height, csrc->rga_format);
+    src.wstride = csrc->rga_wstride;
+    src.hstride = csrc->rga_hstride;
+    
+    /* 配置目标图像 */
+    dst = wrapbuffer_handle(dst_handle, width, height, RK_FORMAT_BGRA_8888);
+    dst.wstride = width;
+    dst.hstride = height;
+    
+    /* 执行 RGA 格式转换 */
+    ret = imcvtcolor(src, dst, src.format, dst.format);
+    if (ret != IM_STATUS_SUCCESS) {
+        fprintf(stderr, "[%s] RGA imcvtcolor failed: %s\n", MODULE_TAG, imStrError(ret));
+        return -1;
+    }
+    
+    return 0;
+}
+
+/* RGA 一次完成检测流的裁剪 + 缩放 + 格式转换 */
+static int yuv_to_detect_rga(const convert_source_t* csrc, rga_buffer_handle_t dst_handle,
+                             const camera_rect_t* roi, const frame_ring_t* ring)
 {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    int i;
+    IM_STATUS ret;
+    rga_buffer_t src = {0};
+    rga_buffer_t dst = {0};
+    rga_buffer_t pat = {0};
+    im_rect src_rect = { roi->x, roi->y, roi->width, roi->height };
+    im_rect dst_rect = { 0, 0, ring->width, ring->height };
+    im_rect pat_rect = {0};
     
-    /* 入队所有缓冲区 */
-    for (i = 0; i < ctx->buffer_count; i++) {
-        struct v4l2_buffer buf;
-        
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        
-        if (xioctl(ctx->v4l2_fd, VIDIOC_QBUF, &buf) < 0) {
-            fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
-            return -1;
-        }
+    if (csrc->rga_handle == 0 || dst_handle == 0) {
+        return -1;
     }
     
-    /* 开始流传输 */
-    if (xioctl(ctx->v4l2_fd, VIDIOC_STREAMON, &type) < 0) {
-        fprintf(stderr, "[%s] VIDIOC_STREAMON failed: %s\n", MODULE_TAG, strerror(errno));
+    src = wrapbuffer_handle(csrc->rga_handle, csrc->img.width, csrc->img.height, csrc->rga_format);
+    src.wstride = csrc->rga_wstride;
+    src.hstride = csrc->rga_hstride;
+    
+    dst = wrapbuffer_handle(dst_handle, ring->width, ring->height, rga_dst_format(ring->format));
+    dst.wstride = ring->width;
+    dst.hstride = ring->height;
+    
+    ret = improcess(src, dst, pat, src_rect, dst_rect, pat_rect, IM_SYNC);
+    if (ret != IM_STATUS_SUCCESS) {
+        fprintf(stderr, "[%s] RGA improcess (detect) failed: %s\n", MODULE_TAG, imStrError(ret));
         return -1;
     }
     
     return 0;
 }
+#endif
 
-/* 停止 V4L2 流 */
-static void v4l2_stop_streaming(camera_context_t* ctx)
+/* 解码输出格式对应的 CPU 转换布局，返回 -1 表示不支持 */
+static int yuv_image_from_mpp(uint8_t* yuv_data, int width, int height, int hor_stride, int ver_stride,
+                              MppFrameFormat format, yuv_image_t* img)
 {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    xioctl(ctx->v4l2_fd, VIDIOC_STREAMOFF, &type);
+    img->y = yuv_data;
+    img->uv = yuv_data + hor_stride * ver_stride;
+    img->y_stride = hor_stride;
+    img->uv_stride = hor_stride;
+    img->width = width;
+    img->height = height;
+    
+    switch (format & MPP_FRAME_FMT_MASK) {
+        case MPP_FMT_YUV420SP:      /* NV12 */
+            img->layout = YUV_LAYOUT_420SP;
+            img->vu = false;
+            return 0;
+        case MPP_FMT_YUV420SP_VU:   /* NV21 */
+            img->layout = YUV_LAYOUT_420SP;
+            img->vu = true;
+            return 0;
+        case MPP_FMT_YUV422SP:      /* NV16 */
+            img->layout = YUV_LAYOUT_422SP;
+            img->vu = false;
+            return 0;
+        case MPP_FMT_YUV422SP_VU:   /* NV61 */
+            img->layout = YUV_LAYOUT_422SP;
+            img->vu = true;
+            return 0;
+        default:
+            /* 默认当作 NV12 处理 */
+            img->layout = YUV_LAYOUT_420SP;
+            img->vu = false;
+            return -1;
+    }
 }
 
-/* MPP 解码器初始化 - 预分配缓冲区 */
-static int mpp_decoder_init(camera_context_t* ctx)
+/* 配置的颜色空间，自动时使用源标注的量化范围和矩阵 */
+static yuv_color_space_t resolve_color_space(camera_context_t* ctx, bool limited, bool bt709)
+{
+    switch (ctx->color_space) {
+        case CAMERA_COLOR_SPACE_BT601_LIMITED: return YUV_BT601_LIMITED;
+        case CAMERA_COLOR_SPACE_BT709_FULL: return YUV_BT709_FULL;
+        case CAMERA_COLOR_SPACE_BT709_LIMITED: return YUV_BT709_LIMITED;
+        case CAMERA_COLOR_SPACE_BT601_FULL: return YUV_BT601_FULL;
+        default: break;
+    }
+    
+    if (bt709) return limited ? YUV_BT709_LIMITED : YUV_BT709_FULL;
+    return limited ? YUV_BT601_LIMITED : YUV_BT601_FULL;
+}
+
+/* 本帧使用的颜色空间：配置优先，自动时取解码器标注（MJPEG 通常为 BT.601 全范围） */
+static yuv_color_space_t frame_color_space(camera_context_t* ctx, MppFrame frame)
+{
+    return resolve_color_space(ctx, mpp_frame_get_color_range(frame) == MPP_FRAME_RANGE_MPEG,
+                               mpp_frame_get_colorspace(frame) == MPP_FRAME_SPC_BT709);
+}
+
+/* 检测流 CPU 回退：最近邻采样裁剪/缩放，同时转换到目标格式（检测图很小，逐像素即可） */
+static void yuv_to_detect_cpu(const yuv_image_t* img, yuv_color_space_t color_space, const camera_rect_t* roi,
+                              const frame_ring_t* ring, uint8_t* dst)
+{
+    const yuv_coeffs_t* coeffs = yuv_get_coeffs(color_space);
+    int bpp = ring->format == CAMERA_PIXEL_FORMAT_BGR888 ? 3 : 4;
+    int y, u, v;
+    
+    for (int i = 0; i < ring->height; i++) {
+        int sy = roi->y + i * roi->height / ring->height;
+        
+        if (ring->format == CAMERA_PIXEL_FORMAT_NV12) {
+            uint8_t* dst_y = dst + i * ring->stride;
+            uint8_t* dst_uv = dst + ring->stride * ring->height + (i / 2) * ring->stride;
+            for (int j = 0; j < ring->width; j++) {
+                int sx = roi->x + j * roi->width / ring->width;
+                yuv_image_sample(img, sx, sy, &y, &u, &v);
+                dst_y[j] = y;
+                if (!(i & 1) && !(j & 1)) {
+                    dst_uv[j + 0] = u;
+                    dst_uv[j + 1] = v;
+                }
+            }
+            continue;
+        }
+        
+        uint8_t* out_row = dst + i * ring->stride;
+        for (int j = 0; j < ring->width; j++) {
+            int sx = roi->x + j * roi->width / ring->width;
+            yuv_image_sample(img, sx, sy, &y, &u, &v);
+            
+            uint8_t* px = out_row + j * bpp;
+            yuv_pixel_to_bgr(coeffs, y, u - 128, v - 128, px);
+            if (bpp == 4) px[3] = 255;
+        }
+    }
+}
+
+
+static long elapsed_us(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000 + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+static int64_t timespec_us(const struct timespec* ts)
+{
+    return (int64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+/* 提交一帧 MJPEG 到 MPP - 使用 MppTask 接口（MJPEG 必须），不等待解码结果
+ * @return 0 已提交，1 流水线已满（帧被丢弃），-1 失败
+ */
+static int decode_submit_mjpeg(camera_context_t* ctx, int v4l2_index, size_t mjpeg_size,
+                               const struct timespec* ts_capture, const camera_frame_info_t* info)
 {
     MPP_RET ret;
-    MppDecCfg cfg = NULL;
-    int i;
+    MppTask task = NULL;
+    MppPacket packet = NULL;
+    MppFrame frame = NULL;
+    v4l2_buffer_t* src = &ctx->v4l2_buffers[v4l2_index];
+    
+    /* 流水线已满：丢弃最新帧而不是阻塞采集 */
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    int full = ctx->in_flight >= ctx->queue_depth;
+    pthread_mutex_unlock(&ctx->pipe_mutex);
+    if (full) {
+        return 1;
+    }
     
-    /* 创建 MPP 上下文 */
-    ret = mpp_create(&ctx->mpp_ctx, &ctx->mpp_mpi);
-    if (ret != MPP_OK) {
-        fprintf(stderr, "[%s] mpp_create failed: %d\n", MODULE_TAG, ret);
+    /* 轮转选取空闲的解码缓冲区 - 跳过在途和被外部持有的缓冲区，全部占用时丢弃本帧
+     * 共享缓冲区模式下还要等上一次借用的缓冲区归还完毕 */
+    int buf_idx = -1;
+    for (int i = 0; i < ctx->decode_buffer_count; i++) {
+        int idx = (ctx->current_buf_idx + i) % ctx->decode_buffer_count;
+        if (atomic_load_explicit(&ctx->decode_bufs[idx].refs, memory_order_acquire) == 0 &&
+            atomic_load_explicit(&ctx->decode_bufs[idx].borrowed, memory_order_acquire) == 0) {
+            buf_idx = idx;
+            break;
+        }
+    }
+    if (buf_idx < 0) {
+        return 1;
+    }
+    
+    mpp_decode_buffer_t* dec_buf = &ctx->decode_bufs[buf_idx];
+    MppBuffer pkt_src;
+    
+    /* MMAP 模式先准备包缓冲区，避免借到共享缓冲区后再丢帧 */
+    if (!src->mpp_buf && decode_packet_buffer_prepare(ctx, dec_buf, mjpeg_size) != 0) {
         return -1;
     }
     
-    /* 初始化为 MJPEG 解码器 */
-    ret = mpp_init(ctx->mpp_ctx, MPP_CTX_DEC, MPP_VIDEO_CodingMJPEG);
+    /* 缓冲池已满或需为高优先级相机保留：与流水线已满一样丢弃本帧 */
+    int prepared = decode_frame_buffer_prepare(ctx, dec_buf);
+    if (prepared != 0) return prepared;
+    ctx->current_buf_idx = (buf_idx + 1) % ctx->decode_buffer_count;
+    
+    /* 在途任务的引用，以下提交失败时归还（借用的共享缓冲区随之放回） */
+    atomic_store_explicit(&dec_buf->refs, 1, memory_order_relaxed);
+    
+    if (src->mpp_buf) {
+        /* 零拷贝：V4L2 缓冲区本身就是 MPP 缓冲区，直接作为输入包 */
+        pkt_src = src->mpp_buf;
+    } else {
+        
+        /* 复制 MJPEG 数据到包缓冲区 */
+        memcpy(mpp_buffer_get_ptr(dec_buf->pkt_buf), src->planes[0].start, mjpeg_size);
+        pkt_src = dec_buf->pkt_buf;
+    }
+    
+    /* 创建输入包 */
+    ret = mpp_packet_init_with_buffer(&packet, pkt_src);
     if (ret != MPP_OK) {
-        fprintf(stderr, "[%s] mpp_init failed: %d\n", MODULE_TAG, ret);
+        decode_buffer_unref(ctx, buf_idx);
         return -1;
     }
+    mpp_packet_set_length(packet, mjpeg_size);
     
-    /* 配置解码器 - 低延迟模式 */
-    mpp_dec_cfg_init(&cfg);
-    ret = ctx->mpp_mpi->control(ctx->mpp_ctx, MPP_DEC_GET_CFG, cfg);
-    if (ret == MPP_OK) {
-        /* 不需要分割解析，MJPEG 每帧都是完整的 */
-        mpp_dec_cfg_set_u32(cfg, "base:split_parse", 0);
-        /* 设置快速输出模式 */
-        mpp_dec_cfg_set_u32(cfg, "base:fast_out", 1);
-        ctx->mpp_mpi->control(ctx->mpp_ctx, MPP_DEC_SET_CFG, cfg);
+    /* 创建输出帧 */
+    ret = mpp_frame_init(&frame);
+    if (ret != MPP_OK) {
+        mpp_packet_deinit(&packet);
+        decode_buffer_unref(ctx, buf_idx);
+        return -1;
     }
-    mpp_dec_cfg_deinit(cfg);
+    mpp_frame_set_buffer(frame, dec_buf->frm_buf);
     
-    /* 创建帧缓冲组 */
-    ret = mpp_buffer_group_get_internal(&ctx->frm_grp, MPP_BUFFER_TYPE_ION);
+    /* 从输入端口获取任务 - 非阻塞，MPP 任务耗尽时视为流水线已满 */
+    ret = ctx->mpp_mpi->poll(ctx->mpp_ctx, MPP_PORT_INPUT, MPP_POLL_NON_BLOCK);
     if (ret != MPP_OK) {
-        fprintf(stderr, "[%s] mpp_buffer_group_get failed: %d\n", MODULE_TAG, ret);
+        mpp_frame_deinit(&frame);
+        mpp_packet_deinit(&packet);
+        decode_buffer_unref(ctx, buf_idx);
+        return 1;
+    }
+    
+    ret = ctx->mpp_mpi->dequeue(ctx->mpp_ctx, MPP_PORT_INPUT, &task);
+    if (ret != MPP_OK || !task) {
+        mpp_frame_deinit(&frame);
+        mpp_packet_deinit(&packet);
+        decode_buffer_unref(ctx, buf_idx);
         return -1;
     }
     
-    /* 预分配解码缓冲区 */
-    RK_U32 hor_stride = ALIGN(ctx->width, 16);
-    RK_U32 ver_stride = ALIGN(ctx->height, 16);
-    size_t pkt_size = ctx->width * ctx->height;  /* MJPEG 压缩后通常小于原始大小 */
-    size_t frm_size = hor_stride * ver_stride * 4;  /* YUV422 最大 */
+    /* 设置输入包和输出帧到任务 */
+    mpp_task_meta_set_packet(task, KEY_INPUT_PACKET, packet);
+    mpp_task_meta_set_frame(task, KEY_OUTPUT_FRAME, frame);
     
-    for (i = 0; i < MPP_BUFFER_COUNT; i++) {
-        ret = mpp_buffer_get(ctx->frm_grp, &ctx->decode_bufs[i].pkt_buf, pkt_size);
-        if (ret != MPP_OK) {
-            fprintf(stderr, "[%s] mpp_buffer_get pkt failed: %d\n", MODULE_TAG, ret);
-            return -1;
-        }
-        ctx->decode_bufs[i].pkt_buf_size = pkt_size;
-        
-        ret = mpp_buffer_get(ctx->frm_grp, &ctx->decode_bufs[i].frm_buf, frm_size);
-        if (ret != MPP_OK) {
-            fprintf(stderr, "[%s] mpp_buffer_get frm failed: %d\n", MODULE_TAG, ret);
-            return -1;
-        }
-        ctx->decode_bufs[i].frm_buf_size = frm_size;
+    /* 先登记在途任务，输出线程可能在 enqueue 返回前就拿到结果 */
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    decode_job_t* job = &ctx->jobs[ctx->job_tail];
+    job->slot = buf_idx;
+    job->v4l2_index = src->mpp_buf ? v4l2_index : -1;
+    job->packet = packet;
+    job->frame = frame;
+    job->ts_capture = *ts_capture;
+    job->info = *info;
+    clock_gettime(CLOCK_MONOTONIC, &job->ts_submit);
+    pthread_mutex_unlock(&ctx->pipe_mutex);
+    
+    /* 入队任务到输入端口 */
+    ret = ctx->mpp_mpi->enqueue(ctx->mpp_ctx, MPP_PORT_INPUT, task);
+    if (ret != MPP_OK) {
+        mpp_frame_deinit(&frame);
+        mpp_packet_deinit(&packet);
+        decode_buffer_unref(ctx, buf_idx);
+        return -1;
     }
     
-    ctx->current_buf_idx = 0;
-    ctx->mpp_initialized = 1;
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    ctx->job_tail = (ctx->job_tail + 1) % MPP_BUFFER_COUNT;
+    ctx->in_flight++;
+    pthread_cond_signal(&ctx->pipe_cond);
+    pthread_mutex_unlock(&ctx->pipe_mutex);
     
-    printf("[%s] MPP MJPEG decoder initialized (pre-allocated %d buffers)\n", MODULE_TAG, MPP_BUFFER_COUNT);
     return 0;
 }
 
-/* MPP 解码器释放 */
-static void mpp_decoder_deinit(camera_context_t* ctx)
+#ifdef FRAME_TRACE
+/* 转换区间名 [流][是否 RGA] */
+static const char* const g_trace_convert_names[CAMERA_STREAM_COUNT][2] = {
+    { "cpu_convert_main", "rga_convert_main" },
+    { "cpu_convert_detect", "rga_convert_detect" },
+};
+
+/* 异步区间标识：同一时刻打开的设备 fd 唯一，多相机的驱动帧序号不会冲突 */
+static uint64_t trace_job_id(camera_context_t* ctx, uint32_t seq)
 {
-    int i;
+    return ((uint64_t)(uint32_t)ctx->v4l2_fd << 32) | seq;
+}
+#endif
+
+/* 将一帧 YUV 源转换到各输出帧环的空闲槽并发布，同一源帧在所有流中共用一个序号
+ * @param slots 输出：各流发布的槽位索引，未发布为 -1
+ * @param info 帧时间信息，这里填写 frame_id 后随槽位发布
+ * @return 发布的输出数量
+ */
+static int convert_source_outputs(camera_context_t* ctx, const convert_source_t* csrc, int slots[CAMERA_STREAM_COUNT],
+                                  camera_frame_info_t* info)
+{
+    int published = 0;
+    uint64_t seq = ctx->next_sequence++;
     
-    /* 释放预分配的缓冲区 */
-    for (i = 0; i < MPP_BUFFER_COUNT; i++) {
-        if (ctx->decode_bufs[i].pkt_buf) {
-            mpp_buffer_put(ctx->decode_bufs[i].pkt_buf);
-            ctx->decode_bufs[i].pkt_buf = NULL;
+    info->frame_id = seq;
+    
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        frame_ring_t* ring = &ctx->rings[s];
+        if (ring->slot_count == 0) continue;
+        if (s == CAMERA_STREAM_DETECT && atomic_load_explicit(&ctx->detect_paused, memory_order_relaxed)) continue;
+        
+        /* 占用写入槽位 - 所有槽位都被读者持有时丢弃本帧，绝不等待读者 */
+        int write_idx = ring_claim_slot(ring);
+        if (write_idx < 0) continue;
+        frame_slot_t* slot = &ring->slots[write_idx];
+        FRAME_TRACE_BEGIN(trace_cv);
+
+#ifdef USE_RGA
+        /* 主输出只做格式转换，检测流在同一次 RGA 调用中完成裁剪和缩放 */
+        camera_group_rga_begin(ctx->group_member);
+        int rga_ret = (s == CAMERA_STREAM_MAIN)
+            ? yuv_to_bgra_rga(csrc, slot->rga_handle)
+            : yuv_to_detect_rga(csrc, slot->rga_handle, &ctx->detect_roi, ring);
+        camera_group_rga_end(ctx->group_member);
+        
+        MppBuffer dst_dma = slot->dma_buf;
+        if (rga_ret != 0) {
+            /* RGA 失败，回退到 CPU；DMA 缓冲区需在 CPU 写入前后同步缓存 */
+            if (dst_dma) mpp_buffer_sync_begin(dst_dma);
+            if (s == CAMERA_STREAM_MAIN) {
+                yuv_converter_to_bgra(ctx->converter, &csrc->img, slot->data, ring->stride, csrc->color_space);
+            } else {
+                yuv_to_detect_cpu(&csrc->img, csrc->color_space, &ctx->detect_roi, ring, slot->data);
+            }
+            if (dst_dma) mpp_buffer_sync_end(dst_dma);
+        } else if (dst_dma) {
+            /* RGA 通过 DMA 写入，CPU 读取前使缓存失效 */
+            mpp_buffer_sync_begin(dst_dma);
+            mpp_buffer_sync_end(dst_dma);
         }
-        if (ctx->decode_bufs[i].frm_buf) {
-            mpp_buffer_put(ctx->decode_bufs[i].frm_buf);
-            ctx->decode_bufs[i].frm_buf = NULL;
+        FRAME_TRACE_END(trace_cv, g_trace_convert_names[s][rga_ret == 0], seq, info->v4l2_sequence);
+#else
+        /* 使用 CPU 转换 */
+        if (s == CAMERA_STREAM_MAIN) {
+            yuv_converter_to_bgra(ctx->converter, &csrc->img, slot->data, ring->stride, csrc->color_space);
+        } else {
+            yuv_to_detect_cpu(&csrc->img, csrc->color_space, &ctx->detect_roi, ring, slot->data);
         }
+        FRAME_TRACE_END(trace_cv, g_trace_convert_names[s][0], seq, info->v4l2_sequence);
+#endif
+        
+        slot->info = *info;
+        ring_publish_slot(ring, write_idx, seq);
+        slots[s] = write_idx;
+        published++;
     }
     
-    if (ctx->frm_grp) {
-        mpp_buffer_group_put(ctx->frm_grp);
-        ctx->frm_grp = NULL;
+    if (published > 0) {
+        ring_notify_waiters(ctx);
     }
     
-    if (ctx->mpp_ctx) {
-        if (ctx->mpp_mpi) {
-            ctx->mpp_mpi->reset(ctx->mpp_ctx);
-        }
-        mpp_destroy(ctx->mpp_ctx);
-        ctx->mpp_ctx = NULL;
-        ctx->mpp_mpi = NULL;
-    }
+    return published;
 }
 
-/* 优化的 NV12/NV21 转 BGRA - 使用 NEON */
-#ifdef USE_NEON
-static void nv12_to_bgra_neon(uint8_t* __restrict y_plane, uint8_t* __restrict uv_plane,
-                               uint8_t* __restrict bgra_data, int width, int height,
-                               int y_stride, int uv_stride)
+/* 原始格式：把采集缓冲区登记为在途任务交给输出线程转换，不复制数据
+ * @return 0 已提交，1 流水线已满（帧被丢弃）
+ */
+static int raw_submit_frame(camera_context_t* ctx, int v4l2_index, size_t bytesused,
+                            const struct timespec* ts_capture, const camera_frame_info_t* info)
 {
-    for (int i = 0; i < height; i++) {
-        uint8_t* y_row = y_plane + i * y_stride;
-        uint8_t* uv_row = uv_plane + (i / 2) * uv_stride;
-        uint8_t* bgra_row = bgra_data + i * width * 4;
-        
-        int j = 0;
-        
-        /* NEON 向量化处理 - 每次处理 8 个像素 */
-        for (; j + 7 < width; j += 8) {
-            /* 加载 8 个 Y 值 */
-            uint8x8_t y_vec = vld1_u8(y_row + j);
-            
-            /* 加载 4 对 UV 值 */
-            uint8x8_t uv_vec = vld1_u8(uv_row + (j / 2) * 2);
-            
-            /* 分离 U 和 V */
-            uint8x8x2_t uv_deint = vuzp_u8(uv_vec, uv_vec);
-            int16x8_t u_vec = vreinterpretq_s16_u16(vmovl_u8(uv_deint.val[0]));
-            int16x8_t v_vec = vreinterpretq_s16_u16(vmovl_u8(uv_deint.val[1]));
-            
-            /* 扩展 UV 到每个像素 */
-            int16x8_t u_exp = vcombine_s16(
-                vzip1_s16(vget_low_s16(u_vec), vget_low_s16(u_vec)),
-                vzip1_s16(vget_high_s16(u_vec), vget_high_s16(u_vec)));
-            int16x8_t v_exp = vcombine_s16(
-                vzip1_s16(vget_low_s16(v_vec), vget_low_s16(v_vec)),
-                vzip1_s16(vget_high_s16(v_vec), vget_high_s16(v_vec)));
-            
-            /* 减去 128 */
-            u_exp = vsubq_s16(u_exp, vdupq_n_s16(128));
-            v_exp = vsubq_s16(v_exp, vdupq_n_s16(128));
-            
-            /* Y 扩展为 16 位 */
-            int16x8_t y16 = vreinterpretq_s16_u16(vmovl_u8(y_vec));
-            
-            /* 计算 RGB */
-            int16x8_t r = vaddq_s16(y16, vshrq_n_s16(vmulq_n_s16(v_exp, 359), 8));
-            int16x8_t g = vsubq_s16(y16, vshrq_n_s16(vaddq_s16(vmulq_n_s16(u_exp, 88), vmulq_n_s16(v_exp, 183)), 8));
-            int16x8_t b = vaddq_s16(y16, vshrq_n_s16(vmulq_n_s16(u_exp, 454), 8));
-            
-            /* 限制范围 0-255 */
-            uint8x8_t r8 = vqmovun_s16(vmaxq_s16(vdupq_n_s16(0), vminq_s16(vdupq_n_s16(255), r)));
-            uint8x8_t g8 = vqmovun_s16(vmaxq_s16(vdupq_n_s16(0), vminq_s16(vdupq_n_s16(255), g)));
-            uint8x8_t b8 = vqmovun_s16(vmaxq_s16(vdupq_n_s16(0), vminq_s16(vdupq_n_s16(255), b)));
-            uint8x8_t a8 = vdup_n_u8(255);
-            
-            /* 交织存储为 BGRA */
-            uint8x8x4_t bgra;
-            bgra.val[0] = b8;
-            bgra.val[1] = g8;
-            bgra.val[2] = r8;
-            bgra.val[3] = a8;
-            vst4_u8(bgra_row + j * 4, bgra);
-        }
-        
-        /* 处理剩余像素 */
-        for (; j < width; j++) {
-            int y = y_row[j];
-            int u = uv_row[(j / 2) * 2] - 128;
-            int v = uv_row[(j / 2) * 2 + 1] - 128;
-            
-            int r = y + ((v * 359) >> 8);
-            int g = y - ((u * 88 + v * 183) >> 8);
-            int b = y + ((u * 454) >> 8);
-            
-            r = r < 0 ? 0 : (r > 255 ? 255 : r);
-            g = g < 0 ? 0 : (g > 255 ? 255 : g);
-            b = b < 0 ? 0 : (b > 255 ? 255 : b);
-            
-            bgra_row[j * 4 + 0] = b;
-            bgra_row[j * 4 + 1] = g;
-            bgra_row[j * 4 + 2] = r;
-            bgra_row[j * 4 + 3] = 255;
-        }
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    if (ctx->in_flight >= ctx->queue_depth) {
+        pthread_mutex_unlock(&ctx->pipe_mutex);
+        return 1;
     }
+    
+    /* 输出线程的引用，转换完成且没有共享帧持有者时重新入队 */
+    atomic_fetch_add_explicit(&ctx->v4l2_buffers[v4l2_index].refs, 1, memory_order_relaxed);
+    
+    decode_job_t* job = &ctx->jobs[ctx->job_tail];
+    job->slot = -1;
+    job->v4l2_index = v4l2_index;
+    job->bytesused = bytesused;
+    job->packet = NULL;
+    job->frame = NULL;
+    job->ts_capture = *ts_capture;
+    job->info = *info;
+    clock_gettime(CLOCK_MONOTONIC, &job->ts_submit);
+    
+    ctx->job_tail = (ctx->job_tail + 1) % MPP_BUFFER_COUNT;
+    ctx->in_flight++;
+    pthread_cond_signal(&ctx->pipe_cond);
+    pthread_mutex_unlock(&ctx->pipe_mutex);
+    
+    return 0;
 }
+
+/* 将解码后的 YUV 帧转换到各输出帧环
+ * @param slots 输出：各流发布的槽位索引，未发布为 -1
+ * @return 发布的输出数量，解码帧无效返回 -1
+ */
+static int convert_frame_outputs(camera_context_t* ctx, MppFrame out_frame, int slots[CAMERA_STREAM_COUNT],
+                                 camera_frame_info_t* info)
+{
+    MppBuffer out_buf = mpp_frame_get_buffer(out_frame);
+    RK_U32 err_info = mpp_frame_get_errinfo(out_frame);
+    convert_source_t csrc;
+    
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) slots[s] = -1;
+    
+    if (!out_buf || err_info) {
+        return -1;
+    }
+    
+    int width = mpp_frame_get_width(out_frame);
+    int height = mpp_frame_get_height(out_frame);
+    int hor_stride = mpp_frame_get_hor_stride(out_frame);
+    int ver_stride = mpp_frame_get_ver_stride(out_frame);
+    MppFrameFormat fmt = mpp_frame_get_fmt(out_frame);
+    
+    /* 解码缓冲池按实际格式确定每像素字节数，之后提交的解码按新大小分配缓冲区 */
+    MppFrameFormat yuv_fmt = (MppFrameFormat)(fmt & MPP_FRAME_FMT_MASK);
+    int bpp_x2 = (yuv_fmt == MPP_FMT_YUV420SP || yuv_fmt == MPP_FMT_YUV420SP_VU) ? 3 : 4;
+    if (bpp_x2 != atomic_load_explicit(&ctx->frame_bpp_x2, memory_order_relaxed)) {
+        atomic_store_explicit(&ctx->frame_bpp_x2, bpp_x2, memory_order_relaxed);
+    }
+    
+    /* 调试：打印格式信息（每个相机仅首帧） */
+    if (!ctx->frame_info_logged) {
+        printf("[%s] Frame info: %dx%d, stride %dx%d, fmt=0x%x\n",
+               MODULE_TAG, width, height, hor_stride, ver_stride, fmt);
+#ifdef USE_RGA
+        printf("[%s] Using RGA hardware acceleration for color conversion\n", MODULE_TAG);
+#else
+        printf("[%s] Using CPU for color conversion\n", MODULE_TAG);
+#endif
+        ctx->frame_info_logged = true;
+    }
+    
+    yuv_image_from_mpp((uint8_t*)mpp_buffer_get_ptr(out_buf), width, height, hor_stride, ver_stride, fmt, &csrc.img);
+    csrc.color_space = frame_color_space(ctx, out_frame);
+
+#ifdef USE_RGA
+    int transient = 0;
+    csrc.rga_handle = rga_cache_get_src(ctx, out_buf, &transient);
+    csrc.rga_format = rga_src_format(fmt);
+    csrc.rga_wstride = hor_stride;
+    csrc.rga_hstride = ver_stride;
+#endif
+    
+    int published = convert_source_outputs(ctx, &csrc, slots, info);
+
+#ifdef USE_RGA
+    if (transient && csrc.rga_handle) {
+        releasebuffer_handle(csrc.rga_handle);
+    }
 #endif
+    
+    return published;
+}
 
-/* 标量版本的 NV12 转 BGRA */
-static void nv12_to_bgra_scalar(uint8_t* y_plane, uint8_t* uv_plane, uint8_t* bgra_data,
-                                 int width, int height, int y_stride, int uv_stride)
+/* 将原始格式采集缓冲区直接转换到各输出帧环（不经过解码）
+ * @return 发布的输出数量，缓冲区数据不足返回 -1
+ */
+static int convert_raw_outputs(camera_context_t* ctx, int v4l2_index, size_t bytesused, int slots[CAMERA_STREAM_COUNT],
+                               camera_frame_info_t* info)
 {
-    for (int i = 0; i < height; i++) {
-        uint8_t* y_row = y_plane + i * y_stride;
-        uint8_t* uv_row = uv_plane + (i / 2) * uv_stride;
-        uint8_t* bgra_row = bgra_data + i * width * 4;
-        
-        for (int j = 0; j < width; j++) {
-            int y = y_row[j];
-            int u = uv_row[(j / 2) * 2] - 128;
-            int v = uv_row[(j / 2) * 2 + 1] - 128;
-            
-            int r = y + ((v * 359) >> 8);
-            int g = y - ((u * 88 + v * 183) >> 8);
-            int b = y + ((u * 454) >> 8);
-            
-            r = r < 0 ? 0 : (r > 255 ? 255 : r);
-            g = g < 0 ? 0 : (g > 255 ? 255 : g);
-            b = b < 0 ? 0 : (b > 255 ? 255 : b);
-            
-            bgra_row[j * 4 + 0] = b;
-            bgra_row[j * 4 + 1] = g;
-            bgra_row[j * 4 + 2] = r;
-            bgra_row[j * 4 + 3] = 255;
-        }
+    v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[v4l2_index];
+    convert_source_t csrc;
+    
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) slots[s] = -1;
+    
+    /* 截断的帧（USB 传输错误等）不转换 */
+    if (bytesused < raw_frame_size(ctx)) {
+        return -1;
+    }
+    
+    /* NV12M 的 UV 在单独的平面中 */
+    csrc.img.y = (const uint8_t*)vbuf->planes[0].start;
+    csrc.img.uv = ctx->plane_count > 1 ? (const uint8_t*)vbuf->planes[1].start
+                                       : csrc.img.y + (size_t)ctx->v4l2_bytesperline * ctx->height;
+    csrc.img.y_stride = ctx->v4l2_bytesperline;
+    csrc.img.uv_stride = ctx->v4l2_bytesperline;
+    csrc.img.width = ctx->width;
+    csrc.img.height = ctx->height;
+    csrc.img.layout = ctx->input_format == CAMERA_INPUT_FORMAT_YUYV ? YUV_LAYOUT_YUYV : YUV_LAYOUT_420SP;
+    csrc.img.vu = false;
+    csrc.color_space = resolve_color_space(ctx, ctx->raw_limited_range, ctx->raw_bt709);
+
+#ifdef USE_RGA
+    /* 零拷贝模式按 fd 命中缓存；MMAP 模式没有 fd，按虚拟地址临时导入；多平面格式 RGA 无法按单个缓冲区访问，走 CPU */
+    int transient = 0;
+    if (ctx->plane_count > 1) {
+        csrc.rga_handle = 0;
+    } else if (vbuf->mpp_buf) {
+        csrc.rga_handle = rga_cache_get_src(ctx, vbuf->mpp_buf, &transient);
+    } else {
+        im_handle_param_t param;
+        rga_src_param(ctx, NULL, &param);
+        csrc.rga_handle = importbuffer_virtualaddr(vbuf->planes[0].start, &param);
+        transient = 1;
     }
-}
+    csrc.rga_format = ctx->input_format == CAMERA_INPUT_FORMAT_YUYV ? RK_FORMAT_YUYV_422 : RK_FORMAT_YCbCr_420_SP;
+    csrc.rga_wstride = ctx->input_format == CAMERA_INPUT_FORMAT_YUYV ? ctx->v4l2_bytesperline / 2 : ctx->v4l2_bytesperline;
+    csrc.rga_hstride = ctx->height;
+#endif
+    
+    /* 采集缓冲区由设备写入，CPU 回退读取前使缓存失效 */
+    if (vbuf->mpp_buf) mpp_buffer_sync_begin(vbuf->mpp_buf);
+    int published = convert_source_outputs(ctx, &csrc, slots, info);
+    if (vbuf->mpp_buf) mpp_buffer_sync_end(vbuf->mpp_buf);
 
-/* NV16 (YUV422) 转 BGRA */
-static void nv16_to_bgra(uint8_t* y_plane, uint8_t* uv_plane, uint8_t* bgra_data,
-                          int width, int height, int y_stride, int uv_stride)
-{
-    for (int i = 0; i < height; i++) {
-        uint8_t* y_row = y_plane + i * y_stride;
-        uint8_t* uv_row = uv_plane + i * uv_stride;
-        uint8_t* bgra_row = bgra_data + i * width * 4;
-        
-        for (int j = 0; j < width; j++) {
-            int y = y_row[j];
-            int u = uv_row[(j / 2) * 2] - 128;
-            int v = uv_row[(j / 2) * 2 + 1] - 128;
-            
-            int r = y + ((v * 359) >> 8);
-            int g = y - ((u * 88 + v * 183) >> 8);
-            int b = y + ((u * 454) >> 8);
-            
-            r = r < 0 ? 0 : (r > 255 ? 255 : r);
-            g = g < 0 ? 0 : (g > 255 ? 255 : g);
-            b = b < 0 ? 0 : (b > 255 ? 255 : b);
-            
-            bgra_row[j * 4 + 0] = b;
-            bgra_row[j * 4 + 1] = g;
-            bgra_row[j * 4 + 2] = r;
-            bgra_row[j * 4 + 3] = 255;
-        }
+#ifdef USE_RGA
+    if (transient && csrc.rga_handle) {
+        releasebuffer_handle(csrc.rga_handle);
     }
+#endif
+    
+    return published;
 }
 
-#ifdef USE_RGA
-/* RGA 硬件加速的 YUV 转 BGRA - 超快！ */
-static int yuv_to_bgra_rga(MppBuffer yuv_buf, uint8_t* bgra_data, 
-                            int width, int height, int hor_stride, int ver_stride,
-                            MppFrameFormat format)
+/* 填充共享解码帧描述并加一个临时引用
+ * @return 0 成功，-1 帧格式不支持共享
+ */
+static int decoded_frame_describe(camera_context_t* ctx, decode_job_t* job, MppFrame out_frame,
+                                  uint64_t sequence, camera_decoded_frame_t* decoded)
 {
-    IM_STATUS ret;
-    rga_buffer_t src = {0};
-    rga_buffer_t dst = {0};
-    im_handle_param_t src_param = {0};
-    im_handle_param_t dst_param = {0};
-    rga_buffer_handle_t src_handle = 0;
-    rga_buffer_handle_t dst_handle = 0;
-    int rga_format;
+    mpp_decode_buffer_t* dec_buf = &ctx->decode_bufs[job->slot];
+    MppFrameFormat fmt = mpp_frame_get_fmt(out_frame) & MPP_FRAME_FMT_MASK;
     
-    /* 确定 RGA 输入格式 */
-    switch (format & MPP_FRAME_FMT_MASK) {
+    decoded->width = mpp_frame_get_width(out_frame);
+    decoded->height = mpp_frame_get_height(out_frame);
+    decoded->hor_stride = mpp_frame_get_hor_stride(out_frame);
+    decoded->ver_stride = mpp_frame_get_ver_stride(out_frame);
+    
+    switch (fmt) {
         case MPP_FMT_YUV420SP:
-            rga_format = RK_FORMAT_YCbCr_420_SP;
-            break;
-        case MPP_FMT_YUV420SP_VU:
-            rga_format = RK_FORMAT_YCrCb_420_SP;
+            decoded->format = CAMERA_PIXEL_FORMAT_NV12;
+            decoded->size = (size_t)decoded->hor_stride * decoded->ver_stride * 3 / 2;
             break;
         case MPP_FMT_YUV422SP:
-            rga_format = RK_FORMAT_YCbCr_422_SP;
-            break;
-        case MPP_FMT_YUV422SP_VU:
-            rga_format = RK_FORMAT_YCrCb_422_SP;
+            decoded->format = CAMERA_PIXEL_FORMAT_NV16;
+            decoded->size = (size_t)decoded->hor_stride * decoded->ver_stride * 2;
             break;
         default:
-            rga_format = RK_FORMAT_YCbCr_420_SP;
-            break;
+            return -1;  /* VU 排列等少见格式不共享，仍走 BGRA 输出 */
     }
     
-    /* 导入源缓冲区（MPP DMA-BUF） */
-    src_param.width = hor_stride;
-    src_param.height = ver_stride;
-    src_param.format = rga_format;
-    
-    int src_fd = mpp_buffer_get_fd(yuv_buf);
-    src_handle = importbuffer_fd(src_fd, &src_param);
-    if (src_handle == 0) {
-        fprintf(stderr, "[%s] RGA importbuffer_fd failed\n", MODULE_TAG);
-        return -1;
-    }
+    decoded->dmabuf_fd = mpp_buffer_get_fd(dec_buf->frm_buf);
+    decoded->data = (uint8_t*)mpp_buffer_get_ptr(dec_buf->frm_buf);
+    decoded->sequence = sequence;
+    decoded->index = job->slot;
+    decoded->info = job->info;
+    atomic_fetch_add_explicit(&dec_buf->refs, 1, memory_order_relaxed);
+    return 0;
+}
+
+/* 原始 NV12 采集：以采集缓冲区本身填充共享帧描述并加一个临时引用
+ * @return 0 成功，-1 该缓冲区没有 dmabuf fd
+ */
+static int raw_decoded_describe(camera_context_t* ctx, decode_job_t* job, uint64_t sequence,
+                                camera_decoded_frame_t* decoded)
+{
+    v4l2_buffer_t* vbuf = &ctx->v4l2_buffers[job->v4l2_index];
+    int fd = v4l2_buffer_fd(vbuf);
+    
+    if (fd < 0) return -1;
+    
+    decoded->dmabuf_fd = fd;
+    decoded->data = (uint8_t*)vbuf->planes[0].start;
+    decoded->width = ctx->width;
+    decoded->height = ctx->height;
+    decoded->hor_stride = ctx->v4l2_bytesperline;
+    decoded->ver_stride = ctx->height;
+    decoded->format = CAMERA_PIXEL_FORMAT_NV12;
+    decoded->size = (size_t)decoded->hor_stride * decoded->ver_stride * 3 / 2;
+    decoded->sequence = sequence;
+    decoded->index = job->v4l2_index;
+    decoded->info = job->info;
+    atomic_fetch_add_explicit(&vbuf->refs, 1, memory_order_relaxed);
+    return 0;
+}
+
+/* 归还解码缓冲区的一个引用，最后一个引用归还时把借用的共享缓冲区放回相机组（可在任意线程调用） */
+static void decode_buffer_unref(camera_context_t* ctx, int index)
+{
+    mpp_decode_buffer_t* dec_buf = &ctx->decode_bufs[index];
     
-    /* 导入目标缓冲区（虚拟地址） */
-    dst_param.width = width;
-    dst_param.height = height;
-    dst_param.format = RK_FORMAT_BGRA_8888;
+    if (atomic_fetch_sub_explicit(&dec_buf->refs, 1, memory_order_acq_rel) != 1) return;
+    if (!atomic_load_explicit(&dec_buf->borrowed, memory_order_relaxed)) return;
     
-    dst_handle = importbuffer_virtualaddr(bgra_data, &dst_param);
-    if (dst_handle == 0) {
-        fprintf(stderr, "[%s] RGA importbuffer_virtualaddr failed\n", MODULE_TAG);
-        releasebuffer_handle(src_handle);
-        return -1;
+    /* refs 为 0 但 borrowed 仍为 1 时采集线程不会选中该槽位 */
+    MppBuffer buffer = dec_buf->frm_buf;
+    dec_buf->frm_buf = NULL;
+    atomic_store_explicit(&dec_buf->borrowed, 0, memory_order_release);
+    camera_group_buffer_put(ctx->group_member, buffer);
+}
+
+/* 结束一个在途任务：释放包/帧对象，零拷贝模式和原始格式归还 V4L2 缓冲区 */
+static void decode_job_finish(camera_context_t* ctx, decode_job_t* job)
+{
+    if (job->v4l2_index >= 0) {
+        if (ctx->raw_input) {
+            v4l2_buffer_unref(ctx, job->v4l2_index);
+        } else if (v4l2_queue_buffer(ctx, job->v4l2_index) < 0 && ctx->running) {
+            fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
+        }
+        job->v4l2_index = -1;
     }
     
-    /* 配置源图像 */
-    src = wrapbuffer_handle(src_handle, width, height, rga_format);
-    src.wstride = hor_stride;
-    src.hstride = ver_stride;
-    
-    /* 配置目标图像 */
-    dst = wrapbuffer_handle(dst_handle, width, height, RK_FORMAT_BGRA_8888);
-    dst.wstride = width;
-    dst.hstride = height;
-    
-    /* 执行 RGA 格式转换 */
-    ret = imcvtcolor(src, dst, src.format, dst.format);
-    if (ret != IM_STATUS_SUCCESS) {
-        fprintf(stderr, "[%s] RGA imcvtcolor failed: %s\n", MODULE_TAG, imStrError(ret));
-        releasebuffer_handle(src_handle);
-        releasebuffer_handle(dst_handle);
-        return -1;
+    /* 原始格式的任务没有包/帧对象和解码缓冲区 */
+    if (job->frame) mpp_frame_deinit(&job->frame);
+    if (job->packet) mpp_packet_deinit(&job->packet);
+    if (job->slot >= 0) {
+        decode_buffer_unref(ctx, job->slot);
     }
     
-    /* 释放句柄 */
-    releasebuffer_handle(src_handle);
-    releasebuffer_handle(dst_handle);
-    
-    return 0;
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    ctx->job_head = (ctx->job_head + 1) % MPP_BUFFER_COUNT;
+    ctx->in_flight--;
+    pthread_cond_signal(&ctx->pipe_cond);
+    pthread_mutex_unlock(&ctx->pipe_mutex);
 }
-#endif
 
-/* 通用 YUV 转 BGRA（CPU 回退版本） */
-static void yuv_to_bgra_cpu(uint8_t* yuv_data, uint8_t* bgra_data, int width, int height, 
-                             int hor_stride, int ver_stride, MppFrameFormat format)
+/* 输出流是否设置了用户回调 */
+static bool stream_has_callback(camera_context_t* ctx, camera_stream_t stream)
 {
-    uint8_t* y_plane = yuv_data;
-    uint8_t* uv_plane = yuv_data + hor_stride * ver_stride;
+    if (ctx->info_callbacks[stream]) return true;
+    return (stream == CAMERA_STREAM_MAIN ? ctx->callback : ctx->detect_callback) != NULL;
+}
+
+/* 调用输出流的用户回调（带时间信息的回调优先）并记录执行时间 */
+static void stream_invoke_callback(camera_context_t* ctx, camera_stream_t stream, uint8_t* data,
+                                   int width, int height, int stride, const camera_frame_info_t* info)
+{
+    frame_info_callback_t info_callback = ctx->info_callbacks[stream];
+    frame_callback_t callback = stream == CAMERA_STREAM_MAIN ? ctx->callback : ctx->detect_callback;
+    struct timespec ts_start, ts_end;
     
-    switch (format & MPP_FRAME_FMT_MASK) {
-        case MPP_FMT_YUV420SP:      /* NV12 */
-        case MPP_FMT_YUV420SP_VU:   /* NV21 */
-#ifdef USE_NEON
-            nv12_to_bgra_neon(y_plane, uv_plane, bgra_data, width, height, hor_stride, hor_stride);
-#else
-            nv12_to_bgra_scalar(y_plane, uv_plane, bgra_data, width, height, hor_stride, hor_stride);
-#endif
-            break;
-        case MPP_FMT_YUV422SP:      /* NV16 */
-        case MPP_FMT_YUV422SP_VU:   /* NV61 */
-            nv16_to_bgra(y_plane, uv_plane, bgra_data, width, height, hor_stride, hor_stride);
-            break;
-        default:
-            /* 默认当作 NV12 处理 */
-#ifdef USE_NEON
-            nv12_to_bgra_neon(y_plane, uv_plane, bgra_data, width, height, hor_stride, hor_stride);
-#else
-            nv12_to_bgra_scalar(y_plane, uv_plane, bgra_data, width, height, hor_stride, hor_stride);
-#endif
-            break;
+    if (!info_callback && !callback) return;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts_start);
+    if (info_callback) {
+        info_callback(ctx->info_user_data[stream], data, width, height, stride, info);
+    } else {
+        callback(stream == CAMERA_STREAM_MAIN ? ctx->user_data : ctx->detect_user_data, data, width, height, stride);
     }
+    clock_gettime(CLOCK_MONOTONIC, &ts_end);
+    latency_stats_record(&ctx->lat_callback, elapsed_us(&ts_start, &ts_end));
+    FRAME_TRACE_SPAN(stream == CAMERA_STREAM_MAIN ? "callback_main" : "callback_detect", timespec_us(&ts_start),
+                     timespec_us(&ts_end), info->frame_id, info->v4l2_sequence);
 }
 
+/* 分发器中的一帧：持有帧环引用，处理完成后归还 */
+typedef struct {
+    camera_context_t* ctx;
+    camera_frame_t frame;
+} dispatch_item_t;
 
-/* 时间统计变量 */
-static long g_poll_input_us = 0;
-static long g_poll_output_us = 0;
-static long g_yuv_convert_us = 0;
-static int g_timing_count = 0;
+/* 工作线程中执行用户回调 */
+static void dispatch_run(void* user_data, void* item)
+{
+    dispatch_item_t* it = (dispatch_item_t*)item;
+    camera_context_t* ctx = it->ctx;
+    (void)user_data;
+    
+    stream_invoke_callback(ctx, it->frame.stream, it->frame.data, it->frame.width, it->frame.height,
+                           it->frame.stride, &it->frame.info);
+}
 
-/* 快速 MJPEG 解码到 BGRA - 使用 MppTask 接口（MJPEG 必须） */
-static int decode_mjpeg_to_bgra_fast(camera_context_t* ctx, void* mjpeg_data, size_t mjpeg_size)
+static void dispatch_release(void* user_data, void* item)
 {
-    MPP_RET ret;
-    MppTask task = NULL;
-    MppPacket packet = NULL;
-    MppFrame frame = NULL;
-    int got_frame = 0;
-    struct timespec ts1, ts2, ts3, ts4;
+    dispatch_item_t* it = (dispatch_item_t*)item;
+    (void)user_data;
     
-    /* 获取当前缓冲区索引 */
-    int buf_idx = ctx->current_buf_idx;
-    ctx->current_buf_idx = (ctx->current_buf_idx + 1) % MPP_BUFFER_COUNT;
+    camera_release_frame(it->ctx, &it->frame);
+    free(it);
+}
+
+/* 把刚发布的槽位投递给分发器（输出线程是唯一写者，刚发布的槽位不会处于写入状态） */
+static void dispatch_stream_frame(camera_context_t* ctx, camera_stream_t stream, int slot_idx)
+{
+    frame_ring_t* ring = &ctx->rings[stream];
+    frame_slot_t* slot = &ring->slots[slot_idx];
     
-    mpp_decode_buffer_t* dec_buf = &ctx->decode_bufs[buf_idx];
+    if (!stream_has_callback(ctx, stream)) return;
     
-    /* 检查缓冲区大小是否足够 */
-    if (mjpeg_size > dec_buf->pkt_buf_size) {
-        return -1;
-    }
+    dispatch_item_t* it = (dispatch_item_t*)malloc(sizeof(dispatch_item_t));
+    if (!it) return;
     
-    /* 复制 MJPEG 数据到预分配缓冲区 */
-    memcpy(mpp_buffer_get_ptr(dec_buf->pkt_buf), mjpeg_data, mjpeg_size);
+    atomic_fetch_add_explicit(&slot->refcount, 1, memory_order_acquire);
+    atomic_store_explicit(&slot->consumed, 1, memory_order_relaxed);
     
-    /* 创建输入包 */
-    ret = mpp_packet_init_with_buffer(&packet, dec_buf->pkt_buf);
-    if (ret != MPP_OK) {
-        return -1;
-    }
-    mpp_packet_set_length(packet, mjpeg_size);
+    it->ctx = ctx;
+    it->frame.data = slot->data;
+    it->frame.width = ring->width;
+    it->frame.height = ring->height;
+    it->frame.stride = ring->stride;
+    it->frame.format = ring->format;
+    it->frame.sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    it->frame.stream = stream;
+    it->frame.slot = slot_idx;
+    it->frame.info = slot->info;
     
-    /* 创建输出帧 */
-    ret = mpp_frame_init(&frame);
-    if (ret != MPP_OK) {
-        mpp_packet_deinit(&packet);
-        return -1;
+    dispatcher_post(ctx->dispatchers[stream], it);
+}
+
+/* 投递已发布的各输出流帧：分发器或直接回调，最后是解码帧回调
+ * @param slots 各流发布的槽位索引，-1 表示未发布
+ * @param decoded 解码帧（已加临时引用，这里归还），NULL 表示无
+ */
+static void deliver_frame_outputs(camera_context_t* ctx, int slots[CAMERA_STREAM_COUNT],
+                                  const camera_decoded_frame_t* decoded)
+{
+    /* 启用分发器时只投递帧引用，回调在工作线程中执行 */
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        if (ctx->dispatchers[s] && slots[s] >= 0) {
+            dispatch_stream_frame(ctx, (camera_stream_t)s, slots[s]);
+            slots[s] = -1;
+        }
     }
-    mpp_frame_set_buffer(frame, dec_buf->frm_buf);
-    
-    clock_gettime(CLOCK_MONOTONIC, &ts1);
     
-    /* 从输入端口获取任务 - 非阻塞 */
-    ret = ctx->mpp_mpi->poll(ctx->mpp_ctx, MPP_PORT_INPUT, MPP_POLL_NON_BLOCK);
-    if (ret != MPP_OK) {
-        mpp_frame_deinit(&frame);
-        mpp_packet_deinit(&packet);
-        return -1;
+    /* 调用回调函数 - 刚发布的槽位是最新帧，回调返回前生产者不会复用它 */
+    for (int s = 0; s < CAMERA_STREAM_COUNT; s++) {
+        if (slots[s] < 0 || !stream_has_callback(ctx, (camera_stream_t)s)) continue;
+        frame_ring_t* ring = &ctx->rings[s];
+        frame_slot_t* slot = &ring->slots[slots[s]];
+        atomic_store_explicit(&slot->consumed, 1, memory_order_relaxed);
+        stream_invoke_callback(ctx, (camera_stream_t)s, slot->data, ring->width, ring->height, ring->stride,
+                               &slot->info);
     }
-    
-    ret = ctx->mpp_mpi->dequeue(ctx->mpp_ctx, MPP_PORT_INPUT, &task);
-    if (ret != MPP_OK || !task) {
-        mpp_frame_deinit(&frame);
-        mpp_packet_deinit(&packet);
-        return -1;
+    if (decoded) {
+        decoded_frame_callback_t decoded_callback = ctx->decoded_callback;
+        if (decoded_callback) {
+            FRAME_TRACE_BEGIN(trace_cb);
+            decoded_callback(ctx->decoded_user_data, decoded);
+            FRAME_TRACE_END(trace_cb, "callback_decoded", decoded->sequence, decoded->info.v4l2_sequence);
+        }
+        if (ctx->raw_input) {
+            v4l2_buffer_unref(ctx, decoded->index);
+        } else {
+            decode_buffer_unref(ctx, decoded->index);
+        }
     }
+}
+
+/* 取回最早提交的一帧解码结果，转换并回调
+ * @return 0 成功输出一帧，1 超时/无帧，2 解码成功但没有输出发布，-1 解码失败，-2 已停止且无在途帧
+ */
+static int decode_collect_frame(camera_context_t* ctx)
+{
+    MPP_RET ret;
+    MppTask task = NULL;
+    decode_job_t* job;
+    struct timespec ts_out, ts_conv;
+    int got_frame = 0;
+    int slots[CAMERA_STREAM_COUNT] = { -1, -1 };
+    camera_decoded_frame_t decoded;
+    int have_decoded = 0;
     
-    /* 设置输入包和输出帧到任务 */
-    mpp_task_meta_set_packet(task, KEY_INPUT_PACKET, packet);
-    mpp_task_meta_set_frame(task, KEY_OUTPUT_FRAME, frame);
-    
-    /* 入队任务到输入端口 */
-    ret = ctx->mpp_mpi->enqueue(ctx->mpp_ctx, MPP_PORT_INPUT, task);
-    if (ret != MPP_OK) {
-        mpp_frame_deinit(&frame);
-        mpp_packet_deinit(&packet);
-        return -1;
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    while (ctx->in_flight == 0 && !ctx->pipeline_exit) {
+        pthread_cond_wait(&ctx->pipe_cond, &ctx->pipe_mutex);
     }
+    if (ctx->in_flight == 0) {
+        pthread_mutex_unlock(&ctx->pipe_mutex);
+        return -2;
+    }
+    job = &ctx->jobs[ctx->job_head];
+    pthread_mutex_unlock(&ctx->pipe_mutex);
     
-    clock_gettime(CLOCK_MONOTONIC, &ts2);
-    
-    /* 从输出端口获取解码结果 - 阻塞等待 */
-    ret = ctx->mpp_mpi->poll(ctx->mpp_ctx, MPP_PORT_OUTPUT, MPP_POLL_BLOCK);
+    /* 从输出端口获取解码结果 - 带超时阻塞等待 */
+    FRAME_TRACE_BEGIN(trace_wait);
+    ret = ctx->mpp_mpi->poll(ctx->mpp_ctx, MPP_PORT_OUTPUT, (MppPollType)MPP_OUTPUT_POLL_TIMEOUT_MS);
     if (ret != MPP_OK) {
-        mpp_frame_deinit(&frame);
-        mpp_packet_deinit(&packet);
-        return -1;
+        return 1;
     }
     
-    clock_gettime(CLOCK_MONOTONIC, &ts3);
-    
     ret = ctx->mpp_mpi->dequeue(ctx->mpp_ctx, MPP_PORT_OUTPUT, &task);
     if (ret != MPP_OK || !task) {
-        mpp_frame_deinit(&frame);
-        mpp_packet_deinit(&packet);
-        return -1;
+        return 1;
     }
     
+    clock_gettime(CLOCK_MONOTONIC, &ts_out);
+    job->info.decode_us = timespec_us(&ts_out);
+    FRAME_TRACE_END(trace_wait, "mpp_dequeue", FRAME_TRACE_NO_ID, job->info.v4l2_sequence);
+    /* 流水线中多帧同时在途，解码区间用异步事件表示 */
+    FRAME_TRACE_ASYNC("mpp_decode", trace_job_id(ctx, job->info.v4l2_sequence), timespec_us(&job->ts_submit),
+                      job->info.decode_us, FRAME_TRACE_NO_ID, job->info.v4l2_sequence);
+    
     /* 获取解码后的帧 */
     MppFrame out_frame = NULL;
     mpp_task_meta_get_frame(task, KEY_OUTPUT_FRAME, &out_frame);
     
-    if (out_frame) {
-        MppBuffer out_buf = mpp_frame_get_buffer(out_frame);
-        RK_U32 err_info = mpp_frame_get_errinfo(out_frame);
+    /* 没有输出流发布（例如只共享解码帧）时，只要有解码帧消费者仍算成功 */
+    int published = out_frame ? convert_frame_outputs(ctx, out_frame, slots, &job->info) : -1;
+    if (published >= 0) {
+        latency_stats_record(&ctx->lat_decode, elapsed_us(&job->ts_submit, &ts_out));
+    }
+    if (published > 0 || (published == 0 && ctx->decoded_callback)) {
+        clock_gettime(CLOCK_MONOTONIC, &ts_conv);
         
-        if (out_buf && !err_info) {
-            int width = mpp_frame_get_width(out_frame);
-            int height = mpp_frame_get_height(out_frame);
-            int hor_stride = mpp_frame_get_hor_stride(out_frame);
-            int ver_stride = mpp_frame_get_ver_stride(out_frame);
-            MppFrameFormat fmt = mpp_frame_get_fmt(out_frame);
-            
-            /* 调试：打印格式信息（仅首帧） */
-            static int first_frame = 1;
-            if (first_frame) {
-                printf("[%s] Frame info: %dx%d, stride %dx%d, fmt=0x%x\n", 
-                       MODULE_TAG, width, height, hor_stride, ver_stride, fmt);
-#ifdef USE_RGA
-                printf("[%s] Using RGA hardware acceleration for color conversion\n", MODULE_TAG);
-#else
-                printf("[%s] Using CPU for color conversion\n", MODULE_TAG);
-#endif
-                first_frame = 0;
-            }
-            
-            /* 获取写入缓冲区 */
-            int write_idx = ctx->bgra_write_idx;
-            uint8_t* out_buf_ptr = ctx->bgra_buffer[write_idx];
-            
-#ifdef USE_RGA
-            /* 使用 RGA 硬件加速转换 YUV 到 BGRA */
-            int rga_ret = yuv_to_bgra_rga(out_buf, out_buf_ptr, width, height, 
-                                          hor_stride, ver_stride, fmt);
-            if (rga_ret != 0) {
-                /* RGA 失败，回退到 CPU */
-                uint8_t* yuv_data = (uint8_t*)mpp_buffer_get_ptr(out_buf);
-                yuv_to_bgra_cpu(yuv_data, out_buf_ptr, width, height, hor_stride, ver_stride, fmt);
-            }
-#else
-            /* 使用 CPU 转换 */
-            uint8_t* yuv_data = (uint8_t*)mpp_buffer_get_ptr(out_buf);
-            yuv_to_bgra_cpu(yuv_data, out_buf_ptr, width, height, hor_stride, ver_stride, fmt);
-#endif
-            
-            clock_gettime(CLOCK_MONOTONIC, &ts4);
-            
-            /* 切换写入缓冲区（双缓冲） */
-            pthread_mutex_lock(&ctx->frame_mutex);
-            ctx->bgra_write_idx = 1 - write_idx;
-            pthread_mutex_unlock(&ctx->frame_mutex);
-            
-            /* 累计时间 */
-            g_poll_input_us += (ts2.tv_sec - ts1.tv_sec) * 1000000 + (ts2.tv_nsec - ts1.tv_nsec) / 1000;
-            g_poll_output_us += (ts3.tv_sec - ts2.tv_sec) * 1000000 + (ts3.tv_nsec - ts2.tv_nsec) / 1000;
-            g_yuv_convert_us += (ts4.tv_sec - ts3.tv_sec) * 1000000 + (ts4.tv_nsec - ts3.tv_nsec) / 1000;
-            g_timing_count++;
-            
-            got_frame = 1;
-            ctx->decode_count++;
+        latency_stats_record(&ctx->lat_convert, elapsed_us(&ts_out, &ts_conv));
+        latency_stats_record(&ctx->lat_end_to_end, elapsed_us(&job->ts_capture, &ts_conv));
+        
+        got_frame = 1;
+        ctx->decode_count++;
+        
+        /* 解码帧共享：在任务结束前加引用，回调期间缓冲区不会被重新提交 */
+        if (ctx->decoded_callback) {
+            have_decoded = decoded_frame_describe(ctx, job, out_frame, ctx->next_sequence - 1, &decoded) == 0;
         }
     }
     
     /* 将任务送回输出端口 */
     ctx->mpp_mpi->enqueue(ctx->mpp_ctx, MPP_PORT_OUTPUT, task);
     
-    mpp_frame_deinit(&frame);
-    mpp_packet_deinit(&packet);
+    decode_job_finish(ctx, job);
+    
+    deliver_frame_outputs(ctx, slots, have_decoded ? &decoded : NULL);
+    
+    if (got_frame) return 0;
+    return published == 0 ? 2 : -1;
+}
+
+/* 原始格式：取出最早入队的采集缓冲区直接转换、归还并回调
+ * @return 0 成功输出一帧，2 没有输出发布，-1 帧无效，-2 已停止且无在途帧
+ */
+static int raw_collect_frame(camera_context_t* ctx)
+{
+    decode_job_t* job;
+    struct timespec ts_start, ts_conv;
+    int slots[CAMERA_STREAM_COUNT];
+    camera_decoded_frame_t decoded;
+    int have_decoded = 0;
+    
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    while (ctx->in_flight == 0 && !ctx->pipeline_exit) {
+        pthread_cond_wait(&ctx->pipe_cond, &ctx->pipe_mutex);
+    }
+    if (ctx->in_flight == 0) {
+        pthread_mutex_unlock(&ctx->pipe_mutex);
+        return -2;
+    }
+    job = &ctx->jobs[ctx->job_head];
+    pthread_mutex_unlock(&ctx->pipe_mutex);
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts_start);
+    job->info.decode_us = timespec_us(&ts_start);
+    int published = convert_raw_outputs(ctx, job->v4l2_index, job->bytesused, slots, &job->info);
+    clock_gettime(CLOCK_MONOTONIC, &ts_conv);
+    
+    if (published > 0 || (published == 0 && ctx->decoded_callback)) {
+        latency_stats_record(&ctx->lat_convert, elapsed_us(&ts_start, &ts_conv));
+        latency_stats_record(&ctx->lat_end_to_end, elapsed_us(&job->ts_capture, &ts_conv));
+        ctx->decode_count++;
+        
+        /* 共享 NV12 采集缓冲区：临时引用保证回调期间不会重新入队 */
+        if (ctx->decoded_callback) {
+            have_decoded = raw_decoded_describe(ctx, job, ctx->next_sequence - 1, &decoded) == 0;
+        }
+    }
+    
+    /* 转换完成即可归还采集缓冲区（仍被共享时延后到最后一个持有者归还），回调读取的是输出帧环 */
+    decode_job_finish(ctx, job);
+    
+    deliver_frame_outputs(ctx, slots, have_decoded ? &decoded : NULL);
+    
+    if (published > 0 || have_decoded) return 0;
+    return published == 0 ? 2 : -1;
+}
+
+/* 回收输出线程退出后仍未完成的任务（硬件超时等异常情况） */
+static void decode_pipeline_flush(camera_context_t* ctx)
+{
+    if (ctx->in_flight <= 0) return;
+    
+    fprintf(stderr, "[%s] Flushing %d in-flight decode tasks\n", MODULE_TAG, ctx->in_flight);
+    
+    /* 复位 MPP 使其放弃所有任务，之后包/帧对象可以安全释放 */
+    if (ctx->mpp_mpi) {
+        ctx->mpp_mpi->reset(ctx->mpp_ctx);
+    }
     
-    return got_frame ? 0 : -1;
+    while (ctx->in_flight > 0) {
+        decode_job_t* job = &ctx->jobs[ctx->job_head];
+        if (ctx->raw_input && job->v4l2_index >= 0) {
+            atomic_fetch_sub_explicit(&ctx->v4l2_buffers[job->v4l2_index].refs, 1, memory_order_release);
+        }
+        job->v4l2_index = -1;   /* STREAMOFF 会收回所有 V4L2 缓冲区 */
+        decode_job_finish(ctx, job);
+    }
 }
 
 /* 打印解码时间统计 */
-static void print_decode_timing(void)
+static void print_decode_timing(camera_context_t* ctx)
+{
+    latency_summary_t decode, convert;
+    
+    latency_stats_summary(&ctx->lat_decode, &decode);
+    latency_stats_summary(&ctx->lat_convert, &convert);
+    if (decode.count > 0) {
+        printf("[%s] Decode timing (avg/p95 over %llu frames):\n", MODULE_TAG, (unsigned long long)decode.count);
+        printf("[%s]   HW decode:   %.2f / %.2f ms (submit -> output)\n", MODULE_TAG,
+               decode.avg_us / 1000.0, decode.p95_us / 1000.0);
+        printf("[%s]   YUV convert: %.2f / %.2f ms\n", MODULE_TAG,
+               convert.avg_us / 1000.0, convert.p95_us / 1000.0);
+    }
+}
+
+/* 统计出队的缓冲区：驱动时间戳到出队的延迟，以及 buf.sequence 缺口（驱动侧丢帧）
+ * @param info 输出：驱动序号、驱动时间戳和出队时刻
+ */
+static void capture_account_buffer(camera_context_t* ctx, const struct v4l2_buffer* buf,
+                                   const struct timespec* ts_dequeue, camera_frame_info_t* info)
+{
+    memset(info, 0, sizeof(*info));
+    info->v4l2_sequence = buf->sequence;
+    info->dequeue_us = timespec_us(ts_dequeue);
+    
+    if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        struct timespec ts_driver = {
+            .tv_sec = buf->timestamp.tv_sec,
+            .tv_nsec = buf->timestamp.tv_usec * 1000,
+        };
+        latency_stats_record(&ctx->lat_capture, elapsed_us(&ts_driver, ts_dequeue));
+        info->capture_us = timespec_us(&ts_driver);
+    }
+    
+    if (ctx->last_v4l2_sequence >= 0 && (int64_t)buf->sequence > ctx->last_v4l2_sequence + 1) {
+        atomic_fetch_add(&ctx->sequence_gaps, 1);
+        atomic_fetch_add(&ctx->frames_lost, (int64_t)buf->sequence - ctx->last_v4l2_sequence - 1);
+    }
+    ctx->last_v4l2_sequence = buf->sequence;
+}
+
+/* 唤醒采集线程（停止命令、缓冲区归还），eventfd 计数在采集线程中读取清零 */
+static void capture_wake(camera_context_t* ctx)
+{
+    uint64_t one = 1;
+    
+    if (ctx->wake_fd < 0) return;
+    if (write(ctx->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[%s] eventfd write failed: %s\n", MODULE_TAG, strerror(errno));
+    }
+}
+
+/* 注册/移除 V4L2 fd：驱动队列为空时 vb2 的 poll 一直返回 EPOLLERR（不受事件掩码控制），只能从 epoll 中移除 */
+static int capture_watch_v4l2(camera_context_t* ctx, int epoll_fd, int watch)
+{
+    struct epoll_event ev;
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = ctx->v4l2_fd;
+    if (epoll_ctl(epoll_fd, watch ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, ctx->v4l2_fd, &ev) < 0) {
+        fprintf(stderr, "[%s] epoll_ctl failed: %s\n", MODULE_TAG, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* 采集线程的 epoll 实例，只注册 eventfd（V4L2 fd 在驱动队列非空时注册） */
+static int capture_epoll_create(camera_context_t* ctx)
 {
-    if (g_timing_count > 0) {
-        printf("[%s] Decode timing (avg over %d frames):\n", MODULE_TAG, g_timing_count);
-        printf("[%s]   Poll input:  %.2f ms\n", MODULE_TAG, g_poll_input_us / 1000.0 / g_timing_count);
-        printf("[%s]   Poll output: %.2f ms (HW decode wait)\n", MODULE_TAG, g_poll_output_us / 1000.0 / g_timing_count);
-        printf("[%s]   YUV convert: %.2f ms\n", MODULE_TAG, g_yuv_convert_us / 1000.0 / g_timing_count);
+    struct epoll_event ev;
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    
+    if (epoll_fd < 0) {
+        fprintf(stderr, "[%s] epoll_create1 failed: %s\n", MODULE_TAG, strerror(errno));
+        return -1;
+    }
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = ctx->wake_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ctx->wake_fd, &ev) < 0) {
+        fprintf(stderr, "[%s] epoll_ctl failed: %s\n", MODULE_TAG, strerror(errno));
+        close(epoll_fd);
+        return -1;
     }
-    /* 重置统计 */
-    g_poll_input_us = 0;
-    g_poll_output_us = 0;
-    g_yuv_convert_us = 0;
-    g_timing_count = 0;
+    return epoll_fd;
 }
 
-/* 采集线程函数 - 高性能版本（带时间测量） */
+/* 采集线程函数 - 只负责出队与提交，解码结果由输出线程处理
+ * 没有帧时阻塞在 epoll_wait 中，不设超时：停止和缓冲区归还通过 eventfd 唤醒 */
 static void* capture_thread_func(void* arg)
 {
     camera_context_t* ctx = (camera_context_t*)arg;
-    struct timeval tv;
-    fd_set fds;
-    struct timespec ts_start, ts_capture, ts_decode, ts_callback;
-    long total_capture_us = 0, total_decode_us = 0, total_callback_us = 0;
-    int measure_count = 0;
+    struct epoll_event events[2];
+    struct timespec ts_capture, ts_submit;
+    camera_frame_info_t info;
+    int watching = 0;
     
+    pthread_mutex_lock(&ctx->pipe_mutex);
     ctx->thread_started = 1;
+    pthread_cond_broadcast(&ctx->start_cond);
+    pthread_mutex_unlock(&ctx->pipe_mutex);
     printf("[%s] Capture thread started (high performance)\n", MODULE_TAG);
     
-    while (ctx->running) {
+    int epoll_fd = capture_epoll_create(ctx);
+    
+    while (epoll_fd >= 0 && ctx->running) {
         struct v4l2_buffer buf;
+        size_t bytesused;
         
-        clock_gettime(CLOCK_MONOTONIC, &ts_start);
+        /* 原始格式：共享帧持有者在其他线程归还的缓冲区在这里重新入队 */
+        if (ctx->raw_input) {
+            v4l2_requeue_released(ctx);
+        }
         
-        /* 等待数据就绪 - 短超时以保持响应 */
-        FD_ZERO(&fds);
-        FD_SET(ctx->v4l2_fd, &fds);
-        tv.tv_sec = 0;
-        tv.tv_usec = 33333;  /* 约 30fps 的周期 */
+        /* 所有缓冲区都在途或被持有时驱动队列为空，只等待归还 */
+        int want = atomic_load_explicit(&ctx->v4l2_queued, memory_order_relaxed) > 0;
+        if (want != watching) {
+            if (capture_watch_v4l2(ctx, epoll_fd, want) < 0) break;
+            watching = want;
+        }
         
-        int r = select(ctx->v4l2_fd + 1, &fds, NULL, NULL, &tv);
-        if (r == -1) {
+        int n = epoll_wait(epoll_fd, events, 2, -1);
+        if (n < 0) {
             if (errno == EINTR) continue;
-            fprintf(stderr, "[%s] select error: %s\n", MODULE_TAG, strerror(errno));
+            fprintf(stderr, "[%s] epoll_wait error: %s\n", MODULE_TAG, strerror(errno));
             break;
         }
-        if (r == 0) continue;  /* 超时 */
         
-        /* 出队缓冲区 */
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
+        int readable = 0;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == ctx->wake_fd) {
+                uint64_t count;
+                if (read(ctx->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                    fprintf(stderr, "[%s] eventfd read failed: %s\n", MODULE_TAG, strerror(errno));
+                }
+            } else {
+                readable = 1;   /* EPOLLERR/EPOLLHUP（设备拔出）也由 DQBUF 报告 */
+            }
+        }
+        if (!readable) continue;
         
-        if (xioctl(ctx->v4l2_fd, VIDIOC_DQBUF, &buf) < 0) {
+        /* 出队缓冲区 */
+        FRAME_TRACE_BEGIN(trace_dq);
+        if (v4l2_dequeue_buffer(ctx, &buf, &bytesused) < 0) {
             if (errno == EAGAIN) continue;
             fprintf(stderr, "[%s] VIDIOC_DQBUF failed: %s\n", MODULE_TAG, strerror(errno));
             break;
@@ -1098,55 +3662,103 @@ static void* capture_thread_func(void* arg)
         clock_gettime(CLOCK_MONOTONIC, &ts_capture);
         
         ctx->frame_count++;
+        capture_account_buffer(ctx, &buf, &ts_capture, &info);
+        FRAME_TRACE_END(trace_dq, "v4l2_dequeue", FRAME_TRACE_NO_ID, buf.sequence);
+        if (info.capture_us > 0) {
+            /* 驱动时间戳到出队：帧在驱动队列中等待的时间 */
+            FRAME_TRACE_ASYNC("v4l2_queued", trace_job_id(ctx, buf.sequence), info.capture_us, info.dequeue_us,
+                              FRAME_TRACE_NO_ID, buf.sequence);
+        }
         
-        /* 解码 MJPEG 帧 */
-        if (buf.bytesused > 0) {
-            int decode_ret = decode_mjpeg_to_bgra_fast(ctx, ctx->v4l2_buffers[buf.index].start, buf.bytesused);
+        /* 提交 MJPEG 帧，零拷贝模式下缓冲区由输出线程在解码完成后归还；
+         * 原始格式直接把缓冲区交给输出线程转换，转换完成后归还 */
+        int submit_ret = -1;
+        if (bytesused > 0) {
+            submit_ret = ctx->raw_input
+                ? raw_submit_frame(ctx, buf.index, bytesused, &ts_capture, &info)
+                : decode_submit_mjpeg(ctx, buf.index, bytesused, &ts_capture, &info);
             
-            clock_gettime(CLOCK_MONOTONIC, &ts_decode);
+            clock_gettime(CLOCK_MONOTONIC, &ts_submit);
+            FRAME_TRACE_SPAN(ctx->raw_input ? "raw_submit" : "mpp_enqueue", timespec_us(&ts_capture),
+                             timespec_us(&ts_submit), FRAME_TRACE_NO_ID, buf.sequence);
             
-            if (decode_ret == 0) {
-                /* 调用回调函数 - 使用最新完成的缓冲区 */
-                if (ctx->callback) {
-                    int read_idx = 1 - ctx->bgra_write_idx;
-                    ctx->callback(ctx->user_data, ctx->bgra_buffer[read_idx], 
-                                  ctx->width, ctx->height, ctx->width * 4);
-                }
-                
-                clock_gettime(CLOCK_MONOTONIC, &ts_callback);
-                
-                /* 累计时间 */
-                total_capture_us += (ts_capture.tv_sec - ts_start.tv_sec) * 1000000 + 
-                                   (ts_capture.tv_nsec - ts_start.tv_nsec) / 1000;
-                total_decode_us += (ts_decode.tv_sec - ts_capture.tv_sec) * 1000000 + 
-                                  (ts_decode.tv_nsec - ts_capture.tv_nsec) / 1000;
-                total_callback_us += (ts_callback.tv_sec - ts_decode.tv_sec) * 1000000 + 
-                                    (ts_callback.tv_nsec - ts_decode.tv_nsec) / 1000;
-                measure_count++;
+            if (submit_ret == 0) {
+                latency_stats_record(&ctx->lat_submit, elapsed_us(&ts_capture, &ts_submit));
+            } else if (submit_ret == 1) {
+                ctx->pipeline_drops++;
             }
         }
         
-        /* 立即重新入队缓冲区以减少延迟 */
-        if (xioctl(ctx->v4l2_fd, VIDIOC_QBUF, &buf) < 0) {
-            fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
-            break;
+        /* MJPEG 的 MMAP 模式数据已复制，或帧未提交：立即重新入队缓冲区以减少延迟 */
+        if (submit_ret != 0 || (!ctx->raw_input && !ctx->v4l2_buffers[buf.index].mpp_buf)) {
+            if (v4l2_queue_buffer(ctx, buf.index) < 0) {
+                fprintf(stderr, "[%s] VIDIOC_QBUF failed: %s\n", MODULE_TAG, strerror(errno));
+                break;
+            }
         }
     }
     
     /* 打印时间统计 */
+    latency_summary_t submit;
+    latency_stats_summary(&ctx->lat_submit, &submit);
+    if (submit.count > 0) {
+        printf("[%s] Capture timing (%llu frames, %llu sequence gaps):\n", MODULE_TAG,
+               (unsigned long long)submit.count, (unsigned long long)atomic_load(&ctx->sequence_gaps));
+        printf("[%s]   Submit:  %.2f ms avg, %.2f ms p95\n", MODULE_TAG,
+               submit.avg_us / 1000.0, submit.p95_us / 1000.0);
+    }
+    
+    if (epoll_fd >= 0) close(epoll_fd);
+    
+    /* 采集异常退出时也要让输出线程结束（running 保持不变，线程由 camera_stop 回收） */
+    pthread_mutex_lock(&ctx->pipe_mutex);
+    ctx->pipeline_exit = 1;
+    pthread_cond_broadcast(&ctx->pipe_cond);
+    pthread_mutex_unlock(&ctx->pipe_mutex);
+    
+    /* 唤醒等待新帧的读者，返回 CAMERA_ERROR_NOT_RUNNING */
+    pthread_mutex_lock(&ctx->wait_mutex);
+    pthread_cond_broadcast(&ctx->wait_cond);
+    pthread_mutex_unlock(&ctx->wait_mutex);
+    
+    printf("[%s] Capture thread exiting\n", MODULE_TAG);
+    return NULL;
+}
+
+/* 输出线程函数 - 取回解码结果、颜色转换并回调用户 */
+static void* output_thread_func(void* arg)
+{
+    camera_context_t* ctx = (camera_context_t*)arg;
+    struct timespec ts_start, ts_end;
+    long total_output_us = 0;
+    int measure_count = 0;
+    
+    printf("[%s] Output thread started\n", MODULE_TAG);
+    
+    for (;;) {
+        clock_gettime(CLOCK_MONOTONIC, &ts_start);
+        
+        int r = ctx->raw_input ? raw_collect_frame(ctx) : decode_collect_frame(ctx);
+        if (r == -2) break;                 /* 已停止且无在途帧 */
+        if (r == 1 && ctx->pipeline_exit) break; /* 停止时硬件无响应，剩余任务由 flush 回收 */
+        if (r == -1) ctx->decode_errors++;
+        if (r == 2) ctx->frames_skipped++;  /* 没有输出流发布（例如读者占满槽位），不算错误 */
+        
+        if (r == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &ts_end);
+            total_output_us += elapsed_us(&ts_start, &ts_end);
+            measure_count++;
+        }
+    }
+    
     if (measure_count > 0) {
-        printf("[%s] Timing stats (avg over %d frames):\n", MODULE_TAG, measure_count);
-        printf("[%s]   Capture: %.2f ms\n", MODULE_TAG, total_capture_us / 1000.0 / measure_count);
-        printf("[%s]   Decode:  %.2f ms\n", MODULE_TAG, total_decode_us / 1000.0 / measure_count);
-        printf("[%s]   Callback:%.2f ms\n", MODULE_TAG, total_callback_us / 1000.0 / measure_count);
-        printf("[%s]   Total:   %.2f ms (max %.1f FPS)\n", MODULE_TAG, 
-               (total_capture_us + total_decode_us + total_callback_us) / 1000.0 / measure_count,
-               1000000.0 * measure_count / (total_capture_us + total_decode_us + total_callback_us));
+        printf("[%s] Output stage: %.2f ms/frame (wait + convert + callback, %d frames)\n",
+               MODULE_TAG, total_output_us / 1000.0 / measure_count, measure_count);
     }
     
     /* 打印解码详细时间 */
-    print_decode_timing();
+    print_decode_timing(ctx);
     
-    printf("[%s] Capture thread exiting\n", MODULE_TAG);
+    printf("[%s] Output thread exiting\n", MODULE_TAG);
     return NULL;
 }
@@ -1,6 +1,8 @@
 /*
  * V4L2 + MPP Camera Library
- * 使用 V4L2 采集 MJPEG 数据，使用 Rockchip MPP 硬件解码
+ * 使用 V4L2 采集 MJPEG 数据，使用 Rockchip MPP 硬件解码；
+ * 设备直接输出 YUYV/NV12 时跳过解码，采集缓冲区直接送 RGA/NEON 转换
+ * 多个相机可加入同一相机组，共享解码输出缓冲池和 RGA 调度（按相机优先级）
  */
 
 #ifndef V4L2_MPP_CAMERA_H
@@ -8,6 +10,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "frame_dispatcher.h"
+#include "latency_stats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,6 +22,22 @@ extern "C" {
 /* 帧回调函数类型 */
 typedef void (*frame_callback_t)(void* user_data, uint8_t* bgra_data, int width, int height, int stride);
 
+/* 帧时间信息（时间为 CLOCK_MONOTONIC 微秒，0 表示未知） */
+typedef struct {
+    uint64_t frame_id;          /* 帧序号，与 camera_frame_t.sequence 一致 */
+    uint32_t v4l2_sequence;     /* 驱动帧序号 buf.sequence，不连续表示驱动侧丢帧 */
+    int64_t capture_us;         /* 驱动时间戳 buf.timestamp（驱动不提供单调时间戳时为 0） */
+    int64_t dequeue_us;         /* 采集线程出队时刻 */
+    int64_t decode_us;          /* 解码完成时刻（原始格式为开始转换的时刻） */
+} camera_frame_info_t;
+
+/* 带时间信息的帧回调函数类型（info 只在回调内有效） */
+typedef void (*frame_info_callback_t)(void* user_data, uint8_t* data, int width, int height, int stride,
+                                      const camera_frame_info_t* info);
+
+/* 帧环形缓冲区最大槽位数 */
+#define CAMERA_MAX_FRAME_SLOTS 8
+
 /* 相机上下文句柄 */
 typedef void* camera_handle_t;
 
@@ -31,8 +53,231 @@ typedef enum {
     CAMERA_ERROR_OUT_OF_MEMORY = -7,
     CAMERA_ERROR_DECODE_FAILED = -8,
     CAMERA_ERROR_NOT_RUNNING = -9,
+    CAMERA_ERROR_TIMEOUT = -10,
 } camera_error_t;
 
+/* V4L2 采集缓冲区模式 */
+typedef enum {
+    CAMERA_CAPTURE_AUTO = 0,      /* 自动：依次尝试 DMABUF -> EXPBUF -> MMAP */
+    CAMERA_CAPTURE_MMAP = 1,      /* MMAP + memcpy 到 MPP 包缓冲区（兼容模式） */
+    CAMERA_CAPTURE_DMABUF = 2,    /* V4L2_MEMORY_DMABUF，缓冲区从 MPP 缓冲组分配（零拷贝） */
+    CAMERA_CAPTURE_EXPBUF = 3,    /* MMAP + VIDIOC_EXPBUF 导出给 MPP（零拷贝） */
+} camera_capture_mode_t;
+
+/* V4L2 采集格式（取值与 gst_player_format_t 一致） */
+typedef enum {
+    CAMERA_INPUT_FORMAT_MJPEG = 0,    /* MJPEG，经 MPP 硬件解码 */
+    CAMERA_INPUT_FORMAT_YUYV = 1,     /* YUYV 4:2:2 打包，不解码直接转换 */
+    CAMERA_INPUT_FORMAT_NV12 = 2,     /* NV12，不解码直接转换 */
+    CAMERA_INPUT_FORMAT_AUTO = 3,     /* 按设备支持依次尝试 MJPEG -> NV12 -> YUYV */
+} camera_input_format_t;
+
+/* 输出流 */
+typedef enum {
+    CAMERA_STREAM_MAIN = 0,       /* 全分辨率 BGRA（显示/抓拍） */
+    CAMERA_STREAM_DETECT = 1,     /* 缩放/裁剪后的检测流 */
+    CAMERA_STREAM_COUNT
+} camera_stream_t;
+
+/* 检测流像素格式 */
+typedef enum {
+    CAMERA_PIXEL_FORMAT_NONE = 0,     /* 不输出检测流 */
+    CAMERA_PIXEL_FORMAT_BGRA8888 = 1,
+    CAMERA_PIXEL_FORMAT_BGR888 = 2,
+    CAMERA_PIXEL_FORMAT_NV12 = 3,
+    CAMERA_PIXEL_FORMAT_NV16 = 4,     /* 仅用于解码帧（4:2:2 MJPEG） */
+} camera_pixel_format_t;
+
+/* YUV 转 RGB 使用的颜色空间（CPU 转换路径） */
+typedef enum {
+    CAMERA_COLOR_SPACE_AUTO = 0,          /* 按解码帧标注选择，未标注时为 BT.601 全范围（JPEG） */
+    CAMERA_COLOR_SPACE_BT601_FULL = 1,
+    CAMERA_COLOR_SPACE_BT601_LIMITED = 2,
+    CAMERA_COLOR_SPACE_BT709_FULL = 3,
+    CAMERA_COLOR_SPACE_BT709_LIMITED = 4,
+} camera_color_space_t;
+
+/* 感兴趣区域（源图像像素坐标，宽高为 0 表示整帧） */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} camera_rect_t;
+
+/* 工作模式 */
+typedef enum {
+    CAMERA_MODE_ACTIVE = 0,       /* 正常模式：配置（或 camera_reconfigure 设置）的分辨率/帧率，检测流开启 */
+    CAMERA_MODE_IDLE = 1,         /* 低功耗空闲模式：低分辨率/低帧率采集，暂停检测流 */
+} camera_mode_t;
+
+/* 相机优先级上限（camera_config_t.priority 取 0~CAMERA_PRIORITY_MAX，越大越优先） */
+#define CAMERA_PRIORITY_MAX 3
+
+/* 相机组句柄：组内相机共享解码输出缓冲池和 RGA 调度 */
+typedef struct camera_group camera_group_t;
+
+/* 相机组配置，0 表示使用默认值 */
+typedef struct {
+    int frame_buffers;            /* 共享解码输出缓冲区总数（默认 8，最大 16），按需分配 */
+    int max_width;                /* 缓冲区按此尺寸分配（0 表示按第一个加入的相机），更大的相机使用独立缓冲区 */
+    int max_height;
+    int rga_jobs;                 /* 同时提交的 RGA 作业数（默认 1），排队时高优先级相机先执行 */
+} camera_group_config_t;
+
+/* 相机组统计 */
+typedef struct {
+    int cameras;                  /* 组内相机数 */
+    int buffers_allocated;        /* 已分配的共享缓冲区数 */
+    int buffers_in_use;           /* 正在解码或被持有的共享缓冲区数 */
+    int buffers_peak;             /* buffers_in_use 峰值 */
+    size_t buffer_size;           /* 每个共享缓冲区字节数 */
+    uint64_t buffers_denied;      /* 缓冲池已满（或为高优先级相机保留）而丢弃的帧数 */
+    uint64_t rga_jobs;            /* 经过调度的 RGA 作业数 */
+    uint64_t rga_waits;           /* 需要排队的 RGA 作业数 */
+    latency_summary_t rga_wait;   /* 排队等待时间 */
+} camera_group_stats_t;
+
+/* 线程调度策略 */
+typedef enum {
+    CAMERA_SCHED_NORMAL = 0,      /* 继承创建者的调度（通常为 SCHED_OTHER） */
+    CAMERA_SCHED_FIFO = 1,
+    CAMERA_SCHED_RR = 2,
+} camera_sched_policy_t;
+
+/* 线程调度配置（RT 策略需要 CAP_SYS_NICE 或 RLIMIT_RTPRIO，不允许时退回普通调度，结果见 camera_thread_status_t） */
+typedef struct {
+    camera_sched_policy_t policy;
+    int priority;                 /* RT 优先级 1~99（0 表示默认 40，低于内核中断线程） */
+    uint32_t cpu_mask;            /* 可运行的 CPU 核心位掩码（0 表示不限制） */
+} camera_thread_config_t;
+
+/* 线程实际生效的调度设置 */
+typedef struct {
+    bool started;                 /* 线程已创建（以下字段有效） */
+    camera_sched_policy_t policy;
+    int priority;
+    uint32_t cpu_mask;            /* 可运行的核心（前 32 个） */
+    bool sched_applied;           /* 请求的策略和优先级已生效（未请求 RT 时为 true） */
+    bool affinity_applied;        /* 可运行核心都在请求的掩码内（未请求时为 true） */
+} camera_thread_status_t;
+
+/* 相机线程和内存锁定的实际状态（camera_start 时确定） */
+typedef struct {
+    camera_thread_status_t capture;   /* 采集 + 提交解码线程 */
+    camera_thread_status_t output;    /* 取回解码结果 + 颜色转换 + 回调线程 */
+    bool lock_requested;              /* 配置了 lock_memory */
+    bool memory_locked;               /* 热点内存全部锁定成功 */
+    size_t locked_bytes;              /* 已锁定的字节数 */
+} camera_thread_report_t;
+
+/* 相机配置 */
+typedef struct {
+    const char* device;                 /* 设备路径，如 /dev/video12 */
+    int width;                          /* 分辨率宽度 */
+    int height;                         /* 分辨率高度 */
+    int fps;                            /* 帧率 */
+    camera_input_format_t input_format; /* 采集格式（0 表示 MJPEG） */
+    camera_capture_mode_t capture_mode; /* 采集缓冲区模式（0 表示自动；多平面格式不支持 DMABUF，自动时使用 EXPBUF） */
+    int v4l2_buffer_count;              /* V4L2 采集缓冲区数（0 表示默认 4，范围 2~16；原始格式共享采集帧时建议 6 以上） */
+    int decode_queue_depth;             /* MPP 在途解码帧数（0 表示默认 2，最大 8；原始格式不超过 V4L2 缓冲区数 - 1） */
+    int decode_buffer_count;            /* MJPEG 解码输出缓冲区数（0 表示在途解码帧数 + 4，范围在途解码帧数 + 1 ~ 8；按需分配） */
+    int frame_ring_slots;               /* BGRA 帧环形缓冲槽位数（0 表示默认 3，范围 2~8） */
+    
+    /* 检测流：与主输出同一颜色转换阶段由 RGA 一次完成裁剪 + 缩放 + 格式转换 */
+    camera_pixel_format_t detect_format;  /* 检测流格式（NONE 表示不输出） */
+    int detect_width;                     /* 检测流宽度（NV12 时向下取偶数） */
+    int detect_height;                    /* 检测流高度 */
+    camera_rect_t detect_roi;             /* 检测流裁剪区域（全 0 表示整帧） */
+    bool skip_main_output;                /* 只输出检测流，不做全分辨率 BGRA 转换 */
+    
+    /* 回调分发：>0 时帧回调在原生工作线程池中执行，输出线程只投递帧（最新帧优先，处理不过来的旧帧丢弃） */
+    int callback_workers;                 /* 每个输出流的工作线程数（0 表示在输出线程中直接回调） */
+    uint32_t callback_cpu_mask;           /* 工作线程绑定的 CPU 核心位掩码（0 表示不绑定） */
+    
+    /* CPU 颜色转换（无 RGA 或 RGA 失败时） */
+    camera_color_space_t color_space;     /* 颜色空间（0 表示自动） */
+    int convert_threads;                  /* 按行分块并行转换的线程数（0/1 表示只用输出线程，最大 8） */
+    
+    /* 低功耗空闲模式（camera_set_mode 切换），0 表示默认 320x240@5fps */
+    int idle_width;
+    int idle_height;
+    int idle_fps;
+    
+    /* 多相机：加入相机组后解码输出缓冲区从组缓冲池借用（帧处理完即归还），RGA 作业按优先级排队 */
+    camera_group_t* group;                /* 相机组（NULL 表示独立缓冲区） */
+    int priority;                         /* 优先级 0~CAMERA_PRIORITY_MAX，缓冲池为高优先级相机保留在途解码所需的缓冲区 */
+    
+    /* 线程调度（camera_start 时生效，实际结果用 camera_get_thread_report 查询），全 0 表示继承调用方的调度 */
+    camera_thread_config_t capture_thread;  /* 采集 + 提交解码 */
+    camera_thread_config_t output_thread;   /* 取回解码结果 + 颜色转换 + 回调（callback_workers 为 0 时） */
+    bool lock_memory;                       /* mlock 相机上下文和非 DMA 输出帧缓冲区（受 RLIMIT_MEMLOCK 限制） */
+} camera_config_t;
+
+/* 零拷贝读取的帧（由 camera_acquire_frame 填充，必须用 camera_release_frame 归还） */
+typedef struct {
+    uint8_t* data;          /* 帧数据，归还前有效（NV12 时 UV 平面紧跟 Y 平面） */
+    int width;
+    int height;
+    int stride;             /* 行字节数（NV12 为 Y 平面行字节数） */
+    camera_pixel_format_t format;
+    uint64_t sequence;      /* 帧序号，从 1 开始单调递增，同一解码帧在各输出流中相同 */
+    camera_stream_t stream; /* 所属输出流 */
+    int slot;               /* 内部槽位索引 */
+    camera_frame_info_t info;   /* 采集/解码时间 */
+} camera_frame_t;
+
+/* MPP 解码输出帧或原始 NV12 采集帧（YUV，dmabuf 可直接交给 GStreamer/RGA/GPU，无需拷贝） */
+typedef struct {
+    int dmabuf_fd;          /* 解码/采集缓冲区 dmabuf fd，归库所有，不要关闭 */
+    uint8_t* data;          /* CPU 映射地址 */
+    size_t size;            /* 有效数据字节数（Y + UV） */
+    int width;
+    int height;
+    int hor_stride;         /* Y/UV 平面行字节数 */
+    int ver_stride;         /* UV 平面相对 Y 平面的行偏移 */
+    camera_pixel_format_t format;   /* NV12 或 NV16 */
+    uint64_t sequence;      /* 与各输出流帧序号一致 */
+    int index;              /* 内部解码缓冲区（原始格式为采集缓冲区）索引 */
+    camera_frame_info_t info;   /* 采集/解码时间 */
+} camera_decoded_frame_t;
+
+/* 解码帧回调（在输出线程中调用，frame 只在回调内有效，需要更久时调用 camera_hold_decoded_frame） */
+typedef void (*decoded_frame_callback_t)(void* user_data, const camera_decoded_frame_t* frame);
+
+/* 帧环形缓冲区统计 */
+typedef struct {
+    uint64_t frames_published;      /* 已发布的帧数 */
+    uint64_t frames_overwritten;    /* 发布后未被任何读者读取就被新帧取代的帧数 */
+    uint64_t frames_dropped;        /* 所有空闲槽位都被读者占用而丢弃的帧数 */
+} camera_ring_stats_t;
+
+/* 相机性能统计（自 camera_start 起累计，延迟单位微秒） */
+typedef struct {
+    uint64_t frames_captured;       /* 从 V4L2 出队的帧数 */
+    uint64_t frames_decoded;        /* 解码并输出的帧数 */
+    uint64_t pipeline_drops;        /* 解码流水线已满而丢弃的帧数 */
+    uint64_t decode_errors;         /* 解码失败或输出无效的帧数 */
+    uint64_t frames_skipped;        /* 解码成功但没有输出流发布的帧数（槽位全被读者占用等），不计入 decode_errors */
+    uint64_t sequence_gaps;         /* V4L2 帧序号（buf.sequence）不连续的次数 */
+    uint64_t frames_lost;           /* 序号缺口累计的驱动侧丢帧数 */
+    latency_summary_t capture;      /* 驱动时间戳 -> 出队（驱动不提供单调时间戳时为空） */
+    latency_summary_t submit;       /* 出队 -> 送入 MPP */
+    latency_summary_t decode;       /* 送入 MPP -> 取回解码结果 */
+    latency_summary_t convert;      /* 取回解码结果 -> 各输出流发布 */
+    latency_summary_t callback;     /* 用户帧回调执行时间 */
+    latency_summary_t end_to_end;   /* 出队 -> 各输出流发布 */
+    
+    /* MJPEG 解码缓冲池（原始格式均为 0） */
+    int decode_buffers;             /* 解码缓冲区槽位数（decode_buffer_count） */
+    int decode_buffers_allocated;   /* 已分配独立输出缓冲区的槽位数（借用相机组缓冲区的不计） */
+    int decode_buffers_in_use;      /* 在途解码或被外部持有的槽位数 */
+    size_t decode_buffer_size;      /* 输出缓冲区字节数（首帧前按 NV16 2 字节/像素，之后按实际格式） */
+    size_t packet_buffer_size;      /* 包缓冲区字节数（仅 MMAP 模式，按观察到的最大帧 + 25% 余量） */
+    size_t max_packet_size;         /* 观察到的最大 MJPEG 帧字节数 */
+    size_t decode_pool_bytes;       /* 已分配的独立输出缓冲区 + 包缓冲区总字节数 */
+} camera_stats_t;
+
 /**
  * 初始化相机
  * @param device 设备路径 (如 /dev/video12)
@@ -43,6 +288,13 @@ typedef enum {
  */
 camera_handle_t camera_init(const char* device, int width, int height, int fps);
 
+/**
+ * 使用完整配置初始化相机
+ * @param config 配置（未设置的字段为 0 时使用默认值）
+ * @return 相机句柄，失败返回 NULL
+ */
+camera_handle_t camera_init_ex(const camera_config_t* config);
+
 /**
  * 释放相机资源
  * @param handle 相机句柄
@@ -85,6 +337,203 @@ bool camera_is_running(camera_handle_t handle);
 camera_error_t camera_capture_frame(camera_handle_t handle, uint8_t* bgra_data, 
                                      int buffer_size, int* width, int* height, int timeout_ms);
 
+/**
+ * 获取最新一帧的零拷贝引用（不阻塞采集线程）
+ * @param handle 相机句柄
+ * @param frame 输出帧信息
+ * @param last_sequence 只返回序号大于该值的帧（传 0 表示任意最新帧）
+ * @param timeout_ms 等待新帧的超时时间 (毫秒)，0 表示不等待
+ * @return 错误码，超时返回 CAMERA_ERROR_TIMEOUT
+ */
+camera_error_t camera_acquire_frame(camera_handle_t handle, camera_frame_t* frame,
+                                     uint64_t last_sequence, int timeout_ms);
+
+/**
+ * 获取指定输出流最新一帧的零拷贝引用
+ * @param handle 相机句柄
+ * @param stream 输出流
+ * @param frame 输出帧信息
+ * @param last_sequence 只返回序号大于该值的帧（传 0 表示任意最新帧）
+ * @param timeout_ms 等待新帧的超时时间 (毫秒)，0 表示不等待
+ * @return 错误码，该流未启用返回 CAMERA_ERROR_NOT_SUPPORTED
+ */
+camera_error_t camera_acquire_stream_frame(camera_handle_t handle, camera_stream_t stream,
+                                            camera_frame_t* frame, uint64_t last_sequence,
+                                            int timeout_ms);
+
+/**
+ * 设置检测流回调（在输出线程中调用，数据格式为配置的 detect_format）
+ * @param handle 相机句柄
+ * @param callback 回调函数，NULL 表示取消
+ * @param user_data 用户数据
+ * @return 错误码
+ */
+camera_error_t camera_set_detect_callback(camera_handle_t handle, frame_callback_t callback, void* user_data);
+
+/**
+ * 设置带时间信息的帧回调，设置后替代该输出流的普通回调（camera_start / camera_set_detect_callback）
+ * 未启用分发器时在输出线程中调用，否则在该流的工作线程中调用
+ * @param handle 相机句柄
+ * @param stream 输出流
+ * @param callback 回调函数，NULL 表示取消（恢复普通回调）
+ * @param user_data 用户数据
+ * @return 错误码，该流未启用返回 CAMERA_ERROR_NOT_SUPPORTED
+ */
+camera_error_t camera_set_frame_info_callback(camera_handle_t handle, camera_stream_t stream,
+                                              frame_info_callback_t callback, void* user_data);
+
+/**
+ * 归还 camera_acquire_frame 获取的帧（必须在 camera_deinit 之前归还）
+ * @param handle 相机句柄
+ * @param frame 帧信息
+ * @return 错误码
+ */
+camera_error_t camera_release_frame(camera_handle_t handle, const camera_frame_t* frame);
+
+/**
+ * 获取主输出流帧环形缓冲区统计
+ * @param handle 相机句柄
+ * @param stats 输出统计
+ * @return 错误码
+ */
+camera_error_t camera_get_ring_stats(camera_handle_t handle, camera_ring_stats_t* stats);
+
+/**
+ * 获取相机性能统计（可在任意线程轮询）
+ * @param handle 相机句柄
+ * @param stats 输出统计
+ * @return 错误码
+ */
+camera_error_t camera_get_stats(camera_handle_t handle, camera_stats_t* stats);
+
+/**
+ * 获取采集/输出线程实际生效的调度设置和内存锁定结果（camera_start 之后有效）
+ * @param handle 相机句柄
+ * @param report 输出
+ * @return 错误码，未启动过返回 CAMERA_ERROR_NOT_RUNNING
+ */
+camera_error_t camera_get_thread_report(camera_handle_t handle, camera_thread_report_t* report);
+
+/**
+ * 获取指定输出流帧环形缓冲区统计
+ * @param handle 相机句柄
+ * @param stream 输出流
+ * @param stats 输出统计
+ * @return 错误码
+ */
+camera_error_t camera_get_stream_ring_stats(camera_handle_t handle, camera_stream_t stream,
+                                             camera_ring_stats_t* stats);
+
+/**
+ * 设置解码帧回调，用于与其他模块（如 GStreamer appsrc）共享同一路解码
+ * @param handle 相机句柄
+ * @param callback 回调函数，NULL 表示取消
+ * @param user_data 用户数据
+ * @return 错误码，原始格式采集时只有单平面 NV12 且为 DMABUF/EXPBUF 采集模式才能共享，否则设置非 NULL 回调返回 CAMERA_ERROR_NOT_SUPPORTED
+ */
+camera_error_t camera_set_decoded_callback(camera_handle_t handle, decoded_frame_callback_t callback,
+                                           void* user_data);
+
+/**
+ * 在回调返回后继续持有解码帧（持有期间解码器不会复用该缓冲区，原始格式的采集缓冲区不会重新入队）
+ * @param handle 相机句柄
+ * @param frame 回调收到的帧
+ * @return 错误码
+ */
+camera_error_t camera_hold_decoded_frame(camera_handle_t handle, const camera_decoded_frame_t* frame);
+
+/**
+ * 归还 camera_hold_decoded_frame 持有的解码帧（可在任意线程调用，必须在 camera_deinit 之前归还）
+ * @param handle 相机句柄
+ * @param frame 持有的帧
+ * @return 错误码
+ */
+camera_error_t camera_release_decoded_frame(camera_handle_t handle, const camera_decoded_frame_t* frame);
+
+/**
+ * 获取输出流回调分发器统计（每个工作线程的占用率和处理帧数、邮箱丢帧数）
+ * @param handle 相机句柄
+ * @param stream 输出流
+ * @param stats 输出统计
+ * @return 错误码，未启用回调分发时返回 CAMERA_ERROR_NOT_SUPPORTED
+ */
+camera_error_t camera_get_dispatch_stats(camera_handle_t handle, camera_stream_t stream,
+                                          dispatcher_stats_t* stats);
+
+/**
+ * 获取实际生效的采集缓冲区模式（AUTO 协商后的结果）
+ * @param handle 相机句柄
+ * @return 采集模式，句柄无效时返回 CAMERA_CAPTURE_AUTO
+ */
+camera_capture_mode_t camera_get_capture_mode(camera_handle_t handle);
+
+/**
+ * 获取实际协商的采集格式（AUTO 协商后的结果）
+ * @param handle 相机句柄
+ * @return 采集格式，句柄无效时返回 CAMERA_INPUT_FORMAT_AUTO
+ */
+camera_input_format_t camera_get_input_format(camera_handle_t handle);
+
+/**
+ * 运行中修改正常模式的分辨率/帧率，不重建解码器和回调分发器
+ * 只改帧率时保留所有缓冲区；改分辨率时重新协商 V4L2 格式并重建采集缓冲区，
+ * 解码/输出缓冲区足够大时直接复用。空闲模式下只记录，切回正常模式时生效。
+ * 正在采集时会短暂停止后自动恢复（帧序号继续递增，性能统计重新开始）。
+ * 不能在帧回调中调用；调用前需归还所有 camera_acquire_frame 获取和 camera_hold_decoded_frame 持有的帧。
+ * @param handle 相机句柄
+ * @param width 分辨率宽度（驱动可能调整到最接近的尺寸，用 camera_get_format 读取实际值）
+ * @param height 分辨率高度
+ * @param fps 帧率
+ * @return CAMERA_OK 成功；CAMERA_ERROR_DEVICE_BUSY 仍有帧被持有（格式未改变）；
+ *         CAMERA_ERROR_NOT_SUPPORTED 设备不支持该分辨率（已恢复原格式）；其他错误时相机保持停止
+ */
+camera_error_t camera_reconfigure(camera_handle_t handle, int width, int height, int fps);
+
+/**
+ * 切换正常/低功耗空闲模式（空闲时采集切换到 idle_width/idle_height/idle_fps，检测流不再输出）
+ * 限制与返回值同 camera_reconfigure
+ * @param handle 相机句柄
+ * @param mode 工作模式
+ */
+camera_error_t camera_set_mode(camera_handle_t handle, camera_mode_t mode);
+
+/**
+ * 获取当前工作模式
+ * @param handle 相机句柄
+ * @return 工作模式，句柄无效时返回 CAMERA_MODE_ACTIVE
+ */
+camera_mode_t camera_get_mode(camera_handle_t handle);
+
+/**
+ * 获取当前实际采集的分辨率和帧率
+ * @param handle 相机句柄
+ * @param width 输出：宽度（可为 NULL）
+ * @param height 输出：高度（可为 NULL）
+ * @param fps 输出：帧率（可为 NULL）
+ */
+camera_error_t camera_get_format(camera_handle_t handle, int* width, int* height, int* fps);
+
+/**
+ * 创建相机组（供多个 camera_init_ex 共享，相机组本身不打开设备）
+ * @param config 配置，NULL 表示全部使用默认值
+ * @return 相机组句柄，失败返回 NULL
+ */
+camera_group_t* camera_group_create(const camera_group_config_t* config);
+
+/**
+ * 释放相机组（组内还有相机时延迟到最后一个相机 camera_deinit 后释放）
+ * @param group 相机组句柄
+ */
+void camera_group_destroy(camera_group_t* group);
+
+/**
+ * 获取相机组统计（可在任意线程轮询）
+ * @param group 相机组句柄
+ * @param stats 输出统计
+ * @return 错误码
+ */
+camera_error_t camera_group_get_stats(camera_group_t* group, camera_group_stats_t* stats);
+
 /**
  * 获取最后一次错误的描述
  * @param error 错误码
@@ -0,0 +1,336 @@
+/*
+ * YUV 半平面转 BGRA 实现
+ *
+ * 定点 Q6 系数：乘积都在 int16 范围内，求和用饱和加减，
+ * 饱和只发生在结果本来就超出 0~255 时，不影响正确性。
+ * 多线程转换为 fork-join：调用线程处理第一块，工作线程处理其余块，全部完成后返回。
+ */
+
+#define _GNU_SOURCE
+#define MODULE_TAG "yuv_convert"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "yuv_convert.h"
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define USE_NEON 1
+#endif
+
+/* Q6 系数表，按 yuv_color_space_t 顺序 */
+static const yuv_coeffs_t g_coeffs[] = {
+    [YUV_BT601_FULL]    = { 0,  64,  90, 22, 46, 113 },
+    [YUV_BT601_LIMITED] = { 16, 74, 102, 25, 52, 129 },
+    [YUV_BT709_FULL]    = { 0,  64, 101, 12, 30, 119 },
+    [YUV_BT709_LIMITED] = { 16, 74, 115, 14, 34, 135 },
+};
+
+const yuv_coeffs_t* yuv_get_coeffs(yuv_color_space_t color_space)
+{
+    if (color_space < YUV_BT601_FULL || color_space > YUV_BT709_LIMITED) {
+        color_space = YUV_BT601_FULL;
+    }
+    return &g_coeffs[color_space];
+}
+
+/* 标量版本：转换一行中 [j_begin, width) 的像素 */
+static void yuv_row_to_bgra_scalar(const yuv_coeffs_t* c, const uint8_t* y_row, const uint8_t* uv_row,
+                                   uint8_t* bgra_row, int j_begin, int width, bool vu)
+{
+    for (int j = j_begin; j < width; j++) {
+        int u = uv_row[(j & ~1) + vu] - 128;
+        int v = uv_row[(j & ~1) + !vu] - 128;
+        
+        yuv_pixel_to_bgr(c, y_row[j], u, v, bgra_row + j * 4);
+        bgra_row[j * 4 + 3] = 255;
+    }
+}
+
+/* 标量版本：YUYV 打包行，每两个像素共用一对 U/V */
+static void yuyv_row_to_bgra_scalar(const yuv_coeffs_t* c, const uint8_t* row, uint8_t* bgra_row,
+                                    int j_begin, int width)
+{
+    for (int j = j_begin; j < width; j++) {
+        const uint8_t* p = row + (j & ~1) * 2;
+        
+        yuv_pixel_to_bgr(c, p[(j & 1) * 2], p[1] - 128, p[3] - 128, bgra_row + j * 4);
+        bgra_row[j * 4 + 3] = 255;
+    }
+}
+
+#ifdef USE_NEON
+/* NEON 版本：每次 16 个像素（8 对色度），返回已处理的像素数 */
+static int yuv_row_to_bgra_neon(const yuv_coeffs_t* c, const uint8_t* __restrict y_row,
+                                const uint8_t* __restrict uv_row, uint8_t* __restrict bgra_row,
+                                int width, bool vu)
+{
+    const uint8x8_t y_offset = vdup_n_u8((uint8_t)c->y_offset);
+    const uint8x8_t y_coef = vdup_n_u8((uint8_t)c->y_coef);
+    const int16x8_t bias = vdupq_n_s16(128);
+    const int u_idx = vu ? 1 : 0;
+    int j = 0;
+    
+    for (; j + 15 < width; j += 16) {
+        uint8x16_t y_vec = vld1q_u8(y_row + j);
+        uint8x8x2_t uv = vld2_u8(uv_row + j);   /* 按 U/V 解交织 */
+        
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uv.val[u_idx])), bias);
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uv.val[!u_idx])), bias);
+        
+        /* 每个色度样本对应两个水平相邻像素 */
+        int16x8x2_t r_c = vzipq_s16(vmulq_n_s16(v, c->r_v), vmulq_n_s16(v, c->r_v));
+        int16x8_t guv = vmlaq_n_s16(vmulq_n_s16(u, c->g_u), v, c->g_v);
+        int16x8x2_t g_c = vzipq_s16(guv, guv);
+        int16x8x2_t b_c = vzipq_s16(vmulq_n_s16(u, c->b_u), vmulq_n_s16(u, c->b_u));
+        
+        int16x8_t y_lo = vreinterpretq_s16_u16(vmull_u8(vqsub_u8(vget_low_u8(y_vec), y_offset), y_coef));
+        int16x8_t y_hi = vreinterpretq_s16_u16(vmull_u8(vqsub_u8(vget_high_u8(y_vec), y_offset), y_coef));
+        
+        /* 舍入右移 6 位并饱和到 0~255 */
+        uint8x8x4_t bgra;
+        bgra.val[3] = vdup_n_u8(255);
+        
+        bgra.val[0] = vqrshrun_n_s16(vqaddq_s16(y_lo, b_c.val[0]), 6);
+        bgra.val[1] = vqrshrun_n_s16(vqsubq_s16(y_lo, g_c.val[0]), 6);
+        bgra.val[2] = vqrshrun_n_s16(vqaddq_s16(y_lo, r_c.val[0]), 6);
+        vst4_u8(bgra_row + j * 4, bgra);
+        
+        bgra.val[0] = vqrshrun_n_s16(vqaddq_s16(y_hi, b_c.val[1]), 6);
+        bgra.val[1] = vqrshrun_n_s16(vqsubq_s16(y_hi, g_c.val[1]), 6);
+        bgra.val[2] = vqrshrun_n_s16(vqaddq_s16(y_hi, r_c.val[1]), 6);
+        vst4_u8(bgra_row + (j + 8) * 4, bgra);
+    }
+    
+    return j;
+}
+
+/* NEON 版本（YUYV）：vld4 直接拆出偶数 Y、U、奇数 Y、V，奇偶像素分别计算后交织回原顺序 */
+static int yuyv_row_to_bgra_neon(const yuv_coeffs_t* c, const uint8_t* __restrict row,
+                                 uint8_t* __restrict bgra_row, int width)
+{
+    const uint8x8_t y_offset = vdup_n_u8((uint8_t)c->y_offset);
+    const uint8x8_t y_coef = vdup_n_u8((uint8_t)c->y_coef);
+    const int16x8_t bias = vdupq_n_s16(128);
+    int j = 0;
+    
+    for (; j + 15 < width; j += 16) {
+        uint8x8x4_t yuyv = vld4_u8(row + j * 2);
+        
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[1])), bias);
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[3])), bias);
+        int16x8_t r_c = vmulq_n_s16(v, c->r_v);
+        int16x8_t g_c = vmlaq_n_s16(vmulq_n_s16(u, c->g_u), v, c->g_v);
+        int16x8_t b_c = vmulq_n_s16(u, c->b_u);
+        
+        int16x8_t y_even = vreinterpretq_s16_u16(vmull_u8(vqsub_u8(yuyv.val[0], y_offset), y_coef));
+        int16x8_t y_odd = vreinterpretq_s16_u16(vmull_u8(vqsub_u8(yuyv.val[2], y_offset), y_coef));
+        
+        uint8x8x2_t b = vzip_u8(vqrshrun_n_s16(vqaddq_s16(y_even, b_c), 6), vqrshrun_n_s16(vqaddq_s16(y_odd, b_c), 6));
+        uint8x8x2_t g = vzip_u8(vqrshrun_n_s16(vqsubq_s16(y_even, g_c), 6), vqrshrun_n_s16(vqsubq_s16(y_odd, g_c), 6));
+        uint8x8x2_t r = vzip_u8(vqrshrun_n_s16(vqaddq_s16(y_even, r_c), 6), vqrshrun_n_s16(vqaddq_s16(y_odd, r_c), 6));
+        
+        uint8x8x4_t bgra;
+        bgra.val[3] = vdup_n_u8(255);
+        for (int h = 0; h < 2; h++) {
+            bgra.val[0] = b.val[h];
+            bgra.val[1] = g.val[h];
+            bgra.val[2] = r.val[h];
+            vst4_u8(bgra_row + (j + h * 8) * 4, bgra);
+        }
+    }
+    
+    return j;
+}
+#endif
+
+void yuv_to_bgra_rows(const yuv_image_t* src, uint8_t* dst, int dst_stride,
+                      yuv_color_space_t color_space, int row_begin, int row_end)
+{
+    const yuv_coeffs_t* c = yuv_get_coeffs(color_space);
+    int uv_shift = src->layout == YUV_LAYOUT_420SP ? 1 : 0;
+    
+    if (src->layout == YUV_LAYOUT_YUYV) {
+        for (int i = row_begin; i < row_end; i++) {
+            const uint8_t* row = src->y + (size_t)i * src->y_stride;
+            uint8_t* bgra_row = dst + (size_t)i * dst_stride;
+            int j = 0;
+
+#ifdef USE_NEON
+            j = yuyv_row_to_bgra_neon(c, row, bgra_row, src->width);
+#endif
+            yuyv_row_to_bgra_scalar(c, row, bgra_row, j, src->width);
+        }
+        return;
+    }
+    
+    for (int i = row_begin; i < row_end; i++) {
+        const uint8_t* y_row = src->y + (size_t)i * src->y_stride;
+        const uint8_t* uv_row = src->uv + (size_t)(i >> uv_shift) * src->uv_stride;
+        uint8_t* bgra_row = dst + (size_t)i * dst_stride;
+        int j = 0;
+
+#ifdef USE_NEON
+        j = yuv_row_to_bgra_neon(c, y_row, uv_row, bgra_row, src->width, src->vu);
+#endif
+        yuv_row_to_bgra_scalar(c, y_row, uv_row, bgra_row, j, src->width, src->vu);
+    }
+}
+
+/* 工作线程 */
+typedef struct {
+    struct yuv_converter* owner;
+    pthread_t thread;
+    int band;
+} yuv_worker_t;
+
+struct yuv_converter {
+    int thread_count;               /* 含调用线程 */
+    yuv_worker_t workers[YUV_CONVERT_MAX_THREADS];
+    int worker_started;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    uint64_t generation;            /* 每提交一帧加一 */
+    int pending;                    /* 尚未完成的工作线程数 */
+    bool stopping;
+    
+    /* 当前帧 */
+    const yuv_image_t* src;
+    uint8_t* dst;
+    int dst_stride;
+    yuv_color_space_t color_space;
+};
+
+/* 第 band 块的行范围，420 保持偶数边界使每对行共享的色度行不跨块 */
+static void band_rows(const yuv_converter_t* conv, const yuv_image_t* src, int band, int* begin, int* end)
+{
+    int rows_per_band = (src->height + conv->thread_count - 1) / conv->thread_count;
+    rows_per_band = (rows_per_band + 1) & ~1;
+    
+    *begin = band * rows_per_band;
+    *end = *begin + rows_per_band;
+    if (*begin > src->height) *begin = src->height;
+    if (*end > src->height) *end = src->height;
+}
+
+static void* yuv_worker_func(void* arg)
+{
+    yuv_worker_t* worker = (yuv_worker_t*)arg;
+    yuv_converter_t* conv = worker->owner;
+    uint64_t seen = 0;
+    
+    for (;;) {
+        pthread_mutex_lock(&conv->mutex);
+        while (conv->generation == seen && !conv->stopping) {
+            pthread_cond_wait(&conv->start_cond, &conv->mutex);
+        }
+        if (conv->stopping) {
+            pthread_mutex_unlock(&conv->mutex);
+            break;
+        }
+        seen = conv->generation;
+        const yuv_image_t* src = conv->src;
+        uint8_t* dst = conv->dst;
+        int dst_stride = conv->dst_stride;
+        yuv_color_space_t color_space = conv->color_space;
+        pthread_mutex_unlock(&conv->mutex);
+        
+        int begin, end;
+        band_rows(conv, src, worker->band, &begin, &end);
+        yuv_to_bgra_rows(src, dst, dst_stride, color_space, begin, end);
+        
+        pthread_mutex_lock(&conv->mutex);
+        if (--conv->pending == 0) {
+            pthread_cond_signal(&conv->done_cond);
+        }
+        pthread_mutex_unlock(&conv->mutex);
+    }
+    
+    return NULL;
+}
+
+yuv_converter_t* yuv_converter_create(int threads)
+{
+    if (threads <= 1) return NULL;
+    if (threads > YUV_CONVERT_MAX_THREADS) threads = YUV_CONVERT_MAX_THREADS;
+    
+    yuv_converter_t* conv = (yuv_converter_t*)calloc(1, sizeof(yuv_converter_t));
+    if (!conv) return NULL;
+    
+    conv->thread_count = threads;
+    pthread_mutex_init(&conv->mutex, NULL);
+    pthread_cond_init(&conv->start_cond, NULL);
+    pthread_cond_init(&conv->done_cond, NULL);
+    
+    /* 第 0 块由调用线程处理 */
+    for (int i = 1; i < threads; i++) {
+        yuv_worker_t* worker = &conv->workers[conv->worker_started];
+        worker->owner = conv;
+        worker->band = i;
+        if (pthread_create(&worker->thread, NULL, yuv_worker_func, worker) != 0) {
+            fprintf(stderr, "[%s] Failed to create convert thread %d\n", MODULE_TAG, i);
+            yuv_converter_destroy(conv);
+            return NULL;
+        }
+        
+        char thread_name[16];
+        snprintf(thread_name, sizeof(thread_name), "yuv-conv-%d", i);
+        pthread_setname_np(worker->thread, thread_name);
+        conv->worker_started++;
+    }
+    
+    printf("[%s] %d-thread row-split conversion\n", MODULE_TAG, threads);
+    return conv;
+}
+
+void yuv_converter_destroy(yuv_converter_t* conv)
+{
+    if (!conv) return;
+    
+    pthread_mutex_lock(&conv->mutex);
+    conv->stopping = true;
+    pthread_cond_broadcast(&conv->start_cond);
+    pthread_mutex_unlock(&conv->mutex);
+    
+    for (int i = 0; i < conv->worker_started; i++) {
+        pthread_join(conv->workers[i].thread, NULL);
+    }
+    
+    pthread_cond_destroy(&conv->done_cond);
+    pthread_cond_destroy(&conv->start_cond);
+    pthread_mutex_destroy(&conv->mutex);
+    free(conv);
+}
+
+void yuv_converter_to_bgra(yuv_converter_t* conv, const yuv_image_t* src, uint8_t* dst, int dst_stride,
+                           yuv_color_space_t color_space)
+{
+    if (!conv) {
+        yuv_to_bgra_rows(src, dst, dst_stride, color_space, 0, src->height);
+        return;
+    }
+    
+    pthread_mutex_lock(&conv->mutex);
+    conv->src = src;
+    conv->dst = dst;
+    conv->dst_stride = dst_stride;
+    conv->color_space = color_space;
+    conv->pending = conv->worker_started;
+    conv->generation++;
+    pthread_cond_broadcast(&conv->start_cond);
+    pthread_mutex_unlock(&conv->mutex);
+    
+    int begin, end;
+    band_rows(conv, src, 0, &begin, &end);
+    yuv_to_bgra_rows(src, dst, dst_stride, color_space, begin, end);
+    
+    pthread_mutex_lock(&conv->mutex);
+    while (conv->pending > 0) {
+        pthread_cond_wait(&conv->done_cond, &conv->mutex);
+    }
+    pthread_mutex_unlock(&conv->mutex);
+}
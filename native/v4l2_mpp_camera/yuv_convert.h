@@ -0,0 +1,128 @@
+/*
+ * YUV 半平面转 BGRA（CPU 路径）
+ *
+ * 1. 支持 420SP/422SP 及其 VU 变体（NV12/NV21/NV16/NV61），以及打包的 YUYV（摄像头原始输出）
+ * 2. BT.601/BT.709 全范围/限制范围系数可选
+ * 3. ARM 上使用 NEON 每次处理 16 像素，其他平台使用标量版本
+ * 4. 可选按行分块到多个线程并行转换，RGA 不可用时仍能实时处理
+ */
+
+#ifndef YUV_CONVERT_H
+#define YUV_CONVERT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 最大转换线程数（含调用线程） */
+#define YUV_CONVERT_MAX_THREADS 8
+
+/* 色度子采样 */
+typedef enum {
+    YUV_LAYOUT_420SP = 0,       /* NV12/NV21：色度每两行一行 */
+    YUV_LAYOUT_422SP = 1,       /* NV16/NV61：色度每行一行 */
+    YUV_LAYOUT_YUYV = 2,        /* YUYV 打包：Y0 U Y1 V，只使用 y/y_stride */
+} yuv_layout_t;
+
+/* 颜色空间及量化范围 */
+typedef enum {
+    YUV_BT601_FULL = 0,         /* JPEG/JFIF（MJPEG 解码输出） */
+    YUV_BT601_LIMITED = 1,
+    YUV_BT709_FULL = 2,
+    YUV_BT709_LIMITED = 3,
+} yuv_color_space_t;
+
+/* 源图像描述 */
+typedef struct {
+    const uint8_t* y;
+    const uint8_t* uv;
+    int y_stride;
+    int uv_stride;
+    int width;
+    int height;
+    yuv_layout_t layout;
+    bool vu;                    /* 色度平面按 V、U 顺序交织（NV21/NV61） */
+} yuv_image_t;
+
+/* 定点系数（Q6），u/v 已减去 128 */
+typedef struct {
+    int16_t y_offset;           /* 限制范围为 16 */
+    int16_t y_coef;
+    int16_t r_v;
+    int16_t g_u;
+    int16_t g_v;
+    int16_t b_u;
+} yuv_coeffs_t;
+
+/* 多线程转换器 */
+typedef struct yuv_converter yuv_converter_t;
+
+/* 获取颜色空间对应的定点系数 */
+const yuv_coeffs_t* yuv_get_coeffs(yuv_color_space_t color_space);
+
+/* 单像素转换（检测流缩放等逐像素路径使用） */
+static inline void yuv_pixel_to_bgr(const yuv_coeffs_t* c, int y, int u, int v, uint8_t* px)
+{
+    int yy = (y > c->y_offset ? y - c->y_offset : 0) * c->y_coef;
+    int r = (yy + c->r_v * v + 32) >> 6;
+    int g = (yy - c->g_u * u - c->g_v * v + 32) >> 6;
+    int b = (yy + c->b_u * u + 32) >> 6;
+    px[0] = b < 0 ? 0 : (b > 255 ? 255 : b);
+    px[1] = g < 0 ? 0 : (g > 255 ? 255 : g);
+    px[2] = r < 0 ? 0 : (r > 255 ? 255 : r);
+}
+
+/* 取 (x, y) 处的 Y 和色度样本（u/v 未减 128，逐像素的缩放路径使用） */
+static inline void yuv_image_sample(const yuv_image_t* img, int x, int y, int* yv, int* u, int* v)
+{
+    if (img->layout == YUV_LAYOUT_YUYV) {
+        const uint8_t* p = img->y + (size_t)y * img->y_stride + (x & ~1) * 2;
+        *yv = p[(x & 1) * 2];
+        *u = p[1];
+        *v = p[3];
+        return;
+    }
+    
+    const uint8_t* uv = img->uv + (size_t)(img->layout == YUV_LAYOUT_420SP ? y >> 1 : y) * img->uv_stride + (x & ~1);
+    *yv = img->y[(size_t)y * img->y_stride + x];
+    *u = uv[img->vu];
+    *v = uv[!img->vu];
+}
+
+/**
+ * 转换 [row_begin, row_end) 行到 BGRA（单线程）
+ * @param src 源图像
+ * @param dst 目标 BGRA 图像首地址（第 0 行）
+ * @param dst_stride 目标行字节数
+ * @param color_space 颜色空间
+ */
+void yuv_to_bgra_rows(const yuv_image_t* src, uint8_t* dst, int dst_stride,
+                      yuv_color_space_t color_space, int row_begin, int row_end);
+
+/**
+ * 创建转换器
+ * @param threads 参与转换的线程总数（含调用线程），<=1 时不创建工作线程
+ * @return 转换器，失败返回 NULL
+ */
+yuv_converter_t* yuv_converter_create(int threads);
+
+/**
+ * 停止工作线程并销毁转换器
+ */
+void yuv_converter_destroy(yuv_converter_t* conv);
+
+/**
+ * 转换整幅图像到 BGRA，按行分块并行，返回时转换已完成
+ * @param conv 转换器，NULL 表示在调用线程中单线程转换
+ */
+void yuv_converter_to_bgra(yuv_converter_t* conv, const yuv_image_t* src, uint8_t* dst, int dst_stride,
+                           yuv_color_space_t color_space);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YUV_CONVERT_H */